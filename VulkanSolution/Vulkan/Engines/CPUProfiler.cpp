@@ -0,0 +1,205 @@
+/******************************************************************************
+Copyright (C) 2022 DigiPen Institute of Technology.
+Reproduction or disclosure of this file or its contents without the prior
+written consent of DigiPen Institute of Technology is prohibited.
+File Name:   CPUProfiler.cpp
+Author
+	- sinil.kang	rtd99062@gmail.com
+Creation Date: 12.24.2022
+	source file for scoped CPU profiling and its chrome trace export.
+******************************************************************************/
+#include "CPUProfiler.h"
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+
+namespace
+{
+	double GetMicroseconds(Timer::typeTimeStamp from, Timer::typeTimeStamp to)
+	{
+		return std::chrono::duration<double, std::micro>(to - from).count();
+	}
+
+	void WriteEscapedString(std::ofstream& file, const char* string)
+	{
+		file << '"';
+		for (const char* c = string; *c != '\0'; c++)
+		{
+			if (*c == '"' || *c == '\\')
+			{
+				file << '\\';
+			}
+			file << *c;
+		}
+		file << '"';
+	}
+}
+
+CPUProfiler::Scope::Scope(const char* _name)
+	: name(_name), start(), isRecorded(CPUProfiler::GetProfiler()->IsCapturing())
+{
+	if (isRecorded)
+	{
+		start = Timer::clock_t::now();
+	}
+}
+
+CPUProfiler::Scope::~Scope()
+{
+	if (isRecorded)
+	{
+		CPUProfiler::GetProfiler()->Push({ name, start, Timer::clock_t::now() });
+	}
+}
+
+CPUProfiler::CPUProfiler()
+	: isCapturing(false), threadBuffers(nullptr), threadCount(0), remainingFrames(0), capturedFrames(0), capturePath(), captureStart(), capturedEvents(), droppedCount(0)
+{
+}
+
+void CPUProfiler::RequestCapture(uint32_t frameCount, const std::string& path)
+{
+	if (isCapturing.load(std::memory_order_relaxed) || frameCount == 0)
+	{
+		return;
+	}
+
+	// Events left by the previous capture.
+	Drain(false);
+	capturedEvents.clear();
+	droppedCount = 0;
+	remainingFrames = frameCount;
+	capturedFrames = 0;
+	capturePath = path;
+	captureStart = Timer::clock_t::now();
+	isCapturing.store(true, std::memory_order_release);
+	std::cout << "Capturing " << frameCount << " frames of CPU trace..." << std::endl;
+}
+
+bool CPUProfiler::IsCapturing() const
+{
+	return isCapturing.load(std::memory_order_relaxed);
+}
+
+void CPUProfiler::EndFrame()
+{
+	GetThreadBuffer()->isMainThread = true;
+	if (isCapturing.load(std::memory_order_relaxed) == false)
+	{
+		return;
+	}
+
+	Drain(true);
+	capturedFrames++;
+	if (--remainingFrames > 0)
+	{
+		return;
+	}
+
+	// Scopes which are still open record their events later, and they are dropped by the next capture.
+	isCapturing.store(false, std::memory_order_relaxed);
+	if (WriteCapture())
+	{
+		std::cout << "CPU trace of " << capturedFrames << " frames is written to " << capturePath << std::endl;
+	}
+	if (droppedCount > 0)
+	{
+		std::cout << droppedCount << " events are dropped. Increase CPUProfiler::THREAD_BUFFER_CAPACITY." << std::endl;
+	}
+	capturedEvents.clear();
+	capturedEvents.shrink_to_fit();
+}
+
+CPUProfiler::ThreadBuffer* CPUProfiler::GetThreadBuffer()
+{
+	thread_local ThreadBuffer* threadBuffer = nullptr;
+	if (threadBuffer != nullptr)
+	{
+		return threadBuffer;
+	}
+
+	threadBuffer = new ThreadBuffer();
+	threadBuffer->threadID = threadCount.fetch_add(1, std::memory_order_relaxed);
+	threadBuffer->isMainThread = false;
+	threadBuffer->events.resize(THREAD_BUFFER_CAPACITY);
+	threadBuffer->writeIndex.store(0, std::memory_order_relaxed);
+	threadBuffer->readIndex.store(0, std::memory_order_relaxed);
+	threadBuffer->droppedCount.store(0, std::memory_order_relaxed);
+	threadBuffer->next = threadBuffers.load(std::memory_order_relaxed);
+	while (threadBuffers.compare_exchange_weak(threadBuffer->next, threadBuffer, std::memory_order_release, std::memory_order_relaxed) == false)
+	{
+	}
+
+	return threadBuffer;
+}
+
+void CPUProfiler::Push(const Event& event)
+{
+	ThreadBuffer* threadBuffer = GetThreadBuffer();
+	const uint64_t writeIndex = threadBuffer->writeIndex.load(std::memory_order_relaxed);
+	if (writeIndex - threadBuffer->readIndex.load(std::memory_order_acquire) >= THREAD_BUFFER_CAPACITY)
+	{
+		threadBuffer->droppedCount.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	threadBuffer->events[writeIndex % THREAD_BUFFER_CAPACITY] = event;
+	// The event is visible to the consumer before the index.
+	threadBuffer->writeIndex.store(writeIndex + 1, std::memory_order_release);
+}
+
+void CPUProfiler::Drain(bool isKept)
+{
+	for (ThreadBuffer* threadBuffer = threadBuffers.load(std::memory_order_acquire); threadBuffer != nullptr; threadBuffer = threadBuffer->next)
+	{
+		const uint64_t readIndex = threadBuffer->readIndex.load(std::memory_order_relaxed);
+		const uint64_t writeIndex = threadBuffer->writeIndex.load(std::memory_order_acquire);
+		if (isKept)
+		{
+			for (uint64_t i = readIndex; i < writeIndex; i++)
+			{
+				capturedEvents.push_back({ threadBuffer->events[i % THREAD_BUFFER_CAPACITY], threadBuffer->threadID });
+			}
+			droppedCount += threadBuffer->droppedCount.exchange(0, std::memory_order_relaxed);
+		}
+		else
+		{
+			threadBuffer->droppedCount.store(0, std::memory_order_relaxed);
+		}
+		// Slots are reused by the owner thread after this.
+		threadBuffer->readIndex.store(writeIndex, std::memory_order_release);
+	}
+}
+
+bool CPUProfiler::WriteCapture() const
+{
+	std::ofstream file(capturePath);
+	if (file.is_open() == false)
+	{
+		std::cout << "Failed to open " << capturePath << std::endl;
+		return false;
+	}
+
+	// Complete events, whose timestamps and durations are in microseconds since the capture is requested.
+	file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	// Default precision is 6 significant digits, which quantizes timestamps after a second and breaks the nesting of short scopes.
+	file << std::fixed << std::setprecision(3);
+	bool isFirst = true;
+	for (ThreadBuffer* threadBuffer = threadBuffers.load(std::memory_order_acquire); threadBuffer != nullptr; threadBuffer = threadBuffer->next)
+	{
+		file << (isFirst ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << threadBuffer->threadID << ",\"args\":{\"name\":\"";
+		file << (threadBuffer->isMainThread ? "Main thread" : "Worker thread ") << (threadBuffer->isMainThread ? "" : std::to_string(threadBuffer->threadID)) << "\"}}";
+		isFirst = false;
+	}
+	for (const CapturedEvent& capturedEvent : capturedEvents)
+	{
+		file << (isFirst ? "" : ",\n") << "{\"name\":";
+		WriteEscapedString(file, capturedEvent.event.name);
+		file << ",\"cat\":\"cpu\",\"ph\":\"X\",\"pid\":0,\"tid\":" << capturedEvent.threadID;
+		file << ",\"ts\":" << GetMicroseconds(captureStart, capturedEvent.event.start) << ",\"dur\":" << GetMicroseconds(capturedEvent.event.start, capturedEvent.event.end) << "}";
+		isFirst = false;
+	}
+	file << "\n]}\n";
+
+	return true;
+}
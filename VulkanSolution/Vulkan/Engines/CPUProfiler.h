@@ -0,0 +1,115 @@
+/******************************************************************************
+Copyright (C) 2022 DigiPen Institute of Technology.
+Reproduction or disclosure of this file or its contents without the prior
+written consent of DigiPen Institute of Technology is prohibited.
+File Name:   CPUProfiler.h
+Author
+	- sinil.kang	rtd99062@gmail.com
+Creation Date: 12.24.2022
+	header file for scoped CPU profiling and its chrome trace export.
+******************************************************************************/
+#pragma once
+#include <atomic>
+#include <vector>
+#include <string>
+#include <cstdint>
+#include "Timer.h"
+
+// Scopes are recorded only while a capture is running. Otherwise a scope costs one atomic load.
+// Each thread writes its own ring buffer, and the main thread drains every buffer at the end of each frame without locks.
+// Captured frames are written in the chrome trace event format, which is opened by chrome://tracing or Perfetto.
+class CPUProfiler
+{
+public:
+	// Events of a thread beyond this in one frame are dropped.
+	static constexpr uint32_t THREAD_BUFFER_CAPACITY = 1 << 14;
+	static constexpr uint32_t DEFAULT_CAPTURE_FRAMES = 60;
+	static constexpr const char* DEFAULT_CAPTURE_PATH = "cpuTrace.json";
+
+	// Record the enclosing scope. name should live until the capture is written, such as a string literal.
+	class Scope
+	{
+	public:
+		Scope(const char* name);
+		~Scope();
+	private:
+		const char* name;
+		Timer::typeTimeStamp start;
+		// False if no capture is running when the scope begins.
+		bool isRecorded;
+	};
+public:
+	static CPUProfiler* GetProfiler()
+	{
+		static CPUProfiler* profiler = new CPUProfiler();
+		return profiler;
+	}
+
+	// Capture the next frameCount frames, and write them to path. Ignored while a capture is running.
+	void RequestCapture(uint32_t frameCount, const std::string& path);
+	bool IsCapturing() const;
+	// Called by the main thread once per frame, after every scope of the frame.
+	void EndFrame();
+private:
+	struct Event
+	{
+		const char* name;
+		Timer::typeTimeStamp start;
+		Timer::typeTimeStamp end;
+	};
+	// Single producer, which is the owner thread, and single consumer, which is the thread calling EndFrame().
+	struct ThreadBuffer
+	{
+		uint32_t threadID;
+		bool isMainThread;
+		std::vector<Event> events;
+		// Written by the owner thread.
+		std::atomic<uint64_t> writeIndex;
+		// Written by the consumer.
+		std::atomic<uint64_t> readIndex;
+		std::atomic<uint64_t> droppedCount;
+		// Buffers are never removed, so the list is only pushed to.
+		ThreadBuffer* next;
+	};
+	struct CapturedEvent
+	{
+		Event event;
+		uint32_t threadID;
+	};
+
+	CPUProfiler();
+
+	// Registered on the first use of each thread.
+	ThreadBuffer* GetThreadBuffer();
+	void Push(const Event& event);
+	// Move events of every thread to capturedEvents, or drop them if isKept is false.
+	void Drain(bool isKept);
+	bool WriteCapture() const;
+
+	std::atomic<bool> isCapturing;
+	std::atomic<ThreadBuffer*> threadBuffers;
+	std::atomic<uint32_t> threadCount;
+
+	// Owned by the main thread.
+	uint32_t remainingFrames;
+	uint32_t capturedFrames;
+	std::string capturePath;
+	Timer::typeTimeStamp captureStart;
+	std::vector<CapturedEvent> capturedEvents;
+	uint64_t droppedCount;
+};
+
+// Instrumentation is compiled only if ENABLE_CPU_PROFILER is defined, which Debug configurations do.
+#ifdef ENABLE_CPU_PROFILER
+#define PROFILE_CONCATENATE_IMPLEMENTATION(a, b) a##b
+#define PROFILE_CONCATENATE(a, b) PROFILE_CONCATENATE_IMPLEMENTATION(a, b)
+#define PROFILE_SCOPE(name) CPUProfiler::Scope PROFILE_CONCATENATE(profileScope, __LINE__)(name)
+#define PROFILE_FUNCTION() PROFILE_SCOPE(__FUNCTION__)
+#define PROFILE_END_FRAME() CPUProfiler::GetProfiler()->EndFrame()
+#define PROFILE_CAPTURE(frameCount, path) CPUProfiler::GetProfiler()->RequestCapture(frameCount, path)
+#else
+#define PROFILE_SCOPE(name)
+#define PROFILE_FUNCTION()
+#define PROFILE_END_FRAME()
+#define PROFILE_CAPTURE(frameCount, path)
+#endif
@@ -12,6 +12,11 @@ Creation Date: 06.08.2021
 #define _CRT_SECURE_NO_WARNINGS
 #include <string>
 #include <iostream>
+#include <fstream>
+#include <vector>
+#include <algorithm>
+#include <numeric>
+#include <array>
 
 #include "Engine.h"
 #include "Engines/Window.h"
@@ -21,6 +26,7 @@ Creation Date: 06.08.2021
 #include "vulkan/vulkan_core.h"
 #include "ImGUI/myGUI.h"
 #include "Input/Input.h"
+#include "CPUProfiler.h"
 
 Engine::Engine()
 	: isUpdate(true), window(new Window()), scene(new MyScene(window)), graphics(new Graphics())
@@ -61,6 +67,7 @@ bool Engine::Init()
 
 void Engine::Update()
 {
+	PROFILE_FUNCTION();
 
 	// Calculate dt, and FPS to show up on window's title bar
 	Timer* timer = Timer::GetTimer();
@@ -78,6 +85,12 @@ void Engine::Update()
 	input.Update(dt);
 	window->PollWindowEvents();
 
+	// Chrome trace of the next frames.
+	if (input.IsKeyTriggered(GLFW_KEY_F9))
+	{
+		PROFILE_CAPTURE(CPUProfiler::DEFAULT_CAPTURE_FRAMES, CPUProfiler::DEFAULT_CAPTURE_PATH);
+	}
+
 	if (window->IsPathDropped())
 	{
 		scene->LoadNewModel();
@@ -108,3 +121,149 @@ bool Engine::IsUpdate()
 {
 	return isUpdate && (!window->ShouldWindowClose());
 }
+
+namespace
+{
+	void PrintFrameTimeStatistics(const char* name, std::vector<double> milliseconds)
+	{
+		if (milliseconds.empty())
+		{
+			std::cout << name << " : not measured" << std::endl;
+			return;
+		}
+
+		std::sort(milliseconds.begin(), milliseconds.end());
+		const double average = std::accumulate(milliseconds.begin(), milliseconds.end(), 0.0) / milliseconds.size();
+		const double percentile95 = milliseconds[std::min(milliseconds.size() - 1, (milliseconds.size() * 95) / 100)];
+		std::cout << name << " (ms) : avg " << average << ", min " << milliseconds.front() << ", max " << milliseconds.back() << ", p95 " << percentile95 << std::endl;
+	}
+}
+
+bool Engine::RunHeadless(const HeadlessSettings& settings)
+{
+	if (graphics->InitVulkanHeadless("Sinil's Hello Vulkan", VK_MAKE_VERSION(1, 0, 0), { settings.width, settings.height }, settings.deviceName) == false)
+	{
+		std::cout << "Init Graphics resources(Vulkan) has Failed!" << std::endl;
+		return false;
+	}
+
+	if (scene->InitScene(graphics) == false)
+	{
+		std::cout << "Init Scene information has Failed!" << std::endl;
+		graphics->CleanVulkan();
+		return false;
+	}
+
+	// Fixed delta time, so every run animates the same frames.
+	constexpr float dt = 1.f / 60.f;
+	std::vector<double> cpuMilliseconds;
+	// GPU time of each region. Negative if it is not measured.
+	std::array<double, GPUProfiler::REGION_COUNT> unmeasured;
+	unmeasured.fill(-1.0);
+	std::vector<std::array<double, GPUProfiler::REGION_COUNT>> gpuMilliseconds(settings.frameCount, unmeasured);
+	GPUProfiler& gpuProfiler = graphics->GetGPUProfiler();
+	const auto collectGPUTimes = [&]()
+	{
+		for (const GPUProfiler::FrameResult& frameResult : gpuProfiler.GetHistory())
+		{
+			if (frameResult.frame < gpuMilliseconds.size())
+			{
+				gpuMilliseconds[frameResult.frame] = frameResult.milliseconds;
+			}
+		}
+		gpuProfiler.ClearHistory();
+	};
+
+	for (uint32_t i = 0; i < settings.frameCount; i++)
+	{
+		const Timer::typeTimeStamp start = Timer::clock_t::now();
+		if (graphics->StartDrawing())
+		{
+			scene->DrawFrame(dt, graphics->GetCommandBuffer(), graphics->GetCurrentFrameID());
+			graphics->EndDrawing();
+		}
+		cpuMilliseconds.push_back(std::chrono::duration<double, std::milli>(Timer::clock_t::now() - start).count());
+
+		collectGPUTimes();
+	}
+	// Frames still in flight.
+	graphics->DeviceWaitIdle();
+	gpuProfiler.ReadAllResults();
+	collectGPUTimes();
+
+	std::cout << "Device : " << graphics->GetDeviceName() << std::endl;
+	std::cout << "Frames : " << settings.frameCount << ", " << settings.width << "x" << settings.height << std::endl;
+	PrintFrameTimeStatistics("CPU frame time", cpuMilliseconds);
+	for (uint32_t region = 0; region < GPUProfiler::REGION_COUNT; region++)
+	{
+		std::vector<double> measuredMilliseconds;
+		for (const std::array<double, GPUProfiler::REGION_COUNT>& milliseconds : gpuMilliseconds)
+		{
+			if (milliseconds[region] >= 0.0)
+			{
+				measuredMilliseconds.push_back(milliseconds[region]);
+			}
+		}
+		const std::string name = std::string("GPU ") + GPUProfiler::GetRegionName(static_cast<GPUProfiler::Region>(region)) + " time";
+		PrintFrameTimeStatistics(name.c_str(), measuredMilliseconds);
+	}
+
+	bool isSucceed = true;
+	if (settings.timingPath.empty() == false)
+	{
+		std::ofstream timingFile(settings.timingPath);
+		if (timingFile.is_open() == false)
+		{
+			std::cout << "Failed to open " << settings.timingPath << std::endl;
+			isSucceed = false;
+		}
+		else
+		{
+			// Empty GPU cell if the region is not measured in the frame.
+			timingFile << "frame,cpuMilliseconds";
+			for (uint32_t region = 0; region < GPUProfiler::REGION_COUNT; region++)
+			{
+				timingFile << ",gpu " << GPUProfiler::GetRegionName(static_cast<GPUProfiler::Region>(region));
+			}
+			timingFile << '\n';
+			for (uint32_t i = 0; i < settings.frameCount; i++)
+			{
+				timingFile << i << ',' << cpuMilliseconds[i];
+				for (double milliseconds : gpuMilliseconds[i])
+				{
+					timingFile << ',';
+					if (milliseconds >= 0.0)
+					{
+						timingFile << milliseconds;
+					}
+				}
+				timingFile << '\n';
+			}
+		}
+	}
+
+	if (settings.imagePath.empty() == false)
+	{
+		std::vector<uint8_t> pixels;
+		std::ofstream imageFile(settings.imagePath, std::ios::binary);
+		if (imageFile.is_open() == false || graphics->ReadOffscreenImage(pixels) == false)
+		{
+			std::cout << "Failed to write " << settings.imagePath << std::endl;
+			isSucceed = false;
+		}
+		else
+		{
+			// Binary PPM has no alpha channel.
+			imageFile << "P6\n" << settings.width << ' ' << settings.height << "\n255\n";
+			for (size_t i = 0; i < pixels.size(); i += 4)
+			{
+				imageFile.write(reinterpret_cast<const char*>(&pixels[i]), 3);
+			}
+		}
+	}
+
+	scene->CleanScene();
+	graphics->CleanVulkan();
+
+	return isSucceed;
+}
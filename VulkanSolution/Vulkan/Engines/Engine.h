@@ -9,11 +9,27 @@ Creation Date: 06.08.2021
 	header file for engine.
 ******************************************************************************/
 #pragma once
+#include <string>
+#include <cstdint>
 
 class Window;
 class MyScene;
 class Graphics;
 
+// Settings of a headless run, which renders the default scene offscreen for a fixed number of frames.
+struct HeadlessSettings
+{
+	uint32_t frameCount = 300;
+	uint32_t width = 800;
+	uint32_t height = 600;
+	// CSV of the CPU time and the GPU time of each profiled region of every frame. Not written if empty.
+	std::string timingPath;
+	// PPM of the last frame. Not written if empty.
+	std::string imagePath;
+	// Device whose name contains this is chosen first.
+	std::string deviceName;
+};
+
 class Engine
 {
 public:
@@ -27,6 +43,10 @@ public:
 
 	bool IsUpdate();
 
+	// Run without a window, with a fixed delta time, and print the frame time statistics.
+		// Init(), Update() and Clean() should not be called. Return whether it is succeed or not.
+	bool RunHeadless(const HeadlessSettings& settings);
+
 private:
 	bool isUpdate;
 	Window* window;
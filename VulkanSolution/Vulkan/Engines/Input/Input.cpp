@@ -12,6 +12,7 @@ Creation date: 9/25/2021
 End Header --------------------------------------------------------*/
 
 #include "Input.h"
+#include "Engines/CPUProfiler.h"
 #include <chrono>
 
 Input input;
@@ -28,6 +29,7 @@ Input::Input()
 
 void Input::Update(float dt)
 {
+	PROFILE_FUNCTION();
 	input.TriggeredReset();
 	input.SetPresentMousePosition(input.GetMousePosition());
 }
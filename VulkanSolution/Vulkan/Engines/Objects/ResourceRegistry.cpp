@@ -0,0 +1,101 @@
+/******************************************************************************
+Copyright (C) 2022 DigiPen Institute of Technology.
+Reproduction or disclosure of this file or its contents without the prior
+written consent of DigiPen Institute of Technology is prohibited.
+File Name:   ResourceRegistry.cpp
+Author
+	- sinil.kang	rtd99062@gmail.com
+Creation Date: 12.23.2022
+	source file for resource registry which owns objects and hands out handles.
+******************************************************************************/
+#include "ResourceRegistry.h"
+#include <cassert>
+#include <iostream>
+
+ResourceRegistry::ResourceRegistry()
+{
+}
+
+ResourceRegistry::~ResourceRegistry()
+{
+	Clear();
+}
+
+void ResourceRegistry::Clear()
+{
+	for (Slot& slot : slots)
+	{
+		delete slot.object;
+		slot.object = nullptr;
+	}
+	slots.clear();
+	freeSlots.clear();
+	indexByName.clear();
+}
+
+Object* ResourceRegistry::FindObjectByName(const std::string& name) const
+{
+	if (auto iter = indexByName.find(name);
+		iter != indexByName.end())
+	{
+		return slots[iter->second].object;
+	}
+	return nullptr;
+}
+
+size_t ResourceRegistry::GetObjectCount() const
+{
+	return slots.size() - freeSlots.size();
+}
+
+uint32_t ResourceRegistry::AddObject(Object* object)
+{
+	uint32_t index;
+	if (freeSlots.empty() == false)
+	{
+		index = freeSlots.back();
+		freeSlots.pop_back();
+		slots[index].object = object;
+	}
+	else
+	{
+		index = static_cast<uint32_t>(slots.size());
+		slots.push_back({ object, 0 });
+	}
+	// Names are keys of FindObjectByName(), so a duplicate would hide the older object.
+	const bool isNameUnique = indexByName.emplace(object->GetName(), index).second;
+	if (isNameUnique == false)
+	{
+		std::cout << "Resource name " << object->GetName() << " is already registered!" << std::endl;
+	}
+	assert(isNameUnique && "Resource names should be unique.");
+	return index;
+}
+
+Object* ResourceRegistry::GetSlotObject(uint32_t index, uint32_t generation) const
+{
+	if (index >= slots.size() || slots[index].generation != generation)
+	{
+		return nullptr;
+	}
+	return slots[index].object;
+}
+
+void ResourceRegistry::RemoveObject(uint32_t index, uint32_t generation)
+{
+	Object* object = GetSlotObject(index, generation);
+	if (object == nullptr)
+	{
+		return;
+	}
+
+	if (auto iter = indexByName.find(object->GetName());
+		iter != indexByName.end() && iter->second == index)
+	{
+		indexByName.erase(iter);
+	}
+	delete object;
+	slots[index].object = nullptr;
+	slots[index].generation++;
+	freeSlots.push_back(index);
+}
@@ -0,0 +1,93 @@
+/******************************************************************************
+Copyright (C) 2022 DigiPen Institute of Technology.
+Reproduction or disclosure of this file or its contents without the prior
+written consent of DigiPen Institute of Technology is prohibited.
+File Name:   ResourceRegistry.h
+Author
+	- sinil.kang	rtd99062@gmail.com
+Creation Date: 12.23.2022
+	header file for resource registry which owns objects and hands out handles.
+******************************************************************************/
+#pragma once
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <cstdint>
+#include <Engines/Objects/Object.h>
+
+// Typed handle of an object in ResourceRegistry.
+// Generation is bumped whenever a slot is reused, so a handle of a removed object never points to a new one.
+template<typename T>
+struct ResourceHandle
+{
+	static constexpr uint32_t INVALID_INDEX = UINT32_MAX;
+
+	uint32_t index = INVALID_INDEX;
+	uint32_t generation = 0;
+
+	bool IsValid() const
+	{
+		return index != INVALID_INDEX;
+	}
+};
+
+// Owns graphic resources.
+// Get() is an array access, so it can be used in the frame loop.
+// FindObjectByName() is only for tooling and debugging.
+class ResourceRegistry
+{
+public:
+	ResourceRegistry();
+	~ResourceRegistry();
+
+	template<typename T>
+	ResourceHandle<T> Add(T* object);
+	template<typename T>
+	T* Get(ResourceHandle<T> handle) const;
+	// Delete the object and invalidate the handle.
+	template<typename T>
+	void Remove(ResourceHandle<T>& handle);
+	// Delete every object.
+	void Clear();
+
+	// Names should be unique. Adding a duplicate name asserts, and the name keeps referring to the older object.
+	Object* FindObjectByName(const std::string& name) const;
+	size_t GetObjectCount() const;
+private:
+	struct Slot
+	{
+		Object* object;
+		uint32_t generation;
+	};
+
+	uint32_t AddObject(Object* object);
+	Object* GetSlotObject(uint32_t index, uint32_t generation) const;
+	void RemoveObject(uint32_t index, uint32_t generation);
+
+	std::vector<Slot> slots;
+	std::vector<uint32_t> freeSlots;
+	std::unordered_map<std::string, uint32_t> indexByName;
+};
+
+template<typename T>
+ResourceHandle<T> ResourceRegistry::Add(T* object)
+{
+	ResourceHandle<T> handle;
+	handle.index = AddObject(object);
+	handle.generation = slots[handle.index].generation;
+	return handle;
+}
+
+template<typename T>
+T* ResourceRegistry::Get(ResourceHandle<T> handle) const
+{
+	// Type is fixed when the handle is made by Add(), so dynamic_cast is not necessary.
+	return static_cast<T*>(GetSlotObject(handle.index, handle.generation));
+}
+
+template<typename T>
+void ResourceRegistry::Remove(ResourceHandle<T>& handle)
+{
+	RemoveObject(handle.index, handle.generation);
+	handle = ResourceHandle<T>();
+}
@@ -0,0 +1,169 @@
+/******************************************************************************
+Copyright (C) 2022 DigiPen Institute of Technology.
+Reproduction or disclosure of this file or its contents without the prior
+written consent of DigiPen Institute of Technology is prohibited.
+File Name:   DescriptorAllocator.cpp
+Author
+	- sinil.kang	rtd99062@gmail.com
+Creation Date: 12.24.2022
+	source file for growable descriptor set allocator.
+******************************************************************************/
+#include <iostream>
+#include <array>
+#include "DescriptorAllocator.h"
+#include <Helper/VulkanHelper.h>
+
+namespace
+{
+	// Descriptors of each type per set in a pool, close to what the scenes of this project use.
+	struct PoolRatio
+	{
+		VkDescriptorType type;
+		uint32_t countPerSet;
+	};
+	constexpr std::array<PoolRatio, 6> POOL_RATIOS = { {
+		{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 4 },
+		{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 2 },
+		{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 4 },
+		{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2 },
+		{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, 1 },
+		{ VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1 },
+	} };
+}
+
+DescriptorAllocator::DescriptorAllocator()
+	: device(VK_NULL_HANDLE), pools(), mutex()
+{
+}
+
+DescriptorAllocator::~DescriptorAllocator()
+{
+}
+
+void DescriptorAllocator::Init(VkDevice _device)
+{
+	device = _device;
+}
+
+void DescriptorAllocator::Clean()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	for (Pool& pool : pools)
+	{
+		if (pool.allocationCount > 0)
+		{
+			std::cout << "Descriptor pool is destroyed with " << pool.allocationCount << " sets not freed!" << std::endl;
+		}
+		vkDestroyDescriptorPool(device, pool.descriptorPool, nullptr);
+	}
+	pools.clear();
+}
+
+bool DescriptorAllocator::Allocate(VkDescriptorSetLayout layout, DescriptorAllocation& allocation)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	for (uint32_t i = 0; i < static_cast<uint32_t>(pools.size()); i++)
+	{
+		Pool& pool = pools[i];
+		if (pool.isFull)
+		{
+			continue;
+		}
+
+		const VkResult result = AllocateFromPool(pool, layout, allocation.descriptorSet);
+		if (result == VK_SUCCESS)
+		{
+			allocation.poolIndex = i;
+			return true;
+		}
+		if (result != VK_ERROR_OUT_OF_POOL_MEMORY && result != VK_ERROR_FRAGMENTED_POOL)
+		{
+			VulkanHelper::VkCheck(result, "Allocating descriptor sets has failed!");
+			return false;
+		}
+		pool.isFull = true;
+	}
+
+	const uint32_t poolIndex = CreatePool();
+	if (poolIndex == UINT32_MAX)
+	{
+		return false;
+	}
+	if (AllocateFromPool(pools[poolIndex], layout, allocation.descriptorSet) != VK_SUCCESS)
+	{
+		// Another pool would fail in the same way.
+		std::cout << "Descriptor set layout needs more descriptors than a pool has!" << std::endl;
+		return false;
+	}
+	allocation.poolIndex = poolIndex;
+	return true;
+}
+
+void DescriptorAllocator::Free(DescriptorAllocation& allocation)
+{
+	if (allocation.IsValid() == false)
+	{
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	Pool& pool = pools[allocation.poolIndex];
+	pool.allocationCount--;
+	if (pool.allocationCount == 0)
+	{
+		vkResetDescriptorPool(device, pool.descriptorPool, 0);
+		pool.isFull = false;
+	}
+	allocation = DescriptorAllocation();
+}
+
+uint32_t DescriptorAllocator::GetPoolCount()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	return static_cast<uint32_t>(pools.size());
+}
+
+uint32_t DescriptorAllocator::CreatePool()
+{
+	std::array<VkDescriptorPoolSize, POOL_RATIOS.size()> poolSizes;
+	for (size_t i = 0; i < POOL_RATIOS.size(); i++)
+	{
+		poolSizes[i].type = POOL_RATIOS[i].type;
+		poolSizes[i].descriptorCount = POOL_RATIOS[i].countPerSet * SETS_PER_POOL;
+	}
+
+	VkDescriptorPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+	poolInfo.pPoolSizes = poolSizes.data();
+	poolInfo.maxSets = SETS_PER_POOL;
+
+	Pool pool;
+	if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &pool.descriptorPool) != VK_SUCCESS)
+	{
+		std::cout << "Creating descriptor pool has failed!" << std::endl;
+		return UINT32_MAX;
+	}
+	pools.push_back(pool);
+	return static_cast<uint32_t>(pools.size() - 1);
+}
+
+VkResult DescriptorAllocator::AllocateFromPool(Pool& pool, VkDescriptorSetLayout layout, VkDescriptorSet& descriptorSet)
+{
+	VkDescriptorSetAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool = pool.descriptorPool;
+	allocInfo.descriptorSetCount = 1;
+	allocInfo.pSetLayouts = &layout;
+
+	const VkResult result = vkAllocateDescriptorSets(device, &allocInfo, &descriptorSet);
+	if (result == VK_SUCCESS)
+	{
+		pool.allocationCount++;
+	}
+	return result;
+}
@@ -0,0 +1,66 @@
+/******************************************************************************
+Copyright (C) 2022 DigiPen Institute of Technology.
+Reproduction or disclosure of this file or its contents without the prior
+written consent of DigiPen Institute of Technology is prohibited.
+File Name:   DescriptorAllocator.h
+Author
+	- sinil.kang	rtd99062@gmail.com
+Creation Date: 12.24.2022
+	header file for growable descriptor set allocator.
+******************************************************************************/
+#pragma once
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <mutex>
+#include <cstdint>
+
+// A descriptor set given by DescriptorAllocator.
+struct DescriptorAllocation
+{
+	VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+	uint32_t poolIndex = UINT32_MAX;
+
+	bool IsValid() const
+	{
+		return descriptorSet != VK_NULL_HANDLE;
+	}
+};
+
+// Descriptor sets of any layout are allocated from shared pools, and a new pool is added when every pool is full.
+// Pools are created without VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT, so drivers can allocate linearly.
+	// Freed sets are not reused one by one. A pool is reset as a whole when every set in it is freed.
+class DescriptorAllocator
+{
+public:
+	static constexpr uint32_t SETS_PER_POOL = 64;
+public:
+	DescriptorAllocator();
+	~DescriptorAllocator();
+
+	void Init(VkDevice device);
+	// Every allocation should be freed already.
+	void Clean();
+
+	// Return false if the layout does not fit in an empty pool, or the driver is out of memory.
+	bool Allocate(VkDescriptorSetLayout layout, DescriptorAllocation& allocation);
+	void Free(DescriptorAllocation& allocation);
+
+	uint32_t GetPoolCount();
+private:
+	struct Pool
+	{
+		VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+		uint32_t allocationCount = 0;
+		// Set when an allocation has failed, and cleared when the pool is reset.
+		bool isFull = false;
+	};
+
+	// Return index of a new pool, UINT32_MAX if vkCreateDescriptorPool has failed.
+	uint32_t CreatePool();
+	// VK_ERROR_OUT_OF_POOL_MEMORY and VK_ERROR_FRAGMENTED_POOL are expected, so they are not checked.
+	VkResult AllocateFromPool(Pool& pool, VkDescriptorSetLayout layout, VkDescriptorSet& descriptorSet);
+
+	VkDevice device;
+	std::vector<Pool> pools;
+	std::mutex mutex;
+};
@@ -0,0 +1,478 @@
+/******************************************************************************
+Copyright (C) 2022 DigiPen Institute of Technology.
+Reproduction or disclosure of this file or its contents without the prior
+written consent of DigiPen Institute of Technology is prohibited.
+File Name:   MemoryAllocator.cpp
+Author
+	- sinil.kang	rtd99062@gmail.com
+Creation Date: 12.24.2022
+	source file for device memory sub-allocator.
+******************************************************************************/
+#include <iostream>
+#include <algorithm>
+#include "MemoryAllocator.h"
+
+namespace
+{
+	// Long lived buffers, long lived optimal images, staging buffers
+	constexpr uint32_t POOL_KIND_COUNT = 3;
+
+	VkDeviceSize AlignUp(VkDeviceSize value, VkDeviceSize alignment)
+	{
+		return (value + alignment - 1) / alignment * alignment;
+	}
+}
+
+DeviceMemoryAllocator::DeviceMemoryAllocator()
+	: device(VK_NULL_HANDLE), memoryProperties(), maxMemoryAllocationCount(), deviceMemoryCount(), pools(), mutex()
+{
+}
+
+DeviceMemoryAllocator::~DeviceMemoryAllocator()
+{
+}
+
+void DeviceMemoryAllocator::Init(VkPhysicalDevice physicalDevice, VkDevice _device)
+{
+	device = _device;
+	vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+	maxMemoryAllocationCount = properties.limits.maxMemoryAllocationCount;
+
+	pools.resize(memoryProperties.memoryTypeCount * POOL_KIND_COUNT);
+	for (uint32_t memoryTypeIndex = 0; memoryTypeIndex < memoryProperties.memoryTypeCount; memoryTypeIndex++)
+	{
+		const VkMemoryType& memoryType = memoryProperties.memoryTypes[memoryTypeIndex];
+		const VkDeviceSize heapSize = memoryProperties.memoryHeaps[memoryType.heapIndex].size;
+
+		for (uint32_t kind = 0; kind < POOL_KIND_COUNT; kind++)
+		{
+			Pool& pool = pools[memoryTypeIndex * POOL_KIND_COUNT + kind];
+			pool.memoryTypeIndex = memoryTypeIndex;
+			pool.isLinear = (kind == POOL_KIND_COUNT - 1);
+			pool.isHostVisible = (memoryType.propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) != 0;
+			pool.blockSize = pool.isLinear ? STAGING_BLOCK_SIZE : LONG_LIVED_BLOCK_SIZE;
+			// Small heaps (e.g. 256MB BAR memory) should not be taken by a few blocks.
+				// Halving keeps the size a power of two, which buddy blocks need.
+			while (pool.blockSize > heapSize / 8 && pool.blockSize > MIN_NODE_SIZE)
+			{
+				pool.blockSize /= 2;
+			}
+		}
+	}
+}
+
+void DeviceMemoryAllocator::Clean()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	for (Pool& pool : pools)
+	{
+		for (Block& block : pool.blocks)
+		{
+			if (block.allocationCount > 0)
+			{
+				std::cout << "Device memory block is destroyed with " << block.allocationCount << " live allocations!" << std::endl;
+			}
+			DestroyBlock(block);
+		}
+		if (pool.dedicatedCount > 0)
+		{
+			std::cout << pool.dedicatedCount << " dedicated device memory allocations are not freed!" << std::endl;
+		}
+	}
+	pools.clear();
+	deviceMemoryCount = 0;
+}
+
+bool DeviceMemoryAllocator::Allocate(const VkMemoryRequirements& memoryRequirements, VkMemoryPropertyFlags properties, MemoryResourceType resourceType, MemoryLifetime lifetime, MemoryAllocation& allocation)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	const uint32_t memoryTypeIndex = FindMemoryTypeIndex(memoryRequirements.memoryTypeBits, properties);
+	if (memoryTypeIndex == UINT32_MAX)
+	{
+		std::cout << "Failed to find suitable memory type!" << std::endl;
+		return false;
+	}
+
+	const uint32_t poolIndex = GetPoolIndex(memoryTypeIndex, resourceType, lifetime);
+	Pool& pool = pools[poolIndex];
+	const VkDeviceSize alignment = std::max<VkDeviceSize>(memoryRequirements.alignment, 1);
+
+	allocation = MemoryAllocation();
+	allocation.poolIndex = poolIndex;
+
+	// A resource larger than half of a block would waste most of the block.
+	if (memoryRequirements.size > pool.blockSize / 2)
+	{
+		return AllocateDedicated(pool, memoryRequirements.size, allocation);
+	}
+
+	VkDeviceSize offset = 0;
+	VkDeviceSize size = memoryRequirements.size;
+	uint32_t blockIndex = UINT32_MAX;
+	for (uint32_t i = 0; i < pool.blocks.size() && blockIndex == UINT32_MAX; i++)
+	{
+		Block& block = pool.blocks[i];
+		if (block.memory == VK_NULL_HANDLE)
+		{
+			continue;
+		}
+		const bool succeed = pool.isLinear ?
+			AllocateLinear(block, memoryRequirements.size, alignment, offset) :
+			AllocateBuddy(block, memoryRequirements.size, alignment, offset, size);
+		if (succeed)
+		{
+			blockIndex = i;
+		}
+	}
+
+	if (blockIndex == UINT32_MAX)
+	{
+		blockIndex = CreateBlock(pool);
+		if (blockIndex == UINT32_MAX)
+		{
+			return false;
+		}
+		Block& block = pool.blocks[blockIndex];
+		if (pool.isLinear)
+		{
+			AllocateLinear(block, memoryRequirements.size, alignment, offset);
+		}
+		else
+		{
+			AllocateBuddy(block, memoryRequirements.size, alignment, offset, size);
+		}
+	}
+
+	Block& block = pool.blocks[blockIndex];
+	block.usedBytes += size;
+	block.allocationCount++;
+
+	allocation.memory = block.memory;
+	allocation.offset = offset;
+	allocation.size = size;
+	allocation.mappedData = (block.mappedData != nullptr) ? block.mappedData + offset : nullptr;
+	allocation.blockIndex = blockIndex;
+	return true;
+}
+
+void DeviceMemoryAllocator::Free(MemoryAllocation& allocation)
+{
+	if (allocation.IsValid() == false)
+	{
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	Pool& pool = pools[allocation.poolIndex];
+	if (allocation.blockIndex == UINT32_MAX)
+	{
+		vkFreeMemory(device, allocation.memory, nullptr);
+		pool.dedicatedCount--;
+		pool.dedicatedBytes -= allocation.size;
+		deviceMemoryCount--;
+		allocation = MemoryAllocation();
+		return;
+	}
+
+	Block& block = pool.blocks[allocation.blockIndex];
+	if (pool.isLinear == false)
+	{
+		FreeBuddy(block, allocation.offset);
+	}
+	block.usedBytes -= allocation.size;
+	block.allocationCount--;
+
+	if (block.allocationCount == 0)
+	{
+		block.head = 0;
+
+		// Keep one empty block per pool, so allocating and freeing a resource every frame does not hit the driver.
+		const bool hasOtherBlock = std::any_of(pool.blocks.begin(), pool.blocks.end(),
+			[&block](const Block& other) { return &other != &block && other.memory != VK_NULL_HANDLE; });
+		if (hasOtherBlock)
+		{
+			DestroyBlock(block);
+		}
+	}
+	allocation = MemoryAllocation();
+}
+
+MemoryStatistics DeviceMemoryAllocator::GetStatistics()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	MemoryStatistics statistics;
+	// Sum of the largest free range of each block. Fragmentation is measured per block,
+		// since free memory of different blocks can never be one range anyway.
+	VkDeviceSize largestFreeSum = 0;
+	for (const Pool& pool : pools)
+	{
+		statistics.dedicatedCount += pool.dedicatedCount;
+		statistics.allocationCount += pool.dedicatedCount;
+		statistics.reservedBytes += pool.dedicatedBytes;
+		statistics.usedBytes += pool.dedicatedBytes;
+
+		for (const Block& block : pool.blocks)
+		{
+			if (block.memory == VK_NULL_HANDLE)
+			{
+				continue;
+			}
+			statistics.blockCount++;
+			statistics.allocationCount += block.allocationCount;
+			statistics.reservedBytes += block.size;
+			statistics.usedBytes += block.usedBytes;
+
+			const VkDeviceSize freeBytes = pool.isLinear ? block.size - block.head : block.size - block.usedBytes;
+			const VkDeviceSize largestFree = pool.isLinear ? freeBytes : GetLargestFreeNode(block);
+			statistics.freeBytes += freeBytes;
+			statistics.largestFreeRange = std::max(statistics.largestFreeRange, largestFree);
+			largestFreeSum += largestFree;
+		}
+	}
+
+	if (statistics.freeBytes > 0)
+	{
+		statistics.fragmentation = 1.f - static_cast<float>(largestFreeSum) / static_cast<float>(statistics.freeBytes);
+	}
+	return statistics;
+}
+
+uint32_t DeviceMemoryAllocator::GetMaxMemoryAllocationCount() const
+{
+	return maxMemoryAllocationCount;
+}
+
+uint32_t DeviceMemoryAllocator::FindMemoryTypeIndex(uint32_t memoryTypeBits, VkMemoryPropertyFlags properties) const
+{
+	for (uint32_t memoryTypeIndex = 0; memoryTypeIndex < memoryProperties.memoryTypeCount; memoryTypeIndex++)
+	{
+		if ((memoryTypeBits & (1 << memoryTypeIndex)) &&
+			(memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags & properties) == properties)
+		{
+			return memoryTypeIndex;
+		}
+	}
+	return UINT32_MAX;
+}
+
+uint32_t DeviceMemoryAllocator::GetPoolIndex(uint32_t memoryTypeIndex, MemoryResourceType resourceType, MemoryLifetime lifetime) const
+{
+	uint32_t kind = 0;
+	if (resourceType == MemoryResourceType::OptimalImage)
+	{
+		kind = 1;
+	}
+	else if (lifetime == MemoryLifetime::Staging)
+	{
+		kind = 2;
+	}
+	return memoryTypeIndex * POOL_KIND_COUNT + kind;
+}
+
+bool DeviceMemoryAllocator::AllocateDedicated(Pool& pool, VkDeviceSize size, MemoryAllocation& allocation)
+{
+	if (deviceMemoryCount >= maxMemoryAllocationCount)
+	{
+		std::cout << "maxMemoryAllocationCount(" << maxMemoryAllocationCount << ") is reached!" << std::endl;
+	}
+
+	VkMemoryAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocInfo.allocationSize = size;
+	allocInfo.memoryTypeIndex = pool.memoryTypeIndex;
+
+	VkDeviceMemory memory;
+	if (vkAllocateMemory(device, &allocInfo, nullptr, &memory) != VK_SUCCESS)
+	{
+		std::cout << "Allocating dedicated device memory has failed!" << std::endl;
+		return false;
+	}
+
+	void* mappedData = nullptr;
+	if (pool.isHostVisible)
+	{
+		vkMapMemory(device, memory, 0, VK_WHOLE_SIZE, 0, &mappedData);
+	}
+
+	pool.dedicatedCount++;
+	pool.dedicatedBytes += size;
+	deviceMemoryCount++;
+
+	allocation.memory = memory;
+	allocation.offset = 0;
+	allocation.size = size;
+	allocation.mappedData = mappedData;
+	allocation.blockIndex = UINT32_MAX;
+	return true;
+}
+
+uint32_t DeviceMemoryAllocator::CreateBlock(Pool& pool)
+{
+	if (deviceMemoryCount >= maxMemoryAllocationCount)
+	{
+		std::cout << "maxMemoryAllocationCount(" << maxMemoryAllocationCount << ") is reached!" << std::endl;
+	}
+
+	VkMemoryAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocInfo.allocationSize = pool.blockSize;
+	allocInfo.memoryTypeIndex = pool.memoryTypeIndex;
+
+	VkDeviceMemory memory;
+	if (vkAllocateMemory(device, &allocInfo, nullptr, &memory) != VK_SUCCESS)
+	{
+		std::cout << "Allocating device memory block has failed!" << std::endl;
+		return UINT32_MAX;
+	}
+	deviceMemoryCount++;
+
+	// Reuse a slot of a destroyed block.
+	uint32_t blockIndex = 0;
+	while (blockIndex < pool.blocks.size() && pool.blocks[blockIndex].memory != VK_NULL_HANDLE)
+	{
+		blockIndex++;
+	}
+	if (blockIndex == pool.blocks.size())
+	{
+		pool.blocks.emplace_back();
+	}
+
+	Block& block = pool.blocks[blockIndex];
+	block = Block();
+	block.memory = memory;
+	block.size = pool.blockSize;
+	if (pool.isHostVisible)
+	{
+		// Host visible blocks are mapped while they live. Allocations get a pointer into it.
+		void* mappedData;
+		vkMapMemory(device, memory, 0, VK_WHOLE_SIZE, 0, &mappedData);
+		block.mappedData = static_cast<char*>(mappedData);
+	}
+	if (pool.isLinear == false)
+	{
+		const uint32_t maxOrder = GetMaxOrder(block.size);
+		block.freeNodes.resize(maxOrder + 1);
+		block.freeNodes[maxOrder].insert(0);
+	}
+	return blockIndex;
+}
+
+void DeviceMemoryAllocator::DestroyBlock(Block& block)
+{
+	if (block.memory == VK_NULL_HANDLE)
+	{
+		return;
+	}
+	// Freeing mapped memory unmaps it implicitly.
+	vkFreeMemory(device, block.memory, nullptr);
+	block = Block();
+	deviceMemoryCount--;
+}
+
+bool DeviceMemoryAllocator::AllocateBuddy(Block& block, VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset, VkDeviceSize& nodeSize)
+{
+	// A node is aligned to its own size, so a node not smaller than the alignment satisfies it.
+	const VkDeviceSize requiredSize = std::max({ size, alignment, MIN_NODE_SIZE });
+	const uint32_t maxOrder = static_cast<uint32_t>(block.freeNodes.size()) - 1;
+
+	uint32_t order = 0;
+	while ((MIN_NODE_SIZE << order) < requiredSize)
+	{
+		order++;
+	}
+	if (order > maxOrder)
+	{
+		return false;
+	}
+
+	uint32_t freeOrder = order;
+	while (freeOrder <= maxOrder && block.freeNodes[freeOrder].empty())
+	{
+		freeOrder++;
+	}
+	if (freeOrder > maxOrder)
+	{
+		return false;
+	}
+
+	// Taking the lowest offset keeps allocations packed at the beginning of the block.
+	offset = *block.freeNodes[freeOrder].begin();
+	block.freeNodes[freeOrder].erase(block.freeNodes[freeOrder].begin());
+	// Split the node until it fits, giving back the upper halves.
+	while (freeOrder > order)
+	{
+		freeOrder--;
+		block.freeNodes[freeOrder].insert(offset + (MIN_NODE_SIZE << freeOrder));
+	}
+
+	block.allocatedOrders[offset] = order;
+	nodeSize = MIN_NODE_SIZE << order;
+	return true;
+}
+
+void DeviceMemoryAllocator::FreeBuddy(Block& block, VkDeviceSize offset)
+{
+	auto iter = block.allocatedOrders.find(offset);
+	if (iter == block.allocatedOrders.end())
+	{
+		std::cout << "Freeing unknown device memory offset " << offset << "!" << std::endl;
+		return;
+	}
+	uint32_t order = iter->second;
+	block.allocatedOrders.erase(iter);
+
+	// Merge with the buddy while it is free.
+	const uint32_t maxOrder = static_cast<uint32_t>(block.freeNodes.size()) - 1;
+	while (order < maxOrder)
+	{
+		const VkDeviceSize buddy = offset ^ (MIN_NODE_SIZE << order);
+		if (block.freeNodes[order].erase(buddy) == 0)
+		{
+			break;
+		}
+		offset = std::min(offset, buddy);
+		order++;
+	}
+	block.freeNodes[order].insert(offset);
+}
+
+bool DeviceMemoryAllocator::AllocateLinear(Block& block, VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset)
+{
+	const VkDeviceSize alignedHead = AlignUp(block.head, alignment);
+	if (alignedHead + size > block.size)
+	{
+		return false;
+	}
+	offset = alignedHead;
+	block.head = alignedHead + size;
+	return true;
+}
+
+uint32_t DeviceMemoryAllocator::GetMaxOrder(VkDeviceSize blockSize) const
+{
+	uint32_t order = 0;
+	while ((MIN_NODE_SIZE << (order + 1)) <= blockSize)
+	{
+		order++;
+	}
+	return order;
+}
+
+VkDeviceSize DeviceMemoryAllocator::GetLargestFreeNode(const Block& block) const
+{
+	for (size_t order = block.freeNodes.size(); order > 0; order--)
+	{
+		if (block.freeNodes[order - 1].empty() == false)
+		{
+			return MIN_NODE_SIZE << (order - 1);
+		}
+	}
+	return 0;
+}
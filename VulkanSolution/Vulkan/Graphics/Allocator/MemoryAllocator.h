@@ -0,0 +1,147 @@
+/******************************************************************************
+Copyright (C) 2022 DigiPen Institute of Technology.
+Reproduction or disclosure of this file or its contents without the prior
+written consent of DigiPen Institute of Technology is prohibited.
+File Name:   MemoryAllocator.h
+Author
+	- sinil.kang	rtd99062@gmail.com
+Creation Date: 12.24.2022
+	header file for device memory sub-allocator.
+******************************************************************************/
+#pragma once
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <set>
+#include <unordered_map>
+#include <mutex>
+#include <cstdint>
+
+enum class MemoryLifetime
+{
+	// Kept for a while (vertex buffers, textures, uniform buffers). Sub-allocated by a buddy allocator.
+	LongLived,
+	// Freed right after an upload. Bump allocated, and the block is rewound when every allocation in it is freed.
+	Staging,
+};
+
+enum class MemoryResourceType
+{
+	Buffer,
+	// Images are always created with VK_IMAGE_TILING_OPTIMAL in this project.
+	OptimalImage,
+};
+
+// A range of VkDeviceMemory given by DeviceMemoryAllocator.
+// Resources should be bound at offset, since a block is shared by many resources.
+struct MemoryAllocation
+{
+	VkDeviceMemory memory = VK_NULL_HANDLE;
+	VkDeviceSize offset = 0;
+	VkDeviceSize size = 0;
+	// Points to offset in the mapped block. nullptr if the memory is not host visible.
+		// vkMapMemory must not be called on sub-allocated memory since a block is mapped only once.
+	void* mappedData = nullptr;
+
+	uint32_t poolIndex = UINT32_MAX;
+	// UINT32_MAX if the allocation has its own VkDeviceMemory.
+	uint32_t blockIndex = UINT32_MAX;
+
+	bool IsValid() const
+	{
+		return memory != VK_NULL_HANDLE;
+	}
+};
+
+struct MemoryStatistics
+{
+	uint32_t blockCount = 0;
+	uint32_t dedicatedCount = 0;
+	uint32_t allocationCount = 0;
+	// Bytes of VkDeviceMemory allocated from the driver, including dedicated ones.
+	VkDeviceSize reservedBytes = 0;
+	// Bytes given to resources, including padding of buddy nodes.
+	VkDeviceSize usedBytes = 0;
+	VkDeviceSize freeBytes = 0;
+	VkDeviceSize largestFreeRange = 0;
+	// 0 if free memory of every block is one range, close to 1 if it is split into small pieces.
+	float fragmentation = 0.f;
+};
+
+// Allocates large VkDeviceMemory blocks, and sub-allocates resources in them,
+	// so the number of vkAllocateMemory calls stays far below maxMemoryAllocationCount.
+// There is a pool per (memory type, resource type, lifetime).
+	// Buffers and optimal images never share a block, so bufferImageGranularity does not have to be considered between neighbors.
+class DeviceMemoryAllocator
+{
+public:
+	static constexpr VkDeviceSize LONG_LIVED_BLOCK_SIZE = 64ull * 1024 * 1024;
+	static constexpr VkDeviceSize STAGING_BLOCK_SIZE = 16ull * 1024 * 1024;
+	// The smallest node of the buddy allocator.
+	static constexpr VkDeviceSize MIN_NODE_SIZE = 256;
+public:
+	DeviceMemoryAllocator();
+	~DeviceMemoryAllocator();
+
+	void Init(VkPhysicalDevice physicalDevice, VkDevice device);
+	// Every allocation should be freed already.
+	void Clean();
+
+	// Return false if no memory type matches or the driver is out of memory.
+	bool Allocate(const VkMemoryRequirements& memoryRequirements, VkMemoryPropertyFlags properties, MemoryResourceType resourceType, MemoryLifetime lifetime, MemoryAllocation& allocation);
+	void Free(MemoryAllocation& allocation);
+
+	MemoryStatistics GetStatistics();
+	uint32_t GetMaxMemoryAllocationCount() const;
+private:
+	struct Block
+	{
+		VkDeviceMemory memory = VK_NULL_HANDLE;
+		char* mappedData = nullptr;
+		VkDeviceSize size = 0;
+		VkDeviceSize usedBytes = 0;
+		uint32_t allocationCount = 0;
+
+		// @@ Buddy block
+		// Offsets of free nodes per order. Node of order k is MIN_NODE_SIZE << k bytes.
+		std::vector<std::set<VkDeviceSize>> freeNodes;
+		// Offset of an allocated node -> its order.
+		std::unordered_map<VkDeviceSize, uint32_t> allocatedOrders;
+		// @@ End of buddy block
+
+		// Bump pointer of a linear block.
+		VkDeviceSize head = 0;
+	};
+	struct Pool
+	{
+		uint32_t memoryTypeIndex = 0;
+		bool isLinear = false;
+		bool isHostVisible = false;
+		VkDeviceSize blockSize = 0;
+		// Freed blocks stay in the vector with null memory, so block indices of allocations are not changed.
+		std::vector<Block> blocks;
+		uint32_t dedicatedCount = 0;
+		VkDeviceSize dedicatedBytes = 0;
+	};
+
+	uint32_t FindMemoryTypeIndex(uint32_t memoryTypeBits, VkMemoryPropertyFlags properties) const;
+	uint32_t GetPoolIndex(uint32_t memoryTypeIndex, MemoryResourceType resourceType, MemoryLifetime lifetime) const;
+	bool AllocateDedicated(Pool& pool, VkDeviceSize size, MemoryAllocation& allocation);
+	// Return index of a new block, UINT32_MAX if vkAllocateMemory has failed.
+	uint32_t CreateBlock(Pool& pool);
+	void DestroyBlock(Block& block);
+
+	bool AllocateBuddy(Block& block, VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset, VkDeviceSize& nodeSize);
+	void FreeBuddy(Block& block, VkDeviceSize offset);
+	bool AllocateLinear(Block& block, VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset);
+
+	uint32_t GetMaxOrder(VkDeviceSize blockSize) const;
+	VkDeviceSize GetLargestFreeNode(const Block& block) const;
+
+	VkDevice device;
+	VkPhysicalDeviceMemoryProperties memoryProperties;
+	uint32_t maxMemoryAllocationCount;
+	// Number of live VkDeviceMemory objects, blocks and dedicated allocations.
+	uint32_t deviceMemoryCount;
+	std::vector<Pool> pools;
+	std::mutex mutex;
+};
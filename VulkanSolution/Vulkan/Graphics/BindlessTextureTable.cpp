@@ -0,0 +1,160 @@
+/******************************************************************************
+Copyright (C) 2022 DigiPen Institute of Technology.
+Reproduction or disclosure of this file or its contents without the prior
+written consent of DigiPen Institute of Technology is prohibited.
+File Name:   BindlessTextureTable.cpp
+Author
+	- sinil.kang	rtd99062@gmail.com
+Creation Date: 12.24.2022
+	source file for one descriptor set holding every texture.
+******************************************************************************/
+#include "Graphics/BindlessTextureTable.h"
+#include "Helper/VulkanHelper.h"
+#include <Graphics/Graphics.h>
+#include <algorithm>
+
+BindlessTextureTable::BindlessTextureTable(Graphics* graphics, std::string name)
+	:Object(name), graphics(graphics), nextSlot(0), freeSlots(), retiredSlots(), descriptorPool(0), descriptorSetLayout(0), descriptorSet(0)
+{
+	device = graphics->GetDevice();
+
+	/// @@ Create Descriptor Set Layout
+	VkDescriptorSetLayoutBinding binding{};
+	binding.binding = 0;
+	binding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	binding.descriptorCount = MAX_TEXTURE_COUNT;
+	binding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+	// Partially bound, since only the slots of loaded textures are written.
+	const VkDescriptorBindingFlags bindingFlags = VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT | VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT;
+	VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo{};
+	bindingFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+	bindingFlagsInfo.bindingCount = 1;
+	bindingFlagsInfo.pBindingFlags = &bindingFlags;
+
+	VkDescriptorSetLayoutCreateInfo layoutCreateInfo{};
+	layoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutCreateInfo.pNext = &bindingFlagsInfo;
+	layoutCreateInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+	layoutCreateInfo.bindingCount = 1;
+	layoutCreateInfo.pBindings = &binding;
+
+	VulkanHelper::VkCheck(vkCreateDescriptorSetLayout(device, &layoutCreateInfo, nullptr, &descriptorSetLayout), "Creating bindless descriptor set layout has failed!");
+	/// @@ End of creating Descriptor Set Layout
+
+
+	/// @@ Create Descriptor Pool
+	VkDescriptorPoolSize poolSize{};
+	poolSize.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	poolSize.descriptorCount = MAX_TEXTURE_COUNT;
+
+	VkDescriptorPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+	poolInfo.poolSizeCount = 1;
+	poolInfo.pPoolSizes = &poolSize;
+	poolInfo.maxSets = 1;
+
+	VulkanHelper::VkCheck(vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptorPool), "Creating bindless descriptor pool has failed!");
+	/// @@ End of creating Descriptor Pool
+
+
+	/// @@ Create Descriptor Set
+	VkDescriptorSetAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.pNext = nullptr;
+	allocInfo.descriptorPool = descriptorPool;
+	allocInfo.descriptorSetCount = 1;
+	allocInfo.pSetLayouts = &descriptorSetLayout;
+
+	VulkanHelper::VkCheck(vkAllocateDescriptorSets(device, &allocInfo, &descriptorSet), "Allocating bindless descriptor set has failed!");
+	/// @@ End of creating Descriptor Set
+}
+
+BindlessTextureTable::~BindlessTextureTable()
+{
+	Clean();
+}
+
+bool BindlessTextureTable::Init()
+{
+	return true;
+}
+
+void BindlessTextureTable::Update(float dt)
+{
+}
+
+void BindlessTextureTable::Clean()
+{
+	vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+	vkDestroyDescriptorSetLayout(device, descriptorSetLayout, nullptr);
+	descriptorPool = VK_NULL_HANDLE;
+	descriptorSetLayout = VK_NULL_HANDLE;
+}
+
+VkDescriptorSetLayout* BindlessTextureTable::GetDescriptorSetLayoutPtr()
+{
+	return &descriptorSetLayout;
+}
+
+VkDescriptorSet* BindlessTextureTable::GetDescriptorSetPtr()
+{
+	return &descriptorSet;
+}
+
+void BindlessTextureTable::Write(uint32_t index, const VkImageView& imageView, const VkSampler& sampler)
+{
+	VkDescriptorImageInfo imageInfo{};
+	imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	imageInfo.imageView = imageView;
+	imageInfo.sampler = sampler;
+
+	VkWriteDescriptorSet descriptorWrite{};
+	descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	descriptorWrite.dstSet = descriptorSet;
+	descriptorWrite.dstBinding = 0;
+	descriptorWrite.dstArrayElement = index;
+	descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	descriptorWrite.descriptorCount = 1;
+	descriptorWrite.pImageInfo = &imageInfo;
+
+	vkUpdateDescriptorSets(device, 1, &descriptorWrite, 0, nullptr);
+}
+
+uint32_t BindlessTextureTable::AllocateSlot()
+{
+	// Same as the retired resources of Graphics, frames up to retiredFrame are completed MAX_FRAMES_IN_FLIGHT frames later.
+	const uint64_t frameCount = graphics->GetFrameCount();
+	auto iter = std::remove_if(retiredSlots.begin(), retiredSlots.end(), [&](const RetiredSlot& retired)
+		{
+			if (frameCount >= retired.retiredFrame + Graphics::MAX_FRAMES_IN_FLIGHT)
+			{
+				freeSlots.push_back(retired.slot);
+				return true;
+			}
+			return false;
+		});
+	retiredSlots.erase(iter, retiredSlots.end());
+
+	if (freeSlots.empty() == false)
+	{
+		const uint32_t slot = freeSlots.back();
+		freeSlots.pop_back();
+		return slot;
+	}
+	if (nextSlot < MAX_TEXTURE_COUNT)
+	{
+		return nextSlot++;
+	}
+	return INVALID_SLOT;
+}
+
+void BindlessTextureTable::FreeSlot(uint32_t slot)
+{
+	if (slot == INVALID_SLOT)
+	{
+		return;
+	}
+	retiredSlots.push_back({ slot, graphics->GetFrameCount() });
+}
@@ -0,0 +1,67 @@
+/******************************************************************************
+Copyright (C) 2022 DigiPen Institute of Technology.
+Reproduction or disclosure of this file or its contents without the prior
+written consent of DigiPen Institute of Technology is prohibited.
+File Name:   BindlessTextureTable.h
+Author
+	- sinil.kang	rtd99062@gmail.com
+Creation Date: 12.24.2022
+	header file for one descriptor set holding every texture.
+******************************************************************************/
+#pragma once
+
+#include <Engines/Objects/Object.h>
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <cstdint>
+
+class Graphics;
+
+// Array of combined image samplers in a single descriptor set, bound once and indexed by the slot each draw passes as firstInstance,
+	// which shaders read as gl_InstanceIndex.
+// The binding is update-after-bind, so writing a slot does not invalidate the binding of the set.
+	// Slots are baked into recorded draws, so MyScene::UpdateTextureStreaming() re-records static command buffers after moving a texture to a new slot.
+// A slot should not be written while a pending command buffer reads it, so a texture replaced while frames are in flight is written to a new slot,
+	// and the old slot is given out again after those frames are completed.
+class BindlessTextureTable : public Object
+{
+public:
+	// Far below the update-after-bind limits of devices supporting descriptor indexing, which are at least 500000.
+	static constexpr uint32_t MAX_TEXTURE_COUNT = 4096;
+	static constexpr uint32_t INVALID_SLOT = UINT32_MAX;
+public:
+	BindlessTextureTable(Graphics* graphics, std::string name);
+	~BindlessTextureTable();
+
+	bool Init();
+	void Update(float dt);
+	void Clean();
+
+	VkDescriptorSetLayout* GetDescriptorSetLayoutPtr();
+	VkDescriptorSet* GetDescriptorSetPtr();
+
+	// Slots never written should not be read by shaders.
+	void Write(uint32_t index, const VkImageView& imageView, const VkSampler& sampler);
+
+	// Slot which no pending command buffer reads. Slots are given from 0 in order until one is freed. INVALID_SLOT if every slot is used.
+	uint32_t AllocateSlot();
+	// The slot may be read until the current frame is completed, so it is given out again MAX_FRAMES_IN_FLIGHT frames later.
+	void FreeSlot(uint32_t slot);
+private:
+	Graphics* graphics;
+	VkDevice device;
+
+	// Never used slots are given from nextSlot, and freed slots are reused first.
+	uint32_t nextSlot;
+	std::vector<uint32_t> freeSlots;
+	struct RetiredSlot
+	{
+		uint32_t slot;
+		uint64_t retiredFrame;
+	};
+	std::vector<RetiredSlot> retiredSlots;
+
+	VkDescriptorPool descriptorPool;
+	VkDescriptorSetLayout descriptorSetLayout;
+	VkDescriptorSet descriptorSet;
+};
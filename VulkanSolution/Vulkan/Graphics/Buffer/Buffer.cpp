@@ -18,27 +18,13 @@ Buffer::Buffer(Graphics* graphics, std::string bufferName, VkBufferUsageFlags us
 	// Use two buffers.
 	// One for writing vertex data, the other is actual vertex buffer which we cannot see and use(map) at CPU.
 	// The reason why use two buffers is the buffer we can see at CPU is not a good buffer from the GPU side.
+	// The one we can see is the staging ring of the upload queue, shared by every upload.
 
 	VkDeviceSize bufferSize = dataTypeSize * dataSize;
 
-	VkBuffer stagingBuffer;
-	VkDeviceMemory stagingBufferMemory;
-	graphics->CreateBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
-
-	const VkDevice device = graphics->GetDevice();
-
-	void* memoryData;
-	// Operate as glMapBuffer, glUnmapBuffer
-	vkMapMemory(device, stagingBufferMemory, 0, bufferSize, 0, &memoryData);
-	memcpy(memoryData, data, static_cast<size_t>(bufferSize));
-	vkUnmapMemory(device, stagingBufferMemory);
-
 	graphics->CreateBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, buffer, bufferMemory);
 
-	graphics->CopyBuffer(stagingBuffer, buffer, bufferSize);
-
-	vkDestroyBuffer(device, stagingBuffer, nullptr);
-	vkFreeMemory(device, stagingBufferMemory, nullptr);
+	graphics->UploadBufferData(buffer, data, bufferSize);
 }
 
 Buffer::~Buffer()
@@ -57,9 +43,7 @@ void Buffer::Update(float dt)
 
 void Buffer::Clean()
 {
-	const VkDevice device = graphics->GetDevice();
-	vkDestroyBuffer(device, buffer, nullptr);
-	vkFreeMemory(device, bufferMemory, nullptr);
+	graphics->DestroyBuffer(buffer, bufferMemory);
 }
 
 unsigned int Buffer::GetBufferDataTypeSize()
@@ -77,7 +61,7 @@ VkBuffer Buffer::GetBuffer()
 	return buffer;
 }
 
-VkDeviceMemory Buffer::GetBufferMemory()
+const MemoryAllocation& Buffer::GetBufferMemory()
 {
 	return bufferMemory;
 }
@@ -88,25 +72,9 @@ void Buffer::ChangeBufferData(unsigned int _dataTypeSize, size_t _dataSize, void
 	dataSize = _dataSize;
 	VkDeviceSize bufferSize = dataTypeSize * dataSize;
 
-	const VkDevice device = graphics->GetDevice();
-	vkDestroyBuffer(device, buffer, nullptr);
-	vkFreeMemory(device, bufferMemory, nullptr);
-
-
-	VkBuffer stagingBuffer;
-	VkDeviceMemory stagingBufferMemory;
-	graphics->CreateBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
-
-	void* memoryData;
-	// Operate as glMapBuffer, glUnmapBuffer
-	vkMapMemory(device, stagingBufferMemory, 0, bufferSize, 0, &memoryData);
-	memcpy(memoryData, data, static_cast<size_t>(bufferSize));
-	vkUnmapMemory(device, stagingBufferMemory);
+	graphics->DestroyBuffer(buffer, bufferMemory);
 
 	graphics->CreateBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, buffer, bufferMemory);
 
-	graphics->CopyBuffer(stagingBuffer, buffer, bufferSize);
-
-	vkDestroyBuffer(device, stagingBuffer, nullptr);
-	vkFreeMemory(device, stagingBufferMemory, nullptr);
+	graphics->UploadBufferData(buffer, data, bufferSize);
 }
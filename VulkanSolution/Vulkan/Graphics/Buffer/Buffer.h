@@ -11,6 +11,7 @@ Creation Date: 12.20.2022
 #pragma once
 #include <Engines/Objects/Object.h>
 #include <vulkan/vulkan.h>
+#include <Graphics/Allocator/MemoryAllocator.h>
 
 class Graphics;
 
@@ -27,7 +28,7 @@ public:
 	unsigned int GetBufferDataTypeSize();
 	size_t GetBufferDataSize();
 	VkBuffer GetBuffer();
-	VkDeviceMemory GetBufferMemory();
+	const MemoryAllocation& GetBufferMemory();
 
 	void ChangeBufferData(unsigned int dataTypeSize, size_t dataSize, void* data);
 private:
@@ -39,5 +40,5 @@ private:
 	size_t dataSize;
 
 	VkBuffer buffer;
-	VkDeviceMemory bufferMemory;
+	MemoryAllocation bufferMemory;
 };
\ No newline at end of file
@@ -0,0 +1,118 @@
+/******************************************************************************
+Copyright (C) 2022 DigiPen Institute of Technology.
+Reproduction or disclosure of this file or its contents without the prior
+written consent of DigiPen Institute of Technology is prohibited.
+File Name:   MeshArena.cpp
+Author
+	- sinil.kang	rtd99062@gmail.com
+Creation Date: 12.24.2022
+	source file for vertex and index buffers shared by meshes.
+******************************************************************************/
+#include "MeshArena.h"
+#include <Graphics/Graphics.h>
+
+MeshArena::MeshArena(Graphics* graphics, std::string name, unsigned int vertexTypeSize, const std::vector<MeshData>& meshes)
+	: Object(name), graphics(graphics), vertexTypeSize(vertexTypeSize), vertexBuffer(VK_NULL_HANDLE), vertexBufferMemory(), vertexCapacity(0), indexBuffer(VK_NULL_HANDLE), indexBufferMemory(), indexCapacity(0), meshRanges()
+{
+	ChangeMeshes(meshes);
+}
+
+MeshArena::~MeshArena()
+{
+	Clean();
+}
+
+bool MeshArena::Init()
+{
+	return true;
+}
+
+void MeshArena::Update(float dt)
+{
+}
+
+void MeshArena::Clean()
+{
+	if (vertexBuffer != VK_NULL_HANDLE)
+	{
+		graphics->DestroyBuffer(vertexBuffer, vertexBufferMemory);
+	}
+	if (indexBuffer != VK_NULL_HANDLE)
+	{
+		graphics->DestroyBuffer(indexBuffer, indexBufferMemory);
+	}
+	vertexCapacity = 0;
+	indexCapacity = 0;
+	meshRanges.clear();
+}
+
+void MeshArena::ChangeMeshes(const std::vector<MeshData>& meshes)
+{
+	meshRanges.resize(meshes.size());
+	uint32_t vertexCount = 0;
+	uint32_t indexCount = 0;
+	for (size_t i = 0; i < meshes.size(); i++)
+	{
+		meshRanges[i] = { vertexCount, meshes[i].vertexCount, indexCount, meshes[i].indexCount };
+		vertexCount += meshes[i].vertexCount;
+		indexCount += meshes[i].indexCount;
+	}
+
+	Reserve(vertexBuffer, vertexBufferMemory, vertexCapacity, static_cast<VkDeviceSize>(vertexTypeSize) * vertexCount, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+	Reserve(indexBuffer, indexBufferMemory, indexCapacity, sizeof(uint32_t) * static_cast<VkDeviceSize>(indexCount), VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
+
+	// Each mesh is copied to its own place, and the copies are submitted together by the upload queue.
+	for (size_t i = 0; i < meshes.size(); i++)
+	{
+		UpdateVertices(i, meshes[i].vertices);
+		if (meshes[i].indexCount > 0)
+		{
+			graphics->UploadBufferData(indexBuffer, meshes[i].indices, sizeof(uint32_t) * static_cast<VkDeviceSize>(meshes[i].indexCount), sizeof(uint32_t) * static_cast<VkDeviceSize>(meshRanges[i].firstIndex));
+		}
+	}
+}
+
+void MeshArena::UpdateVertices(size_t mesh, const void* vertices)
+{
+	const MeshRange& range = meshRanges[mesh];
+	if (range.vertexCount == 0)
+	{
+		return;
+	}
+	graphics->UploadBufferData(vertexBuffer, vertices, static_cast<VkDeviceSize>(vertexTypeSize) * range.vertexCount, static_cast<VkDeviceSize>(vertexTypeSize) * range.firstVertex);
+}
+
+VkBuffer MeshArena::GetVertexBuffer()
+{
+	return vertexBuffer;
+}
+
+VkBuffer MeshArena::GetIndexBuffer()
+{
+	return indexBuffer;
+}
+
+const MeshRange& MeshArena::GetMeshRange(size_t mesh)
+{
+	return meshRanges[mesh];
+}
+
+size_t MeshArena::GetMeshCount()
+{
+	return meshRanges.size();
+}
+
+void MeshArena::Reserve(VkBuffer& buffer, MemoryAllocation& bufferMemory, VkDeviceSize& capacity, VkDeviceSize size, VkBufferUsageFlags usage)
+{
+	if (size <= capacity)
+	{
+		return;
+	}
+
+	if (buffer != VK_NULL_HANDLE)
+	{
+		graphics->DestroyBuffer(buffer, bufferMemory);
+	}
+	graphics->CreateBuffer(size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, buffer, bufferMemory);
+	capacity = size;
+}
@@ -0,0 +1,76 @@
+/******************************************************************************
+Copyright (C) 2022 DigiPen Institute of Technology.
+Reproduction or disclosure of this file or its contents without the prior
+written consent of DigiPen Institute of Technology is prohibited.
+File Name:   MeshArena.h
+Author
+	- sinil.kang	rtd99062@gmail.com
+Creation Date: 12.24.2022
+	header file for vertex and index buffers shared by meshes.
+******************************************************************************/
+#pragma once
+#include <Engines/Objects/Object.h>
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <cstdint>
+#include <Graphics/Allocator/MemoryAllocator.h>
+
+class Graphics;
+
+// Vertices and indices of a mesh to be packed. indices can be nullptr if indexCount is 0.
+struct MeshData
+{
+	const void* vertices;
+	uint32_t vertexCount;
+	const uint32_t* indices;
+	uint32_t indexCount;
+};
+
+// Place of a mesh in the arenas. Indices are relative to the first vertex of the mesh,
+	// so firstVertex is given as vertexOffset of indexed draws.
+struct MeshRange
+{
+	uint32_t firstVertex;
+	uint32_t vertexCount;
+	uint32_t firstIndex;
+	uint32_t indexCount;
+};
+
+// Every mesh of a model is packed into one vertex buffer and one index buffer,
+	// so the buffers are bound once, and meshes are drawn by offsets.
+class MeshArena : public Object
+{
+public:
+	MeshArena(Graphics* graphics, std::string name, unsigned int vertexTypeSize, const std::vector<MeshData>& meshes);
+	~MeshArena();
+
+	bool Init();
+	void Update(float dt);
+	void Clean();
+
+	// Pack meshes from the beginning of the arenas. Buffers are created again only if they are too small.
+		// The arenas should not be in use by the device.
+	void ChangeMeshes(const std::vector<MeshData>& meshes);
+	// Vertex count of the mesh should not be changed.
+	void UpdateVertices(size_t mesh, const void* vertices);
+
+	// VK_NULL_HANDLE if no mesh has vertices or indices.
+	VkBuffer GetVertexBuffer();
+	VkBuffer GetIndexBuffer();
+	const MeshRange& GetMeshRange(size_t mesh);
+	size_t GetMeshCount();
+private:
+	void Reserve(VkBuffer& buffer, MemoryAllocation& bufferMemory, VkDeviceSize& capacity, VkDeviceSize size, VkBufferUsageFlags usage);
+
+	Graphics* graphics;
+	unsigned int vertexTypeSize;
+
+	VkBuffer vertexBuffer;
+	MemoryAllocation vertexBufferMemory;
+	VkDeviceSize vertexCapacity;
+	VkBuffer indexBuffer;
+	MemoryAllocation indexBufferMemory;
+	VkDeviceSize indexCapacity;
+
+	std::vector<MeshRange> meshRanges;
+};
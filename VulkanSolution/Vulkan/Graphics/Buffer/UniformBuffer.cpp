@@ -12,21 +12,14 @@ Creation Date: 12.20.2022
 #include "UniformBuffer.h"
 #include <Graphics/Graphics.h>
 
-UniformBuffer::UniformBuffer(Graphics* graphics, std::string bufferName, VkDeviceSize bufferSize, int numOfBuffer)
-	: Object(bufferName), graphics(graphics), bufferSize(bufferSize)
+UniformBuffer::UniformBuffer(Graphics* graphics, std::string bufferName, VkDeviceSize bufferSize, int numOfBuffer, VkBufferUsageFlags usage)
+	: Object(bufferName), graphics(graphics), bufferSize(bufferSize), usage(usage)
 {
 	// Use two buffers.
 	// One for writing vertex data, the other is actual vertex buffer which we cannot see and use(map) at CPU.
 	// The reason why use two buffers is the buffer we can see at CPU is not a good buffer from the GPU side.
 
-	buffers.resize(numOfBuffer);
-	bufferMemories.resize(numOfBuffer);
-
-	for (int i = 0; i < numOfBuffer; i++)
-	{
-		graphics->CreateBuffer(bufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-			buffers[i], bufferMemories[i]);
-	}
+	CreateBuffers(numOfBuffer);
 }
 
 UniformBuffer::~UniformBuffer()
@@ -45,26 +38,22 @@ void UniformBuffer::Update(float dt)
 
 void UniformBuffer::Clean()
 {
-	const VkDevice device = graphics->GetDevice();
+	DestroyBuffers();
+}
 
-	for (VkBuffer& buffer : buffers)
-	{
-		vkDestroyBuffer(device, buffer, nullptr);
-	}
-	for (VkDeviceMemory& bufferMemory : bufferMemories)
+void UniformBuffer::CleanLater()
+{
+	for (size_t i = 0; i < buffers.size(); i++)
 	{
-		vkFreeMemory(device, bufferMemory, nullptr);
+		graphics->DestroyBufferLater(buffers[i], bufferMemories[i]);
 	}
+	buffers.clear();
+	bufferMemories.clear();
 }
 
 void UniformBuffer::UpdateUniformData(VkDeviceSize bufferSize, void* data, int i)
 {
-	const VkDevice device = graphics->GetDevice();
-
-	void* memory;
-	vkMapMemory(device, bufferMemories[i], 0, bufferSize, 0, &memory);
-	memcpy(memory, data, bufferSize);
-	vkUnmapMemory(device, bufferMemories[i]);
+	memcpy(bufferMemories[i].mappedData, data, bufferSize);
 }
 
 const VkBuffer UniformBuffer::GetBuffer(int i)
@@ -72,7 +61,7 @@ const VkBuffer UniformBuffer::GetBuffer(int i)
 	return buffers[i];
 }
 
-const VkDeviceMemory UniformBuffer::GetBufferMemory(int i)
+const MemoryAllocation& UniformBuffer::GetBufferMemory(int i)
 {
 	return bufferMemories[i];
 }
@@ -85,23 +74,30 @@ VkDeviceSize UniformBuffer::GetBufferSize()
 void UniformBuffer::ChangeBufferData(VkDeviceSize _bufferSize, int numOfBuffer)
 {
 	bufferSize = _bufferSize;
-	const VkDevice device = graphics->GetDevice();
 
-	for (VkBuffer& buffer : buffers)
-	{
-		vkDestroyBuffer(device, buffer, nullptr);
-	}
-	for (VkDeviceMemory& bufferMemory : bufferMemories)
-	{
-		vkFreeMemory(device, bufferMemory, nullptr);
-	}
+	DestroyBuffers();
+	CreateBuffers(numOfBuffer);
+}
 
+void UniformBuffer::CreateBuffers(int numOfBuffer)
+{
 	buffers.resize(numOfBuffer);
 	bufferMemories.resize(numOfBuffer);
 
 	for (int i = 0; i < numOfBuffer; i++)
 	{
-		graphics->CreateBuffer(bufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		// Host coherent memory does not need flush, so the mapped pointer of the allocation can be written any time.
+		graphics->CreateBuffer(bufferSize, usage, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
 			buffers[i], bufferMemories[i]);
 	}
 }
+
+void UniformBuffer::DestroyBuffers()
+{
+	for (size_t i = 0; i < buffers.size(); i++)
+	{
+		graphics->DestroyBuffer(buffers[i], bufferMemories[i]);
+	}
+	buffers.clear();
+	bufferMemories.clear();
+}
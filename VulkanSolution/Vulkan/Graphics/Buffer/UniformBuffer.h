@@ -12,30 +12,41 @@ Creation Date: 12.20.2022
 #pragma once
 #include <Engines/Objects/Object.h>
 #include <vulkan/vulkan.h>
+#include <vector>
+#include <Graphics/Allocator/MemoryAllocator.h>
 
 class Graphics;
 
 class UniformBuffer : public Object
 {
 public:
-	UniformBuffer(Graphics* graphics, std::string bufferName, VkDeviceSize bufferSize, int numOfBuffer = 1);
+	// Host visible buffers written by CPU every frame. usage can be changed to use them as dynamic vertex buffers.
+	// Buffers stay mapped while they live, so updating them is a memcpy.
+	UniformBuffer(Graphics* graphics, std::string bufferName, VkDeviceSize bufferSize, int numOfBuffer = 1, VkBufferUsageFlags usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT);
 	~UniformBuffer();
 
 	bool Init();
 	void Update(float dt);
 	void Clean();
+	// Buffers are destroyed by Graphics after frames using them are completed, and this has no buffer afterwards.
+	void CleanLater();
 
 	void UpdateUniformData(VkDeviceSize bufferSize, void* data, int i = 0);
 
 	const VkBuffer GetBuffer(int i = 0);
-	const VkDeviceMemory GetBufferMemory(int i = 0);
+	const MemoryAllocation& GetBufferMemory(int i = 0);
 	VkDeviceSize GetBufferSize();
 
 	void ChangeBufferData(VkDeviceSize bufferSize, int numOfBuffer);
 private:
+	void CreateBuffers(int numOfBuffer);
+	void DestroyBuffers();
+
 	Graphics* graphics;
 
 	std::vector<VkBuffer> buffers;
-	std::vector<VkDeviceMemory> bufferMemories;
+	// Host visible allocations are mapped by the allocator.
+	std::vector<MemoryAllocation> bufferMemories;
 	VkDeviceSize bufferSize;
+	VkBufferUsageFlags usage;
 };
\ No newline at end of file
@@ -0,0 +1,113 @@
+/******************************************************************************
+Copyright (C) 2022 DigiPen Institute of Technology.
+Reproduction or disclosure of this file or its contents without the prior
+written consent of DigiPen Institute of Technology is prohibited.
+File Name:   UniformRingBuffer.cpp
+Author
+	- sinil.kang	rtd99062@gmail.com
+Creation Date: 12.24.2022
+	Source file for persistently mapped uniform ring buffer.
+******************************************************************************/
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include "UniformRingBuffer.h"
+#include <Graphics/Graphics.h>
+
+UniformRingBuffer::UniformRingBuffer(Graphics* graphics, std::string bufferName, VkDeviceSize frameSize)
+	: Object(bufferName), graphics(graphics), buffer(VK_NULL_HANDLE), bufferMemory(), mappedMemory(nullptr), frameSize(0), alignment(1), frameBegin(0), head(0)
+{
+	alignment = std::max<VkDeviceSize>(graphics->GetPhysicalDeviceProperties().limits.minUniformBufferOffsetAlignment, 1);
+	this->frameSize = GetAlignedSize(frameSize);
+	CreateRingBuffer();
+}
+
+UniformRingBuffer::~UniformRingBuffer()
+{
+	Clean();
+}
+
+bool UniformRingBuffer::Init()
+{
+	return true;
+}
+
+void UniformRingBuffer::Update(float dt)
+{
+}
+
+void UniformRingBuffer::Clean()
+{
+	graphics->DestroyBuffer(buffer, bufferMemory);
+	mappedMemory = nullptr;
+}
+
+void UniformRingBuffer::BeginFrame(uint32_t frameID)
+{
+	frameBegin = frameSize * frameID;
+	head = frameBegin;
+}
+
+uint32_t UniformRingBuffer::Allocate(VkDeviceSize size, const void* data)
+{
+	const VkDeviceSize alignedSize = GetAlignedSize(size);
+	if (head + alignedSize > frameBegin + frameSize)
+	{
+		// Wrapping would overwrite blocks already bound by this frame, and the next region belongs to another frame in flight.
+		assert(false && "Uniform ring buffer is full. Reserve() larger frame size before the frame.");
+		std::abort();
+	}
+
+	const VkDeviceSize offset = head;
+	memcpy(mappedMemory + offset, data, static_cast<size_t>(size));
+	head += alignedSize;
+
+	return static_cast<uint32_t>(offset);
+}
+
+bool UniformRingBuffer::Reserve(VkDeviceSize _frameSize)
+{
+	if (_frameSize <= frameSize)
+	{
+		return false;
+	}
+
+	// Frames in flight still read the old buffer.
+	const VkDeviceSize frameID = frameBegin / frameSize;
+	graphics->DestroyBufferLater(buffer, bufferMemory);
+	mappedMemory = nullptr;
+	frameSize = GetAlignedSize(_frameSize);
+	CreateRingBuffer();
+
+	// Keep writing the region of the current frame.
+	frameBegin = frameSize * frameID;
+	head = frameBegin;
+	return true;
+}
+
+VkDeviceSize UniformRingBuffer::GetAlignedSize(VkDeviceSize size) const
+{
+	return (size + alignment - 1) / alignment * alignment;
+}
+
+VkBuffer UniformRingBuffer::GetBuffer()
+{
+	return buffer;
+}
+
+VkDeviceSize UniformRingBuffer::GetFrameSize()
+{
+	return frameSize;
+}
+
+void UniformRingBuffer::CreateRingBuffer()
+{
+	graphics->CreateBuffer(frameSize * Graphics::MAX_FRAMES_IN_FLIGHT, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		buffer, bufferMemory);
+
+	// Host coherent memory stays mapped by the allocator until the buffer is destroyed, so writing needs neither map nor flush.
+	mappedMemory = static_cast<char*>(bufferMemory.mappedData);
+	frameBegin = 0;
+	head = 0;
+}
@@ -0,0 +1,58 @@
+/******************************************************************************
+Copyright (C) 2022 DigiPen Institute of Technology.
+Reproduction or disclosure of this file or its contents without the prior
+written consent of DigiPen Institute of Technology is prohibited.
+File Name:   UniformRingBuffer.h
+Author
+	- sinil.kang	rtd99062@gmail.com
+Creation Date: 12.24.2022
+	Header file for persistently mapped uniform ring buffer.
+******************************************************************************/
+#pragma once
+#include <Engines/Objects/Object.h>
+#include <vulkan/vulkan.h>
+#include <Graphics/Allocator/MemoryAllocator.h>
+
+class Graphics;
+
+// One host coherent buffer split into a region per frame in flight, mapped while the buffer lives.
+// Uniform data of a frame is bump allocated in the region of the frame,
+	// and descriptors of VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC select it with the returned offset.
+class UniformRingBuffer : public Object
+{
+public:
+	UniformRingBuffer(Graphics* graphics, std::string bufferName, VkDeviceSize frameSize);
+	~UniformRingBuffer();
+
+	bool Init();
+	void Update(float dt);
+	void Clean();
+
+	// Rewind to the region of the frame. Fence of the frame should be waited already.
+	void BeginFrame(uint32_t frameID);
+	// Copy data to the region of the current frame, and return its dynamic offset.
+		// Blocks of a frame never wrap, so the frame size should be reserved before the frame. Asserts if the region is full.
+	uint32_t Allocate(VkDeviceSize size, const void* data);
+
+	// Recreate the buffer if frameSize is larger than the current one. Return true if the buffer is recreated.
+		// The old buffer is destroyed after frames in flight using it are completed. Descriptors using the buffer should be written again.
+	bool Reserve(VkDeviceSize frameSize);
+
+	VkBuffer GetBuffer();
+	VkDeviceSize GetFrameSize();
+private:
+	void CreateRingBuffer();
+	// Size of a block including padding for the dynamic offset alignment.
+	VkDeviceSize GetAlignedSize(VkDeviceSize size) const;
+
+	Graphics* graphics;
+
+	VkBuffer buffer;
+	MemoryAllocation bufferMemory;
+	char* mappedMemory;
+
+	VkDeviceSize frameSize;
+	VkDeviceSize alignment;
+	VkDeviceSize frameBegin;
+	VkDeviceSize head;
+};
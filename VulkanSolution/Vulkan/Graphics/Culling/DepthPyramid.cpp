@@ -0,0 +1,221 @@
+/******************************************************************************
+Copyright (C) 2022 DigiPen Institute of Technology.
+Reproduction or disclosure of this file or its contents without the prior
+written consent of DigiPen Institute of Technology is prohibited.
+File Name:   DepthPyramid.cpp
+Author
+	- sinil.kang	rtd99062@gmail.com
+Creation Date: 12.24.2022
+	source file for the hierarchical depth buffer used by occlusion culling.
+******************************************************************************/
+#include "DepthPyramid.h"
+#include <algorithm>
+#include <Graphics/Graphics.h>
+#include <Graphics/DescriptorSet.h>
+#include <Graphics/Pipelines/Pipeline.h>
+#include <Helper/VulkanHelper.h>
+
+namespace
+{
+	// Layout of PushConstants in depthPyramid.comp.
+	struct DepthPyramidPushConstants
+	{
+		int32_t sourceSize[2];
+		int32_t destinationSize[2];
+	};
+
+	void RecordComputeBarrier(VkCommandBuffer commandBuffer, VkAccessFlags srcAccessMask, VkAccessFlags dstAccessMask)
+	{
+		VkMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		barrier.srcAccessMask = srcAccessMask;
+		barrier.dstAccessMask = dstAccessMask;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+	}
+}
+
+DepthPyramid::DepthPyramid()
+	: graphics(nullptr), device(VK_NULL_HANDLE), image(VK_NULL_HANDLE), imageMemory(), imageView(VK_NULL_HANDLE), extent{ 0, 0 }, mipLevels(0), sampler(VK_NULL_HANDLE), descriptorSetLayout(VK_NULL_HANDLE), descriptorSet(nullptr), pipeline(nullptr), isBuilt(false)
+{
+}
+
+DepthPyramid::~DepthPyramid()
+{
+	Clean();
+}
+
+void DepthPyramid::Init(Graphics* _graphics)
+{
+	graphics = _graphics;
+	device = graphics->GetDevice();
+
+	VkSamplerCreateInfo samplerInfo{};
+	samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	samplerInfo.magFilter = VK_FILTER_NEAREST;
+	samplerInfo.minFilter = VK_FILTER_NEAREST;
+	samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+	samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.anisotropyEnable = VK_FALSE;
+	samplerInfo.maxAnisotropy = 1.f;
+	samplerInfo.minLod = 0.f;
+	samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+	VulkanHelper::VkCheck(vkCreateSampler(device, &samplerInfo, nullptr, &sampler), "Creating depth pyramid sampler has failed!");
+
+	layoutBindings = {
+		{0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr},
+		{1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr}
+	};
+	// Descriptor sets made by Create() get the same layout from the cache.
+	descriptorSetLayout = graphics->GetDescriptorSetLayoutCache().Acquire(layoutBindings);
+
+	PipelineDescription description;
+	description.name = "depthPyramidPipeline";
+	description.pushConstantSize = sizeof(DepthPyramidPushConstants);
+	description.pushConstantTargetStage = VK_SHADER_STAGE_COMPUTE_BIT;
+	description.descriptorSetLayouts = { descriptorSetLayout };
+	description.compShader = SHADER_PATH;
+	pipeline = new Pipeline(graphics, description);
+}
+
+void DepthPyramid::Clean()
+{
+	if (graphics == nullptr)
+	{
+		return;
+	}
+
+	Destroy();
+
+	delete pipeline;
+	pipeline = nullptr;
+	graphics->GetDescriptorSetLayoutCache().Release(descriptorSetLayout);
+	descriptorSetLayout = VK_NULL_HANDLE;
+	vkDestroySampler(device, sampler, nullptr);
+	sampler = VK_NULL_HANDLE;
+
+	graphics = nullptr;
+}
+
+void DepthPyramid::Create(VkImageView depthImageView, VkExtent2D depthExtent)
+{
+	extent.width = std::max(depthExtent.width / 2, 1u);
+	extent.height = std::max(depthExtent.height / 2, 1u);
+	mipLevels = 1;
+	while ((std::max(extent.width, extent.height) >> mipLevels) > 0)
+	{
+		mipLevels++;
+	}
+
+	graphics->CreateImage(extent.width, extent.height, mipLevels, VK_FORMAT_R32_SFLOAT, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, image, imageMemory);
+	imageView = graphics->CreateImageView(image, VK_FORMAT_R32_SFLOAT, VK_IMAGE_ASPECT_COLOR_BIT, mipLevels);
+	mipViews.resize(mipLevels);
+	for (uint32_t i = 0; i < mipLevels; i++)
+	{
+		mipViews[i] = graphics->CreateImageView(image, VK_FORMAT_R32_SFLOAT, VK_IMAGE_ASPECT_COLOR_BIT, 1, i);
+	}
+
+	// The pyramid stays in the general layout, since every level is written as a storage image and read as a sampled image.
+	VkCommandBuffer commandBuffer = graphics->BeginSingleTimeCommands();
+	graphics->TransitionImageLayout(commandBuffer, image, VK_FORMAT_R32_SFLOAT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL, mipLevels);
+	graphics->EndSingleTimeCommands(commandBuffer);
+
+	descriptorSet = new DescriptorSet(graphics, "depthPyramidDescriptor", mipLevels, layoutBindings);
+	for (uint32_t i = 0; i < mipLevels; i++)
+	{
+		const DescriptorInfo source = (i == 0) ?
+			DescriptorSet::MakeImageInfo(depthImageView, sampler, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL) :
+			DescriptorSet::MakeImageInfo(mipViews[i - 1], sampler, VK_IMAGE_LAYOUT_GENERAL);
+		descriptorSet->Write(i, { source, DescriptorSet::MakeImageInfo(mipViews[i], VK_NULL_HANDLE, VK_IMAGE_LAYOUT_GENERAL) });
+	}
+
+	isBuilt = false;
+}
+
+void DepthPyramid::Destroy()
+{
+	if (image == VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	delete descriptorSet;
+	descriptorSet = nullptr;
+	for (VkImageView mipView : mipViews)
+	{
+		vkDestroyImageView(device, mipView, nullptr);
+	}
+	mipViews.clear();
+	vkDestroyImageView(device, imageView, nullptr);
+	imageView = VK_NULL_HANDLE;
+	graphics->DestroyImage(image, imageMemory);
+
+	isBuilt = false;
+}
+
+void DepthPyramid::Record(VkCommandBuffer commandBuffer)
+{
+	if (image == VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	// Culling passes of this frame have read the pyramid before the render pass.
+	RecordComputeBarrier(commandBuffer, VK_ACCESS_SHADER_READ_BIT, VK_ACCESS_SHADER_WRITE_BIT);
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline->GetPipeline());
+
+	VkExtent2D sourceExtent = graphics->GetSwapchainExtent();
+	VkExtent2D destinationExtent = extent;
+	for (uint32_t i = 0; i < mipLevels; i++)
+	{
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline->GetPipelineLayout(), 0, 1, descriptorSet->GetDescriptorSetPtr(i), 0, nullptr);
+
+		const DepthPyramidPushConstants pushConstants{
+			{ static_cast<int32_t>(sourceExtent.width), static_cast<int32_t>(sourceExtent.height) },
+			{ static_cast<int32_t>(destinationExtent.width), static_cast<int32_t>(destinationExtent.height) }
+		};
+		vkCmdPushConstants(commandBuffer, pipeline->GetPipelineLayout(), VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(DepthPyramidPushConstants), &pushConstants);
+		vkCmdDispatch(commandBuffer, (destinationExtent.width + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, (destinationExtent.height + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, 1);
+
+		// The next level reads this level. After the last level, culling passes of the next frame read the pyramid.
+		RecordComputeBarrier(commandBuffer, VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT);
+
+		sourceExtent = destinationExtent;
+		destinationExtent.width = std::max(destinationExtent.width / 2, 1u);
+		destinationExtent.height = std::max(destinationExtent.height / 2, 1u);
+	}
+
+	isBuilt = true;
+}
+
+bool DepthPyramid::ReloadShader(const std::string& spvPath, const std::string& reloadedPath)
+{
+	return pipeline->OverrideShader(spvPath, reloadedPath) && pipeline->Rebuild();
+}
+
+bool DepthPyramid::IsBuilt() const
+{
+	return isBuilt;
+}
+
+VkImageView DepthPyramid::GetImageView() const
+{
+	return imageView;
+}
+
+VkSampler DepthPyramid::GetSampler() const
+{
+	return sampler;
+}
+
+VkExtent2D DepthPyramid::GetExtent() const
+{
+	return extent;
+}
+
+uint32_t DepthPyramid::GetMipLevels() const
+{
+	return mipLevels;
+}
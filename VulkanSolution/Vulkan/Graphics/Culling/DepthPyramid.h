@@ -0,0 +1,75 @@
+/******************************************************************************
+Copyright (C) 2022 DigiPen Institute of Technology.
+Reproduction or disclosure of this file or its contents without the prior
+written consent of DigiPen Institute of Technology is prohibited.
+File Name:   DepthPyramid.h
+Author
+	- sinil.kang	rtd99062@gmail.com
+Creation Date: 12.24.2022
+	header file for the hierarchical depth buffer used by occlusion culling.
+******************************************************************************/
+#pragma once
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <Graphics/Allocator/MemoryAllocator.h>
+
+class Graphics;
+class Pipeline;
+class DescriptorSet;
+
+// Mip chain of the depth buffer, where each texel holds the farthest depth of the texels it covers.
+// It is built from the depth buffer at the end of every frame, and read by culling passes of the next frame.
+// Level 0 is half the size of the depth buffer, and odd rows and columns are folded into the last texels.
+class DepthPyramid
+{
+public:
+	static constexpr uint32_t WORKGROUP_SIZE = 8;
+	static constexpr const char* SHADER_PATH = "spv/depthPyramid.comp.spv";
+public:
+	DepthPyramid();
+	~DepthPyramid();
+
+	// Build the pipeline. Images are made by Create().
+	void Init(Graphics* graphics);
+	void Clean();
+
+	// Called whenever the depth buffer is recreated. The pyramid is not built until the next Record().
+	void Create(VkImageView depthImageView, VkExtent2D depthExtent);
+	void Destroy();
+
+	// Recorded after the render pass, whose depth attachment is left readable by compute shaders.
+	void Record(VkCommandBuffer commandBuffer);
+	// Rebuild the pipeline from reloadedPath if it uses spvPath. Recorded every frame, so the next Record() binds the new pipeline.
+	bool ReloadShader(const std::string& spvPath, const std::string& reloadedPath);
+
+	// False until the pyramid of the current depth buffer is recorded.
+	bool IsBuilt() const;
+	// Every mip level in VK_IMAGE_LAYOUT_GENERAL.
+	VkImageView GetImageView() const;
+	// Nearest filter, so a sample is the depth of one texel.
+	VkSampler GetSampler() const;
+	VkExtent2D GetExtent() const;
+	uint32_t GetMipLevels() const;
+private:
+	Graphics* graphics;
+	VkDevice device;
+
+	VkImage image;
+	MemoryAllocation imageMemory;
+	VkImageView imageView;
+	// One view per level, written as storage images.
+	std::vector<VkImageView> mipViews;
+	VkExtent2D extent;
+	uint32_t mipLevels;
+	VkSampler sampler;
+
+	std::vector<VkDescriptorSetLayoutBinding> layoutBindings;
+	VkDescriptorSetLayout descriptorSetLayout;
+	// Set i reduces level i - 1, or the depth buffer for level 0, into level i.
+	DescriptorSet* descriptorSet;
+	Pipeline* pipeline;
+
+	bool isBuilt;
+};
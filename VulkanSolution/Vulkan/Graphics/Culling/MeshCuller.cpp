@@ -0,0 +1,303 @@
+/******************************************************************************
+Copyright (C) 2022 DigiPen Institute of Technology.
+Reproduction or disclosure of this file or its contents without the prior
+written consent of DigiPen Institute of Technology is prohibited.
+File Name:   MeshCuller.cpp
+Author
+	- sinil.kang	rtd99062@gmail.com
+Creation Date: 12.24.2022
+	source file for culling meshes on the GPU before they are drawn.
+******************************************************************************/
+#include "MeshCuller.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <Graphics/Graphics.h>
+#include <Graphics/DescriptorSet.h>
+#include <Graphics/Pipelines/Pipeline.h>
+#include <Engines/CPUProfiler.h>
+
+namespace
+{
+	// One count per recording thread.
+	constexpr uint32_t MAX_GROUP_COUNT = Graphics::MAX_RECORDING_THREADS;
+	// Weights of a vertex should sum to 1 for its position to be in the boxes of its bones.
+	constexpr float WEIGHT_SUM_TOLERANCE = 1e-3f;
+}
+
+MeshCuller::MeshCuller(Graphics* graphics, std::string name, const std::vector<std::vector<CullingBox>>& meshBoxes)
+	: Object(name), graphics(graphics), boxBuffer(VK_NULL_HANDLE), boxBufferMemory(), boxCapacity(0), meshBoxRanges(), frames(), drawCapacity(0), meshDraws(),
+	uniformBuffer(VK_NULL_HANDLE), sceneRange(0), animationRange(0), writtenSwapchainGeneration(0), descriptorSet(nullptr), pipeline(nullptr), previousModelViewProjection(1.f), hasPreviousFrame(false)
+{
+	// Bindings in the order of meshCulling.comp. One descriptor set per frame in flight, since draw buffers are per frame.
+	descriptorSet = new DescriptorSet(graphics, name + "Descriptor", Graphics::MAX_FRAMES_IN_FLIGHT, {
+		{0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr},
+		{1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr},
+		{2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr},
+		{3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr},
+		{4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr},
+		{5, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr},
+		{6, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr}
+		});
+
+	PipelineDescription description;
+	description.name = name + "Pipeline";
+	description.pushConstantSize = sizeof(CullingPushConstants);
+	description.pushConstantTargetStage = VK_SHADER_STAGE_COMPUTE_BIT;
+	description.descriptorSetLayouts = { *descriptorSet->GetDescriptorSetLayoutPtr() };
+	description.compShader = SHADER_PATH;
+	pipeline = new Pipeline(graphics, description);
+
+	ChangeMeshes(meshBoxes);
+}
+
+MeshCuller::~MeshCuller()
+{
+	Clean();
+}
+
+bool MeshCuller::Init()
+{
+	return true;
+}
+
+void MeshCuller::Update(float dt)
+{
+}
+
+void MeshCuller::Clean()
+{
+	DestroyFrameBuffers();
+	if (boxBuffer != VK_NULL_HANDLE)
+	{
+		graphics->DestroyBuffer(boxBuffer, boxBufferMemory);
+	}
+	boxCapacity = 0;
+	meshBoxRanges.clear();
+
+	delete pipeline;
+	pipeline = nullptr;
+	delete descriptorSet;
+	descriptorSet = nullptr;
+}
+
+std::vector<CullingBox> MeshCuller::CalculateBoneBoxes(const Vertex* vertices, size_t vertexCount, size_t boneCount)
+{
+	// Index of the box of each bone, -1 if no vertex is influenced by the bone.
+	std::vector<int> boxIndices(boneCount, -1);
+	std::vector<CullingBox> boxes;
+	for (size_t i = 0; i < vertexCount; i++)
+	{
+		const Vertex& vertex = vertices[i];
+		const float weightSum = vertex.boneWeights.x + vertex.boneWeights.y + vertex.boneWeights.z + vertex.boneWeights.w;
+		if (std::isfinite(weightSum) == false || std::abs(weightSum - 1.f) > WEIGHT_SUM_TOLERANCE)
+		{
+			return {};
+		}
+
+		for (int k = 0; k < 4; k++)
+		{
+			if (vertex.boneWeights[k] == 0.f)
+			{
+				continue;
+			}
+			const int boneID = vertex.boneIDs[k];
+			if (vertex.boneWeights[k] < 0.f || boneID < 0 || static_cast<size_t>(boneID) >= boneCount)
+			{
+				return {};
+			}
+
+			if (boxIndices[boneID] < 0)
+			{
+				boxIndices[boneID] = static_cast<int>(boxes.size());
+				boxes.push_back({ vertex.position, boneID, vertex.position, 0.f });
+			}
+			CullingBox& box = boxes[boxIndices[boneID]];
+			box.minimum = glm::min(box.minimum, vertex.position);
+			box.maximum = glm::max(box.maximum, vertex.position);
+		}
+	}
+	return boxes;
+}
+
+void MeshCuller::ChangeMeshes(const std::vector<std::vector<CullingBox>>& meshBoxes)
+{
+	std::vector<CullingBox> boxes;
+	meshBoxRanges.resize(meshBoxes.size());
+	for (size_t i = 0; i < meshBoxes.size(); i++)
+	{
+		meshBoxRanges[i] = { static_cast<uint32_t>(boxes.size()), static_cast<uint32_t>(meshBoxes[i].size()) };
+		boxes.insert(boxes.end(), meshBoxes[i].begin(), meshBoxes[i].end());
+	}
+
+	// Storage buffers cannot be empty.
+	const VkDeviceSize boxSize = sizeof(CullingBox) * std::max<size_t>(boxes.size(), 1);
+	if (boxSize > boxCapacity)
+	{
+		if (boxBuffer != VK_NULL_HANDLE)
+		{
+			graphics->DestroyBuffer(boxBuffer, boxBufferMemory);
+		}
+		graphics->CreateBuffer(boxSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, boxBuffer, boxBufferMemory);
+		boxCapacity = boxSize;
+	}
+	if (boxes.empty() == false)
+	{
+		graphics->UploadBufferData(boxBuffer, boxes.data(), sizeof(CullingBox) * boxes.size());
+	}
+
+	const uint32_t drawCount = static_cast<uint32_t>(std::max<size_t>(meshBoxes.size(), 1));
+	if (drawCount > drawCapacity)
+	{
+		DestroyFrameBuffers();
+		CreateFrameBuffers(drawCount);
+	}
+
+	WriteDescriptorSets();
+}
+
+void MeshCuller::WriteUniformBuffer(VkBuffer _uniformBuffer, VkDeviceSize _sceneRange, VkDeviceSize _animationRange)
+{
+	uniformBuffer = _uniformBuffer;
+	sceneRange = _sceneRange;
+	animationRange = _animationRange;
+
+	WriteDescriptorSets();
+}
+
+void MeshCuller::UpdateDraws(uint32_t frameID, const std::vector<VkDrawIndexedIndirectCommand>& commands, const std::vector<uint32_t>& groupFirstDraws)
+{
+	meshDraws.resize(std::min<size_t>(commands.size(), meshBoxRanges.size()));
+	uint32_t group = 0;
+	for (uint32_t i = 0; i < static_cast<uint32_t>(meshDraws.size()); i++)
+	{
+		while (group + 1 < groupFirstDraws.size() && groupFirstDraws[group + 1] <= i)
+		{
+			group++;
+		}
+
+		MeshDraw& draw = meshDraws[i];
+		draw.command = commands[i];
+		draw.firstBox = meshBoxRanges[i].first;
+		draw.boxCount = meshBoxRanges[i].second;
+		draw.countIndex = std::min(group, MAX_GROUP_COUNT - 1);
+		draw.firstOutput = groupFirstDraws.empty() ? 0 : groupFirstDraws[draw.countIndex];
+	}
+
+	// Host coherent memory does not need flush.
+	if (meshDraws.empty() == false)
+	{
+		memcpy(frames[frameID].meshDrawBufferMemory.mappedData, meshDraws.data(), sizeof(MeshDraw) * meshDraws.size());
+	}
+}
+
+void MeshCuller::Record(VkCommandBuffer commandBuffer, uint32_t frameID, const uint32_t* dynamicOffsets, const glm::mat4& modelViewProjection)
+{
+	PROFILE_FUNCTION();
+	// Swapchain is recreated after the device is idle, so no descriptor set is in use.
+	if (writtenSwapchainGeneration != graphics->GetSwapchainGeneration())
+	{
+		WriteDescriptorSets();
+	}
+
+	FrameBuffers& frame = frames[frameID];
+	vkCmdFillBuffer(commandBuffer, frame.drawCountBuffer, 0, sizeof(uint32_t) * MAX_GROUP_COUNT, 0);
+
+	// Depth pyramid of the previous frame is already made visible by the barrier at the end of its pass.
+	VkMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+	if (meshDraws.empty() == false)
+	{
+		const DepthPyramid& depthPyramid = graphics->GetDepthPyramid();
+		CullingPushConstants pushConstants{};
+		pushConstants.previousModelViewProjection = previousModelViewProjection;
+		pushConstants.pyramidSize = glm::vec2(depthPyramid.GetExtent().width, depthPyramid.GetExtent().height);
+		pushConstants.drawCount = static_cast<uint32_t>(meshDraws.size());
+		pushConstants.isOcclusionEnabled = (hasPreviousFrame && depthPyramid.IsBuilt()) ? 1 : 0;
+
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline->GetPipeline());
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline->GetPipelineLayout(), 0, 1, descriptorSet->GetDescriptorSetPtr(frameID), 2, dynamicOffsets);
+		vkCmdPushConstants(commandBuffer, pipeline->GetPipelineLayout(), VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(CullingPushConstants), &pushConstants);
+		vkCmdDispatch(commandBuffer, (pushConstants.drawCount + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, 1, 1);
+	}
+
+	// Compacted commands and counts are read by indirect draws in the render pass.
+	barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+	previousModelViewProjection = modelViewProjection;
+	hasPreviousFrame = true;
+}
+
+bool MeshCuller::ReloadShader(const std::string& spvPath, const std::string& reloadedPath)
+{
+	return pipeline->OverrideShader(spvPath, reloadedPath) && pipeline->Rebuild();
+}
+
+VkBuffer MeshCuller::GetDrawBuffer(uint32_t frameID)
+{
+	return frames[frameID].drawBuffer;
+}
+
+VkBuffer MeshCuller::GetDrawCountBuffer(uint32_t frameID)
+{
+	return frames[frameID].drawCountBuffer;
+}
+
+VkDeviceSize MeshCuller::GetDrawCountOffset(uint32_t group)
+{
+	return sizeof(uint32_t) * static_cast<VkDeviceSize>(group);
+}
+
+void MeshCuller::CreateFrameBuffers(uint32_t _drawCapacity)
+{
+	drawCapacity = _drawCapacity;
+	frames.resize(Graphics::MAX_FRAMES_IN_FLIGHT);
+	for (FrameBuffers& frame : frames)
+	{
+		graphics->CreateBuffer(sizeof(MeshDraw) * static_cast<VkDeviceSize>(drawCapacity), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, frame.meshDrawBuffer, frame.meshDrawBufferMemory);
+		graphics->CreateBuffer(sizeof(VkDrawIndexedIndirectCommand) * static_cast<VkDeviceSize>(drawCapacity), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, frame.drawBuffer, frame.drawBufferMemory);
+		graphics->CreateBuffer(sizeof(uint32_t) * MAX_GROUP_COUNT, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, frame.drawCountBuffer, frame.drawCountBufferMemory);
+	}
+}
+
+void MeshCuller::DestroyFrameBuffers()
+{
+	for (FrameBuffers& frame : frames)
+	{
+		graphics->DestroyBuffer(frame.meshDrawBuffer, frame.meshDrawBufferMemory);
+		graphics->DestroyBuffer(frame.drawBuffer, frame.drawBufferMemory);
+		graphics->DestroyBuffer(frame.drawCountBuffer, frame.drawCountBufferMemory);
+	}
+	frames.clear();
+	drawCapacity = 0;
+}
+
+void MeshCuller::WriteDescriptorSets()
+{
+	// Written again by WriteUniformBuffer() before the first Record().
+	if (uniformBuffer == VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	const DepthPyramid& depthPyramid = graphics->GetDepthPyramid();
+	for (uint32_t i = 0; i < Graphics::MAX_FRAMES_IN_FLIGHT; i++)
+	{
+		descriptorSet->Write(i, {
+			DescriptorSet::MakeBufferInfo(uniformBuffer, sceneRange),
+			DescriptorSet::MakeBufferInfo(uniformBuffer, animationRange),
+			DescriptorSet::MakeBufferInfo(boxBuffer, VK_WHOLE_SIZE),
+			DescriptorSet::MakeBufferInfo(frames[i].meshDrawBuffer, VK_WHOLE_SIZE),
+			DescriptorSet::MakeBufferInfo(frames[i].drawBuffer, VK_WHOLE_SIZE),
+			DescriptorSet::MakeBufferInfo(frames[i].drawCountBuffer, VK_WHOLE_SIZE),
+			DescriptorSet::MakeImageInfo(depthPyramid.GetImageView(), depthPyramid.GetSampler(), VK_IMAGE_LAYOUT_GENERAL)
+			});
+	}
+	writtenSwapchainGeneration = graphics->GetSwapchainGeneration();
+}
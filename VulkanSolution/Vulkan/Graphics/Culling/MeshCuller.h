@@ -0,0 +1,127 @@
+/******************************************************************************
+Copyright (C) 2022 DigiPen Institute of Technology.
+Reproduction or disclosure of this file or its contents without the prior
+written consent of DigiPen Institute of Technology is prohibited.
+File Name:   MeshCuller.h
+Author
+	- sinil.kang	rtd99062@gmail.com
+Creation Date: 12.24.2022
+	header file for culling meshes on the GPU before they are drawn.
+******************************************************************************/
+#pragma once
+#include <Engines/Objects/Object.h>
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <cstdint>
+#include <Graphics/Allocator/MemoryAllocator.h>
+#include <Graphics/Structures/Structs.h>
+
+class Graphics;
+class Pipeline;
+class DescriptorSet;
+
+// Box of the vertices influenced by a bone, in the bind pose. Layout of CullingBox in meshCulling.comp.
+struct CullingBox
+{
+	glm::vec3 minimum;
+	int32_t boneID;
+	glm::vec3 maximum;
+	float padding;
+};
+
+// A compute pass tests the bounds of every mesh against the view frustum and the depth pyramid of the previous frame.
+// Commands of visible meshes are compacted and counted on the GPU, so they are drawn by vkCmdDrawIndexedIndirectCount.
+// Draws are split into groups, such as the meshes of each recording thread. Visible draws of a group are compacted
+	// into the range of the group in the draw buffer, and counted by its own count.
+class MeshCuller : public Object
+{
+public:
+	static constexpr uint32_t WORKGROUP_SIZE = 64;
+	static constexpr const char* SHADER_PATH = "spv/meshCulling.comp.spv";
+public:
+	MeshCuller(Graphics* graphics, std::string name, const std::vector<std::vector<CullingBox>>& meshBoxes);
+	~MeshCuller();
+
+	bool Init();
+	void Update(float dt);
+	void Clean();
+
+	// Skinned positions are weighted sums of the bone transforms, so the boxes of its bones bound the mesh in any pose.
+	// Empty if boxes cannot bound the mesh, for example if weights are not normalized or a bone is missing. Such a mesh is never culled.
+	static std::vector<CullingBox> CalculateBoneBoxes(const Vertex* vertices, size_t vertexCount, size_t boneCount);
+
+	// Buffers are kept if the meshes fit in them. Device should be idle.
+	void ChangeMeshes(const std::vector<std::vector<CullingBox>>& meshBoxes);
+	// Written in the same layout as dynamic uniform buffers of the model, whose blocks are selected by dynamic offsets. Device should be idle.
+	void WriteUniformBuffer(VkBuffer uniformBuffer, VkDeviceSize sceneRange, VkDeviceSize animationRange);
+
+	// Commands of every mesh for this frame, in the order of meshes. Commands without instance are neither tested nor drawn.
+		// Group i covers meshes in [groupFirstDraws[i], groupFirstDraws[i + 1]), and the last one ends at the last mesh.
+	void UpdateDraws(uint32_t frameID, const std::vector<VkDrawIndexedIndirectCommand>& commands, const std::vector<uint32_t>& groupFirstDraws);
+	// Recorded outside of the render pass. dynamicOffsets select the scene and the animation blocks of this frame.
+		// modelViewProjection is kept for the occlusion test of the next frame, which reads the depth of this frame.
+	void Record(VkCommandBuffer commandBuffer, uint32_t frameID, const uint32_t* dynamicOffsets, const glm::mat4& modelViewProjection);
+	// Rebuild the pipeline from reloadedPath if it uses spvPath. Recorded every frame, so the next Record() binds the new pipeline.
+	bool ReloadShader(const std::string& spvPath, const std::string& reloadedPath);
+
+	// Visible commands of group i start at the first draw of the group.
+	VkBuffer GetDrawBuffer(uint32_t frameID);
+	VkBuffer GetDrawCountBuffer(uint32_t frameID);
+	VkDeviceSize GetDrawCountOffset(uint32_t group);
+private:
+	// Layout of MeshDraw in meshCulling.comp.
+	struct MeshDraw
+	{
+		VkDrawIndexedIndirectCommand command;
+		uint32_t firstBox;
+		uint32_t boxCount;
+		uint32_t countIndex;
+		uint32_t firstOutput;
+	};
+	// Layout of PushConstants in meshCulling.comp.
+	struct CullingPushConstants
+	{
+		glm::mat4 previousModelViewProjection;
+		glm::vec2 pyramidSize;
+		uint32_t drawCount;
+		uint32_t isOcclusionEnabled;
+	};
+	struct FrameBuffers
+	{
+		// Host visible, written by UpdateDraws().
+		VkBuffer meshDrawBuffer;
+		MemoryAllocation meshDrawBufferMemory;
+		VkBuffer drawBuffer;
+		MemoryAllocation drawBufferMemory;
+		VkBuffer drawCountBuffer;
+		MemoryAllocation drawCountBufferMemory;
+	};
+
+	void CreateFrameBuffers(uint32_t drawCapacity);
+	void DestroyFrameBuffers();
+	void WriteDescriptorSets();
+
+	Graphics* graphics;
+
+	VkBuffer boxBuffer;
+	MemoryAllocation boxBufferMemory;
+	VkDeviceSize boxCapacity;
+	// First box and box count of each mesh.
+	std::vector<std::pair<uint32_t, uint32_t>> meshBoxRanges;
+
+	std::vector<FrameBuffers> frames;
+	uint32_t drawCapacity;
+	std::vector<MeshDraw> meshDraws;
+
+	VkBuffer uniformBuffer;
+	VkDeviceSize sceneRange;
+	VkDeviceSize animationRange;
+	// Depth pyramid is recreated with the swapchain, so descriptor sets are written again.
+	uint32_t writtenSwapchainGeneration;
+
+	DescriptorSet* descriptorSet;
+	Pipeline* pipeline;
+
+	glm::mat4 previousModelViewProjection;
+	bool hasPreviousFrame;
+};
@@ -11,52 +11,30 @@ Creation Date 11.05.2022
 ******************************************************************************/
 #include "Graphics/DescriptorSet.h"
 #include "Helper/VulkanHelper.h"
+#include <iostream>
 #include <Graphics/Graphics.h>
 
 DescriptorSet::DescriptorSet(Graphics* graphics, std::string name, unsigned int descriptorSetSize, std::vector<VkDescriptorSetLayoutBinding> layoutBindings)
-	:Object(name), descriptorSetSize(descriptorSetSize), descriptorPool(0), descriptorSetLayout(0), descriptorSets(descriptorSetSize), bindingTable(layoutBindings)
+	:Object(name), graphics(graphics), descriptorSetLayout(0), allocations(descriptorSetSize), descriptorSets(descriptorSetSize), updateTemplate(0), descriptorCount(0), bindingTable(layoutBindings)
 {
 	device = graphics->GetDevice();
 
-	/// @@ Create Descriptor Set Layout
-	VkDescriptorSetLayoutCreateInfo layoutCreateInfo{};
-	layoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-	layoutCreateInfo.bindingCount = bindingTable.size();
-	layoutCreateInfo.pBindings = bindingTable.data();
-
-	VulkanHelper::VkCheck(vkCreateDescriptorSetLayout(device, &layoutCreateInfo, nullptr, &descriptorSetLayout), "Creating descriptor set layout has failed!");
-	/// @@ End of creating Descriptor Set Layout
+	descriptorSetLayout = graphics->GetDescriptorSetLayoutCache().Acquire(bindingTable);
 
+	/// @@ Allocate Descriptor Sets
+	DescriptorAllocator& descriptorAllocator = graphics->GetDescriptorAllocator();
+	for (size_t i = 0; i < allocations.size(); i++)
+	{
+		if (descriptorAllocator.Allocate(descriptorSetLayout, allocations[i]) == false)
+		{
+			std::cout << "Allocating descriptor sets has failed!" << std::endl;
+			continue;
+		}
+		descriptorSets[i] = allocations[i].descriptorSet;
+	}
+	/// @@ End of allocating Descriptor Sets
 
-	/// @@ Create Descriptor Pool
-	// Assemble the same type descriptor set bindings to the sum of them in one descriptor type.
-	std::vector<VkDescriptorPoolSize> poolSizes;
-	CreateDescriptorPoolSize(poolSizes);
-	
-	VkDescriptorPoolCreateInfo poolInfo{};
-	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-	poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
-	poolInfo.pPoolSizes = poolSizes.data();
-	poolInfo.maxSets = descriptorSetSize;
-
-	VulkanHelper::VkCheck(vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptorPool), "Creating descriptor pool has failed!");
-	/// @@ End of creating Descriptor Pool
-
-
-	/// @@ Create Descriptor Sets
-	std::vector<VkDescriptorSetLayout> layouts(descriptorSetSize, descriptorSetLayout);
-	VkDescriptorSetAllocateInfo allocInfo{};
-	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-	allocInfo.pNext = nullptr;
-	allocInfo.descriptorPool = descriptorPool;
-	allocInfo.descriptorSetCount = static_cast<uint32_t>(descriptorSetSize);
-	allocInfo.pSetLayouts = layouts.data();
-
-	// vkAllocateDescriptorSets may fail with the error code VK_ERROR_POOL_OUT_OF_MEMORY 
-		// if the pool is not sufficiently large, 
-		// but the driver may also try to solve the problem internally.
-	VulkanHelper::VkCheck(vkAllocateDescriptorSets(device, &allocInfo, descriptorSets.data()), "Allocating descriptor sets has failed!");
-	/// @@ End of creating Descriptor Sets
+	CreateUpdateTemplate();
 }
 
 DescriptorSet::~DescriptorSet()
@@ -75,58 +53,21 @@ void DescriptorSet::Update(float dt)
 
 void DescriptorSet::Clean()
 {
-	vkDestroyDescriptorPool(device, descriptorPool, nullptr);
-	vkDestroyDescriptorSetLayout(device, descriptorSetLayout, nullptr);
-}
+	if (descriptorSetLayout == VK_NULL_HANDLE)
+	{
+		return;
+	}
 
-void DescriptorSet::ChangeDescriptorSet(unsigned int _descriptorSetSize, std::vector<VkDescriptorSetLayoutBinding> layoutBindings)
-{
-	vkDestroyDescriptorPool(device, descriptorPool, nullptr);
-	vkDestroyDescriptorSetLayout(device, descriptorSetLayout, nullptr);
-
-	descriptorSetSize = _descriptorSetSize;
-	bindingTable = layoutBindings;
-
-	/// @@ Create Descriptor Set Layout
-	VkDescriptorSetLayoutCreateInfo layoutCreateInfo{};
-	layoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-	layoutCreateInfo.bindingCount = bindingTable.size();
-	layoutCreateInfo.pBindings = bindingTable.data();
-
-	VulkanHelper::VkCheck(vkCreateDescriptorSetLayout(device, &layoutCreateInfo, nullptr, &descriptorSetLayout), "Creating descriptor set layout has failed!");
-	/// @@ End of creating Descriptor Set Layout
-
-
-	/// @@ Create Descriptor Pool
-	// Assemble the same type descriptor set bindings to the sum of them in one descriptor type.
-	std::vector<VkDescriptorPoolSize> poolSizes;
-	CreateDescriptorPoolSize(poolSizes);
-
-	VkDescriptorPoolCreateInfo poolInfo{};
-	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-	poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
-	poolInfo.pPoolSizes = poolSizes.data();
-	poolInfo.maxSets = descriptorSetSize;
-
-	VulkanHelper::VkCheck(vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptorPool), "Creating descriptor pool has failed!");
-	/// @@ End of creating Descriptor Pool
-
-
-	/// @@ Create Descriptor Sets
-	std::vector<VkDescriptorSetLayout> layouts(descriptorSetSize, descriptorSetLayout);
-	VkDescriptorSetAllocateInfo allocInfo{};
-	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-	allocInfo.pNext = nullptr;
-	allocInfo.descriptorPool = descriptorPool;
-	allocInfo.descriptorSetCount = static_cast<uint32_t>(descriptorSetSize);
-	allocInfo.pSetLayouts = layouts.data();
-
-	descriptorSets.resize(descriptorSetSize);
-	// vkAllocateDescriptorSets may fail with the error code VK_ERROR_POOL_OUT_OF_MEMORY 
-		// if the pool is not sufficiently large, 
-		// but the driver may also try to solve the problem internally.
-	VulkanHelper::VkCheck(vkAllocateDescriptorSets(device, &allocInfo, descriptorSets.data()), "Allocating descriptor sets has failed!");
-	/// @@ End of creating Descriptor Sets
+	vkDestroyDescriptorUpdateTemplate(device, updateTemplate, nullptr);
+	for (DescriptorAllocation& allocation : allocations)
+	{
+		graphics->GetDescriptorAllocator().Free(allocation);
+	}
+	graphics->GetDescriptorSetLayoutCache().Release(descriptorSetLayout);
+
+	updateTemplate = VK_NULL_HANDLE;
+	descriptorSets.clear();
+	descriptorSetLayout = VK_NULL_HANDLE;
 }
 
 VkDescriptorSetLayout* DescriptorSet::GetDescriptorSetLayoutPtr()
@@ -152,6 +93,14 @@ void DescriptorSet::Write(size_t descriptorIndex, uint32_t dstBinding, const VkB
 	descriptorWrite.dstBinding = dstBinding;
 	descriptorWrite.dstArrayElement = 0;
 	descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+	for (const VkDescriptorSetLayoutBinding& binding : bindingTable)
+	{
+		if (binding.binding == dstBinding)
+		{
+			descriptorWrite.descriptorType = binding.descriptorType;
+			break;
+		}
+	}
 	descriptorWrite.descriptorCount = 1;
 	descriptorWrite.pBufferInfo = &bufferInfo;
 
@@ -178,34 +127,60 @@ void DescriptorSet::Write(size_t descriptorIndex, uint32_t dstBinding, const VkI
 	vkUpdateDescriptorSets(device, 1, &descriptorWrite, 0, nullptr);
 }
 
-void DescriptorSet::CreateDescriptorPoolSize(std::vector<VkDescriptorPoolSize>& poolSizes)
+void DescriptorSet::Write(size_t descriptorIndex, const std::vector<DescriptorInfo>& infos)
 {
-	for (auto bindingIter = bindingTable.cbegin(); bindingIter != bindingTable.cend(); ++bindingIter)
+	if (infos.size() != descriptorCount)
 	{
-		bool duplicatedType = false;
+		std::cout << "Descriptor infos do not match the bindings of " << GetName() << "!" << std::endl;
+		return;
+	}
 
-		for (auto poolSizeIter = poolSizes.begin(); poolSizeIter != poolSizes.end(); ++poolSizeIter)
-		{
-			// If poolSizes already has the same type of the bindingTable element,
-				// Update descriptor count and stop inner loop.
-			if (poolSizeIter->type == bindingIter->descriptorType)
-			{
-				duplicatedType = true;
-
-				poolSizeIter->descriptorCount += bindingIter->descriptorCount * descriptorSetSize;
-				break;
-			}
-		}
+	vkUpdateDescriptorSetWithTemplate(device, descriptorSets[descriptorIndex], updateTemplate, infos.data());
+}
 
-		// If there was no element has the same type, 
-			// add new element to the pool size.
-		if (duplicatedType == false)
-		{
-			VkDescriptorPoolSize descriptorPoolSize{};
-			descriptorPoolSize.type = bindingIter->descriptorType;
-			descriptorPoolSize.descriptorCount = bindingIter->descriptorCount * descriptorSetSize;
+DescriptorInfo DescriptorSet::MakeBufferInfo(const VkBuffer& buffer, VkDeviceSize range)
+{
+	DescriptorInfo info{};
+	info.buffer.buffer = buffer;
+	info.buffer.offset = 0;
+	info.buffer.range = range;
+	return info;
+}
 
-			poolSizes.push_back(descriptorPoolSize);
-		}
+DescriptorInfo DescriptorSet::MakeImageInfo(const VkImageView& imageView, const VkSampler& sampler, VkImageLayout imageLayout)
+{
+	DescriptorInfo info{};
+	info.image.imageLayout = imageLayout;
+	info.image.imageView = imageView;
+	info.image.sampler = sampler;
+	return info;
+}
+
+void DescriptorSet::CreateUpdateTemplate()
+{
+	// Descriptors of every binding are packed in one array of DescriptorInfo.
+	std::vector<VkDescriptorUpdateTemplateEntry> entries;
+	entries.reserve(bindingTable.size());
+	for (const VkDescriptorSetLayoutBinding& binding : bindingTable)
+	{
+		VkDescriptorUpdateTemplateEntry entry{};
+		entry.dstBinding = binding.binding;
+		entry.dstArrayElement = 0;
+		entry.descriptorCount = binding.descriptorCount;
+		entry.descriptorType = binding.descriptorType;
+		entry.offset = descriptorCount * sizeof(DescriptorInfo);
+		entry.stride = sizeof(DescriptorInfo);
+		entries.push_back(entry);
+
+		descriptorCount += binding.descriptorCount;
 	}
+
+	VkDescriptorUpdateTemplateCreateInfo templateInfo{};
+	templateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO;
+	templateInfo.descriptorUpdateEntryCount = static_cast<uint32_t>(entries.size());
+	templateInfo.pDescriptorUpdateEntries = entries.data();
+	templateInfo.templateType = VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET;
+	templateInfo.descriptorSetLayout = descriptorSetLayout;
+
+	VulkanHelper::VkCheck(vkCreateDescriptorUpdateTemplate(device, &templateInfo, nullptr, &updateTemplate), "Creating descriptor update template has failed!");
 }
@@ -12,10 +12,20 @@ Creation Date 11.05.2022
 
 #include <vector>
 #include <Engines/Objects/Object.h>
+#include <Graphics/Allocator/DescriptorAllocator.h>
 #include <vulkan/vulkan.h>
 
 class Graphics;
 
+// One descriptor of a binding, for writing every binding of a set at once.
+union DescriptorInfo
+{
+	VkDescriptorBufferInfo buffer;
+	VkDescriptorImageInfo image;
+};
+
+// Layouts are shared through the layout cache of Graphics, and sets are allocated from its descriptor allocator.
+// Every binding of a set can be rewritten by one vkUpdateDescriptorSetWithTemplate call.
 class DescriptorSet : public Object
 {
 public:
@@ -26,23 +36,30 @@ public:
 	void Update(float dt);
 	void Clean();
 
-	void ChangeDescriptorSet(unsigned int descriptorSetSize, std::vector<VkDescriptorSetLayoutBinding> layoutBindings);
-
 	VkDescriptorSetLayout* GetDescriptorSetLayoutPtr();
 	VkDescriptorSet* GetDescriptorSetPtr(size_t index);
 
+	// Descriptor type of the binding is used, so it also writes VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC bindings.
 	void Write(size_t descriptorIndex, uint32_t dstBinding, const VkBuffer& buffer, VkDeviceSize range);
 	void Write(size_t descriptorIndex, uint32_t dstBinding, const VkImageView& imageView, const VkSampler& sampler);
+	// Write every binding with the update template. infos has descriptorCount elements per binding, in order of the layout bindings.
+	void Write(size_t descriptorIndex, const std::vector<DescriptorInfo>& infos);
+
+	static DescriptorInfo MakeBufferInfo(const VkBuffer& buffer, VkDeviceSize range);
+	// Storage images and images written by compute shaders are usually in VK_IMAGE_LAYOUT_GENERAL.
+	static DescriptorInfo MakeImageInfo(const VkImageView& imageView, const VkSampler& sampler, VkImageLayout imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
 private:
-	void CreateDescriptorPoolSize(std::vector<VkDescriptorPoolSize>& poolSizes);
+	void CreateUpdateTemplate();
 
+	Graphics* graphics;
 	VkDevice device;
 
-	unsigned int descriptorSetSize;
-
-	VkDescriptorPool descriptorPool;
 	VkDescriptorSetLayout descriptorSetLayout;
+	std::vector<DescriptorAllocation> allocations;
 	std::vector<VkDescriptorSet> descriptorSets;
+	VkDescriptorUpdateTemplate updateTemplate;
+	// Sum of descriptorCount of every binding.
+	size_t descriptorCount;
 
 	std::vector<VkDescriptorSetLayoutBinding> bindingTable;
-};
\ No newline at end of file
+};
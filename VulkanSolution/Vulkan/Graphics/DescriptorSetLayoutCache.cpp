@@ -0,0 +1,107 @@
+/******************************************************************************
+Copyright (C) 2022 DigiPen Institute of Technology.
+Reproduction or disclosure of this file or its contents without the prior
+written consent of DigiPen Institute of Technology is prohibited.
+File Name:   DescriptorSetLayoutCache.cpp
+Author
+	- sinil.kang	rtd99062@gmail.com
+Creation Date: 12.24.2022
+	source file for cache of shared descriptor set layouts.
+******************************************************************************/
+#include <iostream>
+#include "DescriptorSetLayoutCache.h"
+#include <Helper/VulkanHelper.h>
+
+DescriptorSetLayoutCache::DescriptorSetLayoutCache()
+	: device(VK_NULL_HANDLE), entries(), mutex()
+{
+}
+
+DescriptorSetLayoutCache::~DescriptorSetLayoutCache()
+{
+}
+
+void DescriptorSetLayoutCache::Init(VkDevice _device)
+{
+	device = _device;
+}
+
+void DescriptorSetLayoutCache::Clean()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	for (auto& [key, entry] : entries)
+	{
+		vkDestroyDescriptorSetLayout(device, entry.descriptorSetLayout, nullptr);
+	}
+	entries.clear();
+}
+
+VkDescriptorSetLayout DescriptorSetLayoutCache::Acquire(const std::vector<VkDescriptorSetLayoutBinding>& bindings)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	const Key key = MakeKey(bindings);
+	if (auto iter = entries.find(key);
+		iter != entries.end())
+	{
+		iter->second.referenceCount++;
+		return iter->second.descriptorSetLayout;
+	}
+
+	VkDescriptorSetLayoutCreateInfo layoutCreateInfo{};
+	layoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutCreateInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+	layoutCreateInfo.pBindings = bindings.data();
+
+	VkDescriptorSetLayout descriptorSetLayout;
+	VulkanHelper::VkCheck(vkCreateDescriptorSetLayout(device, &layoutCreateInfo, nullptr, &descriptorSetLayout), "Creating descriptor set layout has failed!");
+	entries[key] = { descriptorSetLayout, 1 };
+
+	return descriptorSetLayout;
+}
+
+void DescriptorSetLayoutCache::Release(VkDescriptorSetLayout descriptorSetLayout)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	// Few layouts live at the same time, so linear search is fine.
+	for (auto iter = entries.begin(); iter != entries.end(); ++iter)
+	{
+		if (iter->second.descriptorSetLayout != descriptorSetLayout)
+		{
+			continue;
+		}
+
+		iter->second.referenceCount--;
+		if (iter->second.referenceCount == 0)
+		{
+			vkDestroyDescriptorSetLayout(device, descriptorSetLayout, nullptr);
+			entries.erase(iter);
+		}
+		return;
+	}
+	std::cout << "Releasing descriptor set layout which is not in the cache!" << std::endl;
+}
+
+size_t DescriptorSetLayoutCache::GetLayoutCount()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	return entries.size();
+}
+
+DescriptorSetLayoutCache::Key DescriptorSetLayoutCache::MakeKey(const std::vector<VkDescriptorSetLayoutBinding>& bindings)
+{
+	Key key;
+	key.reserve(bindings.size() * 5);
+	for (const VkDescriptorSetLayoutBinding& binding : bindings)
+	{
+		key.push_back(binding.binding);
+		key.push_back(binding.descriptorType);
+		key.push_back(binding.descriptorCount);
+		key.push_back(binding.stageFlags);
+		key.push_back(reinterpret_cast<uint64_t>(binding.pImmutableSamplers));
+	}
+	return key;
+}
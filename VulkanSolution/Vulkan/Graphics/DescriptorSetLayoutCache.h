@@ -0,0 +1,48 @@
+/******************************************************************************
+Copyright (C) 2022 DigiPen Institute of Technology.
+Reproduction or disclosure of this file or its contents without the prior
+written consent of DigiPen Institute of Technology is prohibited.
+File Name:   DescriptorSetLayoutCache.h
+Author
+	- sinil.kang	rtd99062@gmail.com
+Creation Date: 12.24.2022
+	header file for cache of shared descriptor set layouts.
+******************************************************************************/
+#pragma once
+#include <vector>
+#include <map>
+#include <mutex>
+#include <vulkan/vulkan.h>
+
+// Descriptor sets with the same bindings share one VkDescriptorSetLayout,
+	// so pipelines using them also share one pipeline layout in PipelineLayoutCache.
+// Layouts are reference counted, and destroyed when the last descriptor set releases it.
+class DescriptorSetLayoutCache
+{
+public:
+	DescriptorSetLayoutCache();
+	~DescriptorSetLayoutCache();
+
+	void Init(VkDevice device);
+	// Destroy every layout, even if a descriptor set still holds it.
+	void Clean();
+
+	VkDescriptorSetLayout Acquire(const std::vector<VkDescriptorSetLayoutBinding>& bindings);
+	void Release(VkDescriptorSetLayout descriptorSetLayout);
+
+	size_t GetLayoutCount();
+private:
+	// Bindings (binding, descriptorType, descriptorCount, stageFlags, pImmutableSamplers) in order.
+	using Key = std::vector<uint64_t>;
+	struct Entry
+	{
+		VkDescriptorSetLayout descriptorSetLayout;
+		uint32_t referenceCount;
+	};
+
+	static Key MakeKey(const std::vector<VkDescriptorSetLayoutBinding>& bindings);
+
+	VkDevice device;
+	std::map<Key, Entry> entries;
+	std::mutex mutex;
+};
@@ -13,18 +13,43 @@ Creation Date: 12.19.2022
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
 #include <algorithm>
+#include <numeric>	// for std::iota
+#include <execution>
 #include <array>
+#include <thread>
+#include <fstream>
+#include <cstring>
 
 #include <Helper/VulkanHelper.h>
 #include <Engines/Window.h>
+#include <Engines/CPUProfiler.h>
+#include <Graphics/Textures/TextureImporter.h>
 
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
 
 #include <ImGUI/myGUI.h>
 
+namespace
+{
+	// Written in front of the data of VkPipelineCache.
+		// The driver also validates the data, but some drivers crash on data made by another driver, so it is checked first.
+	struct PipelineCacheFileHeader
+	{
+		static constexpr uint32_t MAGIC = 0x53504348;	// "SPCH"
+
+		uint32_t magic;
+		uint32_t vendorID;
+		uint32_t deviceID;
+		uint32_t driverVersion;
+		uint8_t deviceUUID[VK_UUID_SIZE];
+		uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+		uint64_t dataSize;
+	};
+}
+
 Graphics::Graphics()
-	:instance(), physicalDeviceProperties(), physicalDeviceFeatures(), physicalDevice(), queueFamily(), device(), queue(), surface(), commandPool(), commandBuffers(), swapchain(), swapchainImages(), swapchainImageFormat(), swapchainExtent(), swapchainImageViews(), depthImage(), depthImageMemory(), depthImageView(), renderPass(), swapchainFramebuffers(), imageAvailableSemaphores(), renderFinishedSemaphores(), inFlightFences(), currentFrameID(), textureSampler(), windowHolder(nullptr), imageIndex()
+	:instance(), physicalDeviceProperties(), physicalDeviceFeatures(), physicalDeviceVulkan12Features(), physicalDevice(), queueFamily(), transferQueueFamily(), device(), queue(), transferQueue(), uploadQueue(), surface(), isHeadless(false), preferredDeviceName(), offscreenImage(), offscreenImageMemory(), memoryAllocator(), descriptorAllocator(), descriptorSetLayoutCache(), commandPool(), frameCommandPools(), commandBuffers(), guiCommandBuffers(), dynamicCommandBuffers(), threadCommandPools(), threadCommandBuffers(), recordingThreadCount(), swapchain(), swapchainGeneration(), swapchainImages(), swapchainImageFormat(), swapchainExtent(), swapchainImageViews(), depthImage(), depthImageMemory(), depthImageView(), depthPyramid(), renderPass(), swapchainFramebuffers(), imageAvailableSemaphores(), renderFinishedSemaphores(), inFlightFences(), gpuProfiler(), currentFrameID(), frameCount(), textureSampler(), isTextureCompressionEnabled(), pipelineCache(), pipelineLayoutCache(), retiredResources(), windowHolder(nullptr), imageIndex()
 {
 }
 
@@ -40,13 +65,30 @@ bool Graphics::InitVulkan(const char* appName, uint32_t appVersion, Window* _win
 	{
 		return false;
 	}
-	CreatePhysicalDevice();
+	if (CreatePhysicalDevice() == false)
+	{
+		return false;
+	}
+	if (isHeadless && std::max(swapchainExtent.width, swapchainExtent.height) > physicalDeviceProperties.limits.maxImageDimension2D)
+	{
+		std::cout << "Offscreen image is larger than the device limit " << physicalDeviceProperties.limits.maxImageDimension2D << "!" << std::endl;
+		return false;
+	}
 	ChooseQueueFamily();
 	if (CreateDevice() == false)
 	{
 		return false;
 	}
-	if (CreateSurfaceByGLFW() == false)
+	memoryAllocator.Init(physicalDevice, device);
+	descriptorAllocator.Init(device);
+	descriptorSetLayoutCache.Init(device);
+	isTextureCompressionEnabled = COMPRESS_TEXTURES && IsTextureFormatSupported(VK_FORMAT_BC1_RGB_SRGB_BLOCK) && IsTextureFormatSupported(VK_FORMAT_BC7_SRGB_BLOCK);
+	if (uploadQueue.Init(device, &memoryAllocator, transferQueueFamily, transferQueue, physicalDeviceVulkan12Features.timelineSemaphore == VK_TRUE,
+		std::max<VkDeviceSize>(physicalDeviceProperties.limits.optimalBufferCopyOffsetAlignment, TextureImporter::LEVEL_ALIGNMENT)) == false)
+	{
+		return false;
+	}
+	if (isHeadless == false && CreateSurfaceByGLFW() == false)
 	{
 		return false;
 	}
@@ -54,7 +96,11 @@ bool Graphics::InitVulkan(const char* appName, uint32_t appVersion, Window* _win
 	{
 		return false;
 	}
-	if (CreateSwapchain() == false)
+	if (isHeadless)
+	{
+		CreateOffscreenImage();
+	}
+	else if (CreateSwapchain() == false)
 	{
 		return false;
 	}
@@ -62,23 +108,66 @@ bool Graphics::InitVulkan(const char* appName, uint32_t appVersion, Window* _win
 
 	CreateSyncObjects();
 
+	InitGPUProfiler();
+
 	CreateImageViews();
 
+	// Depth pyramid builds its pipeline with the pipeline cache, and its images are made with the depth resources.
+	CreatePipelineCache();
+
+	depthPyramid.Init(this);
+
 	CreateDepthResources();
 
 	CreateFramebuffers();
 
 	CreateTextureSampler();
 
-	MyImGUI::InitImGUI(windowHolder->glfwWindow, device, instance, physicalDevice, queue, renderPass, commandBuffers.front());
+	if (isHeadless == false)
+	{
+		MyImGUI::InitImGUI(windowHolder->glfwWindow, device, instance, physicalDevice, queue, renderPass, commandBuffers.front());
+	}
 
 	return true;
 }
 
+bool Graphics::InitVulkanHeadless(const char* appName, uint32_t appVersion, VkExtent2D extent, const std::string& _preferredDeviceName)
+{
+	if (extent.width == 0 || extent.height == 0)
+	{
+		std::cout << "Offscreen image should not be empty!" << std::endl;
+		return false;
+	}
+
+	isHeadless = true;
+	preferredDeviceName = _preferredDeviceName;
+	swapchainExtent = extent;
+	// Nothing is presented.
+	reqDeviceExtensions.erase(std::remove_if(reqDeviceExtensions.begin(), reqDeviceExtensions.end(), [](const char* extension) { return strcmp(extension, VK_KHR_SWAPCHAIN_EXTENSION_NAME) == 0; }), reqDeviceExtensions.end());
+
+	return InitVulkan(appName, appVersion, nullptr);
+}
+
+bool Graphics::IsHeadless()
+{
+	return isHeadless;
+}
+
+std::string Graphics::GetDeviceName()
+{
+	return physicalDeviceProperties.deviceName;
+}
+
 void Graphics::CleanVulkan()
 {
 	DeviceWaitIdle();
 
+	DestroyRetiredResources(true);
+
+	depthPyramid.Clean();
+
+	DestroyPipelineCache();
+
 	DestroyTextureSampler();
 
 	DestroyFramebuffers();
@@ -87,6 +176,8 @@ void Graphics::CleanVulkan()
 
 	DestroyImageViews();
 
+	gpuProfiler.Clean();
+
 	DestroySyncObjects();
 
 	DestroyRenderPass();
@@ -95,6 +186,14 @@ void Graphics::CleanVulkan()
 
 	DestroyCommandPool();
 
+	uploadQueue.Clean();
+
+	descriptorAllocator.Clean();
+
+	descriptorSetLayoutCache.Clean();
+
+	memoryAllocator.Clean();
+
 	DestroySurface();
 
 	DestroyDevice();
@@ -104,60 +203,130 @@ void Graphics::CleanVulkan()
 
 bool Graphics::StartDrawing()
 {
+	PROFILE_FUNCTION();
 	// Synchronize with GPU
 	vkWaitForFences(device, 1, &inFlightFences[currentFrameID], VK_TRUE, UINT64_MAX);
+	uploadQueue.CollectGarbage();
+	DestroyRetiredResources(false);
+	gpuProfiler.ReadResults(currentFrameID);
 
-	VkResult resultGetNextImage = vkAcquireNextImageKHR(device, swapchain, UINT64_MAX, imageAvailableSemaphores[currentFrameID], VK_NULL_HANDLE, &imageIndex);
-	if (windowHolder->windowFramebufferResized || resultGetNextImage == VK_ERROR_OUT_OF_DATE_KHR)
+	if (isHeadless)
 	{
-		windowHolder->SetWindowFramebufferResized(false);
-		RecreateSwapchain();
-		return false;
+		// Every frame draws into the offscreen image, and frames are ordered by the dependencies of the render pass.
+		imageIndex = 0;
 	}
-	else if (resultGetNextImage != VK_SUCCESS && resultGetNextImage != VK_SUBOPTIMAL_KHR)
+	else
 	{
-		std::cout << "Acquiring next image has failed!" << std::endl;
-		abort();
-		return false;
+		VkResult resultGetNextImage = vkAcquireNextImageKHR(device, swapchain, UINT64_MAX, imageAvailableSemaphores[currentFrameID], VK_NULL_HANDLE, &imageIndex);
+		if (windowHolder->windowFramebufferResized || resultGetNextImage == VK_ERROR_OUT_OF_DATE_KHR)
+		{
+			windowHolder->SetWindowFramebufferResized(false);
+			RecreateSwapchain();
+			return false;
+		}
+		else if (resultGetNextImage != VK_SUCCESS && resultGetNextImage != VK_SUBOPTIMAL_KHR)
+		{
+			std::cout << "Acquiring next image has failed!" << std::endl;
+			abort();
+			return false;
+		}
 	}
 
 
 	// Prevent deadlock, delay ResetFences
 	vkResetFences(device, 1, &inFlightFences[currentFrameID]);
 
-	vkResetCommandBuffer(commandBuffers[currentFrameID], 0);
+	// Primary, GUI and dynamic command buffers of this frame are reset at once.
+	VulkanHelper::VkCheck(vkResetCommandPool(device, frameCommandPools[currentFrameID], 0), "Resetting command pool has failed!");
 
-	RecordCommandBuffer(commandBuffers[currentFrameID], imageIndex);
+	RecordCommandBuffer(commandBuffers[currentFrameID]);
 
 	return true;
 }
 
-void Graphics::EndDrawing()
+void Graphics::BeginRenderPass()
 {
+	VkRenderPassBeginInfo renderPassInfo{};
+	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+	renderPassInfo.renderPass = renderPass;
+	renderPassInfo.framebuffer = swapchainFramebuffers[imageIndex];
+	renderPassInfo.renderArea.offset = { 0, 0 };
+	renderPassInfo.renderArea.extent = swapchainExtent;
+
+	// Since VkClearValue is union, use appropriate member variable name for usage.
+	std::array<VkClearValue, 2> clearValues{};
+	clearValues[0].color = { { 0.4f, 0.f, 0.f, 1.f} };
+	clearValues[1].depthStencil = { 1.f, 0 };
+
+	renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
+	renderPassInfo.pClearValues = clearValues.data();
+
+	// Every draw is recorded in secondary command buffers. Viewport and scissor are set in BeginSecondaryCommandBuffer().
+	vkCmdBeginRenderPass(commandBuffers[currentFrameID], &renderPassInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+}
 
-	MyImGUI::GUIRender(commandBuffers[currentFrameID]);
+void Graphics::EndDrawing()
+{
+	PROFILE_FUNCTION();
+	// Headless mode has no GUI.
+	if (isHeadless == false)
+	{
+		BeginSecondaryCommandBuffer(guiCommandBuffers[currentFrameID]);
+		gpuProfiler.BeginRegion(guiCommandBuffers[currentFrameID], currentFrameID, GPUProfiler::Region::GUI);
+		MyImGUI::GUIRender(guiCommandBuffers[currentFrameID]);
+		gpuProfiler.EndRegion(guiCommandBuffers[currentFrameID], currentFrameID, GPUProfiler::Region::GUI);
+		EndSecondaryCommandBuffer(guiCommandBuffers[currentFrameID]);
+		vkCmdExecuteCommands(commandBuffers[currentFrameID], 1, &guiCommandBuffers[currentFrameID]);
+	}
 
 	vkCmdEndRenderPass(commandBuffers[currentFrameID]);
 
+	depthPyramid.Record(commandBuffers[currentFrameID]);
+
+	gpuProfiler.EndFrame(commandBuffers[currentFrameID], currentFrameID, frameCount);
+
 	VulkanHelper::VkCheck(vkEndCommandBuffer(commandBuffers[currentFrameID]), "Ending command buffer has failed!");
 
+	// Uploads recorded during this frame are submitted first, and draws wait for them on the GPU.
+	const uint64_t uploadValue = uploadQueue.Submit();
+
 	VkSubmitInfo submitInfo{};
 	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-	VkSemaphore waitSemaphores[] = { imageAvailableSemaphores[currentFrameID] };
-	VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
-	submitInfo.waitSemaphoreCount = 1;
-	submitInfo.pWaitSemaphores = waitSemaphores;
-	submitInfo.pWaitDstStageMask = waitStages;
+	VkSemaphore waitSemaphores[] = { imageAvailableSemaphores[currentFrameID], uploadQueue.GetTimelineSemaphore() };
+	VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT };
+	// Value of the binary semaphore is ignored.
+	const uint64_t waitValues[] = { 0, uploadValue };
+	// Headless frames have no swapchain image to wait for, and nothing to present.
+	const uint32_t firstWait = isHeadless ? 1 : 0;
+	const bool isUploadWaited = uploadQueue.IsTimelineSemaphoreUsed() && uploadValue > 0;
+	submitInfo.waitSemaphoreCount = (isUploadWaited ? 2 : 1) - firstWait;
+	submitInfo.pWaitSemaphores = waitSemaphores + firstWait;
+	submitInfo.pWaitDstStageMask = waitStages + firstWait;
+
+	VkTimelineSemaphoreSubmitInfo timelineSubmitInfo{};
+	timelineSubmitInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+	timelineSubmitInfo.waitSemaphoreValueCount = submitInfo.waitSemaphoreCount;
+	timelineSubmitInfo.pWaitSemaphoreValues = waitValues + firstWait;
+	if (isUploadWaited)
+	{
+		submitInfo.pNext = &timelineSubmitInfo;
+	}
 
 	submitInfo.commandBufferCount = 1;
 	submitInfo.pCommandBuffers = &commandBuffers[currentFrameID];
 
 	VkSemaphore signalSemaphores[] = { renderFinishedSemaphores[currentFrameID] };
-	submitInfo.signalSemaphoreCount = 1;
+	submitInfo.signalSemaphoreCount = isHeadless ? 0 : 1;
 	submitInfo.pSignalSemaphores = signalSemaphores;
 
 	VulkanHelper::VkCheck(vkQueueSubmit(queue, 1, &submitInfo, inFlightFences[currentFrameID]), "Submitting queue has failed!");
 
+	if (isHeadless)
+	{
+		UpdateCurrentFrameID();
+		return;
+	}
+
 	VkPresentInfoKHR presentInfo{};
 	presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
 	presentInfo.waitSemaphoreCount = 1;
@@ -211,6 +380,11 @@ VkExtent2D Graphics::GetSwapchainExtent()
 	return swapchainExtent;
 }
 
+const VkPhysicalDeviceProperties& Graphics::GetPhysicalDeviceProperties()
+{
+	return physicalDeviceProperties;
+}
+
 VkCommandBuffer Graphics::GetCommandBuffer()
 {
 	return commandBuffers[currentFrameID];
@@ -221,6 +395,72 @@ uint32_t Graphics::GetCurrentFrameID()
 	return currentFrameID;
 }
 
+uint64_t Graphics::GetFrameCount()
+{
+	return frameCount;
+}
+
+VkCommandBuffer Graphics::GetDynamicCommandBuffer()
+{
+	return dynamicCommandBuffers[currentFrameID];
+}
+
+uint32_t Graphics::GetRecordingThreadCount()
+{
+	return recordingThreadCount;
+}
+
+void Graphics::ResetThreadCommandPool(uint32_t threadID, uint32_t frameID)
+{
+	VulkanHelper::VkCheck(vkResetCommandPool(device, threadCommandPools[threadID * MAX_FRAMES_IN_FLIGHT + frameID], 0), "Resetting thread command pool has failed!");
+}
+
+VkCommandBuffer Graphics::GetThreadCommandBuffer(uint32_t threadID, uint32_t frameID)
+{
+	return threadCommandBuffers[threadID * MAX_FRAMES_IN_FLIGHT + frameID];
+}
+
+void Graphics::BeginSecondaryCommandBuffer(VkCommandBuffer commandBuffer)
+{
+	// Framebuffer is left null, so the recorded commands are valid for every swapchain image.
+	VkCommandBufferInheritanceInfo inheritanceInfo{};
+	inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+	inheritanceInfo.renderPass = renderPass;
+	inheritanceInfo.subpass = 0;
+	inheritanceInfo.framebuffer = VK_NULL_HANDLE;
+
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+	beginInfo.pInheritanceInfo = &inheritanceInfo;
+
+	VulkanHelper::VkCheck(vkBeginCommandBuffer(commandBuffer, &beginInfo), "Begining secondary command buffer has failed!");
+
+	VkViewport viewport{};
+	viewport.x = 0.f;
+	viewport.y = 0.f;
+	viewport.width = static_cast<float>(swapchainExtent.width);
+	viewport.height = static_cast<float>(swapchainExtent.height);
+	viewport.minDepth = 0.f;
+	viewport.maxDepth = 1.f;
+	vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+
+	VkRect2D scissor{};
+	scissor.offset = { 0, 0 };
+	scissor.extent = swapchainExtent;
+	vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+}
+
+void Graphics::EndSecondaryCommandBuffer(VkCommandBuffer commandBuffer)
+{
+	VulkanHelper::VkCheck(vkEndCommandBuffer(commandBuffer), "Ending secondary command buffer has failed!");
+}
+
+uint32_t Graphics::GetSwapchainGeneration()
+{
+	return swapchainGeneration;
+}
+
 bool Graphics::CreateInstance(const char* appName, uint32_t appVersion)
 {
 	//A generic application info structure
@@ -233,8 +473,9 @@ bool Graphics::CreateInstance(const char* appName, uint32_t appVersion)
 	applicationInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
 	applicationInfo.apiVersion = VK_API_VERSION_1_3;
 
-	uint32_t glfwExtensionCount;
-	const char** extensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+	// Surface extensions are not needed without a window.
+	uint32_t glfwExtensionCount = 0;
+	const char** extensions = isHeadless ? nullptr : glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
 
 
 	VkValidationFeatureEnableEXT enables[] = { VK_VALIDATION_FEATURE_ENABLE_BEST_PRACTICES_EXT };
@@ -273,49 +514,125 @@ void Graphics::DestroyInstance()
 	vkDestroyInstance(instance, nullptr);
 }
 
-void Graphics::CreatePhysicalDevice()
+bool Graphics::CreatePhysicalDevice()
 {
 	uint32_t physicalDevicesCount;
 	VulkanHelper::VkCheck(vkEnumeratePhysicalDevices(instance, &physicalDevicesCount, nullptr), "Get number of physical devices has failed.");
 	std::vector<VkPhysicalDevice> physicalDeviceCandidates(physicalDevicesCount);
 	VulkanHelper::VkCheck(vkEnumeratePhysicalDevices(instance, &physicalDevicesCount, physicalDeviceCandidates.data()), "Get physical devices information has failed.");
 
+	int64_t bestScore = 0;
 	for (const VkPhysicalDevice& physicalDeviceCandidate : physicalDeviceCandidates)
 	{
 		VkPhysicalDeviceProperties deviceProperties;
 		vkGetPhysicalDeviceProperties(physicalDeviceCandidate, &deviceProperties);
 
-		if (deviceProperties.deviceType != VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU)
+		const int64_t score = RatePhysicalDevice(physicalDeviceCandidate, deviceProperties);
+		if (score > bestScore)
 		{
-			continue;
+			bestScore = score;
+			physicalDeviceProperties = deviceProperties;
+			physicalDevice = physicalDeviceCandidate;
 		}
+	}
+
+	if (bestScore <= 0)
+	{
+		std::cout << "No physical device can run the engine!" << std::endl;
+		return false;
+	}
+	std::cout << "Physical device : " << physicalDeviceProperties.deviceName << std::endl;
 
-		uint32_t extensionCount = 0;
-		VulkanHelper::VkCheck(vkEnumerateDeviceExtensionProperties(physicalDeviceCandidate, nullptr, &extensionCount, nullptr), "Get number of device extension properties has failed.");
-		std::vector<VkExtensionProperties> extensions(extensionCount);
-		VulkanHelper::VkCheck(vkEnumerateDeviceExtensionProperties(physicalDeviceCandidate, nullptr, &extensionCount, extensions.data()), "Get device extension properties has failed.");
+	return true;
+}
 
-		unsigned int compatibleExtensions = 0;
-		for (const char* element : reqDeviceExtensions)
+int64_t Graphics::RatePhysicalDevice(VkPhysicalDevice candidate, const VkPhysicalDeviceProperties& properties)
+{
+	// Features required by CreateDevice() are in Vulkan 1.2.
+	if (properties.apiVersion < VK_API_VERSION_1_2)
+	{
+		return 0;
+	}
+
+	// Same features as CreateDevice() requires, so a device failing there is never chosen over the others.
+	VkPhysicalDeviceVulkan12Features vulkan12Features{};
+	vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+	VkPhysicalDeviceFeatures2 features{};
+	features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+	features.pNext = &vulkan12Features;
+	vkGetPhysicalDeviceFeatures2(candidate, &features);
+	if (vulkan12Features.runtimeDescriptorArray == VK_FALSE ||
+		vulkan12Features.descriptorBindingPartiallyBound == VK_FALSE ||
+		vulkan12Features.descriptorBindingSampledImageUpdateAfterBind == VK_FALSE ||
+		vulkan12Features.descriptorBindingUpdateUnusedWhilePending == VK_FALSE ||
+		vulkan12Features.drawIndirectCount == VK_FALSE ||
+		vulkan12Features.timelineSemaphore == VK_FALSE ||
+		features.features.multiDrawIndirect == VK_FALSE ||
+		features.features.drawIndirectFirstInstance == VK_FALSE)
+	{
+		return 0;
+	}
+
+	uint32_t extensionCount = 0;
+	VulkanHelper::VkCheck(vkEnumerateDeviceExtensionProperties(candidate, nullptr, &extensionCount, nullptr), "Get number of device extension properties has failed.");
+	std::vector<VkExtensionProperties> extensions(extensionCount);
+	VulkanHelper::VkCheck(vkEnumerateDeviceExtensionProperties(candidate, nullptr, &extensionCount, extensions.data()), "Get device extension properties has failed.");
+	for (const char* element : reqDeviceExtensions)
+	{
+		if (std::none_of(extensions.begin(), extensions.end(), [element](const VkExtensionProperties& extension) { return strcmp(element, extension.extensionName) == 0; }))
 		{
-			for (size_t i = 0; i < extensionCount; i++)
-			{
-				if (strcmp(element, extensions[i].extensionName) == 0)
-				{
-					compatibleExtensions++;
-					break;
-				}
-			}
+			return 0;
+		}
+	}
 
-			if (compatibleExtensions == reqDeviceExtensions.size())
-			{
-				physicalDeviceProperties = deviceProperties;
-				physicalDevice = physicalDeviceCandidate;
-				return;
-			}
+	uint32_t queueFamilyCount;
+	vkGetPhysicalDeviceQueueFamilyProperties(candidate, &queueFamilyCount, nullptr);
+	std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+	vkGetPhysicalDeviceQueueFamilyProperties(candidate, &queueFamilyCount, queueFamilies.data());
+	const VkQueueFlags requiredQueueFlags = VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT;
+	if (std::none_of(queueFamilies.begin(), queueFamilies.end(), [requiredQueueFlags](const VkQueueFamilyProperties& family) { return (family.queueFlags & requiredQueueFlags) == requiredQueueFlags; }))
+	{
+		return 0;
+	}
+
+	int64_t typeRank = 0;
+	switch (properties.deviceType)
+	{
+	case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU:
+		typeRank = 4;
+		break;
+	case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU:
+		typeRank = 3;
+		break;
+	case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU:
+		typeRank = 2;
+		break;
+	case VK_PHYSICAL_DEVICE_TYPE_CPU:
+		typeRank = 1;
+		break;
+	default:
+		break;
+	}
+	if (preferredDeviceName.empty() == false && std::string(properties.deviceName).find(preferredDeviceName) != std::string::npos)
+	{
+		typeRank = 5;
+	}
+
+	VkPhysicalDeviceMemoryProperties memoryProperties;
+	vkGetPhysicalDeviceMemoryProperties(candidate, &memoryProperties);
+	VkDeviceSize deviceLocalSize = 0;
+	for (uint32_t i = 0; i < memoryProperties.memoryHeapCount; i++)
+	{
+		if (memoryProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT)
+		{
+			deviceLocalSize += memoryProperties.memoryHeaps[i].size;
 		}
 	}
 
+	// Memory in megabytes never reaches the rank, so the type always decides first.
+		// Usable devices score at least 1, even if they report no device local memory.
+	constexpr int64_t RANK_SCALE = int64_t(1) << 40;
+	return typeRank * RANK_SCALE + std::min(static_cast<int64_t>(deviceLocalSize >> 20), RANK_SCALE - 2) + 1;
 }
 
 void Graphics::ChooseQueueFamily()
@@ -324,7 +641,8 @@ void Graphics::ChooseQueueFamily()
 	// VK_QUEUE_COMPUTE_BIT - queues in this family support compute operations such as dispatching compute shaders.
 	// VK_QUEUE_TRANSFER_BIT - queues in this family support transfer operations such as copying buffer and image contents.
 	// VK_QUEUE_SPARSE_BINDING_BIT - queues in this family support memory binding operations used to update sparse resources.
-	VkQueueFlags requiredQueueFlags = VK_QUEUE_GRAPHICS_BIT;
+	// Culling passes are dispatched in the command buffer of the frame.
+	VkQueueFlags requiredQueueFlags = VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT;
 
 	uint32_t queueFamilyCount;
 	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
@@ -340,36 +658,97 @@ void Graphics::ChooseQueueFamily()
 			queueFamily = i;
 		}
 	}
+
+	// A family only for transfer is usually a DMA engine, which copies while the graphics queue is drawing.
+	transferQueueFamily = queueFamily;
+	for (uint32_t i = 0; i < queueFamilyCount; i++)
+	{
+		const VkQueueFlags flags = queueFamilyCandidates[i].queueFlags;
+		if ((flags & VK_QUEUE_TRANSFER_BIT) && (flags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT)) == 0)
+		{
+			transferQueueFamily = i;
+			break;
+		}
+	}
 }
 
 bool Graphics::CreateDevice()
 {
+	physicalDeviceVulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+	physicalDeviceVulkan12Features.pNext = nullptr;
+
 	physicalDeviceFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
-	physicalDeviceFeatures.pNext = nullptr;
+	physicalDeviceFeatures.pNext = (physicalDeviceProperties.apiVersion >= VK_API_VERSION_1_2) ? &physicalDeviceVulkan12Features : nullptr;
 
 	vkGetPhysicalDeviceFeatures2(physicalDevice, &physicalDeviceFeatures);
 
+	// Only the features used by the engine are enabled among Vulkan 1.2 features.
+	VkPhysicalDeviceVulkan12Features enabledVulkan12Features{};
+	enabledVulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+	enabledVulkan12Features.timelineSemaphore = physicalDeviceVulkan12Features.timelineSemaphore;
+	// Required by BindlessTextureTable.
+	if (physicalDeviceVulkan12Features.runtimeDescriptorArray == VK_FALSE ||
+		physicalDeviceVulkan12Features.descriptorBindingPartiallyBound == VK_FALSE ||
+		physicalDeviceVulkan12Features.descriptorBindingSampledImageUpdateAfterBind == VK_FALSE ||
+		physicalDeviceVulkan12Features.descriptorBindingUpdateUnusedWhilePending == VK_FALSE)
+	{
+		std::cout << "Descriptor indexing is not supported by the device!" << std::endl;
+		return false;
+	}
+	enabledVulkan12Features.runtimeDescriptorArray = VK_TRUE;
+	enabledVulkan12Features.descriptorBindingPartiallyBound = VK_TRUE;
+	enabledVulkan12Features.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+	enabledVulkan12Features.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+	// Culled draws are compacted on the GPU, so their count is read from a buffer.
+	if (physicalDeviceVulkan12Features.drawIndirectCount == VK_FALSE)
+	{
+		std::cout << "Draw indirect count is not supported by the device!" << std::endl;
+		return false;
+	}
+	enabledVulkan12Features.drawIndirectCount = VK_TRUE;
+	physicalDeviceFeatures.pNext = (physicalDeviceProperties.apiVersion >= VK_API_VERSION_1_2) ? &enabledVulkan12Features : nullptr;
+	// Models are drawn by indirect draws of many meshes, which give materials as firstInstance.
+		// Supported core features are enabled by passing physicalDeviceFeatures as they are.
+	if (physicalDeviceFeatures.features.multiDrawIndirect == VK_FALSE ||
+		physicalDeviceFeatures.features.drawIndirectFirstInstance == VK_FALSE)
+	{
+		std::cout << "Multi draw indirect is not supported by the device!" << std::endl;
+		return false;
+	}
+
 	// priority is between [0.f, 1.f], 1.f has higher priority while 0 has lower priority.
 	float priority = 1.0f;
-	VkDeviceQueueCreateInfo queueCreateInfo{};
-	queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
-	queueCreateInfo.queueCount = 1;
-	queueCreateInfo.queueFamilyIndex = queueFamily;
-	queueCreateInfo.pQueuePriorities = &priority;
+	std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
+	for (uint32_t family : { queueFamily, transferQueueFamily })
+	{
+		if (queueCreateInfos.empty() == false && queueCreateInfos.front().queueFamilyIndex == family)
+		{
+			continue;
+		}
+		VkDeviceQueueCreateInfo queueCreateInfo{};
+		queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+		queueCreateInfo.queueCount = 1;
+		queueCreateInfo.queueFamilyIndex = family;
+		queueCreateInfo.pQueuePriorities = &priority;
+		queueCreateInfos.push_back(queueCreateInfo);
+	}
 
 
 	VkDeviceCreateInfo deviceCreateInfo{};
 	deviceCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
 
-	deviceCreateInfo.queueCreateInfoCount = 1;
-	deviceCreateInfo.pQueueCreateInfos = &queueCreateInfo;
+	deviceCreateInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
+	deviceCreateInfo.pQueueCreateInfos = queueCreateInfos.data();
 
 	deviceCreateInfo.pNext = &physicalDeviceFeatures;
 
 	deviceCreateInfo.enabledExtensionCount = static_cast<uint32_t>(reqDeviceExtensions.size());
 	deviceCreateInfo.ppEnabledExtensionNames = reqDeviceExtensions.data();
 
-	if (VulkanHelper::VkCheck(vkCreateDevice(physicalDevice, &deviceCreateInfo, nullptr, &device), "Creating a logical device has failed.") != VK_SUCCESS)
+	const VkResult createResult = VulkanHelper::VkCheck(vkCreateDevice(physicalDevice, &deviceCreateInfo, nullptr, &device), "Creating a logical device has failed.");
+	// enabledVulkan12Features is a local variable.
+	physicalDeviceFeatures.pNext = nullptr;
+	if (createResult != VK_SUCCESS)
 	{
 		DestroyDevice();
 		return false;
@@ -404,32 +783,65 @@ bool Graphics::CreateSurfaceByGLFW()
 // Use the command pool to also create a command buffer.
 bool Graphics::CreateCommandPoolAndAllocateCommandBuffers()
 {
-	commandBuffers.resize(MAX_FRAMES_IN_FLIGHT);
-
-	VkCommandPoolCreateInfo poolCreateInfo{};
-	poolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-	poolCreateInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
-	poolCreateInfo.queueFamilyIndex = queueFamily;
-	if (VulkanHelper::VkCheck(vkCreateCommandPool(device, &poolCreateInfo, nullptr, &commandPool), "Creating command pool has failed!") != VK_SUCCESS)
+	if (CreateCommandPool(VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT, commandPool) == false)
 	{
 		DestroyCommandPool();
 		return false;
 	}
 
-	VkCommandBufferAllocateInfo bufferAllocateInfo{};
-	bufferAllocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-	bufferAllocateInfo.commandPool = commandPool;
-	bufferAllocateInfo.commandBufferCount = MAX_FRAMES_IN_FLIGHT;
-	bufferAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-	if (VulkanHelper::VkCheck(vkAllocateCommandBuffers(device, &bufferAllocateInfo, commandBuffers.data()), "Allocating command buffer has failed!") != VK_SUCCESS)
+	// Command buffers of a frame live in the pool of the frame, which is reset wholesale instead of resetting each command buffer.
+	frameCommandPools.resize(MAX_FRAMES_IN_FLIGHT);
+	commandBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+	guiCommandBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+	dynamicCommandBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+	for (unsigned int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
 	{
-		DestroyCommandPool();
-		return false;
+		if (CreateCommandPool(VK_COMMAND_POOL_CREATE_TRANSIENT_BIT, frameCommandPools[i]) == false ||
+			AllocateCommandBuffers(frameCommandPools[i], VK_COMMAND_BUFFER_LEVEL_PRIMARY, 1, &commandBuffers[i]) == false ||
+			AllocateCommandBuffers(frameCommandPools[i], VK_COMMAND_BUFFER_LEVEL_SECONDARY, 1, &guiCommandBuffers[i]) == false ||
+			AllocateCommandBuffers(frameCommandPools[i], VK_COMMAND_BUFFER_LEVEL_SECONDARY, 1, &dynamicCommandBuffers[i]) == false)
+		{
+			DestroyCommandPool();
+			return false;
+		}
+	}
+
+	// hardware_concurrency() can return 0 if it is not computable.
+	recordingThreadCount = std::clamp(std::thread::hardware_concurrency(), 1u, MAX_RECORDING_THREADS);
+	threadCommandPools.resize(recordingThreadCount * MAX_FRAMES_IN_FLIGHT);
+	threadCommandBuffers.resize(recordingThreadCount * MAX_FRAMES_IN_FLIGHT);
+	for (size_t i = 0; i < threadCommandPools.size(); i++)
+	{
+		if (CreateCommandPool(0, threadCommandPools[i]) == false ||
+			AllocateCommandBuffers(threadCommandPools[i], VK_COMMAND_BUFFER_LEVEL_SECONDARY, 1, &threadCommandBuffers[i]) == false)
+		{
+			DestroyCommandPool();
+			return false;
+		}
 	}
 
 	return true;
 }
 
+bool Graphics::CreateCommandPool(VkCommandPoolCreateFlags flags, VkCommandPool& pool)
+{
+	VkCommandPoolCreateInfo poolCreateInfo{};
+	poolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolCreateInfo.flags = flags;
+	poolCreateInfo.queueFamilyIndex = queueFamily;
+	return VulkanHelper::VkCheck(vkCreateCommandPool(device, &poolCreateInfo, nullptr, &pool), "Creating command pool has failed!") == VK_SUCCESS;
+}
+
+bool Graphics::AllocateCommandBuffers(VkCommandPool pool, VkCommandBufferLevel level, uint32_t count, VkCommandBuffer* buffers)
+{
+	VkCommandBufferAllocateInfo bufferAllocateInfo{};
+	bufferAllocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	bufferAllocateInfo.commandPool = pool;
+	bufferAllocateInfo.commandBufferCount = count;
+	bufferAllocateInfo.level = level;
+	return VulkanHelper::VkCheck(vkAllocateCommandBuffers(device, &bufferAllocateInfo, buffers), "Allocating command buffer has failed!") == VK_SUCCESS;
+}
+
 bool Graphics::CreateSwapchain()
 {
 	VkSurfaceCapabilitiesKHR capabilities;
@@ -500,6 +912,14 @@ bool Graphics::CreateSwapchain()
 	return true;
 }
 
+void Graphics::CreateOffscreenImage()
+{
+	// Extent is given by InitVulkanHeadless(). Copied out by ReadOffscreenImage().
+	swapchainImageFormat = OFFSCREEN_FORMAT;
+	CreateImage(swapchainExtent.width, swapchainExtent.height, 1, swapchainImageFormat, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, offscreenImage, offscreenImageMemory);
+	swapchainImages = { offscreenImage };
+}
+
 void Graphics::CreateRenderPass()
 {
 	VkAttachmentDescription colorAttachment{};
@@ -511,17 +931,19 @@ void Graphics::CreateRenderPass()
 	colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
 	colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
 	colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+	// Offscreen image is copied to the host instead of being presented.
+	colorAttachment.finalLayout = isHeadless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
 
 	VkAttachmentDescription depthAttachment{};
 	depthAttachment.format = VulkanHelper::FindDepthFormat(physicalDevice);
 	depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
 	depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-	depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	// Depth is kept for the depth pyramid, which is built after the render pass.
+	depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
 	depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
 	depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
 	depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+	depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
 
 	VkAttachmentReference colorAttachmentRef{};
 	colorAttachmentRef.attachment = 0;
@@ -542,13 +964,22 @@ void Graphics::CreateRenderPass()
 	// @@@@@@@@ TODO: Back to dependency part and understand what dependency is for
 	// https://vulkan-tutorial.com/Drawing_a_triangle/Drawing/Rendering_and_presentation
 	// @@ Todo: I forgot what they do, recall it again
-	VkSubpassDependency dependency{};
-	dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-	dependency.dstSubpass = 0;
-	dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-	dependency.srcAccessMask = 0;
-	dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-	dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+	// Depth of the previous frame may still be read by its depth pyramid pass.
+		// Headless frames write the same color and depth images with nothing between them, so the writes of the previous frame are ordered too.
+	std::array<VkSubpassDependency, 2> dependencies{};
+	dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+	dependencies[0].dstSubpass = 0;
+	dependencies[0].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+	dependencies[0].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+	dependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+	dependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+	// Depth written by the subpass is read by the depth pyramid pass after the render pass.
+	dependencies[1].srcSubpass = 0;
+	dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+	dependencies[1].srcStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+	dependencies[1].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+	dependencies[1].dstStageMask = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+	dependencies[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
 
 	std::array<VkAttachmentDescription, 2> attachments{ colorAttachment, depthAttachment };
 	VkRenderPassCreateInfo renderPassInfo{};
@@ -557,8 +988,8 @@ void Graphics::CreateRenderPass()
 	renderPassInfo.pAttachments = attachments.data();
 	renderPassInfo.subpassCount = 1;
 	renderPassInfo.pSubpasses = &subpass;
-	renderPassInfo.dependencyCount = 1;
-	renderPassInfo.pDependencies = &dependency;
+	renderPassInfo.dependencyCount = static_cast<uint32_t>(dependencies.size());
+	renderPassInfo.pDependencies = dependencies.data();
 
 	VulkanHelper::VkCheck(vkCreateRenderPass(device, &renderPassInfo, nullptr, &renderPass), "Creating render pass has failed!");
 }
@@ -603,6 +1034,67 @@ void Graphics::DestroySyncObjects()
 	}
 }
 
+void Graphics::InitGPUProfiler()
+{
+	uint32_t queueFamilyCount;
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+	std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
+
+	gpuProfiler.Init(device, MAX_FRAMES_IN_FLIGHT, physicalDeviceProperties.limits.timestampPeriod, queueFamilies[queueFamily].timestampValidBits);
+}
+
+GPUProfiler& Graphics::GetGPUProfiler()
+{
+	return gpuProfiler;
+}
+
+bool Graphics::ReadOffscreenImage(std::vector<uint8_t>& pixels)
+{
+	if (isHeadless == false)
+	{
+		return false;
+	}
+
+	const VkDeviceSize imageSize = static_cast<VkDeviceSize>(4) * swapchainExtent.width * swapchainExtent.height;
+	VkBuffer readbackBuffer;
+	MemoryAllocation readbackBufferMemory;
+	CreateBuffer(imageSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, readbackBuffer, readbackBufferMemory, MemoryLifetime::Staging);
+	if (readbackBufferMemory.mappedData == nullptr)
+	{
+		DestroyBuffer(readbackBuffer, readbackBufferMemory);
+		return false;
+	}
+
+	VkCommandBuffer commandBuffer = BeginSingleTimeCommands();
+
+	// Render pass leaves the image in the transfer source layout. Only the writes of the last frame should be made visible.
+	VkImageMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+	barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+	barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = offscreenImage;
+	barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+	VkBufferImageCopy region{};
+	region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+	region.imageExtent = { swapchainExtent.width, swapchainExtent.height, 1 };
+	vkCmdCopyImageToBuffer(commandBuffer, offscreenImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, readbackBuffer, 1, &region);
+
+	EndSingleTimeCommands(commandBuffer);
+
+	pixels.resize(static_cast<size_t>(imageSize));
+	memcpy(pixels.data(), readbackBufferMemory.mappedData, pixels.size());
+	DestroyBuffer(readbackBuffer, readbackBufferMemory);
+
+	return true;
+}
+
 void Graphics::CreateFramebuffers()
 {
 	const size_t swapchainImageViewCount = swapchainImageViews.size();
@@ -641,15 +1133,18 @@ void Graphics::CreateDepthResources()
 {
 	VkFormat depthFormat = VulkanHelper::FindDepthFormat(physicalDevice);
 
-	CreateImage(swapchainExtent.width, swapchainExtent.height, depthFormat, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, depthImage, depthImageMemory);
-	depthImageView = CreateImageView(depthImage, depthFormat, VK_IMAGE_ASPECT_DEPTH_BIT);
+	// Sampled by the depth pyramid pass.
+	CreateImage(swapchainExtent.width, swapchainExtent.height, 1, depthFormat, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, depthImage, depthImageMemory);
+	depthImageView = CreateImageView(depthImage, depthFormat, VK_IMAGE_ASPECT_DEPTH_BIT, 1);
+
+	depthPyramid.Create(depthImageView, swapchainExtent);
 }
 
 void Graphics::DestroyDepthResources()
 {
+	depthPyramid.Destroy();
 	vkDestroyImageView(device, depthImageView, nullptr);
-	vkDestroyImage(device, depthImage, nullptr);
-	vkFreeMemory(device, depthImageMemory, nullptr);
+	DestroyImage(depthImage, depthImageMemory);
 }
 
 void Graphics::CreateImageViews()
@@ -659,7 +1154,7 @@ void Graphics::CreateImageViews()
 	const size_t swapchainImageCount = swapchainImages.size();
 	for (size_t i = 0; i < swapchainImageCount; i++)
 	{
-		swapchainImageViews[i] = CreateImageView(swapchainImages[i], swapchainImageFormat, VK_IMAGE_ASPECT_COLOR_BIT);
+		swapchainImageViews[i] = CreateImageView(swapchainImages[i], swapchainImageFormat, VK_IMAGE_ASPECT_COLOR_BIT, 1);
 	}
 }
 
@@ -703,7 +1198,8 @@ void Graphics::CreateTextureSampler()
 	samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
 	samplerInfo.mipLodBias = 0.f;
 	samplerInfo.minLod = 0.f;
-	samplerInfo.maxLod = 0.f;
+	// Use the whole mip chain of each texture.
+	samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
 
 	VulkanHelper::VkCheck(vkCreateSampler(device, &samplerInfo, nullptr, &textureSampler), "Creating sampler has failed!");
 }
@@ -713,7 +1209,175 @@ void Graphics::DestroyTextureSampler()
 	vkDestroySampler(device, textureSampler, nullptr);
 }
 
-void Graphics::CreateImage(uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, VkDeviceMemory& imageMemory)
+void Graphics::CreatePipelineCache()
+{
+	pipelineLayoutCache.Init(device);
+
+	std::vector<char> fileData;
+	std::ifstream file(PIPELINE_CACHE_PATH, std::ios::ate | std::ios::binary);
+	if (file.is_open())
+	{
+		fileData.resize(static_cast<size_t>(file.tellg()));
+		file.seekg(0);
+		file.read(fileData.data(), fileData.size());
+	}
+
+	VkPipelineCacheCreateInfo cacheCreateInfo{};
+	cacheCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+	if (IsPipelineCacheCompatible(fileData))
+	{
+		cacheCreateInfo.initialDataSize = fileData.size() - sizeof(PipelineCacheFileHeader);
+		cacheCreateInfo.pInitialData = fileData.data() + sizeof(PipelineCacheFileHeader);
+	}
+	else if (fileData.empty() == false)
+	{
+		std::cout << "Pipeline cache is made by another device or driver. It is rebuilt." << std::endl;
+	}
+
+	VulkanHelper::VkCheck(vkCreatePipelineCache(device, &cacheCreateInfo, nullptr, &pipelineCache), "Creating pipeline cache has failed!");
+}
+
+void Graphics::DestroyPipelineCache()
+{
+	size_t dataSize = 0;
+	vkGetPipelineCacheData(device, pipelineCache, &dataSize, nullptr);
+	std::vector<char> data(dataSize);
+	if (dataSize > 0 && vkGetPipelineCacheData(device, pipelineCache, &dataSize, data.data()) == VK_SUCCESS)
+	{
+		VkPhysicalDeviceIDProperties idProperties{};
+		idProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ID_PROPERTIES;
+		VkPhysicalDeviceProperties2 properties2{};
+		properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+		properties2.pNext = &idProperties;
+		vkGetPhysicalDeviceProperties2(physicalDevice, &properties2);
+
+		PipelineCacheFileHeader header{};
+		header.magic = PipelineCacheFileHeader::MAGIC;
+		header.vendorID = physicalDeviceProperties.vendorID;
+		header.deviceID = physicalDeviceProperties.deviceID;
+		header.driverVersion = physicalDeviceProperties.driverVersion;
+		memcpy(header.deviceUUID, idProperties.deviceUUID, VK_UUID_SIZE);
+		memcpy(header.pipelineCacheUUID, physicalDeviceProperties.pipelineCacheUUID, VK_UUID_SIZE);
+		header.dataSize = dataSize;
+
+		std::ofstream file(PIPELINE_CACHE_PATH, std::ios::binary | std::ios::trunc);
+		if (file.is_open())
+		{
+			file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+			file.write(data.data(), dataSize);
+		}
+		else
+		{
+			std::cout << "Saving pipeline cache has failed!" << std::endl;
+		}
+	}
+
+	vkDestroyPipelineCache(device, pipelineCache, nullptr);
+	pipelineLayoutCache.Clean();
+}
+
+bool Graphics::IsPipelineCacheCompatible(const std::vector<char>& fileData) const
+{
+	if (fileData.size() < sizeof(PipelineCacheFileHeader) + sizeof(VkPipelineCacheHeaderVersionOne))
+	{
+		return false;
+	}
+
+	PipelineCacheFileHeader header;
+	memcpy(&header, fileData.data(), sizeof(header));
+
+	VkPhysicalDeviceIDProperties idProperties{};
+	idProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ID_PROPERTIES;
+	VkPhysicalDeviceProperties2 properties2{};
+	properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+	properties2.pNext = &idProperties;
+	vkGetPhysicalDeviceProperties2(physicalDevice, &properties2);
+
+	if (header.magic != PipelineCacheFileHeader::MAGIC ||
+		header.vendorID != physicalDeviceProperties.vendorID ||
+		header.deviceID != physicalDeviceProperties.deviceID ||
+		header.driverVersion != physicalDeviceProperties.driverVersion ||
+		memcmp(header.deviceUUID, idProperties.deviceUUID, VK_UUID_SIZE) != 0 ||
+		memcmp(header.pipelineCacheUUID, physicalDeviceProperties.pipelineCacheUUID, VK_UUID_SIZE) != 0 ||
+		header.dataSize != fileData.size() - sizeof(PipelineCacheFileHeader))
+	{
+		return false;
+	}
+
+	// Header of the driver's data should match as well.
+	VkPipelineCacheHeaderVersionOne driverHeader;
+	memcpy(&driverHeader, fileData.data() + sizeof(PipelineCacheFileHeader), sizeof(driverHeader));
+	return driverHeader.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+		driverHeader.vendorID == physicalDeviceProperties.vendorID &&
+		driverHeader.deviceID == physicalDeviceProperties.deviceID &&
+		memcmp(driverHeader.pipelineCacheUUID, physicalDeviceProperties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
+
+VkPipelineCache Graphics::GetPipelineCache()
+{
+	return pipelineCache;
+}
+
+PipelineLayoutCache& Graphics::GetPipelineLayoutCache()
+{
+	return pipelineLayoutCache;
+}
+
+void Graphics::DestroyPipelineLater(VkPipeline pipeline)
+{
+	RetiredResource retired;
+	retired.pipeline = pipeline;
+	retired.retiredFrame = frameCount;
+	retiredResources.push_back(retired);
+}
+
+void Graphics::DestroyBufferLater(VkBuffer& buffer, MemoryAllocation& bufferMemory)
+{
+	if (buffer != VK_NULL_HANDLE)
+	{
+		RetiredResource retired;
+		retired.buffer = buffer;
+		retired.memory = bufferMemory;
+		retired.retiredFrame = frameCount;
+		retiredResources.push_back(retired);
+	}
+	buffer = VK_NULL_HANDLE;
+	bufferMemory = MemoryAllocation();
+}
+
+void Graphics::DestroyRetiredResources(bool destroyAll)
+{
+	// Frames up to retiredFrame may use the resource.
+		// When the fence of frame (retiredFrame + MAX_FRAMES_IN_FLIGHT) is waited, all of them are completed.
+	auto iter = std::remove_if(retiredResources.begin(), retiredResources.end(), [&](RetiredResource& retired)
+		{
+			if (destroyAll == false && frameCount < retired.retiredFrame + MAX_FRAMES_IN_FLIGHT)
+			{
+				return false;
+			}
+
+			if (retired.pipeline != VK_NULL_HANDLE)
+			{
+				vkDestroyPipeline(device, retired.pipeline, nullptr);
+			}
+			if (retired.buffer != VK_NULL_HANDLE)
+			{
+				DestroyBuffer(retired.buffer, retired.memory);
+			}
+			if (retired.imageView != VK_NULL_HANDLE)
+			{
+				vkDestroyImageView(device, retired.imageView, nullptr);
+			}
+			if (retired.image != VK_NULL_HANDLE)
+			{
+				DestroyImage(retired.image, retired.memory);
+			}
+			return true;
+		});
+	retiredResources.erase(iter, retiredResources.end());
+}
+
+void Graphics::CreateImage(uint32_t width, uint32_t height, uint32_t mipLevels, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, MemoryAllocation& imageMemory)
 {
 	VkImageCreateInfo imageInfo{};
 	imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
@@ -721,13 +1385,22 @@ void Graphics::CreateImage(uint32_t width, uint32_t height, VkFormat format, VkI
 	imageInfo.extent.width = width;
 	imageInfo.extent.height = height;
 	imageInfo.extent.depth = 1;
-	imageInfo.mipLevels = 1;
+	imageInfo.mipLevels = mipLevels;
 	imageInfo.arrayLayers = 1;
 	imageInfo.format = format;
 	imageInfo.tiling = tiling;
 	imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
 	imageInfo.usage = usage;
 	imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	// Uploaded images are written by the transfer queue and read by the graphics queue.
+		// Concurrent sharing avoids queue family ownership transfers between them.
+	const uint32_t queueFamilies[] = { queueFamily, transferQueueFamily };
+	if ((usage & VK_IMAGE_USAGE_TRANSFER_DST_BIT) && transferQueueFamily != queueFamily)
+	{
+		imageInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+		imageInfo.queueFamilyIndexCount = 2;
+		imageInfo.pQueueFamilyIndices = queueFamilies;
+	}
 	imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
 	imageInfo.flags = 0;
 
@@ -737,18 +1410,24 @@ void Graphics::CreateImage(uint32_t width, uint32_t height, VkFormat format, VkI
 	// Note that using vkGetImageMemoryRequirements instead of vkGetBufferMemoryRequirements
 	vkGetImageMemoryRequirements(device, image, &memRequirements);
 
-	VkMemoryAllocateInfo allocInfo{};
-	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-	allocInfo.allocationSize = memRequirements.size;
-	allocInfo.memoryTypeIndex = VulkanHelper::FindMemoryType(physicalDevice, memRequirements.memoryTypeBits, properties);
-
-	VulkanHelper::VkCheck(vkAllocateMemory(device, &allocInfo, nullptr, &imageMemory), "Allocating memory has failed!");
+	if (memoryAllocator.Allocate(memRequirements, properties, MemoryResourceType::OptimalImage, MemoryLifetime::LongLived, imageMemory) == false)
+	{
+		std::cout << "Allocating memory has failed!" << std::endl;
+		return;
+	}
 
 	// Note that using vkBindImageMemoryinstead of vkBindBufferMemory
-	vkBindImageMemory(device, image, imageMemory, 0);
+	vkBindImageMemory(device, image, imageMemory.memory, imageMemory.offset);
 }
 
-VkImageView Graphics::CreateImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags)
+void Graphics::DestroyImage(VkImage& image, MemoryAllocation& imageMemory)
+{
+	vkDestroyImage(device, image, nullptr);
+	memoryAllocator.Free(imageMemory);
+	image = VK_NULL_HANDLE;
+}
+
+VkImageView Graphics::CreateImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags, uint32_t mipLevels, uint32_t baseMipLevel)
 {
 	VkImageViewCreateInfo createInfo{};
 	createInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
@@ -756,8 +1435,8 @@ VkImageView Graphics::CreateImageView(VkImage image, VkFormat format, VkImageAsp
 	createInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
 	createInfo.format = format;
 	createInfo.subresourceRange.aspectMask = aspectFlags;
-	createInfo.subresourceRange.baseMipLevel = 0;
-	createInfo.subresourceRange.levelCount = 1;
+	createInfo.subresourceRange.baseMipLevel = baseMipLevel;
+	createInfo.subresourceRange.levelCount = mipLevels;
 	createInfo.subresourceRange.baseArrayLayer = 0;
 	createInfo.subresourceRange.layerCount = 1;
 
@@ -767,6 +1446,14 @@ VkImageView Graphics::CreateImageView(VkImage image, VkFormat format, VkImageAsp
 	return imageView;
 }
 
+bool Graphics::IsTextureFormatSupported(VkFormat format) const
+{
+	VkFormatProperties formatProperties;
+	vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &formatProperties);
+	const VkFormatFeatureFlags requiredFeatures = VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+	return (formatProperties.optimalTilingFeatures & requiredFeatures) == requiredFeatures;
+}
+
 VkCommandBuffer Graphics::BeginSingleTimeCommands()
 {
 	VkCommandBufferAllocateInfo allocInfo{};
@@ -803,95 +1490,212 @@ void Graphics::EndSingleTimeCommands(VkCommandBuffer commandBuffer)
 	vkFreeCommandBuffers(device, commandPool, 1, &commandBuffer);
 }
 
-void Graphics::CopyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size)
+bool Graphics::UploadBufferData(VkBuffer dstBuffer, const void* data, VkDeviceSize size, VkDeviceSize dstOffset)
 {
-	VkCommandBuffer copyCommandBuffer = BeginSingleTimeCommands();
+	UploadQueue::StagingRegion staging;
+	VkCommandBuffer copyCommandBuffer = uploadQueue.BeginRecording(size, staging);
+	if (copyCommandBuffer == VK_NULL_HANDLE)
+	{
+		return false;
+	}
+
+	memcpy(staging.mappedData, data, static_cast<size_t>(size));
 
 	VkBufferCopy copyRegion{};
-	copyRegion.srcOffset = 0;
-	copyRegion.dstOffset = 0;
+	copyRegion.srcOffset = staging.offset;
+	copyRegion.dstOffset = dstOffset;
 	copyRegion.size = size;
-	vkCmdCopyBuffer(copyCommandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
+	vkCmdCopyBuffer(copyCommandBuffer, staging.buffer, dstBuffer, 1, &copyRegion);
 
-	EndSingleTimeCommands(copyCommandBuffer);
+	uploadQueue.EndRecording();
+	return true;
 }
 
-void Graphics::CreateTextureImageAndImageView(const std::string& path, VkImage& textureImage, VkDeviceMemory& textureImageMemory, VkImageView& textureImageView)
+void Graphics::FlushUploads()
 {
-	int texWidth, texHeight, texChannels;
+	uploadQueue.Submit();
+}
 
-	stbi_set_flip_vertically_on_load(true);
-	stbi_uc* pixels = stbi_load(path.c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
-	constexpr int RGBA = 4;
-	VkDeviceSize imageSize = texWidth * texHeight * RGBA;
+std::vector<TextureData> Graphics::ImportTextures(const std::vector<std::string>& paths)
+{
+	const size_t textureCount = paths.size();
+	std::vector<TextureData> textures(textureCount);
+	// char instead of bool, since elements of std::vector<bool> cannot be written from several threads.
+	std::vector<char> isImported(textureCount);
+
+	// Meshes often share an image. It is decoded once, so its cache file is not transcoded and written by several threads.
+	std::vector<size_t> indices(textureCount);
+	std::iota(indices.begin(), indices.end(), 0);
+	std::stable_sort(indices.begin(), indices.end(), [&](size_t a, size_t b) { return paths[a] < paths[b]; });
+	std::vector<size_t> uniqueIndices = indices;
+	uniqueIndices.erase(std::unique(uniqueIndices.begin(), uniqueIndices.end(), [&](size_t a, size_t b) { return paths[a] == paths[b]; }), uniqueIndices.end());
+	std::for_each(std::execution::par, uniqueIndices.begin(), uniqueIndices.end(), [&](size_t i)
+		{
+			isImported[i] = ImportTexture(paths[i], textures[i]);
+		});
+	// Sorted indices of the same path start with the decoded one.
+	for (size_t i = 1; i < textureCount; i++)
+	{
+		if (paths[indices[i]] == paths[indices[i - 1]])
+		{
+			textures[indices[i]] = textures[indices[i - 1]];
+			isImported[indices[i]] = isImported[indices[i - 1]];
+		}
+	}
 
-	if (!pixels)
+	// Message boxes are only shown by the main thread.
+	for (size_t i = 0; i < textureCount; i++)
 	{
-		windowHolder->DisplayMessage("Texture Error", std::string("Loading texture image has Failed!") + std::string("\n") + path);
+		if (isImported[i] == false)
+		{
+			textures[i] = ImportDefaultTexture(paths[i]);
+		}
+	}
+
+	return textures;
+}
+
+bool Graphics::ImportTexture(const std::string& path, TextureData& texture)
+{
+	return TextureImporter::Import(path, isTextureCompressionEnabled, texture) && IsTextureFormatSupported(texture.format);
+}
 
-		// The path is for when the given path is not valid, display default image.
-		pixels = stbi_load("../Vulkan/Graphics/Model/EssentialImages/transparent.png", &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
-		imageSize = texWidth * texHeight * RGBA;
+TextureData Graphics::ImportDefaultTexture(const std::string& failedPath)
+{
+	if (isHeadless)
+	{
+		std::cout << "Loading texture image has Failed! " << failedPath << std::endl;
+	}
+	else
+	{
+		windowHolder->DisplayMessage("Texture Error", std::string("Loading texture image has Failed!") + std::string("\n") + failedPath);
 	}
 
-	VkBuffer stagingBuffer;
-	VkDeviceMemory stagingBufferMemory;
+	// The path is for when the given path is not valid, display default image.
+	TextureData texture;
+	TextureImporter::Import("../Vulkan/Graphics/Model/EssentialImages/transparent.png", false, texture);
+	return texture;
+}
 
-	CreateBuffer(imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
-	void* data;
-	vkMapMemory(device, stagingBufferMemory, 0, imageSize, 0, &data);
-	memcpy(data, pixels, static_cast<size_t>(imageSize));
-	vkUnmapMemory(device, stagingBufferMemory);
+void Graphics::CreateTextureImageAndImageView(const std::string& path, VkImage& textureImage, MemoryAllocation& textureImageMemory, VkImageView& textureImageView)
+{
+	CreateTextureImageAndImageView(ImportTextures({ path }).front(), textureImage, textureImageMemory, textureImageView);
+}
+
+bool Graphics::CreateTextureImageAndImageView(const TextureData& texture, VkImage& textureImage, MemoryAllocation& textureImageMemory, VkImageView& textureImageView)
+{
+	const uint32_t mipLevels = static_cast<uint32_t>(texture.mipLevels.size());
+	const uint32_t texWidth = texture.mipLevels.front().width;
+	const uint32_t texHeight = texture.mipLevels.front().height;
+	CreateImage(texWidth, texHeight, mipLevels, texture.format, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, textureImage, textureImageMemory);
+	const bool isUploaded = RecordTextureUpload(texture, textureImage, 0);
 
-	stbi_image_free(pixels);
+	// Create Image View
+	textureImageView = CreateImageView(textureImage, texture.format, VK_IMAGE_ASPECT_COLOR_BIT, mipLevels);
+	return isUploaded;
+}
 
-	CreateImage(texWidth, texHeight, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, textureImage, textureImageMemory);
+bool Graphics::CreateStreamedTextureImage(const TextureData& levels, uint32_t firstLevel, uint32_t width, uint32_t height, uint32_t mipLevels, VkImage& textureImage, MemoryAllocation& textureImageMemory, VkImageView& textureImageView)
+{
+	// Levels in front of firstLevel stay in the undefined layout until they are uploaded, and no view covers them until then.
+	CreateImage(width, height, mipLevels, levels.format, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, textureImage, textureImageMemory);
+	const bool isUploaded = RecordTextureUpload(levels, textureImage, firstLevel);
 
-	TransitionImageLayout(textureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-	CopyBufferToImage(stagingBuffer, textureImage, static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight));
+	textureImageView = CreateImageView(textureImage, levels.format, VK_IMAGE_ASPECT_COLOR_BIT, mipLevels - firstLevel, firstLevel);
+	return isUploaded;
+}
 
-	TransitionImageLayout(textureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+bool Graphics::UploadTextureMipLevels(const TextureData& levels, uint32_t firstLevel, uint32_t mipLevels, VkImage textureImage, VkImageView& textureImageView)
+{
+	const bool isUploaded = RecordTextureUpload(levels, textureImage, firstLevel);
 
-	vkDestroyBuffer(device, stagingBuffer, nullptr);
-	vkFreeMemory(device, stagingBufferMemory, nullptr);
-	// Finished creating texture image (create staging buffer, copy image data, copy buffer data to image buffer, clean staging buffer)
+	RetiredResource retired;
+	retired.imageView = textureImageView;
+	retired.retiredFrame = frameCount;
+	retiredResources.push_back(retired);
 
-	// Create Image View
-	textureImageView = CreateImageView(textureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_ASPECT_COLOR_BIT);
+	textureImageView = CreateImageView(textureImage, levels.format, VK_IMAGE_ASPECT_COLOR_BIT, mipLevels - firstLevel, firstLevel);
+	return isUploaded;
 }
 
-void Graphics::DestroyTextureImageAndImageView(VkImage& textureImage, VkDeviceMemory textureImageMemory, VkImageView& textureImageView)
+void Graphics::DestroyTextureImageAndImageView(VkImage& textureImage, MemoryAllocation& textureImageMemory, VkImageView& textureImageView)
 {
 	vkDestroyImageView(device, textureImageView, nullptr);
-	vkDestroyImage(device, textureImage, nullptr);
-	vkFreeMemory(device, textureImageMemory, nullptr);
+	DestroyImage(textureImage, textureImageMemory);
 }
 
-void Graphics::CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& bufferMemory)
+void Graphics::DestroyTextureImageAndImageViewLater(VkImage& textureImage, MemoryAllocation& textureImageMemory, VkImageView& textureImageView)
+{
+	RetiredResource retired;
+	retired.image = textureImage;
+	retired.imageView = textureImageView;
+	retired.memory = textureImageMemory;
+	retired.retiredFrame = frameCount;
+	retiredResources.push_back(retired);
+
+	textureImage = VK_NULL_HANDLE;
+	textureImageMemory = MemoryAllocation();
+	textureImageView = VK_NULL_HANDLE;
+}
+
+DeviceMemoryAllocator& Graphics::GetMemoryAllocator()
+{
+	return memoryAllocator;
+}
+
+DescriptorAllocator& Graphics::GetDescriptorAllocator()
+{
+	return descriptorAllocator;
+}
+
+DescriptorSetLayoutCache& Graphics::GetDescriptorSetLayoutCache()
+{
+	return descriptorSetLayoutCache;
+}
+
+DepthPyramid& Graphics::GetDepthPyramid()
+{
+	return depthPyramid;
+}
+
+void Graphics::CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, MemoryAllocation& bufferMemory, MemoryLifetime lifetime)
 {
 	VkBufferCreateInfo bufferInfo{};
 	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
 	bufferInfo.size = size;
 	bufferInfo.usage = usage;
 	bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	// Same as images, uploaded buffers are shared by the transfer and the graphics queue.
+	const uint32_t queueFamilies[] = { queueFamily, transferQueueFamily };
+	if ((usage & VK_BUFFER_USAGE_TRANSFER_DST_BIT) && transferQueueFamily != queueFamily)
+	{
+		bufferInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+		bufferInfo.queueFamilyIndexCount = 2;
+		bufferInfo.pQueueFamilyIndices = queueFamilies;
+	}
 
 	VulkanHelper::VkCheck(vkCreateBuffer(device, &bufferInfo, nullptr, &buffer), "Creating Vertex buffer has failed!");
 
 	VkMemoryRequirements memRequirements;
 	vkGetBufferMemoryRequirements(device, buffer, &memRequirements);
 
-	VkMemoryAllocateInfo allocInfo{};
-	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-	allocInfo.allocationSize = memRequirements.size;
-	allocInfo.memoryTypeIndex = VulkanHelper::FindMemoryTypeIndex(physicalDevice, memRequirements, properties);
+	if (memoryAllocator.Allocate(memRequirements, properties, MemoryResourceType::Buffer, lifetime, bufferMemory) == false)
+	{
+		std::cout << "Allocating vertex buffer memory has failed!" << std::endl;
+		return;
+	}
+	vkBindBufferMemory(device, buffer, bufferMemory.memory, bufferMemory.offset);
+}
 
-	VulkanHelper::VkCheck(vkAllocateMemory(device, &allocInfo, nullptr, &bufferMemory), "Allocating vertex buffer memory has failed!");
-	vkBindBufferMemory(device, buffer, bufferMemory, 0);
+void Graphics::DestroyBuffer(VkBuffer& buffer, MemoryAllocation& bufferMemory)
+{
+	vkDestroyBuffer(device, buffer, nullptr);
+	memoryAllocator.Free(bufferMemory);
+	buffer = VK_NULL_HANDLE;
 }
 
-void Graphics::TransitionImageLayout(VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout)
+void Graphics::TransitionImageLayout(VkCommandBuffer commandBuffer, VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t mipLevels, uint32_t baseMipLevel)
 {
-	VkCommandBuffer commandBuffer = BeginSingleTimeCommands();
 
 	VkImageMemoryBarrier barrier{};
 	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
@@ -901,8 +1705,8 @@ void Graphics::TransitionImageLayout(VkImage image, VkFormat format, VkImageLayo
 	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
 	barrier.image = image;
 	barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-	barrier.subresourceRange.baseMipLevel = 0;
-	barrier.subresourceRange.levelCount = 1;
+	barrier.subresourceRange.baseMipLevel = baseMipLevel;
+	barrier.subresourceRange.levelCount = mipLevels;
 	barrier.subresourceRange.baseArrayLayer = 0;
 	barrier.subresourceRange.layerCount = 1;
 	barrier.srcAccessMask = 0; // TODO
@@ -926,6 +1730,23 @@ void Graphics::TransitionImageLayout(VkImage image, VkFormat format, VkImageLayo
 
 		sourceStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
 		destinationStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+
+		// A transfer only queue has no fragment shader stage.
+			// Draws wait for the upload semaphore, which makes the writes visible to them anyway.
+		if (transferQueueFamily != queueFamily)
+		{
+			barrier.dstAccessMask = 0;
+			destinationStage = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+		}
+	}
+	else if (oldLayout == VK_IMAGE_LAYOUT_UNDEFINED && newLayout == VK_IMAGE_LAYOUT_GENERAL)
+	{
+		// Images written and read by compute shaders.
+		barrier.srcAccessMask = 0;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+		sourceStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+		destinationStage = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
 	}
 	else
 	{
@@ -938,21 +1759,17 @@ void Graphics::TransitionImageLayout(VkImage image, VkFormat format, VkImageLayo
 		0, nullptr,
 		0, nullptr,
 		1, &barrier);
-
-	EndSingleTimeCommands(commandBuffer);
 }
 
-void Graphics::CopyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height)
+void Graphics::CopyBufferToImage(VkCommandBuffer commandBuffer, VkBuffer buffer, VkDeviceSize bufferOffset, VkImage image, uint32_t width, uint32_t height, uint32_t mipLevel)
 {
-	VkCommandBuffer commandBuffer = BeginSingleTimeCommands();
-
 	VkBufferImageCopy region{};
-	region.bufferOffset = 0;
+	region.bufferOffset = bufferOffset;
 	region.bufferRowLength = 0;
 	region.bufferImageHeight = 0;
 
 	region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-	region.imageSubresource.mipLevel = 0;
+	region.imageSubresource.mipLevel = mipLevel;
 	region.imageSubresource.baseArrayLayer = 0;
 	region.imageSubresource.layerCount = 1;
 
@@ -960,8 +1777,37 @@ void Graphics::CopyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width,
 	region.imageExtent = { width, height, 1 };
 
 	vkCmdCopyBufferToImage(commandBuffer, buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+}
 
-	EndSingleTimeCommands(commandBuffer);
+bool Graphics::RecordTextureUpload(const TextureData& levels, VkImage textureImage, uint32_t firstLevel)
+{
+	const uint32_t levelCount = static_cast<uint32_t>(levels.mipLevels.size());
+
+	// Every level is staged in the ring at once, and the transitions and the copies go into the current upload batch.
+	UploadQueue::StagingRegion staging;
+	VkCommandBuffer uploadCommandBuffer = uploadQueue.BeginRecording(levels.data.size(), staging);
+	if (uploadCommandBuffer == VK_NULL_HANDLE)
+	{
+		// Image is still made readable, so descriptor sets referring to it stay valid. Compressed formats cannot be cleared, so its contents are undefined.
+		uploadCommandBuffer = uploadQueue.BeginRecording();
+		TransitionImageLayout(uploadCommandBuffer, textureImage, levels.format, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, levelCount, firstLevel);
+		TransitionImageLayout(uploadCommandBuffer, textureImage, levels.format, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, levelCount, firstLevel);
+		uploadQueue.EndRecording();
+		return false;
+	}
+
+	memcpy(staging.mappedData, levels.data.data(), levels.data.size());
+
+	TransitionImageLayout(uploadCommandBuffer, textureImage, levels.format, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, levelCount, firstLevel);
+	for (uint32_t level = 0; level < levelCount; level++)
+	{
+		const TextureMipLevel& mipLevel = levels.mipLevels[level];
+		CopyBufferToImage(uploadCommandBuffer, staging.buffer, staging.offset + mipLevel.offset, textureImage, mipLevel.width, mipLevel.height, firstLevel + level);
+	}
+	TransitionImageLayout(uploadCommandBuffer, textureImage, levels.format, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, levelCount, firstLevel);
+
+	uploadQueue.EndRecording();
+	return true;
 }
 
 std::vector<const char*> Graphics::LoadCompatibleLayers(std::vector<const char*> layers)
@@ -996,6 +1842,8 @@ void Graphics::GetCommandQueue()
 {
 	// Why queueIndex is 0???
 	vkGetDeviceQueue(device, queueFamily, 0, &queue);
+	// If there is no transfer only family, uploads share the graphics queue.
+	vkGetDeviceQueue(device, transferQueueFamily, 0, &transferQueue);
 }
 
 void Graphics::DestroySurface()
@@ -1005,6 +1853,18 @@ void Graphics::DestroySurface()
 
 void Graphics::DestroyCommandPool()
 {
+	// Destroying a pool frees every command buffer allocated from it.
+	for (VkCommandPool pool : threadCommandPools)
+	{
+		vkDestroyCommandPool(device, pool, nullptr);
+	}
+	threadCommandPools.clear();
+	threadCommandBuffers.clear();
+	for (VkCommandPool pool : frameCommandPools)
+	{
+		vkDestroyCommandPool(device, pool, nullptr);
+	}
+	frameCommandPools.clear();
 	vkDestroyCommandPool(device, commandPool, nullptr);
 }
 
@@ -1093,10 +1953,18 @@ void Graphics::RecreateSwapchain()
 	CreateImageViews();
 	CreateDepthResources();
 	CreateFramebuffers();
+
+	swapchainGeneration++;
 }
 
 void Graphics::DestroySwapchain()
 {
+	if (isHeadless)
+	{
+		DestroyImage(offscreenImage, offscreenImageMemory);
+		swapchainImages.clear();
+		return;
+	}
 	vkDestroySwapchainKHR(device, swapchain, nullptr);
 }
 
@@ -1111,9 +1979,10 @@ void Graphics::GetSwapchainImages()
 void Graphics::UpdateCurrentFrameID()
 {
 	currentFrameID = (currentFrameID + 1) % MAX_FRAMES_IN_FLIGHT;
+	frameCount++;
 }
 
-void Graphics::RecordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex)
+void Graphics::RecordCommandBuffer(VkCommandBuffer commandBuffer)
 {
 	VkCommandBufferBeginInfo beginInfo{};
 	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
@@ -1122,36 +1991,8 @@ void Graphics::RecordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t image
 
 	VulkanHelper::VkCheck(vkBeginCommandBuffer(commandBuffer, &beginInfo), "Begining command buffer has failed!");
 
+	// The frame is ended in EndDrawing().
+	gpuProfiler.BeginFrame(commandBuffer, currentFrameID);
 
-	// Starting a render pass??????
-	VkRenderPassBeginInfo renderPassInfo{};
-	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-	renderPassInfo.renderPass = renderPass;
-	renderPassInfo.framebuffer = swapchainFramebuffers[imageIndex];
-	renderPassInfo.renderArea.offset = { 0, 0 };
-	renderPassInfo.renderArea.extent = swapchainExtent;
-
-	// Since VkClearValue is union, use appropriate member variable name for usage.
-	std::array<VkClearValue, 2> clearValues{};
-	clearValues[0].color = { { 0.4f, 0.f, 0.f, 1.f} };
-	clearValues[1].depthStencil = { 1.f, 0 };
-
-	renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
-	renderPassInfo.pClearValues = clearValues.data();
-
-	vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-
-	VkViewport viewport{};
-	viewport.x = 0.f;
-	viewport.y = 0.f;
-	viewport.width = static_cast<float>(swapchainExtent.width);
-	viewport.height = static_cast<float>(swapchainExtent.height);
-	viewport.minDepth = 0.f;
-	viewport.maxDepth = 1.f;
-	vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
-
-	VkRect2D scissor{};
-	scissor.offset = { 0, 0 };
-	scissor.extent = swapchainExtent;
-	vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+	// Render pass is begun by BeginRenderPass(), after the commands which should be outside of it.
 }
@@ -12,10 +12,21 @@ Creation Date: 12.19.2022
 #include "Vulkan/vulkan.h"
 #include <vector>
 #include <string>
+#include <Graphics/Allocator/MemoryAllocator.h>
+#include <Graphics/Allocator/DescriptorAllocator.h>
+#include <Graphics/DescriptorSetLayoutCache.h>
+#include <Graphics/UploadQueue.h>
+#include <Graphics/Pipelines/PipelineLayoutCache.h>
+#include <Graphics/Culling/DepthPyramid.h>
+#include <Graphics/Profiling/GPUProfiler.h>
+#include <Graphics/Textures/TextureImporter.h>
 
 class Window;
 class Buffer;
 class UniformBuffer;
+class UniformRingBuffer;
+class MeshArena;
+class MeshCuller;
 
 
 class Graphics
@@ -23,8 +34,17 @@ class Graphics
 public:
 	friend Buffer;
 	friend UniformBuffer;
+	friend UniformRingBuffer;
+	friend MeshArena;
+	friend MeshCuller;
+	friend DepthPyramid;
 public:
 	static constexpr unsigned int MAX_FRAMES_IN_FLIGHT = 2;
+	static constexpr unsigned int MAX_RECORDING_THREADS = 8;
+	// Transcode decoded textures into BC1/BC7 if the device supports them.
+	static constexpr bool COMPRESS_TEXTURES = true;
+	// Format of the offscreen color image in the headless mode.
+	static constexpr VkFormat OFFSCREEN_FORMAT = VK_FORMAT_R8G8B8A8_SRGB;
 public:
 	Graphics();
 	~Graphics();
@@ -32,9 +52,17 @@ public:
 	// Return if initialization is succeed or not
 	// Use VK_MAKE_VERSION(major, minor, patch) for second parameter 'appVersion'
 	bool InitVulkan(const char* appName, uint32_t appVersion, Window* windowHolder);
+	// Render into an offscreen color image and the depth image of the extent, without a window, a surface or a swapchain.
+		// Any device which can run the engine is accepted, including CPU implementations such as lavapipe.
+		// Device whose name contains preferredDeviceName is chosen first if it is not empty.
+	bool InitVulkanHeadless(const char* appName, uint32_t appVersion, VkExtent2D extent, const std::string& preferredDeviceName);
+	bool IsHeadless();
+	std::string GetDeviceName();
 	void CleanVulkan();
 
 	bool StartDrawing();
+	// Commands outside of the render pass, such as compute passes, are recorded into GetCommandBuffer() before this.
+	void BeginRenderPass();
 	void EndDrawing();
 
 	void DeviceWaitIdle();
@@ -43,28 +71,96 @@ public:
 	VkSampler GetTextureSampler();
 	VkRenderPass GetRenderPass();
 	VkExtent2D GetSwapchainExtent();
+	const VkPhysicalDeviceProperties& GetPhysicalDeviceProperties();
 
 	VkCommandBuffer GetCommandBuffer();
 	uint32_t GetCurrentFrameID();
-
-	void CreateTextureImageAndImageView(const std::string& path, VkImage& textureImage, VkDeviceMemory& textureImageMemory, VkImageView& textureImageView);
-	void DestroyTextureImageAndImageView(VkImage& textureImage, VkDeviceMemory textureImageMemory, VkImageView& textureImageView);
+	// Number of frames submitted so far. Resources used by frame N are free when this is N + MAX_FRAMES_IN_FLIGHT, after StartDrawing().
+	uint64_t GetFrameCount();
+
+	// The main render pass only executes secondary command buffers.
+	// Secondary command buffer recorded every frame by the main thread. It is reset with the pool of the frame in StartDrawing().
+	VkCommandBuffer GetDynamicCommandBuffer();
+	// @@ Multithreaded recording
+	// Each recording thread owns one command pool per frame in flight, so threads never share a pool.
+	// A pool is reset wholesale, and its command buffer is kept until the owner resets it again.
+	uint32_t GetRecordingThreadCount();
+	void ResetThreadCommandPool(uint32_t threadID, uint32_t frameID);
+	VkCommandBuffer GetThreadCommandBuffer(uint32_t threadID, uint32_t frameID);
+	// @@ End of multithreaded recording
+	// Viewport and scissor are set here, since dynamic states are not inherited from the primary command buffer.
+	void BeginSecondaryCommandBuffer(VkCommandBuffer commandBuffer);
+	void EndSecondaryCommandBuffer(VkCommandBuffer commandBuffer);
+	// Increased whenever the swapchain is recreated. Secondary command buffers recorded before have old viewport.
+	uint32_t GetSwapchainGeneration();
+
+	// Decode every image on the thread pool. Textures failed to load are replaced with the default image.
+		// Nothing is uploaded here, so the results can be created in one batch of the upload queue.
+	std::vector<TextureData> ImportTextures(const std::vector<std::string>& paths);
+	// Can be called from any thread. Return false if the image cannot be loaded or sampled by the device.
+	bool ImportTexture(const std::string& path, TextureData& texture);
+	// Main thread only. Display the error of failedPath, and load the default image instead.
+	TextureData ImportDefaultTexture(const std::string& failedPath);
+	void CreateTextureImageAndImageView(const std::string& path, VkImage& textureImage, MemoryAllocation& textureImageMemory, VkImageView& textureImageView);
+	// If the data cannot be staged, the image is left with undefined contents in the shader read layout, and false is returned.
+	bool CreateTextureImageAndImageView(const TextureData& texture, VkImage& textureImage, MemoryAllocation& textureImageMemory, VkImageView& textureImageView);
+	void DestroyTextureImageAndImageView(VkImage& textureImage, MemoryAllocation& textureImageMemory, VkImageView& textureImageView);
+	// Same as DestroyPipelineLater(). The handles are reset, so a new texture can be created in their place right away.
+	void DestroyTextureImageAndImageViewLater(VkImage& textureImage, MemoryAllocation& textureImageMemory, VkImageView& textureImageView);
+	// Streamed textures. The image is made with the full chain of mipLevels levels from width x height once,
+		// but only the levels of the given data, which start from firstLevel and end at the smallest level, are uploaded and viewed.
+	bool CreateStreamedTextureImage(const TextureData& levels, uint32_t firstLevel, uint32_t width, uint32_t height, uint32_t mipLevels, VkImage& textureImage, MemoryAllocation& textureImageMemory, VkImageView& textureImageView);
+	// Upload levels from firstLevel, which end right before the viewed ones, and replace the view with one from firstLevel.
+		// Frames in flight only read the old levels, so nothing is waited. The old view is destroyed after those frames are completed.
+	bool UploadTextureMipLevels(const TextureData& levels, uint32_t firstLevel, uint32_t mipLevels, VkImage textureImage, VkImageView& textureImageView);
+
+	// Every buffer and image memory is sub-allocated from here.
+	DeviceMemoryAllocator& GetMemoryAllocator();
+	// Every descriptor set, except the bindless texture table, is allocated from here.
+	DescriptorAllocator& GetDescriptorAllocator();
+	DescriptorSetLayoutCache& GetDescriptorSetLayoutCache();
+	// Built from the depth buffer at the end of each frame, so culling passes read the depth of the previous frame.
+	DepthPyramid& GetDepthPyramid();
+
+	// Submit uploads recorded so far without waiting for the next frame. Call it at the end of loading.
+	void FlushUploads();
+
+	// Loaded from PIPELINE_CACHE_PATH at initialization, and saved back at cleanup.
+	VkPipelineCache GetPipelineCache();
+	PipelineLayoutCache& GetPipelineLayoutCache();
+	// Destroy the pipeline after every frame in flight which may use it is completed, so it can be replaced without waiting for the device.
+	void DestroyPipelineLater(VkPipeline pipeline);
+
+	// @@ Frame timing
+	// The frame region is written by Graphics. Other regions are written by whoever records them, with GetCurrentFrameID().
+		// Results of a frame are read when its fence is waited in StartDrawing().
+	GPUProfiler& GetGPUProfiler();
+	// @@ End of frame timing
+	// Headless only, and the device should be idle. RGBA pixels of the last frame in OFFSCREEN_FORMAT, row by row from the top.
+	bool ReadOffscreenImage(std::vector<uint8_t>& pixels);
 
 private:
 	bool CreateInstance(const char* appName, uint32_t appVersion);
 	void DestroyInstance();
 
-	void CreatePhysicalDevice();
+	bool CreatePhysicalDevice();
+	// Higher is better. 0 if the device cannot run the engine, such as missing a feature CreateDevice() requires.
+		// Discrete GPUs come first, then integrated, virtual and CPU devices. Devices of the same type are ordered by their device local memory.
+	int64_t RatePhysicalDevice(VkPhysicalDevice candidate, const VkPhysicalDeviceProperties& properties);
 	void ChooseQueueFamily();
 	bool CreateDevice();
 	bool CreateSurfaceByGLFW();
 	bool CreateCommandPoolAndAllocateCommandBuffers();
 	bool CreateSwapchain();
+	// Takes the place of the swapchain images in the headless mode.
+	void CreateOffscreenImage();
 	void CreateRenderPass();
 
 	void CreateSyncObjects();
 	void DestroySyncObjects();
 
+	void InitGPUProfiler();
+
 	void CreateFramebuffers();
 	void DestroyFramebuffers();
 
@@ -77,19 +173,40 @@ private:
 	void CreateTextureSampler();
 	void DestroyTextureSampler();
 
-	void CreateImage(uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, VkDeviceMemory& imageMemory);
-	VkImageView CreateImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags);
+	void CreatePipelineCache();
+	void DestroyPipelineCache();
+	// Return false if the file is made by another device or driver.
+	bool IsPipelineCacheCompatible(const std::vector<char>& fileData) const;
+	// Destroy every retired resource if destroyAll is true, otherwise only the ones no frame in flight uses.
+	void DestroyRetiredResources(bool destroyAll);
+
+	void CreateImage(uint32_t width, uint32_t height, uint32_t mipLevels, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, MemoryAllocation& imageMemory);
+	void DestroyImage(VkImage& image, MemoryAllocation& imageMemory);
+	VkImageView CreateImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags, uint32_t mipLevels, uint32_t baseMipLevel = 0);
+	// True if images of the format can be sampled with a linear filter.
+	bool IsTextureFormatSupported(VkFormat format) const;
 
 
 	VkCommandBuffer BeginSingleTimeCommands();
 	void EndSingleTimeCommands(VkCommandBuffer commandBuffer);
 
-	void CopyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
+	// Data is copied into the staging ring of the upload queue, and the copy is executed before the next draw.
+		// Return false if staging memory cannot be made, and nothing is uploaded.
+	bool UploadBufferData(VkBuffer dstBuffer, const void* data, VkDeviceSize size, VkDeviceSize dstOffset = 0);
 
 	// Texture related functions
-	void CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& bufferMemory);
-	void TransitionImageLayout(VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout);
-	void CopyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height);
+	// Staging buffers should be destroyed right after the upload, so they are bump allocated.
+	void CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, MemoryAllocation& bufferMemory, MemoryLifetime lifetime = MemoryLifetime::LongLived);
+	void DestroyBuffer(VkBuffer& buffer, MemoryAllocation& bufferMemory);
+	// Same as DestroyPipelineLater(). The handles are reset, so the owner can create a new buffer right away.
+	void DestroyBufferLater(VkBuffer& buffer, MemoryAllocation& bufferMemory);
+	// Recorded into commandBuffer of the upload queue.
+	// mipLevels levels from baseMipLevel are transitioned together.
+	void TransitionImageLayout(VkCommandBuffer commandBuffer, VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t mipLevels, uint32_t baseMipLevel = 0);
+	void CopyBufferToImage(VkCommandBuffer commandBuffer, VkBuffer buffer, VkDeviceSize bufferOffset, VkImage image, uint32_t width, uint32_t height, uint32_t mipLevel);
+	// Stage the levels, and copy them to the levels of the image from firstLevel, which are left in the shader read layout.
+		// If the data cannot be staged, the levels are only transitioned with undefined contents, and false is returned.
+	bool RecordTextureUpload(const TextureData& levels, VkImage textureImage, uint32_t firstLevel);
 	// End of texture functions
 private:
 	std::vector<const char*> LoadCompatibleLayers(std::vector<const char*> layers);
@@ -97,6 +214,8 @@ private:
 	void GetCommandQueue();
 	void DestroySurface();
 	void DestroyCommandPool();
+	bool CreateCommandPool(VkCommandPoolCreateFlags flags, VkCommandPool& pool);
+	bool AllocateCommandBuffers(VkCommandPool pool, VkCommandBufferLevel level, uint32_t count, VkCommandBuffer* buffers);
 	void DestroyRenderPass();
 
 	const VkSurfaceFormatKHR& ChooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& formats) const;
@@ -109,28 +228,55 @@ private:
 
 
 	void UpdateCurrentFrameID();
-	void RecordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex);
+	void RecordCommandBuffer(VkCommandBuffer commandBuffer);
 
 private:
 	VkInstance instance{};
 	VkPhysicalDeviceProperties physicalDeviceProperties;
 	VkPhysicalDeviceFeatures2 physicalDeviceFeatures;
+	// Supported features of Vulkan 1.2. Zero if the device is older.
+	VkPhysicalDeviceVulkan12Features physicalDeviceVulkan12Features;
 	VkPhysicalDevice physicalDevice;
 	uint32_t queueFamily;
+	// Same as queueFamily if the device has no transfer only queue family.
+	uint32_t transferQueueFamily;
 	VkDevice device;
 	VkQueue queue;
+	VkQueue transferQueue;
+	UploadQueue uploadQueue;
 	VkSurfaceKHR surface;
+	// No window, surface and swapchain. The offscreen image is the only swapchain image.
+	bool isHeadless;
+	std::string preferredDeviceName;
+	VkImage offscreenImage;
+	MemoryAllocation offscreenImageMemory;
+	DeviceMemoryAllocator memoryAllocator;
+	DescriptorAllocator descriptorAllocator;
+	DescriptorSetLayoutCache descriptorSetLayoutCache;
+	// Used for single time commands.
 	VkCommandPool commandPool;
+	// Command buffers below are allocated from the pool of each frame, which is reset at the beginning of the frame.
+	std::vector<VkCommandPool> frameCommandPools;
 	std::vector<VkCommandBuffer> commandBuffers;
+	// ImGui is recorded every frame into its own secondary command buffer.
+	std::vector<VkCommandBuffer> guiCommandBuffers;
+	std::vector<VkCommandBuffer> dynamicCommandBuffers;
+	// Indexed by threadID * MAX_FRAMES_IN_FLIGHT + frameID
+	std::vector<VkCommandPool> threadCommandPools;
+	std::vector<VkCommandBuffer> threadCommandBuffers;
+	uint32_t recordingThreadCount;
 	VkSwapchainKHR swapchain;
+	uint32_t swapchainGeneration;
 	std::vector<VkImage> swapchainImages;
 	VkFormat swapchainImageFormat;
 	VkExtent2D swapchainExtent;
 	std::vector<VkImageView> swapchainImageViews;
 
 	VkImage depthImage;
-	VkDeviceMemory depthImageMemory;
+	MemoryAllocation depthImageMemory;
 	VkImageView depthImageView;
+	// Recreated with the depth image.
+	DepthPyramid depthPyramid;
 
 	VkRenderPass renderPass;
 	std::vector<VkFramebuffer>  swapchainFramebuffers;
@@ -140,13 +286,33 @@ private:
 	std::vector<VkSemaphore> renderFinishedSemaphores;
 	std::vector<VkFence> inFlightFences;
 
+	GPUProfiler gpuProfiler;
+
 	uint32_t currentFrameID;
+	// Number of frames submitted so far.
+	uint64_t frameCount;
 
 	std::vector<const char*> reqDeviceExtensions = {
 		VK_KHR_SWAPCHAIN_EXTENSION_NAME,
 	};
 
 	VkSampler textureSampler;
+	bool isTextureCompressionEnabled;
+
+	static constexpr const char* PIPELINE_CACHE_PATH = "pipeline_cache.bin";
+	VkPipelineCache pipelineCache;
+	PipelineLayoutCache pipelineLayoutCache;
+	// Only the handles of one kind are valid.
+	struct RetiredResource
+	{
+		VkPipeline pipeline = VK_NULL_HANDLE;
+		VkBuffer buffer = VK_NULL_HANDLE;
+		VkImage image = VK_NULL_HANDLE;
+		VkImageView imageView = VK_NULL_HANDLE;
+		MemoryAllocation memory;
+		uint64_t retiredFrame = 0;
+	};
+	std::vector<RetiredResource> retiredResources;
 
 	Window* windowHolder;
 
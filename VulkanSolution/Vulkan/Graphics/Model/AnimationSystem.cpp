@@ -37,11 +37,15 @@ void AnimationSystem::ImportSkeleton(FbxNode* node, FbxNode* parentNode)
 
 void AnimationSystem::Update(float dt, glm::mat4 modelMatrix, bool bindPoseFlag, std::vector<glm::mat4>* animationMatrix)
 {
+	physicsRecorder.RecordInput(dt, modelMatrix, bindPoseFlag, animationMatrix, skeleton);
 	skeleton.Update(dt, modelMatrix, bindPoseFlag, animationMatrix);
+	physicsRecorder.RecordResult(skeleton);
 }
 
 void AnimationSystem::Clear()
 {
+	// Recorded log is not valid for another skeleton.
+	physicsRecorder.EndRecording();
 	skeleton.Clear();
 	animations.clear();
 	selectedAnimation = 0;
@@ -219,6 +223,51 @@ void AnimationSystem::AddBone(Bone* newBone)
 	skeleton.AddBone(newBone);
 }
 
+int AnimationSystem::AddCollider(const BoneCollider& collider)
+{
+	return skeleton.AddCollider(collider);
+}
+
+void AnimationSystem::RemoveCollider(int index)
+{
+	skeleton.RemoveCollider(index);
+}
+
+ColliderSystem& AnimationSystem::GetColliderSystem()
+{
+	return skeleton.GetColliderSystem();
+}
+
+void AnimationSystem::SetViewProjection(glm::mat4 viewProjection)
+{
+	skeleton.SetViewProjection(viewProjection);
+}
+
+const JiggleChainStats& AnimationSystem::GetJiggleChainStats()
+{
+	return skeleton.GetJiggleChainStats();
+}
+
+bool AnimationSystem::BeginPhysicsRecording(const std::string& path)
+{
+	return physicsRecorder.BeginRecording(path, skeleton);
+}
+
+void AnimationSystem::EndPhysicsRecording()
+{
+	physicsRecorder.EndRecording();
+}
+
+bool AnimationSystem::IsPhysicsRecording()
+{
+	return physicsRecorder.IsRecording();
+}
+
+size_t AnimationSystem::GetPhysicsRecordedStepCount()
+{
+	return physicsRecorder.GetRecordedStepCount();
+}
+
 int AnimationSystem::GetChildrenBoneID(int boneID)
 {
 	size_t size = skeleton.GetSkeletonSize();
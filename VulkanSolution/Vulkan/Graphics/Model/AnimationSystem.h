@@ -14,6 +14,7 @@ Creation Date: 10.25.2022
 #include "fbxsdk.h"
 #include <GLMath.h>
 #include "Graphics/Structures/Structs.h"
+#include "PhysicsRecorder.h"
 
 struct Animation;
 
@@ -49,6 +50,22 @@ public:
 	std::string GetBoneName(unsigned int boneID);
 	void AddBone(Bone* newBone);
 
+	// @@ Colliders for jiggle bones
+	int AddCollider(const BoneCollider& collider);
+	void RemoveCollider(int index);
+	ColliderSystem& GetColliderSystem();
+	// @@ End of colliders
+
+	void SetViewProjection(glm::mat4 viewProjection);
+	const JiggleChainStats& GetJiggleChainStats();
+
+	// @@ Physics record
+	bool BeginPhysicsRecording(const std::string& path);
+	void EndPhysicsRecording();
+	bool IsPhysicsRecording();
+	size_t GetPhysicsRecordedStepCount();
+	// @@ End of physics record
+
 	// Return the first bone whose parent bone is given bone ID.
 	int GetChildrenBoneID(int boneID);
 
@@ -74,6 +91,7 @@ private:
 	std::vector<Animation> animations;
 
 	Skeleton skeleton;
+	PhysicsRecorder physicsRecorder;
 
 	std::vector<glm::ivec4> boneVertexID;
 	std::vector<glm::vec4> boneVertexWeights;
@@ -0,0 +1,593 @@
+/******************************************************************************
+Copyright (C) 2022 DigiPen Institute of Technology.
+Reproduction or disclosure of this file or its contents without the prior
+written consent of DigiPen Institute of Technology is prohibited.
+File Name:   Cloth.cpp
+Author
+	- sinil.kang	rtd99062@gmail.com
+Creation Date: 12.23.2022
+	source file for cloth patches simulated on skinned meshes.
+******************************************************************************/
+#include "Cloth.h"
+#include <Graphics/Structures/Structs.h>
+#include <Graphics/Structures/Collider.h>
+#include <algorithm>
+#include <execution>
+#include <chrono>
+#include <cmath>
+#include <map>
+
+namespace
+{
+	constexpr float EPSILON = 1e-8f;
+	// Bigger steps than this make the cloth explode when the application hitches.
+	constexpr float MAX_STEP_TIME = 1.f / 30.f;
+
+	// Same blending as vertexShader.vert
+	glm::mat4 GetSkinningMatrix(const Vertex& vertex, const std::vector<glm::mat4>& animationMatrix)
+	{
+		if (animationMatrix.empty())
+		{
+			return glm::mat4(1.f);
+		}
+
+		const int boneSize = static_cast<int>(animationMatrix.size());
+		glm::mat4 result(0.f);
+		for (int k = 0; k < 4; k++)
+		{
+			const int boneID = vertex.boneIDs[k];
+			if (boneID < 0 || boneID >= boneSize)
+			{
+				continue;
+			}
+			result += animationMatrix[boneID] * vertex.boneWeights[k];
+		}
+		return result;
+	}
+
+	glm::vec3 TransformPoint(const glm::mat4& m, glm::vec3 p)
+	{
+		glm::vec4 result = m * glm::vec4(p, 1.f);
+		return glm::vec3(result.x, result.y, result.z);
+	}
+
+	glm::vec3 ClosestPointOnSegment(glm::vec3 a, glm::vec3 b, glm::vec3 p)
+	{
+		glm::vec3 ab = b - a;
+		float lengthSquared = glm::dot(ab, ab);
+		if (lengthSquared <= EPSILON)
+		{
+			return a;
+		}
+		float t = std::clamp(glm::dot(p - a, ab) / lengthSquared, 0.f, 1.f);
+		return a + ab * t;
+	}
+}
+
+ClothPatch::ClothPatch()
+	: meshIndex(-1), normalSign(1.f), isInitialized(false)
+{
+}
+
+size_t ClothPatch::GetParticleCount() const
+{
+	return vertexByParticle.size();
+}
+
+ClothSystem::ClothSystem()
+	: substepCount(8), stretchCompliance(0.f), bendCompliance(0.001f), damping(1.f), gravityScaler(10.f), thickness(0.01f), collisionFlag(true), lastUpdateTime(0.f)
+{
+}
+
+ClothSystem::~ClothSystem()
+{
+}
+
+int ClothSystem::CreatePatch(int meshIndex, const Mesh& mesh, glm::vec3 trans, float radius)
+{
+	const float radiusSquared = radius * radius;
+	const int vertexSize = static_cast<int>(mesh.vertices.size());
+	const int triangleSize = static_cast<int>(mesh.indices.size()) / 3;
+
+	// Weld vertices by position, so uv seams do not tear the cloth.
+	std::map<glm::vec3, int, vec3Compare> weldedIndexByPosition;
+	std::vector<int> weldedIndex(vertexSize);
+	for (int i = 0; i < vertexSize; i++)
+	{
+		auto result = weldedIndexByPosition.insert({ mesh.vertices[i].position, static_cast<int>(weldedIndexByPosition.size()) });
+		weldedIndex[i] = result.first->second;
+	}
+
+	std::vector<bool> isInSphere(vertexSize);
+	for (int i = 0; i < vertexSize; i++)
+	{
+		glm::vec3 diff = mesh.vertices[i].position - trans;
+		isInSphere[i] = glm::dot(diff, diff) <= radiusSquared;
+	}
+	// Vertices of other patches stay outside, so their triangles pin the new patch instead of overlapping.
+	for (const ClothPatch& other : patches)
+	{
+		if (other.meshIndex != meshIndex)
+		{
+			continue;
+		}
+		for (int vertex : other.vertices)
+		{
+			isInSphere[vertex] = false;
+		}
+	}
+
+	ClothPatch patch;
+	patch.meshIndex = meshIndex;
+	patch.particleByVertex.assign(vertexSize, -1);
+
+	std::vector<int> particleByWelded(weldedIndexByPosition.size(), -1);
+	std::vector<bool> isTouchingOutside(weldedIndexByPosition.size(), false);
+	for (int t = 0; t < triangleSize; t++)
+	{
+		const uint32_t* triangle = &mesh.indices[t * 3];
+		if ((isInSphere[triangle[0]] && isInSphere[triangle[1]] && isInSphere[triangle[2]]) == false)
+		{
+			// Particles shared with the rest of the mesh become pinned.
+			for (int k = 0; k < 3; k++)
+			{
+				isTouchingOutside[weldedIndex[triangle[k]]] = true;
+			}
+			continue;
+		}
+
+		for (int k = 0; k < 3; k++)
+		{
+			const int welded = weldedIndex[triangle[k]];
+			if (particleByWelded[welded] < 0)
+			{
+				particleByWelded[welded] = static_cast<int>(patch.vertexByParticle.size());
+				patch.vertexByParticle.push_back(triangle[k]);
+			}
+			patch.triangles.push_back(particleByWelded[welded]);
+		}
+	}
+
+	const int particleSize = static_cast<int>(patch.GetParticleCount());
+	if (particleSize <= 0)
+	{
+		return -1;
+	}
+
+	for (int i = 0; i < vertexSize; i++)
+	{
+		patch.particleByVertex[i] = particleByWelded[weldedIndex[i]];
+		if (patch.particleByVertex[i] >= 0)
+		{
+			patch.vertices.push_back(i);
+		}
+	}
+
+	patch.positionX.resize(particleSize);
+	patch.positionY.resize(particleSize);
+	patch.positionZ.resize(particleSize);
+	patch.inverseMass.assign(particleSize, 1.f);
+	for (int p = 0; p < particleSize; p++)
+	{
+		const int vertex = patch.vertexByParticle[p];
+		glm::vec3 position = mesh.vertices[vertex].position;
+		patch.positionX[p] = position.x;
+		patch.positionY[p] = position.y;
+		patch.positionZ[p] = position.z;
+		if (isTouchingOutside[weldedIndex[vertex]])
+		{
+			patch.inverseMass[p] = 0.f;
+			patch.pinnedParticles.push_back(p);
+		}
+	}
+	patch.previousX = patch.positionX;
+	patch.previousY = patch.positionY;
+	patch.previousZ = patch.positionZ;
+	patch.velocityX.assign(particleSize, 0.f);
+	patch.velocityY.assign(particleSize, 0.f);
+	patch.velocityZ.assign(particleSize, 0.f);
+	patch.pinStart.resize(patch.pinnedParticles.size());
+	patch.pinEnd.resize(patch.pinnedParticles.size());
+
+	// Edge -> opposite particles of triangles sharing the edge.
+	std::map<std::pair<int, int>, std::vector<int>> edges;
+	const int patchTriangleSize = static_cast<int>(patch.triangles.size()) / 3;
+	for (int t = 0; t < patchTriangleSize; t++)
+	{
+		const int* triangle = &patch.triangles[t * 3];
+		for (int k = 0; k < 3; k++)
+		{
+			const int a = triangle[k];
+			const int b = triangle[(k + 1) % 3];
+			edges[{ std::min(a, b), std::max(a, b) }].push_back(triangle[(k + 2) % 3]);
+		}
+	}
+
+	auto restLength = [&patch](int a, int b)
+	{
+		glm::vec3 diff(patch.positionX[a] - patch.positionX[b], patch.positionY[a] - patch.positionY[b], patch.positionZ[a] - patch.positionZ[b]);
+		return glm::length(diff);
+	};
+	for (const std::pair<const std::pair<int, int>, std::vector<int>>& edge : edges)
+	{
+		const int a = edge.first.first;
+		const int b = edge.first.second;
+		// Constraints between two pinned particles never move anything.
+		if (patch.inverseMass[a] + patch.inverseMass[b] <= 0.f)
+		{
+			continue;
+		}
+		patch.constraints.push_back({ a, b, restLength(a, b), false });
+	}
+	for (const std::pair<const std::pair<int, int>, std::vector<int>>& edge : edges)
+	{
+		if (edge.second.size() != 2)
+		{
+			continue;
+		}
+		const int a = edge.second[0];
+		const int b = edge.second[1];
+		if (a == b || patch.inverseMass[a] + patch.inverseMass[b] <= 0.f)
+		{
+			continue;
+		}
+		patch.constraints.push_back({ a, b, restLength(a, b), true });
+	}
+
+	// Check winding against the imported normals once.
+	CalculateNormals(patch);
+	float agreement = 0.f;
+	for (int p = 0; p < particleSize; p++)
+	{
+		agreement += glm::dot(patch.normals[p], mesh.vertices[patch.vertexByParticle[p]].normal);
+	}
+	patch.normalSign = (agreement < 0.f) ? -1.f : 1.f;
+
+	patches.push_back(std::move(patch));
+	return static_cast<int>(patches.size()) - 1;
+}
+
+void ClothSystem::RemovePatch(int index)
+{
+	if (index < 0 || index >= static_cast<int>(patches.size()))
+	{
+		return;
+	}
+	patches.erase(patches.begin() + index);
+}
+
+void ClothSystem::Clear()
+{
+	patches.clear();
+}
+
+size_t ClothSystem::GetPatchCount() const
+{
+	return patches.size();
+}
+
+const ClothPatch& ClothSystem::GetPatch(int index) const
+{
+	return patches[index];
+}
+
+bool ClothSystem::HasPatch(int meshIndex) const
+{
+	for (const ClothPatch& patch : patches)
+	{
+		if (patch.meshIndex == meshIndex)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+float ClothSystem::GetLastUpdateTime() const
+{
+	return lastUpdateTime;
+}
+
+void ClothSystem::Update(float dt, glm::mat4 modelMatrix, const std::vector<Mesh>& meshes, const std::vector<glm::mat4>& animationMatrix, ColliderSystem& colliderSystem)
+{
+	if (patches.empty() || dt <= 0.f)
+	{
+		return;
+	}
+
+	auto start = std::chrono::high_resolution_clock::now();
+
+	dt = std::min(dt, MAX_STEP_TIME);
+	// Cloth is simulated in the animated model space, but gravity is given in the world space.
+	glm::vec3 gravity = glm::inverse(glm::mat3(modelMatrix)) * (Physics::GravityVector * Physics::GravityScaler * gravityScaler);
+
+	std::vector<CapsuleShape> capsules;
+	if (collisionFlag)
+	{
+		const size_t colliderSize = colliderSystem.GetColliderCount();
+		for (size_t i = 0; i < colliderSize; i++)
+		{
+			const BoneCollider& collider = colliderSystem.GetCollider(static_cast<int>(i));
+			capsules.push_back({ collider.pointA, collider.pointB, collider.radius + thickness });
+		}
+	}
+
+	// Patches do not share any data, so they are simulated independently.
+	std::for_each(std::execution::par, patches.begin(), patches.end(), [&](ClothPatch& patch)
+		{
+			if (patch.meshIndex < 0 || patch.meshIndex >= static_cast<int>(meshes.size()))
+			{
+				return;
+			}
+			StepPatch(patch, dt, gravity, meshes[patch.meshIndex], animationMatrix, capsules);
+		});
+
+	lastUpdateTime = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+void ClothSystem::WriteVertices(int meshIndex, const Mesh& mesh, const std::vector<glm::mat4>& animationMatrix, Vertex* dst)
+{
+	if (HasPatch(meshIndex) == false)
+	{
+		return;
+	}
+
+	// Most cloth vertices follow one bone, and they are unskinned by the inverse of the bone, which is computed once per frame.
+	inverseBoneMatrices.resize(animationMatrix.size());
+	std::transform(animationMatrix.begin(), animationMatrix.end(), inverseBoneMatrices.begin(), [](const glm::mat4& m)
+		{
+			return (std::abs(glm::determinant(m)) <= EPSILON) ? glm::mat4(0.f) : glm::inverse(m);
+		});
+
+	for (ClothPatch& patch : patches)
+	{
+		if (patch.meshIndex != meshIndex || patch.isInitialized == false)
+		{
+			continue;
+		}
+
+		CalculateNormals(patch);
+
+		// Vertices welded into a particle usually share their weights, so the inverse is computed once per particle.
+		const size_t particleSize = patch.GetParticleCount();
+		inverseSkinningByParticle.resize(particleSize);
+		for (size_t p = 0; p < particleSize; p++)
+		{
+			inverseSkinningByParticle[p] = GetInverseSkinningMatrix(mesh.vertices[patch.vertexByParticle[p]], animationMatrix);
+		}
+
+		for (int i : patch.vertices)
+		{
+			const int p = patch.particleByVertex[i];
+			const Vertex& vertex = mesh.vertices[i];
+			const Vertex& particleVertex = mesh.vertices[patch.vertexByParticle[p]];
+
+			// Undo skinning, so the vertex shader produces the simulated position again.
+			const bool isSameSkinning = vertex.boneIDs == particleVertex.boneIDs && vertex.boneWeights == particleVertex.boneWeights;
+			const glm::mat4 inverseSkinning = isSameSkinning ? inverseSkinningByParticle[p] : GetInverseSkinningMatrix(vertex, animationMatrix);
+			if (inverseSkinning[3][3] == 0.f)
+			{
+				// Singular skinning, which leaves the vertex as it is.
+				dst[i].position = vertex.position;
+				dst[i].normal = vertex.normal;
+				continue;
+			}
+			dst[i].position = TransformPoint(inverseSkinning, glm::vec3(patch.positionX[p], patch.positionY[p], patch.positionZ[p]));
+			glm::vec3 normal = glm::mat3(inverseSkinning) * patch.normals[p] * patch.normalSign;
+			dst[i].normal = (glm::dot(normal, normal) > EPSILON) ? glm::normalize(normal) : vertex.normal;
+		}
+	}
+}
+
+glm::mat4 ClothSystem::GetInverseSkinningMatrix(const Vertex& vertex, const std::vector<glm::mat4>& animationMatrix) const
+{
+	if (animationMatrix.empty())
+	{
+		return glm::mat4(1.f);
+	}
+
+	// Inverse of a single weighted bone is the inverse of the bone divided by the weight.
+	const int boneSize = static_cast<int>(animationMatrix.size());
+	int singleBone = -1;
+	int boneCount = 0;
+	for (int k = 0; k < 4; k++)
+	{
+		const int boneID = vertex.boneIDs[k];
+		if (boneID >= 0 && boneID < boneSize && vertex.boneWeights[k] != 0.f)
+		{
+			singleBone = k;
+			boneCount++;
+		}
+	}
+	if (boneCount == 1)
+	{
+		return inverseBoneMatrices[vertex.boneIDs[singleBone]] * (1.f / vertex.boneWeights[singleBone]);
+	}
+
+	glm::mat4 skinning = GetSkinningMatrix(vertex, animationMatrix);
+	if (std::abs(glm::determinant(skinning)) <= EPSILON)
+	{
+		return glm::mat4(0.f);
+	}
+	return glm::inverse(skinning);
+}
+
+void ClothSystem::StepPatch(ClothPatch& patch, float dt, glm::vec3 gravity, const Mesh& mesh, const std::vector<glm::mat4>& animationMatrix, const std::vector<CapsuleShape>& capsules)
+{
+	const int particleSize = static_cast<int>(patch.GetParticleCount());
+	const int pinnedSize = static_cast<int>(patch.pinnedParticles.size());
+
+	for (int i = 0; i < pinnedSize; i++)
+	{
+		const Vertex& vertex = mesh.vertices[patch.vertexByParticle[patch.pinnedParticles[i]]];
+		patch.pinEnd[i] = TransformPoint(GetSkinningMatrix(vertex, animationMatrix), vertex.position);
+	}
+
+	// Start from the skinned pose, rather than the bind pose.
+	if (patch.isInitialized == false)
+	{
+		for (int p = 0; p < particleSize; p++)
+		{
+			const Vertex& vertex = mesh.vertices[patch.vertexByParticle[p]];
+			glm::vec3 position = TransformPoint(GetSkinningMatrix(vertex, animationMatrix), vertex.position);
+			patch.positionX[p] = position.x;
+			patch.positionY[p] = position.y;
+			patch.positionZ[p] = position.z;
+		}
+		std::fill(patch.velocityX.begin(), patch.velocityX.end(), 0.f);
+		std::fill(patch.velocityY.begin(), patch.velocityY.end(), 0.f);
+		std::fill(patch.velocityZ.begin(), patch.velocityZ.end(), 0.f);
+		patch.pinStart = patch.pinEnd;
+		patch.isInitialized = true;
+	}
+
+	const int substeps = std::max(substepCount, 1);
+	const float h = dt / substeps;
+	const float dampingFactor = std::max(1.f - damping * h, 0.f);
+	const glm::vec3 gravityStep = gravity * h;
+
+	float* px = patch.positionX.data();
+	float* py = patch.positionY.data();
+	float* pz = patch.positionZ.data();
+	float* qx = patch.previousX.data();
+	float* qy = patch.previousY.data();
+	float* qz = patch.previousZ.data();
+	float* vx = patch.velocityX.data();
+	float* vy = patch.velocityY.data();
+	float* vz = patch.velocityZ.data();
+	const float* w = patch.inverseMass.data();
+
+	for (int s = 0; s < substeps; s++)
+	{
+		// Predict. Branchless, pinned particles have zero inverse mass so gravity does not affect them.
+		for (int p = 0; p < particleSize; p++)
+		{
+			qx[p] = px[p];
+			qy[p] = py[p];
+			qz[p] = pz[p];
+			vx[p] = (vx[p] + gravityStep.x * w[p]) * dampingFactor;
+			vy[p] = (vy[p] + gravityStep.y * w[p]) * dampingFactor;
+			vz[p] = (vz[p] + gravityStep.z * w[p]) * dampingFactor;
+			px[p] += vx[p] * h;
+			py[p] += vy[p] * h;
+			pz[p] += vz[p] * h;
+		}
+
+		// Pinned particles follow the skin, interpolated through the substeps.
+		const float alpha = static_cast<float>(s + 1) / substeps;
+		for (int i = 0; i < pinnedSize; i++)
+		{
+			const int p = patch.pinnedParticles[i];
+			glm::vec3 position = glm::mix(patch.pinStart[i], patch.pinEnd[i], alpha);
+			px[p] = position.x;
+			py[p] = position.y;
+			pz[p] = position.z;
+		}
+
+		SolveConstraints(patch, h);
+		SolveCollisions(patch, capsules);
+
+		const float inverseH = 1.f / h;
+		for (int p = 0; p < particleSize; p++)
+		{
+			vx[p] = (px[p] - qx[p]) * inverseH;
+			vy[p] = (py[p] - qy[p]) * inverseH;
+			vz[p] = (pz[p] - qz[p]) * inverseH;
+		}
+	}
+
+	patch.pinStart = patch.pinEnd;
+}
+
+void ClothSystem::SolveConstraints(ClothPatch& patch, float h)
+{
+	// One XPBD iteration per substep, so lagrange multipliers start from zero every time.
+	const float stretchAlpha = stretchCompliance / (h * h);
+	const float bendAlpha = bendCompliance / (h * h);
+
+	float* px = patch.positionX.data();
+	float* py = patch.positionY.data();
+	float* pz = patch.positionZ.data();
+	const float* w = patch.inverseMass.data();
+
+	for (const ClothConstraint& constraint : patch.constraints)
+	{
+		const int a = constraint.particleA;
+		const int b = constraint.particleB;
+		const float weightSum = w[a] + w[b];
+
+		const float dx = px[a] - px[b];
+		const float dy = py[a] - py[b];
+		const float dz = pz[a] - pz[b];
+		const float length = std::sqrt(dx * dx + dy * dy + dz * dz);
+		if (length <= EPSILON)
+		{
+			continue;
+		}
+
+		const float alpha = constraint.isBending ? bendAlpha : stretchAlpha;
+		const float lambda = -(length - constraint.restLength) / (weightSum + alpha);
+		const float scale = lambda / length;
+
+		px[a] += dx * scale * w[a];
+		py[a] += dy * scale * w[a];
+		pz[a] += dz * scale * w[a];
+		px[b] -= dx * scale * w[b];
+		py[b] -= dy * scale * w[b];
+		pz[b] -= dz * scale * w[b];
+	}
+}
+
+void ClothSystem::SolveCollisions(ClothPatch& patch, const std::vector<CapsuleShape>& capsules)
+{
+	if (capsules.empty())
+	{
+		return;
+	}
+
+	const int particleSize = static_cast<int>(patch.GetParticleCount());
+	for (int p = 0; p < particleSize; p++)
+	{
+		if (patch.inverseMass[p] <= 0.f)
+		{
+			continue;
+		}
+
+		glm::vec3 position(patch.positionX[p], patch.positionY[p], patch.positionZ[p]);
+		for (const CapsuleShape& capsule : capsules)
+		{
+			glm::vec3 diff = position - ClosestPointOnSegment(capsule.pointA, capsule.pointB, position);
+			float distanceSquared = glm::dot(diff, diff);
+			if (distanceSquared >= capsule.radius * capsule.radius || distanceSquared <= EPSILON)
+			{
+				continue;
+			}
+			float distance = std::sqrt(distanceSquared);
+			position += diff * ((capsule.radius - distance) / distance);
+		}
+		patch.positionX[p] = position.x;
+		patch.positionY[p] = position.y;
+		patch.positionZ[p] = position.z;
+	}
+}
+
+void ClothSystem::CalculateNormals(ClothPatch& patch)
+{
+	patch.normals.assign(patch.GetParticleCount(), glm::vec3(0.f));
+
+	const int triangleSize = static_cast<int>(patch.triangles.size()) / 3;
+	for (int t = 0; t < triangleSize; t++)
+	{
+		const int a = patch.triangles[t * 3];
+		const int b = patch.triangles[t * 3 + 1];
+		const int c = patch.triangles[t * 3 + 2];
+		glm::vec3 pa(patch.positionX[a], patch.positionY[a], patch.positionZ[a]);
+		glm::vec3 pb(patch.positionX[b], patch.positionY[b], patch.positionZ[b]);
+		glm::vec3 pc(patch.positionX[c], patch.positionY[c], patch.positionZ[c]);
+		// Area weighted
+		glm::vec3 normal = glm::cross(pb - pa, pc - pa);
+		patch.normals[a] += normal;
+		patch.normals[b] += normal;
+		patch.normals[c] += normal;
+	}
+}
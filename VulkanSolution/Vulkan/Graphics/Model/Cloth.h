@@ -0,0 +1,122 @@
+/******************************************************************************
+Copyright (C) 2022 DigiPen Institute of Technology.
+Reproduction or disclosure of this file or its contents without the prior
+written consent of DigiPen Institute of Technology is prohibited.
+File Name:   Cloth.h
+Author
+	- sinil.kang	rtd99062@gmail.com
+Creation Date: 12.23.2022
+	header file for cloth patches simulated on skinned meshes.
+******************************************************************************/
+#pragma once
+#include <vector>
+#include <GLMath.h>
+
+struct Mesh;
+struct Vertex;
+class ColliderSystem;
+
+// Distance constraint between two particles.
+// Stretching constraints are triangle edges, bending constraints connect opposite vertices of adjacent triangles.
+struct ClothConstraint
+{
+	int particleA;
+	int particleB;
+	float restLength;
+	bool isBending;
+};
+
+// A region of a mesh simulated as a XPBD cloth.
+// Particles are stored as structure of arrays so per particle loops can be vectorized.
+struct ClothPatch
+{
+	ClothPatch();
+
+	size_t GetParticleCount() const;
+
+	int meshIndex;
+
+	// Mesh vertex index -> particle index, -1 if the vertex is not in the patch.
+	// Vertices at the same position (split by uv or normal) are welded into one particle.
+	std::vector<int> particleByVertex;
+	// Particle index -> one of the mesh vertices welded into it. Used for skinning.
+	std::vector<int> vertexByParticle;
+	// Mesh vertices in the patch, so writing them does not visit the rest of the mesh.
+	std::vector<int> vertices;
+	// Triangles of the patch in particle indices.
+	std::vector<int> triangles;
+	std::vector<ClothConstraint> constraints;
+	// Particles on the boundary of the patch follow the skinned mesh.
+	std::vector<int> pinnedParticles;
+
+	std::vector<float> positionX, positionY, positionZ;
+	std::vector<float> previousX, previousY, previousZ;
+	std::vector<float> velocityX, velocityY, velocityZ;
+	// 0 for pinned particles, 1 for the others.
+	std::vector<float> inverseMass;
+
+	// Skinned positions of pinned particles at the beginning and the end of the step.
+	std::vector<glm::vec3> pinStart;
+	std::vector<glm::vec3> pinEnd;
+
+	std::vector<glm::vec3> normals;
+	// -1 if winding of the mesh makes normals point inward.
+	float normalSign;
+	bool isInitialized;
+};
+
+class ClothSystem
+{
+public:
+	ClothSystem();
+	~ClothSystem();
+
+	// Build a patch from triangles whose vertices are all in the sphere.
+	// Triangles touching another patch of the mesh are left out, so a vertex is simulated by one patch at most.
+	// Return index of the patch, -1 if there is no such triangle.
+	int CreatePatch(int meshIndex, const Mesh& mesh, glm::vec3 trans, float radius);
+	void RemovePatch(int index);
+	void Clear();
+
+	size_t GetPatchCount() const;
+	const ClothPatch& GetPatch(int index) const;
+	bool HasPatch(int meshIndex) const;
+	// Milliseconds spent in the last Update() call.
+	float GetLastUpdateTime() const;
+
+	// Simulate all patches in parallel. animationMatrix is the palette of the current frame.
+	void Update(float dt, glm::mat4 modelMatrix, const std::vector<Mesh>& meshes, const std::vector<glm::mat4>& animationMatrix, ColliderSystem& colliderSystem);
+	// Write simulated vertices of the mesh to dst, which holds every vertex of the mesh. Other vertices are not written.
+	// Simulated vertices are written in bind space(unskinned),
+	// so the regular vertex shader puts them back on the simulated positions.
+	void WriteVertices(int meshIndex, const Mesh& mesh, const std::vector<glm::mat4>& animationMatrix, Vertex* dst);
+
+	int substepCount;
+	float stretchCompliance;
+	float bendCompliance;
+	float damping;
+	float gravityScaler;
+	// Distance kept from the colliders.
+	float thickness;
+	bool collisionFlag;
+private:
+	struct CapsuleShape
+	{
+		glm::vec3 pointA;
+		glm::vec3 pointB;
+		float radius;
+	};
+
+	void StepPatch(ClothPatch& patch, float dt, glm::vec3 gravity, const Mesh& mesh, const std::vector<glm::mat4>& animationMatrix, const std::vector<CapsuleShape>& capsules);
+	void SolveConstraints(ClothPatch& patch, float h);
+	void SolveCollisions(ClothPatch& patch, const std::vector<CapsuleShape>& capsules);
+	void CalculateNormals(ClothPatch& patch);
+	// Inverse of the blended skinning matrix of the vertex, or a zero matrix if it is singular.
+	glm::mat4 GetInverseSkinningMatrix(const Vertex& vertex, const std::vector<glm::mat4>& animationMatrix) const;
+
+	std::vector<ClothPatch> patches;
+	// Written by WriteVertices(), and kept to avoid allocations every frame.
+	std::vector<glm::mat4> inverseBoneMatrices;
+	std::vector<glm::mat4> inverseSkinningByParticle;
+	float lastUpdateTime;
+};
@@ -17,6 +17,7 @@ Creation Date: 09.27.2022
 #include "assimp/postprocess.h"
 #include "stb/stb_image.h"
 #include "Graphics/Model/AnimationSystem.h"
+#include "Engines/CPUProfiler.h"
 
 
 Model::Model(const std::string& path)
@@ -34,6 +35,7 @@ Model::~Model()
 
 bool Model::LoadModel(const std::string& path)
 {
+	PROFILE_FUNCTION();
 	ClearData();
 	CleanFBXResources();
 
@@ -53,7 +55,10 @@ bool Model::LoadModel(const std::string& path)
 
 	lScene = FbxScene::Create(lSdkManager, "myScene");
 
-	lImporter->Import(lScene);
+	{
+		PROFILE_SCOPE("FbxImporter::Import");
+		lImporter->Import(lScene);
+	}
 
 	GetSkeleton();
 	GetScene();
@@ -90,6 +95,7 @@ bool Model::LoadModel(const std::string& path)
 
 void Model::Update(float dt, glm::mat4 modelMatrix, bool bindPoseFlag)
 {
+	PROFILE_FUNCTION();
 	animationSystem->Update(dt, modelMatrix, bindPoseFlag, &animationMatrix);
 }
 
@@ -181,20 +187,27 @@ const std::vector<std::string>& Model::GetNormalImagePaths()
 	return normalImagePaths;
 }
 
-void Model::ChangeBoneIndexInSphere(int meshIndex, glm::vec3 trans, float radius, int boneIDIndex, int newBoneIndex, glm::vec4 weight, std::vector<glm::vec3>& changedVertices)
+void Model::ChangeBoneIndexInSphere(int meshIndex, glm::vec3 trans, float radius, int boneIDIndex, int newBoneIndex, glm::vec4 weight, std::vector<glm::vec3>& changedVertices, std::vector<std::pair<int, glm::vec3>>& removedVertices)
 {
 	Mesh& mesh = meshes[meshIndex];
 	float radiusSquared = radius * radius;
 	changedVertices.clear();
+	removedVertices.clear();
 	for (Vertex& vertex : mesh.vertices)
 	{
 		glm::vec3 diff = vertex.position - trans;
 		float lengthSquared = diff.x * diff.x + diff.y * diff.y + diff.z * diff.z;
 		if (lengthSquared <= radiusSquared)
 		{
+			// Report only the vertices whose bone is actually changed, so physics can be updated incrementally.
+			if (int previousBoneIndex = vertex.boneIDs[boneIDIndex];
+				previousBoneIndex != newBoneIndex)
+			{
+				removedVertices.push_back({ previousBoneIndex, vertex.position });
+				changedVertices.push_back(vertex.position);
+			}
 			vertex.boneIDs[boneIDIndex] = newBoneIndex;
 			vertex.boneWeights = weight;
-			changedVertices.push_back(vertex.position);
 		}
 	}
 	for (Vertex& vertex : mesh.uniqueVertices)
@@ -299,6 +312,7 @@ FbxString Model::GetAttributeTypeName(FbxNodeAttribute::EType type)
 
 void Model::GetScene(FbxNode* root)
 {
+	PROFILE_FUNCTION();
 	if (!root)
 	{
 		root = lScene->GetRootNode();
@@ -522,6 +536,7 @@ bool Model::GetMeshData(FbxMesh* mesh, Mesh& m)
 
 void Model::GetSkeleton(FbxNode* root)
 {
+	PROFILE_FUNCTION();
 	if (!root)
 	{
 		root = lScene->GetRootNode();
@@ -551,6 +566,7 @@ void Model::GetSkeleton(FbxNode* root)
 
 void Model::InitBoneData()
 {
+	PROFILE_FUNCTION();
 	std::vector<glm::mat4> toBoneFromUnit;
 	animationSystem->GetToBoneFromUnit(toBoneFromUnit);
 
@@ -575,6 +591,7 @@ void Model::InitBoneData()
 
 void Model::GetAnimation()
 {
+	PROFILE_FUNCTION();
 	FbxNode* rootNode = lScene->GetRootNode();
 
 	if (rootNode == nullptr)
@@ -663,6 +680,7 @@ void Model::GetTextureData(FbxSurfaceMaterial* material)
 void Model::ClearData()
 {
 	meshes.clear();
+	clothSystem.Clear();
 	bones.clear();
 	diffuseImagePaths.clear();
 	normalImagePaths.clear();
@@ -797,6 +815,7 @@ void Model::SetAnimationIndex(unsigned int i)
 
 void Model::CalculateAnimation(float t, bool bindPoseFlag)
 {
+	PROFILE_FUNCTION();
 	animationMatrix.clear();
 
 	if (bindPoseFlag || animationSystem->GetAnimationCount() <= 0)
@@ -872,6 +891,81 @@ void Model::AddBone(Bone* newBone)
 	bones.push_back(animationSystem->GetBone(newBone->parentID)->toBoneFromUnit * glm::vec4(0.f, 0.f, 0.f, 1.f));
 }
 
+int Model::AddCollider(const BoneCollider& collider)
+{
+	return animationSystem->AddCollider(collider);
+}
+
+void Model::RemoveCollider(int index)
+{
+	animationSystem->RemoveCollider(index);
+}
+
+ColliderSystem& Model::GetColliderSystem()
+{
+	return animationSystem->GetColliderSystem();
+}
+
+void Model::SetViewProjection(glm::mat4 viewProjection)
+{
+	animationSystem->SetViewProjection(viewProjection);
+}
+
+const JiggleChainStats& Model::GetJiggleChainStats()
+{
+	return animationSystem->GetJiggleChainStats();
+}
+
+bool Model::BeginPhysicsRecording(const std::string& path)
+{
+	return animationSystem->BeginPhysicsRecording(path);
+}
+
+void Model::EndPhysicsRecording()
+{
+	animationSystem->EndPhysicsRecording();
+}
+
+bool Model::IsPhysicsRecording()
+{
+	return animationSystem->IsPhysicsRecording();
+}
+
+size_t Model::GetPhysicsRecordedStepCount()
+{
+	return animationSystem->GetPhysicsRecordedStepCount();
+}
+
+int Model::CreateClothInSphere(int meshIndex, glm::vec3 trans, float radius)
+{
+	if (meshIndex < 0 || meshIndex >= static_cast<int>(meshes.size()))
+	{
+		return -1;
+	}
+	return clothSystem.CreatePatch(meshIndex, meshes[meshIndex], trans, radius);
+}
+
+void Model::UpdateCloth(float dt, glm::mat4 modelMatrix)
+{
+	PROFILE_FUNCTION();
+	clothSystem.Update(dt, modelMatrix, meshes, animationMatrix, animationSystem->GetColliderSystem());
+}
+
+bool Model::HasCloth(int meshIndex)
+{
+	return clothSystem.HasPatch(meshIndex);
+}
+
+void Model::GetClothVertexData(int meshIndex, Vertex* dst)
+{
+	clothSystem.WriteVertices(meshIndex, meshes[meshIndex], animationMatrix, dst);
+}
+
+ClothSystem& Model::GetClothSystem()
+{
+	return clothSystem;
+}
+
 void Model::ReadMaterial(const aiScene* scene, const std::string& path)
 {
 	//std::string::size_type slashIndex = path.find_last_of('/');
@@ -11,6 +11,7 @@ Creation Date: 09.27.2022
 #pragma once
 #include <string>
 #include <Graphics/Structures/Structs.h>
+#include <Graphics/Model/Cloth.h>
 #include "assimp/Importer.hpp"
 #include "fbxsdk.h"
 
@@ -50,6 +51,31 @@ public:
 	void GetToModelFromBone(std::vector<glm::mat4>& data);
 	void AddBone(Bone* newBone);
 
+	// Return index of the collider, -1 if the collider can't be attached to the bone.
+	int AddCollider(const BoneCollider& collider);
+	void RemoveCollider(int index);
+	ColliderSystem& GetColliderSystem();
+
+	// Camera for physics LOD
+	void SetViewProjection(glm::mat4 viewProjection);
+	const JiggleChainStats& GetJiggleChainStats();
+
+	// Record inputs and results of physics steps to replay them headlessly.
+	bool BeginPhysicsRecording(const std::string& path);
+	void EndPhysicsRecording();
+	bool IsPhysicsRecording();
+	size_t GetPhysicsRecordedStepCount();
+
+	// Turn triangles of the mesh in the sphere into a cloth patch pinned to the rest of the mesh.
+	// Return index of the patch, -1 if there is no triangle in the sphere.
+	int CreateClothInSphere(int meshIndex, glm::vec3 trans, float radius);
+	// Should be called after CalculateAnimation(), cloth is pinned to the current pose.
+	void UpdateCloth(float dt, glm::mat4 modelMatrix = glm::mat4(1.f));
+	bool HasCloth(int meshIndex);
+	// Write simulated cloth vertices of the mesh to dst, which holds GetVertexCount(meshIndex) vertices. Other vertices are not written.
+	void GetClothVertexData(int meshIndex, Vertex* dst);
+	ClothSystem& GetClothSystem();
+
 	// @@ Getter&Setter of animation system
 	unsigned int GetAnimationCount();
 	unsigned int GetSelectedAnimationIndex();
@@ -74,7 +100,9 @@ public:
 	// [ ?, ?, ?, ? ] 
 	// If boneIDIndex == 1 -> [ ?, newBoneIndex, ?, ? ]
 	// glm::vec4 weight -> Set all weights altogether.
-	void ChangeBoneIndexInSphere(int meshIndex, glm::vec3 trans, float radius, int boneIDIndex, int newBoneIndex, glm::vec4 weight, std::vector<glm::vec3>& changedVertices);
+	// changedVertices are vertices newly bound to newBoneIndex,
+	// removedVertices are pairs of <previous bone ID, vertex> which are unbound from the previous bone.
+	void ChangeBoneIndexInSphere(int meshIndex, glm::vec3 trans, float radius, int boneIDIndex, int newBoneIndex, glm::vec4 weight, std::vector<glm::vec3>& changedVertices, std::vector<std::pair<int, glm::vec3>>& removedVertices);
 
 	glm::vec3 GetModelScale();
 private:
@@ -127,6 +155,7 @@ private:
 	int numTabs = 0;
 
 	std::vector<Mesh> meshes;
+	ClothSystem clothSystem;
 
 	// it would be std::vector<LineVertex> bones;
 	std::vector<glm::vec3> bones;
@@ -0,0 +1,734 @@
+/******************************************************************************
+Copyright (C) 2022 DigiPen Institute of Technology.
+Reproduction or disclosure of this file or its contents without the prior
+written consent of DigiPen Institute of Technology is prohibited.
+File Name:   PhysicsRecorder.cpp
+Author
+	- sinil.kang	rtd99062@gmail.com
+Creation Date: 12.22.2022
+	source file for recording and replaying jiggle bone physics.
+******************************************************************************/
+#include "PhysicsRecorder.h"
+#include "Graphics/Structures/Structs.h"
+#include <sstream>
+#include <chrono>
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+namespace
+{
+	constexpr char MAGIC[4] = { 'J', 'G', 'R', 'C' };
+	constexpr uint32_t VERSION = 2;
+	constexpr char SNAPSHOT_RECORD = 'S';
+	constexpr char FRAME_RECORD = 'F';
+
+	template<typename T>
+	void Write(std::ostream& os, const T& value)
+	{
+		os.write(reinterpret_cast<const char*>(&value), sizeof(T));
+	}
+
+	template<typename T>
+	T Read(std::istream& is)
+	{
+		T value{};
+		is.read(reinterpret_cast<char*>(&value), sizeof(T));
+		return value;
+	}
+
+	template<typename T>
+	void WriteVector(std::ostream& os, const std::vector<T>& values)
+	{
+		Write(os, static_cast<uint32_t>(values.size()));
+		if (values.empty() == false)
+		{
+			os.write(reinterpret_cast<const char*>(values.data()), sizeof(T) * values.size());
+		}
+	}
+
+	// Bytes left after the current position, or 0 if the stream is failed.
+	uint64_t GetRemainingSize(std::istream& is)
+	{
+		if (!is)
+		{
+			return 0;
+		}
+
+		const std::streampos current = is.tellg();
+		is.seekg(0, std::ios::end);
+		const std::streampos end = is.tellg();
+		is.seekg(current);
+		if (!is || current < 0 || end < current)
+		{
+			is.setstate(std::ios::failbit);
+			return 0;
+		}
+		return static_cast<uint64_t>(end - current);
+	}
+
+	// A count read from a broken log may be anything, so it is rejected if its elements do not fit in the rest of the stream.
+	bool ReadCount(std::istream& is, size_t elementSize, uint32_t& count)
+	{
+		count = Read<uint32_t>(is);
+		if (!is || static_cast<uint64_t>(count) * elementSize > GetRemainingSize(is))
+		{
+			is.setstate(std::ios::failbit);
+			count = 0;
+			return false;
+		}
+		return true;
+	}
+
+	template<typename T>
+	void ReadVector(std::istream& is, std::vector<T>& values)
+	{
+		uint32_t count;
+		if (ReadCount(is, sizeof(T), count) == false)
+		{
+			values.clear();
+			return;
+		}
+
+		values.resize(count);
+		if (values.empty() == false)
+		{
+			is.read(reinterpret_cast<char*>(values.data()), sizeof(T) * values.size());
+		}
+	}
+
+	void WriteString(std::ostream& os, const std::string& str)
+	{
+		Write(os, static_cast<uint32_t>(str.size()));
+		os.write(str.data(), str.size());
+	}
+
+	std::string ReadString(std::istream& is)
+	{
+		uint32_t size;
+		if (ReadCount(is, sizeof(char), size) == false)
+		{
+			return std::string();
+		}
+
+		std::string str(size, '\0');
+		is.read(str.data(), str.size());
+		return str;
+	}
+
+	float MaxDifference(const float* lhs, const float* rhs, size_t count)
+	{
+		float result = 0.f;
+		for (size_t i = 0; i < count; i++)
+		{
+			result = std::max(result, std::abs(lhs[i] - rhs[i]));
+		}
+		return result;
+	}
+}
+
+PhysicsRecorder::PhysicsRecorder()
+	: file(), lastTunables(), recordedStepCount(0)
+{
+}
+
+PhysicsRecorder::~PhysicsRecorder()
+{
+	EndRecording();
+}
+
+bool PhysicsRecorder::BeginRecording(const std::string& path, Skeleton& skeleton)
+{
+	EndRecording();
+
+	file.open(path, std::ios::binary | std::ios::trunc);
+	if (file.is_open() == false)
+	{
+		std::cout << "Failed to open " << path << " for physics recording!" << std::endl;
+		return false;
+	}
+
+	file.write(MAGIC, sizeof(MAGIC));
+	Write(file, VERSION);
+
+	std::ostringstream tunables;
+	WriteTunables(tunables, skeleton);
+	lastTunables = tunables.str();
+
+	WriteSnapshot(file, skeleton);
+	recordedStepCount = 0;
+
+	return true;
+}
+
+void PhysicsRecorder::EndRecording()
+{
+	if (file.is_open())
+	{
+		file.close();
+	}
+	lastTunables.clear();
+}
+
+bool PhysicsRecorder::IsRecording() const
+{
+	return file.is_open();
+}
+
+size_t PhysicsRecorder::GetRecordedStepCount() const
+{
+	return recordedStepCount;
+}
+
+void PhysicsRecorder::RecordInput(float dt, glm::mat4 modelMatrix, bool bindPoseFlag, const std::vector<glm::mat4>* animationMatrix, Skeleton& skeleton)
+{
+	if (IsRecording() == false)
+	{
+		return;
+	}
+
+	// Take a new snapshot only when something is changed outside of the physics step.
+	std::ostringstream tunables;
+	WriteTunables(tunables, skeleton);
+	if (tunables.str() != lastTunables)
+	{
+		lastTunables = tunables.str();
+		WriteSnapshot(file, skeleton);
+	}
+
+	Write(file, FRAME_RECORD);
+	Write(file, dt);
+	Write(file, modelMatrix);
+	Write(file, static_cast<uint8_t>(bindPoseFlag));
+	Write(file, static_cast<uint8_t>(skeleton.hasViewProjection));
+	Write(file, skeleton.viewProjection);
+
+	// Animation matrices are not used in bind pose, skip them to keep the log small.
+	if (bindPoseFlag == false && animationMatrix != nullptr)
+	{
+		WriteVector(file, *animationMatrix);
+	}
+	else
+	{
+		Write(file, static_cast<uint32_t>(0));
+	}
+}
+
+void PhysicsRecorder::RecordResult(Skeleton& skeleton)
+{
+	if (IsRecording() == false)
+	{
+		return;
+	}
+
+	WriteJiggleStates(file, skeleton);
+	recordedStepCount++;
+}
+
+bool PhysicsRecorder::Replay(const std::string& path)
+{
+	std::ifstream log(path, std::ios::binary);
+	if (log.is_open() == false)
+	{
+		std::cout << "Failed to open " << path << " for physics replay!" << std::endl;
+		return false;
+	}
+
+	char magic[4];
+	log.read(magic, sizeof(magic));
+	uint32_t version = Read<uint32_t>(log);
+	if (!log || std::equal(magic, magic + 4, MAGIC) == false || version != VERSION)
+	{
+		std::cout << path << " is not a physics log or version is not matched!" << std::endl;
+		return false;
+	}
+
+	Skeleton skeleton;
+	std::vector<glm::mat4> animationMatrix;
+	size_t stepCount = 0;
+	size_t snapshotCount = 0;
+	double totalTime = 0.0;
+	double worstTime = 0.0;
+	float maxDivergence = 0.f;
+
+	char record;
+	while (log.read(&record, 1))
+	{
+		if (record == SNAPSHOT_RECORD)
+		{
+			if (ReadSnapshot(log, skeleton) == false)
+			{
+				std::cout << "Broken snapshot in " << path << std::endl;
+				return false;
+			}
+			snapshotCount++;
+			continue;
+		}
+		else if (record != FRAME_RECORD)
+		{
+			std::cout << "Unknown record in " << path << std::endl;
+			skeleton.Clear();
+			return false;
+		}
+
+		float dt = Read<float>(log);
+		glm::mat4 modelMatrix = Read<glm::mat4>(log);
+		bool bindPoseFlag = Read<uint8_t>(log) != 0;
+		bool hasViewProjection = Read<uint8_t>(log) != 0;
+		glm::mat4 viewProjection = Read<glm::mat4>(log);
+		ReadVector(log, animationMatrix);
+		if (hasViewProjection)
+		{
+			skeleton.SetViewProjection(viewProjection);
+		}
+
+		auto start = std::chrono::high_resolution_clock::now();
+		skeleton.Update(dt, modelMatrix, bindPoseFlag, &animationMatrix);
+		double elapsed = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+		totalTime += elapsed;
+		worstTime = std::max(worstTime, elapsed);
+		maxDivergence = std::max(maxDivergence, CompareJiggleStates(log, skeleton));
+		stepCount++;
+
+		if (!log)
+		{
+			std::cout << "Log is truncated at step " << stepCount << std::endl;
+			break;
+		}
+	}
+
+	std::cout << "Physics replay: " << path << std::endl;
+	std::cout << "\tsteps: " << stepCount << ", snapshots: " << snapshotCount << std::endl;
+	std::cout << "\tsteps/sec: " << ((totalTime > 0.0) ? stepCount / (totalTime / 1000.0) : 0.0) << std::endl;
+	std::cout << "\tworst step: " << worstTime << " ms" << std::endl;
+	std::cout << "\tmax divergence: " << maxDivergence << std::endl;
+
+	// Skeleton does not delete bones on destruction.
+	skeleton.Clear();
+
+	return true;
+}
+
+void PhysicsRecorder::WriteSnapshot(std::ostream& os, Skeleton& skeleton)
+{
+	Write(os, SNAPSHOT_RECORD);
+
+	Write(os, static_cast<uint8_t>(Physics::forceApplyFlag));
+	Write(os, Physics::GravityVector);
+	Write(os, Physics::GravityScaler);
+	Write(os, static_cast<uint8_t>(Physics::sleepFlag));
+	Write(os, Physics::SleepThreshold);
+	Write(os, Physics::SleepStepCount);
+	Write(os, static_cast<uint8_t>(Physics::lodFlag));
+	Write(os, Physics::LODScreenSize);
+	Write(os, Physics::LODMaxRate);
+
+	Write(os, static_cast<int32_t>(skeleton.boneSize));
+	for (const Bone* bone : skeleton.bones)
+	{
+		WriteString(os, bone->name);
+		Write(os, bone->parentID);
+		Write(os, bone->id);
+		Write(os, bone->toBoneFromUnit);
+		Write(os, bone->toModelFromBone);
+
+		const JiggleBone* jb = dynamic_cast<const JiggleBone*>(bone);
+		Write(os, static_cast<uint8_t>(jb != nullptr));
+		if (jb == nullptr)
+		{
+			continue;
+		}
+
+		Write(os, (jb->childBonePtr != nullptr) ? jb->childBonePtr->id : -1);
+		Write(os, (jb->grandParentBonePtr != nullptr) ? jb->grandParentBonePtr->id : -1);
+		Write(os, static_cast<uint8_t>(jb->isUpdateJigglePhysics));
+		Write(os, jb->customPhysicsTranslation);
+		Write(os, jb->customPhysicsRotation);
+		Write(os, jb->bendingSpringInitLengthA);
+		Write(os, jb->bendingSpringInitLengthB);
+		Write(os, jb->collisionForceA);
+		Write(os, jb->collisionForceB);
+		WritePhysics(os, jb->physics);
+	}
+
+	ColliderSystem& colliders = skeleton.colliders;
+	Write(os, colliders.segmentRadius);
+	Write(os, colliders.stiffness);
+	Write(os, colliders.damping);
+	const int colliderCount = static_cast<int>(colliders.GetColliderCount());
+	Write(os, colliderCount);
+	for (int i = 0; i < colliderCount; i++)
+	{
+		const BoneCollider& collider = colliders.GetCollider(i);
+		Write(os, static_cast<int32_t>(collider.type));
+		Write(os, collider.boneID);
+		Write(os, collider.radius);
+		Write(os, collider.localPointA);
+		Write(os, collider.localPointB);
+	}
+
+	// Chains are rebuilt in the same order from the same bones, so only their states are needed.
+	Write(os, static_cast<uint32_t>(skeleton.chains.size()));
+	for (const JiggleChain& chain : skeleton.chains)
+	{
+		Write(os, chain.anchorTransform);
+		const JiggleChainParameters& parameters = chain.parameters;
+		Write(os, static_cast<uint8_t>(parameters.forceApplyFlag));
+		Write(os, parameters.gravityVector);
+		Write(os, parameters.gravityScaler);
+		Write(os, static_cast<uint32_t>(parameters.bones.size()));
+		for (const JiggleChainParameters::BoneParameters& bone : parameters.bones)
+		{
+			Write(os, static_cast<uint8_t>(bone.isUpdateJigglePhysics));
+			Write(os, bone.springScaler);
+			Write(os, bone.dampingScaler);
+			Write(os, bone.bendSpringScaler);
+			Write(os, bone.bendDampingScaler);
+			Write(os, bone.momentCount);
+		}
+		Write(os, static_cast<uint8_t>(chain.isSleeping));
+		Write(os, chain.restStepCount);
+		Write(os, chain.lodRate);
+		Write(os, chain.skippedStepCount);
+		Write(os, chain.accumulatedTime);
+	}
+}
+
+bool PhysicsRecorder::ReadSnapshot(std::istream& is, Skeleton& skeleton)
+{
+	skeleton.Clear();
+	if (ReadSnapshotData(is, skeleton) == false || !is)
+	{
+		// A half built skeleton is never replayed.
+		skeleton.Clear();
+		return false;
+	}
+	return true;
+}
+
+bool PhysicsRecorder::ReadSnapshotData(std::istream& is, Skeleton& skeleton)
+{
+
+	Physics::forceApplyFlag = Read<uint8_t>(is) != 0;
+	Physics::GravityVector = Read<glm::vec3>(is);
+	Physics::GravityScaler = Read<float>(is);
+	Physics::sleepFlag = Read<uint8_t>(is) != 0;
+	Physics::SleepThreshold = Read<float>(is);
+	Physics::SleepStepCount = Read<int>(is);
+	Physics::lodFlag = Read<uint8_t>(is) != 0;
+	Physics::LODScreenSize = Read<float>(is);
+	Physics::LODMaxRate = Read<int>(is);
+
+	const int boneSize = Read<int32_t>(is);
+	if (!is || boneSize < 0)
+	{
+		return false;
+	}
+	std::vector<std::pair<JiggleBone*, int>> childIDs;
+	for (int i = 0; i < boneSize && is; i++)
+	{
+		std::string name = ReadString(is);
+		int parentID = Read<int>(is);
+		int id = Read<int>(is);
+		glm::mat4 toBoneFromUnit = Read<glm::mat4>(is);
+		glm::mat4 toModelFromBone = Read<glm::mat4>(is);
+		bool isJiggleBone = Read<uint8_t>(is) != 0;
+		if (!is)
+		{
+			return false;
+		}
+
+		if (isJiggleBone == false)
+		{
+			Bone* bone = new Bone(name, parentID, id, toBoneFromUnit, toModelFromBone);
+			skeleton.AddBone(bone);
+			continue;
+		}
+
+		int childID = Read<int>(is);
+		int grandParentID = Read<int>(is);
+		if (parentID < 0 || parentID >= i || grandParentID >= i)
+		{
+			return false;
+		}
+
+		const Bone* parentBone = skeleton.bones[parentID];
+		const Bone* grandParentBone = (grandParentID >= 0) ? skeleton.bones[grandParentID] : nullptr;
+		JiggleBone* jb = new JiggleBone(name, parentID, id, toBoneFromUnit, toModelFromBone, parentBone, nullptr, grandParentBone);
+		jb->isUpdateJigglePhysics = Read<uint8_t>(is) != 0;
+		jb->customPhysicsTranslation = Read<glm::mat4>(is);
+		jb->customPhysicsRotation = Read<glm::mat4>(is);
+		jb->bendingSpringInitLengthA = Read<float>(is);
+		jb->bendingSpringInitLengthB = Read<float>(is);
+		jb->collisionForceA = Read<glm::vec3>(is);
+		jb->collisionForceB = Read<glm::vec3>(is);
+		ReadPhysics(is, jb->physics);
+		skeleton.AddBone(jb);
+
+		childIDs.push_back({ jb, childID });
+	}
+
+	// Children are created after their parents, so link them at last.
+	for (const std::pair<JiggleBone*, int>& link : childIDs)
+	{
+		if (link.second < 0 || link.second >= skeleton.boneSize)
+		{
+			continue;
+		}
+		link.first->childBonePtr = dynamic_cast<const JiggleBone*>(skeleton.bones[link.second]);
+	}
+
+	ColliderSystem& colliders = skeleton.colliders;
+	colliders.segmentRadius = Read<float>(is);
+	colliders.stiffness = Read<float>(is);
+	colliders.damping = Read<float>(is);
+	const int colliderCount = Read<int>(is);
+	if (!is || colliderCount < 0)
+	{
+		return false;
+	}
+	for (int i = 0; i < colliderCount && is; i++)
+	{
+		BoneCollider collider;
+		collider.type = static_cast<ColliderType>(Read<int32_t>(is));
+		collider.boneID = Read<int>(is);
+		collider.radius = Read<float>(is);
+		collider.localPointA = Read<glm::vec3>(is);
+		collider.localPointB = Read<glm::vec3>(is);
+		colliders.AddCollider(collider);
+	}
+
+	std::vector<JiggleBone*> jiggleBones;
+	for (Bone* bone : skeleton.bones)
+	{
+		if (JiggleBone* jb = dynamic_cast<JiggleBone*>(bone);
+			jb != nullptr)
+		{
+			jiggleBones.push_back(jb);
+		}
+	}
+	skeleton.BuildJiggleChains(jiggleBones);
+
+	const uint32_t chainCount = Read<uint32_t>(is);
+	for (uint32_t i = 0; i < chainCount && is; i++)
+	{
+		JiggleChain state;
+		state.anchorTransform = Read<glm::mat4>(is);
+		JiggleChainParameters& parameters = state.parameters;
+		parameters.forceApplyFlag = Read<uint8_t>(is) != 0;
+		parameters.gravityVector = Read<glm::vec3>(is);
+		parameters.gravityScaler = Read<float>(is);
+		uint32_t boneCount;
+		if (ReadCount(is, sizeof(uint8_t) + 4 * sizeof(float) + sizeof(double), boneCount) == false)
+		{
+			return false;
+		}
+		parameters.bones.resize(boneCount);
+		for (JiggleChainParameters::BoneParameters& bone : parameters.bones)
+		{
+			bone.isUpdateJigglePhysics = Read<uint8_t>(is) != 0;
+			bone.springScaler = Read<float>(is);
+			bone.dampingScaler = Read<float>(is);
+			bone.bendSpringScaler = Read<float>(is);
+			bone.bendDampingScaler = Read<float>(is);
+			bone.momentCount = Read<double>(is);
+		}
+		state.isSleeping = Read<uint8_t>(is) != 0;
+		state.restStepCount = Read<int>(is);
+		state.lodRate = Read<int>(is);
+		state.skippedStepCount = Read<int>(is);
+		state.accumulatedTime = Read<float>(is);
+
+		if (i < skeleton.chains.size())
+		{
+			JiggleChain& chain = skeleton.chains[i];
+			chain.anchorTransform = state.anchorTransform;
+			chain.parameters = std::move(state.parameters);
+			chain.isSleeping = state.isSleeping;
+			chain.restStepCount = state.restStepCount;
+			chain.lodRate = state.lodRate;
+			chain.skippedStepCount = state.skippedStepCount;
+			chain.accumulatedTime = state.accumulatedTime;
+		}
+	}
+
+	return static_cast<bool>(is);
+}
+
+void PhysicsRecorder::WriteTunables(std::ostream& os, Skeleton& skeleton)
+{
+	Write(os, static_cast<uint8_t>(Physics::forceApplyFlag));
+	Write(os, Physics::GravityVector);
+	Write(os, Physics::GravityScaler);
+	Write(os, static_cast<uint8_t>(Physics::sleepFlag));
+	Write(os, Physics::SleepThreshold);
+	Write(os, Physics::SleepStepCount);
+	Write(os, static_cast<uint8_t>(Physics::lodFlag));
+	Write(os, Physics::LODScreenSize);
+	Write(os, Physics::LODMaxRate);
+
+	Write(os, static_cast<int32_t>(skeleton.boneSize));
+	for (const Bone* bone : skeleton.bones)
+	{
+		if (const JiggleBone* jb = dynamic_cast<const JiggleBone*>(bone);
+			jb != nullptr)
+		{
+			Write(os, static_cast<uint8_t>(jb->isUpdateJigglePhysics));
+			Write(os, jb->physics.springScaler);
+			Write(os, jb->physics.dampingScaler);
+			Write(os, jb->physics.bendSpringScaler);
+			Write(os, jb->physics.bendDampingScaler);
+			Write(os, jb->physics.moments.count);
+			Write(os, jb->physics.moments.first);
+		}
+	}
+
+	ColliderSystem& colliders = skeleton.colliders;
+	Write(os, colliders.segmentRadius);
+	Write(os, colliders.stiffness);
+	Write(os, colliders.damping);
+	const int colliderCount = static_cast<int>(colliders.GetColliderCount());
+	for (int i = 0; i < colliderCount; i++)
+	{
+		const BoneCollider& collider = colliders.GetCollider(i);
+		Write(os, static_cast<int32_t>(collider.type));
+		Write(os, collider.boneID);
+		Write(os, collider.radius);
+		Write(os, collider.localPointA);
+		Write(os, collider.localPointB);
+	}
+}
+
+void PhysicsRecorder::WriteJiggleStates(std::ostream& os, Skeleton& skeleton)
+{
+	uint32_t jiggleBoneCount = 0;
+	for (const Bone* bone : skeleton.bones)
+	{
+		if (dynamic_cast<const JiggleBone*>(bone) != nullptr)
+		{
+			jiggleBoneCount++;
+		}
+	}
+
+	Write(os, jiggleBoneCount);
+	for (const Bone* bone : skeleton.bones)
+	{
+		if (const JiggleBone* jb = dynamic_cast<const JiggleBone*>(bone);
+			jb != nullptr)
+		{
+			const Physics& physics = jb->physics;
+			Write(os, physics.translation);
+			Write(os, physics.rotation);
+			Write(os, physics.angularMomentum);
+			for (size_t i = 0; i < physics.springSize; i++)
+			{
+				Write(os, physics.linearMomentums[i]);
+			}
+		}
+	}
+}
+
+float PhysicsRecorder::CompareJiggleStates(std::istream& is, Skeleton& skeleton)
+{
+	const uint32_t recordedCount = Read<uint32_t>(is);
+
+	std::vector<const JiggleBone*> jiggleBones;
+	for (const Bone* bone : skeleton.bones)
+	{
+		if (const JiggleBone* jb = dynamic_cast<const JiggleBone*>(bone);
+			jb != nullptr)
+		{
+			jiggleBones.push_back(jb);
+		}
+	}
+
+	float divergence = (recordedCount == jiggleBones.size()) ? 0.f : FLT_MAX;
+	for (uint32_t i = 0; i < recordedCount; i++)
+	{
+		glm::vec3 translation = Read<glm::vec3>(is);
+		glm::mat3 rotation = Read<glm::mat3>(is);
+		glm::vec3 angularMomentum = Read<glm::vec3>(is);
+		glm::vec3 linearMomentums[4];
+		for (glm::vec3& linearMomentum : linearMomentums)
+		{
+			linearMomentum = Read<glm::vec3>(is);
+		}
+
+		if (i >= jiggleBones.size())
+		{
+			continue;
+		}
+
+		const Physics& physics = jiggleBones[i]->physics;
+		divergence = std::max(divergence, MaxDifference(&translation.x, &physics.translation.x, 3));
+		divergence = std::max(divergence, MaxDifference(&rotation[0][0], &physics.rotation[0][0], 9));
+		divergence = std::max(divergence, MaxDifference(&angularMomentum.x, &physics.angularMomentum.x, 3));
+		for (size_t spring = 0; spring < std::min<size_t>(physics.springSize, 4); spring++)
+		{
+			divergence = std::max(divergence, MaxDifference(&linearMomentums[spring].x, &physics.linearMomentums[spring].x, 3));
+		}
+	}
+
+	return divergence;
+}
+
+void PhysicsRecorder::WritePhysics(std::ostream& os, const Physics& physics)
+{
+	Write(os, physics.centerOfMass);
+	Write(os, physics.initCenterOfMass);
+	Write(os, physics.translation);
+	WriteVector(os, physics.linearMomentums);
+	WriteVector(os, physics.linearVelocities);
+	Write(os, physics.force);
+	Write(os, physics.rotation);
+	Write(os, physics.angularMomentum);
+	Write(os, physics.angularVelocity);
+	Write(os, physics.inertiaTensorInverse);
+	Write(os, physics.inertiaTensorObj);
+	Write(os, physics.torque);
+	Write(os, physics.totalMass);
+	WriteVector(os, physics.initVertices);
+	WriteVector(os, physics.vertices);
+	Write(os, physics.dampingScaler);
+	Write(os, physics.springScaler);
+	Write(os, physics.bendDampingScaler);
+	Write(os, physics.bendSpringScaler);
+	Write(os, physics.moments.count);
+	Write(os, physics.moments.first);
+	Write(os, physics.moments.second);
+}
+
+void PhysicsRecorder::ReadPhysics(std::istream& is, Physics& physics)
+{
+	physics.centerOfMass = Read<glm::vec3>(is);
+	physics.initCenterOfMass = Read<glm::vec3>(is);
+	physics.translation = Read<glm::vec3>(is);
+	ReadVector(is, physics.linearMomentums);
+	ReadVector(is, physics.linearVelocities);
+	physics.force = Read<glm::vec3>(is);
+	physics.rotation = Read<glm::mat3>(is);
+	physics.angularMomentum = Read<glm::vec3>(is);
+	physics.angularVelocity = Read<glm::vec3>(is);
+	physics.inertiaTensorInverse = Read<glm::mat3>(is);
+	physics.inertiaTensorObj = Read<glm::mat3>(is);
+	physics.torque = Read<glm::vec3>(is);
+	physics.totalMass = Read<float>(is);
+	ReadVector(is, physics.initVertices);
+	ReadVector(is, physics.vertices);
+	if (physics.vertices.size() != physics.initVertices.size())
+	{
+		// Vertices are removed from both in the same slots.
+		is.setstate(std::ios::failbit);
+	}
+	// Built again from the read vertices when they are removed.
+	physics.vertexSlots.clear();
+	physics.isVertexSlotsBuilt = false;
+	physics.dampingScaler = Read<float>(is);
+	physics.springScaler = Read<float>(is);
+	physics.bendDampingScaler = Read<float>(is);
+	physics.bendSpringScaler = Read<float>(is);
+	physics.moments.count = Read<double>(is);
+	physics.moments.first = Read<glm::dvec3>(is);
+	physics.moments.second = Read<glm::dmat3>(is);
+}
@@ -0,0 +1,58 @@
+/******************************************************************************
+Copyright (C) 2022 DigiPen Institute of Technology.
+Reproduction or disclosure of this file or its contents without the prior
+written consent of DigiPen Institute of Technology is prohibited.
+File Name:   PhysicsRecorder.h
+Author
+	- sinil.kang	rtd99062@gmail.com
+Creation Date: 12.22.2022
+	header file for recording and replaying jiggle bone physics.
+******************************************************************************/
+#pragma once
+#include <string>
+#include <fstream>
+#include <vector>
+#include <GLMath.h>
+
+class Skeleton;
+struct Physics;
+
+// Record inputs of Skeleton::Update() and resulting jiggle bone states to a binary log.
+// The log can be replayed against the current physics code without GPU.
+	// Log is a stream of records.
+	// 'S' : Snapshot of the whole skeleton. Written at the beginning, and whenever parameters or vertices are changed.
+	// 'F' : Inputs of a step followed by the resulting jiggle bone states.
+class PhysicsRecorder
+{
+public:
+	PhysicsRecorder();
+	~PhysicsRecorder();
+
+	bool BeginRecording(const std::string& path, Skeleton& skeleton);
+	void EndRecording();
+	bool IsRecording() const;
+	size_t GetRecordedStepCount() const;
+
+	// Should be called right before and after Skeleton::Update().
+	void RecordInput(float dt, glm::mat4 modelMatrix, bool bindPoseFlag, const std::vector<glm::mat4>* animationMatrix, Skeleton& skeleton);
+	void RecordResult(Skeleton& skeleton);
+
+	// Headless replay. Print steps per second, worst step latency and max state divergence to the std::cout.
+	static bool Replay(const std::string& path);
+private:
+	static void WriteSnapshot(std::ostream& os, Skeleton& skeleton);
+	// Skeleton is cleared if the snapshot is broken.
+	static bool ReadSnapshot(std::istream& is, Skeleton& skeleton);
+	static bool ReadSnapshotData(std::istream& is, Skeleton& skeleton);
+	// Everything GUI or vertex brush can change during recording.
+	static void WriteTunables(std::ostream& os, Skeleton& skeleton);
+	static void WriteJiggleStates(std::ostream& os, Skeleton& skeleton);
+	// Return max absolute difference between recorded and current states.
+	static float CompareJiggleStates(std::istream& is, Skeleton& skeleton);
+	static void WritePhysics(std::ostream& os, const Physics& physics);
+	static void ReadPhysics(std::istream& is, Physics& physics);
+
+	std::ofstream file;
+	std::string lastTunables;
+	size_t recordedStepCount;
+};
@@ -14,6 +14,9 @@ Creation Date: 06.12.2021
 #include <fstream>
 #include <vector>
 #include <algorithm> // for std::clamp
+#include <numeric>	// for std::iota
+#include <execution>
+#include <future>
 
 #include "Graphics/MyScene.h"
 #include "Graphics.h"
@@ -26,16 +29,21 @@ Creation Date: 06.12.2021
 #include "Graphics/DescriptorSet.h"
 #include "ImGUI/myGUI.h"
 #include "Engines/Input/Input.h"
+#include "Engines/CPUProfiler.h"
 
 #include <Engines/Objects/Object.h>
 #include <Graphics/Textures/Texture.h>
 #include <Graphics/Buffer/Buffer.h>
 #include <Graphics/Buffer/UniformBuffer.h>
+#include <Graphics/Buffer/UniformRingBuffer.h>
+#include <Graphics/Buffer/MeshArena.h>
+#include <Graphics/Culling/MeshCuller.h>
 #include <Graphics/Pipelines/Pipeline.h>
+#include <Graphics/BindlessTextureTable.h>
 #include <Engines/Objects/HairBone.h>
 
 MyScene::MyScene(Window* window)
-	: windowHolder(window), model(nullptr), isUpdateAnimationTimer(true), animationTimer(0.f), rightMouseCenter(glm::vec3(0.f, 0.f, 0.f)), cameraPoint(glm::vec3(0.f, 0.f, 2.f)), targetPoint(glm::vec3(0.f)), bindPoseFlag(false), showSkeletonFlag(true), blendingWeightMode(false), showModel(true), vertexPointsMode(false), pointSize(5.f), selectedMesh(0), mouseSensitivity(1.f), applyingBone(false), flagChangeBoneIndexInSphere(false), boneIDIndex(0), proceedFrame(false), runRealtime(false)
+	: windowHolder(window), model(nullptr), isUpdateAnimationTimer(true), animationTimer(0.f), rightMouseCenter(glm::vec3(0.f, 0.f, 0.f)), cameraPoint(glm::vec3(0.f, 0.f, 2.f)), targetPoint(glm::vec3(0.f)), bindPoseFlag(false), showSkeletonFlag(true), blendingWeightMode(false), showModel(true), vertexPointsMode(false), pointSize(5.f), selectedMesh(0), mouseSensitivity(1.f), applyingBone(false), flagChangeBoneIndexInSphere(false), boneIDIndex(0), proceedFrame(false), runRealtime(false), flagMakeClothInSphere(false)
 {
 }
 
@@ -51,96 +59,130 @@ bool MyScene::InitScene(Graphics* _graphics)
 
 	graphics = _graphics;
 
-	graphicResources.push_back(new Texture(graphics, "EmergencyTexture", "../Vulkan/Graphics/Model/EssentialImages/transparent.png"));
-	const std::vector<std::string>& paths = model->GetDiffuseImagePaths();
-	for (int i = 0; i < paths.size(); i++)
-	{
-		graphicResources.push_back(new Texture(graphics, std::string("diffuseImage") + std::to_string(i), paths[i]));
-	}
-	graphicResources.push_back(new Buffer(graphics, "skeletonBuffer", VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, sizeof(LineVertex), 2 * model->GetBoneCount(), model->GetBoneDataForDrawing()));
 	const int meshSize = model->GetMeshSize();
-	for (int i = 0; i < meshSize; i++)
-	{
-		graphicResources.push_back(new Buffer(graphics, std::string("vertex") + std::to_string(i), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, sizeof(Vertex), model->GetVertexCount(i), model->GetVertexData(i)));
-		graphicResources.push_back(new Buffer(graphics, std::string("index") + std::to_string(i), VK_BUFFER_USAGE_INDEX_BUFFER_BIT, sizeof(uint32_t), model->GetIndexCount(i), model->GetIndexData(i)));
-		graphicResources.push_back(new Buffer(graphics, std::string("uniqueVertex") + std::to_string(i), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, sizeof(Vertex), model->GetUniqueVertexCount(i), model->GetUniqueVertexData(i)));
-	}
-	graphicResources.push_back(new Buffer(graphics, std::string("sphereVertex"), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, sizeof(Vertex), sphereMesh->GetVertexCount(0), sphereMesh->GetVertexData(0)));
-	graphicResources.push_back(new Buffer(graphics, std::string("sphereIndex"), VK_BUFFER_USAGE_INDEX_BUFFER_BIT, sizeof(uint32_t), sphereMesh->GetIndexCount(0), sphereMesh->GetIndexData(0)));
-
-	graphicResources.push_back(new UniformBuffer(graphics, std::string("uniformBuffer"), sizeof(UniformBufferObject), Graphics::MAX_FRAMES_IN_FLIGHT));
-	graphicResources.push_back(new UniformBuffer(graphics, std::string("animationUniformBuffer"), sizeof(glm::mat4) * model->GetBoneCount(), Graphics::MAX_FRAMES_IN_FLIGHT));
-	graphicResources.push_back(new UniformBuffer(graphics, std::string("unitBoneUniformBuffer"), sizeof(glm::mat4) * model->GetBoneCount(), Graphics::MAX_FRAMES_IN_FLIGHT));
 
-	graphicResources.push_back(new DescriptorSet(graphics, "descriptor", Graphics::MAX_FRAMES_IN_FLIGHT * meshSize, {
-		{0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT, nullptr},
-		{1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT, nullptr},
-		{2, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr}
+	// @@ Pipelines
+	// Descriptor set layouts are made first, so pipelines can be built on worker threads while resources are loaded.
+	// Meshes only differ in their textures, which are selected from the texture table by push constants.
+		// Thus, every mesh shares one descriptor set of each layout.
+	descriptorHandle = graphicResources.Add(new DescriptorSet(graphics, "descriptor", 1, {
+		{0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1, VK_SHADER_STAGE_VERTEX_BIT, nullptr},
+		{1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1, VK_SHADER_STAGE_VERTEX_BIT, nullptr}
 		}));
-	WriteDescriptorSet();
+	textureTableHandle = graphicResources.Add(new BindlessTextureTable(graphics, "textureTable"));
+	// The first slot is kept for the emergency texture.
+	graphicResources.Get(textureTableHandle)->AllocateSlot();
 
-	graphicResources.push_back(new DescriptorSet(graphics, "waxDescriptor", Graphics::MAX_FRAMES_IN_FLIGHT * meshSize, {
-		{0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT, nullptr},
-		{1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT, nullptr}
+	waxDescriptorHandle = graphicResources.Add(new DescriptorSet(graphics, "waxDescriptor", 1, {
+		{0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1, VK_SHADER_STAGE_VERTEX_BIT, nullptr},
+		{1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1, VK_SHADER_STAGE_VERTEX_BIT, nullptr}
 		}));
 
-	WriteWaxDescriptorSet();
-
-	graphicResources.push_back(new DescriptorSet(graphics, "blendingWeightDescriptor", Graphics::MAX_FRAMES_IN_FLIGHT * meshSize, {
-		{0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT, nullptr},
-		{1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT, nullptr}
+	blendingWeightDescriptorHandle = graphicResources.Add(new DescriptorSet(graphics, "blendingWeightDescriptor", 1, {
+		{0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1, VK_SHADER_STAGE_VERTEX_BIT, nullptr},
+		{1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1, VK_SHADER_STAGE_VERTEX_BIT, nullptr}
 		}));
-	WriteBlendingWeightDescriptorSet();
 
-	graphicResources.push_back(new DescriptorSet(graphics, "sphereDescriptor", Graphics::MAX_FRAMES_IN_FLIGHT,
+	sphereDescriptorHandle = graphicResources.Add(new DescriptorSet(graphics, "sphereDescriptor", 1,
 		{
-			{0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT, nullptr}
+			{0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1, VK_SHADER_STAGE_VERTEX_BIT, nullptr}
 		}));
-	WriteSphereDescriptorSet();
 
+	hairBoneDescriptorHandle = graphicResources.Add(new DescriptorSet(graphics, "hairBoneDescriptor", 1,
+		{
+			{0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1, VK_SHADER_STAGE_VERTEX_BIT, nullptr},
+			{1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1, VK_SHADER_STAGE_VERTEX_BIT, nullptr},
+			{2, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1, VK_SHADER_STAGE_VERTEX_BIT, nullptr},
+			{3, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1, VK_SHADER_STAGE_VERTEX_BIT, nullptr}
+		}));
 
-	DescriptorSet* descriptorSet = dynamic_cast<DescriptorSet*>(FindObjectByName("descriptor"));
-	graphicResources.push_back(new Pipeline(graphics, "pipeline", "spv/vertexShader.vert.spv", "spv/fragShader.frag.spv", descriptorSet->GetDescriptorSetLayoutPtr()));
-
-	DescriptorSet* waxDescriptorSet = dynamic_cast<DescriptorSet*>(FindObjectByName("waxDescriptor"));
-	graphicResources.push_back(new Pipeline(graphics, "waxPipeline", "spv/waxShader.vert.spv", "spv/waxShader.frag.spv", waxDescriptorSet->GetDescriptorSetLayoutPtr()));
+	const VkDescriptorSetLayout descriptorSetLayout = *graphicResources.Get(descriptorHandle)->GetDescriptorSetLayoutPtr();
+	const VkDescriptorSetLayout textureTableLayout = *graphicResources.Get(textureTableHandle)->GetDescriptorSetLayoutPtr();
+	const VkDescriptorSetLayout waxDescriptorSetLayout = *graphicResources.Get(waxDescriptorHandle)->GetDescriptorSetLayoutPtr();
+	const VkDescriptorSetLayout blendingWeightDescriptorSetLayout = *graphicResources.Get(blendingWeightDescriptorHandle)->GetDescriptorSetLayoutPtr();
+	const VkDescriptorSetLayout sphereDescriptorSetLayout = *graphicResources.Get(sphereDescriptorHandle)->GetDescriptorSetLayoutPtr();
+	const VkDescriptorSetLayout hairBoneDescriptorSetLayout = *graphicResources.Get(hairBoneDescriptorHandle)->GetDescriptorSetLayoutPtr();
+	const std::vector<PipelineDescription> pipelineDescriptions = {
+		{ "pipeline", "spv/vertexShader.vert.spv", "spv/fragShader.frag.spv", Vertex::GetBindingDescription(), Vertex::GetAttributeDescriptions(), 0, 0, { descriptorSetLayout, textureTableLayout } },
+		{ "waxPipeline", "spv/waxShader.vert.spv", "spv/waxShader.frag.spv", Vertex::GetBindingDescription(), Vertex::GetAttributeDescriptions(), 0, 0, { waxDescriptorSetLayout } },
+		{ "blendingWeightPipeline", "spv/blendingWeight.vert.spv", "spv/blendingWeight.frag.spv", Vertex::GetBindingDescription(), Vertex::GetAttributeDescriptions(), sizeof(int), VK_SHADER_STAGE_VERTEX_BIT, { blendingWeightDescriptorSetLayout } },
+		{ "vertexPipeline", "spv/vertexPoints.vert.spv", "spv/vertexPoints.frag.spv", Vertex::GetBindingDescription(), Vertex::GetAttributeDescriptions(), sizeof(VertexPipelinePushConstants), VK_SHADER_STAGE_VERTEX_BIT, { blendingWeightDescriptorSetLayout }, VK_PRIMITIVE_TOPOLOGY_POINT_LIST },
+		{ "linePipeline", "spv/skeleton.vert.spv", "spv/skeleton.frag.spv", LineVertex::GetBindingDescription(), LineVertex::GetAttributeDescriptions(), sizeof(int), VK_SHADER_STAGE_VERTEX_BIT, { blendingWeightDescriptorSetLayout }, VK_PRIMITIVE_TOPOLOGY_LINE_LIST, VK_FALSE },
+		{ "spherePipeline", "spv/sphere.vert.spv", "spv/sphere.frag.spv", Vertex::GetBindingDescription(), Vertex::GetAttributeDescriptions(), sizeof(SpherePushConstants), VK_SHADER_STAGE_VERTEX_BIT, { sphereDescriptorSetLayout } },
+		{ "hairBonePipeline", "spv/hairBone.vert.spv", "spv/hairBone.frag.spv", LineVertex::GetBindingDescription(), LineVertex::GetAttributeDescriptions(), sizeof(HairBonePushConstants), VK_SHADER_STAGE_VERTEX_BIT, { hairBoneDescriptorSetLayout }, VK_PRIMITIVE_TOPOLOGY_POINT_LIST, VK_FALSE },
+	};
+	std::future<std::vector<Pipeline*>> pipelineBuild = std::async(std::launch::async, Pipeline::CreatePipelines, graphics, pipelineDescriptions);
+	// @@ End of pipelines
+
+	emergencyTextureHandle = graphicResources.Add(new Texture(graphics, "EmergencyTexture", "../Vulkan/Graphics/Model/EssentialImages/transparent.png"));
+	// Diffuse images are created by UpdateTextureStreaming() when they are decoded.
+	textureStreamer.Init(graphics, TEXTURE_BUDGET);
+	diffuseImageHandles.resize(model->GetDiffuseImagePaths().size());
+	textureStreamer.Request(model->GetDiffuseImagePaths());
+	skeletonBufferHandle = graphicResources.Add(new Buffer(graphics, "skeletonBuffer", VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, sizeof(LineVertex), 2 * model->GetBoneCount(), model->GetBoneDataForDrawing()));
+	meshResources.resize(meshSize);
+	meshArenaHandle = graphicResources.Add(new MeshArena(graphics, "meshArena", sizeof(Vertex), GetMeshData()));
+	uniqueVertexArenaHandle = graphicResources.Add(new MeshArena(graphics, "uniqueVertexArena", sizeof(Vertex), GetUniqueVertexMeshData()));
+	meshCullerHandle = graphicResources.Add(new MeshCuller(graphics, "meshCuller", GetCullingBoxes()));
+	sphereVertexHandle = graphicResources.Add(new Buffer(graphics, std::string("sphereVertex"), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, sizeof(Vertex), sphereMesh->GetVertexCount(0), sphereMesh->GetVertexData(0)));
+	sphereIndexHandle = graphicResources.Add(new Buffer(graphics, std::string("sphereIndex"), VK_BUFFER_USAGE_INDEX_BUFFER_BIT, sizeof(uint32_t), sphereMesh->GetIndexCount(0), sphereMesh->GetIndexData(0)));
 
-	DescriptorSet* blendingWeightDescriptor = dynamic_cast<DescriptorSet*>(FindObjectByName("blendingWeightDescriptor"));
-	graphicResources.push_back(new Pipeline(graphics, "blendingWeightPipeline", "spv/blendingWeight.vert.spv", "spv/blendingWeight.frag.spv", Vertex::GetBindingDescription(), Vertex::GetAttributeDescriptions(), sizeof(int), VK_SHADER_STAGE_VERTEX_BIT, blendingWeightDescriptor->GetDescriptorSetLayoutPtr()));
+	hairBone0 = new HairBone("HairBone");
+	uniformRingHandle = graphicResources.Add(new UniformRingBuffer(graphics, std::string("uniformRing"), GetUniformFrameSize()));
+	uniformOffsets.fill(0);
 
-	graphicResources.push_back(new Pipeline(graphics, "vertexPipeline", "spv/vertexPoints.vert.spv", "spv/vertexPoints.frag.spv", Vertex::GetBindingDescription(), Vertex::GetAttributeDescriptions(), sizeof(VertexPipelinePushConstants), VK_SHADER_STAGE_VERTEX_BIT, blendingWeightDescriptor->GetDescriptorSetLayoutPtr(), VK_PRIMITIVE_TOPOLOGY_POINT_LIST));
+	WriteDescriptorSet();
+	WriteTextureTable();
+	WriteWaxDescriptorSet();
+	WriteBlendingWeightDescriptorSet();
+	WriteSphereDescriptorSet();
+	WriteCullingDescriptorSet();
 
-	graphicResources.push_back(new Pipeline(graphics, "linePipeline", "spv/skeleton.vert.spv", "spv/skeleton.frag.spv", LineVertex::GetBindingDescription(), LineVertex::GetAttributeDescriptions(), sizeof(int), VK_SHADER_STAGE_VERTEX_BIT, blendingWeightDescriptor->GetDescriptorSetLayoutPtr(), VK_PRIMITIVE_TOPOLOGY_LINE_LIST, VK_FALSE));
+	InitUniformBufferData();
 
-	DescriptorSet* sphereDescriptor = dynamic_cast<DescriptorSet*>(FindObjectByName("sphereDescriptor"));
-	graphicResources.push_back(new Pipeline(graphics, "spherePipeline", "spv/sphere.vert.spv", "spv/sphere.frag.spv", Vertex::GetBindingDescription(), Vertex::GetAttributeDescriptions(), sizeof(SpherePushConstants), VK_SHADER_STAGE_VERTEX_BIT, sphereDescriptor->GetDescriptorSetLayoutPtr()));
+	isStaticCommandBufferDirty.assign(Graphics::MAX_FRAMES_IN_FLIGHT, true);
+	staticChunkCounts.assign(Graphics::MAX_FRAMES_IN_FLIGHT, 0);
+	recordedUniformOffsets.assign(Graphics::MAX_FRAMES_IN_FLIGHT, uniformOffsets);
+	lastDrawState = GetDrawState();
 
-	InitUniformBufferData();
+	hairBoneBufferHandle = graphicResources.Add(new Buffer(graphics, std::string("HairBone"), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, sizeof(glm::vec3), hairBone0->GetBoneSize(), hairBone0->GetBoneData()));
+	WriteHairBoneDescriptorSet();
 
-	hairBone0 = new HairBone("HairBone");
-	graphicResources.push_back(new Buffer(graphics, std::string("HairBone"), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, sizeof(glm::vec3), hairBone0->GetBoneSize(), hairBone0->GetBoneData()));
-	graphicResources.push_back(new UniformBuffer(graphics, std::string("HairBoneUniform"), hairBone0->GetHairBoneMaxDataSize(), Graphics::MAX_FRAMES_IN_FLIGHT));
-	DescriptorSet* hairBoneDescriptor = new DescriptorSet(graphics, "hairBoneDescriptor", Graphics::MAX_FRAMES_IN_FLIGHT,
+	// Start uploading the loaded resources while the first frame is being prepared.
+	graphics->FlushUploads();
+
+	// Every pipeline is waited at once, in the order of pipelineDescriptions.
+	const std::vector<Pipeline*> pipelines = pipelineBuild.get();
+	pipelineHandle = graphicResources.Add(pipelines[0]);
+	waxPipelineHandle = graphicResources.Add(pipelines[1]);
+	blendingWeightPipelineHandle = graphicResources.Add(pipelines[2]);
+	vertexPipelineHandle = graphicResources.Add(pipelines[3]);
+	linePipelineHandle = graphicResources.Add(pipelines[4]);
+	spherePipelineHandle = graphicResources.Add(pipelines[5]);
+	hairBonePipelineHandle = graphicResources.Add(pipelines[6]);
+	// VkCheck does not abort in Release, so a failed pipeline is left as VK_NULL_HANDLE. Handles above still own them for cleaning.
+	for (Pipeline* pipeline : pipelines)
+	{
+		if (pipeline->GetPipeline() == VK_NULL_HANDLE)
 		{
-			{0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT, nullptr},
-			{1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT, nullptr},
-			{2, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT, nullptr},
-			{3, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT, nullptr}
-		});
-	graphicResources.push_back(hairBoneDescriptor);
-	WriteHairBoneDescriptorSet();
-	graphicResources.push_back(new Pipeline(graphics, "hairBonePipeline", "spv/hairBone.vert.spv", "spv/hairBone.frag.spv", LineVertex::GetBindingDescription(), LineVertex::GetAttributeDescriptions(), sizeof(HairBonePushConstants), VK_SHADER_STAGE_VERTEX_BIT, hairBoneDescriptor->GetDescriptorSetLayoutPtr(), VK_PRIMITIVE_TOPOLOGY_POINT_LIST, VK_FALSE));
+			std::cout << "Creating " << pipeline->GetName() << " has failed!" << std::endl;
+			return false;
+		}
+	}
+
+#ifdef _DEBUG
+	shaderHotReloader.Init("../Vulkan/Graphics/Shaders", "spv");
+#endif
 
 	return true;
 }
 
 void MyScene::CleanScene()
 {
+	shaderHotReloader.Clean();
+	textureStreamer.Clean();
 
-	for (Object* obj : graphicResources)
-	{
-		delete obj;
-	}
+	graphicResources.Clear();
 
 	delete hairBone0;
 	delete sphereMesh;
@@ -149,8 +191,13 @@ void MyScene::CleanScene()
 
 void MyScene::DrawFrame(float dt, VkCommandBuffer commandBuffer, uint32_t currentFrameID)
 {
+	PROFILE_FUNCTION();
+	ReloadChangedShaders();
+	UpdateTextureStreaming();
 
 	UpdateTimer(dt);
+	model->SetViewProjection(uniformData.proj * uniformData.view);
+	const bool stepPhysics = runRealtime || proceedFrame;
 	if (runRealtime)
 	{
 
@@ -166,121 +213,287 @@ void MyScene::DrawFrame(float dt, VkCommandBuffer commandBuffer, uint32_t curren
 	}
 	model->CalculateAnimation(animationTimer, bindPoseFlag);
 
+	MakeClothInSphere();
+	// Cloth is pinned to the current pose, so it should be updated after the animation.
+	if (stepPhysics)
+	{
+		model->UpdateCloth(dt, uniformData.model);
+	}
+
 
 	ModifyBone();
 	CleanBones();
 
 	ChangeBoneIndexInSphere();
 
+	// Fence of this frame is already waited, so the region of this frame can be overwritten.
+	UniformRingBuffer* uniformRing = graphicResources.Get(uniformRingHandle);
+	uniformRing->BeginFrame(currentFrameID);
+
 	UpdateUniformBuffer(currentFrameID);
 
 	UpdateAnimationUniformBuffer(currentFrameID);
 
 	UpdateHairBoneBuffer(currentFrameID);
 
-	RecordDrawModelCalls(commandBuffer);
+	UpdateClothVertexBuffer(currentFrameID);
 
-	RecordDrawSkeletonCall(commandBuffer);
+	UpdateIndirectCommands(currentFrameID);
 
-	RecordDrawHairBoneCall(commandBuffer);
+	// Culling is a compute pass, so it is recorded before the render pass begins.
+	graphicResources.Get(meshCullerHandle)->Record(commandBuffer, currentFrameID, uniformOffsets.data(), uniformData.proj * uniformData.view * uniformData.model);
+	graphics->BeginRenderPass();
 
-	RecordDrawSphereCall(commandBuffer);
+	RecordDrawCalls(commandBuffer, currentFrameID);
 }
 
-void MyScene::FillBufferWithFloats(VkCommandBuffer cmdBuffer, VkBuffer dstBuffer, VkDeviceSize offset, VkDeviceSize size, const float value)
+bool MyScene::DrawState::operator==(const DrawState& other) const
 {
-	vkCmdFillBuffer(cmdBuffer, dstBuffer, offset, size, *(const uint32_t*)&value);
+	return showModel == other.showModel &&
+		blendingWeightMode == other.blendingWeightMode &&
+		vertexPointsMode == other.vertexPointsMode &&
+		showSkeletonFlag == other.showSkeletonFlag &&
+		selectedBone == other.selectedBone &&
+		swapchainGeneration == other.swapchainGeneration;
 }
 
-void MyScene::LoadNewModel()
+bool MyScene::DrawState::operator!=(const DrawState& other) const
 {
-	windowHolder->isPathDropped = false;
-	const char* newPath = windowHolder->path;
+	return !(*this == other);
+}
 
-	const int oldTextureSize = static_cast<const int>(model->GetDiffuseImagePaths().size());
-	const int oldMeshSize = model->GetMeshSize();
+MyScene::DrawState MyScene::GetDrawState()
+{
+	return DrawState{ showModel, blendingWeightMode, vertexPointsMode, showSkeletonFlag, selectedBone, graphics->GetSwapchainGeneration() };
+}
 
-	if (model->LoadModel(newPath) == false)
+void MyScene::ReloadChangedShaders()
+{
+	PROFILE_FUNCTION();
+	const std::vector<ShaderHotReloader::ReloadedShader> reloadedShaders = shaderHotReloader.TakeReloadedShaders();
+	if (reloadedShaders.empty())
 	{
-		windowHolder->DisplayMessage("Failed model loading!", model->GetErrorString());
 		return;
 	}
 
-	// In order to clean previous model buffers successfully, 
-			// I should guarantee that deleted buffers are not in use by a command buffer.
-	// Thus, wait until the submitted command buffer completed execution.
-	graphics->DeviceWaitIdle();
-
-	// Reload textures
-	const std::vector<std::string> texturePaths = model->GetDiffuseImagePaths();
-	const int textureSize = static_cast<const int>(texturePaths.size());
-	for (int i = 0; i < textureSize; i++)
+	bool isRebuilt = false;
+	for (const ResourceHandle<Pipeline>& handle : { pipelineHandle, waxPipelineHandle, blendingWeightPipelineHandle, vertexPipelineHandle, linePipelineHandle, spherePipelineHandle, hairBonePipelineHandle })
 	{
-		if (i < oldTextureSize)
+		Pipeline* pipeline = graphicResources.Get(handle);
+		bool isAffected = false;
+		for (const ShaderHotReloader::ReloadedShader& reloadedShader : reloadedShaders)
 		{
-			Texture* texture = dynamic_cast<Texture*>(FindObjectByName(std::string("diffuseImage") + std::to_string(i)));
-			texture->ChangeTexture(texturePaths[i]);
+			isAffected |= pipeline->OverrideShader(reloadedShader.spvPath, reloadedShader.reloadedPath);
 		}
-		else
+		if (isAffected && pipeline->Rebuild())
 		{
-			graphicResources.push_back(new Texture(graphics, std::string("diffuseImage") + std::to_string(i), texturePaths[i]));
+			isRebuilt = true;
 		}
 	}
-	for (int i = textureSize; i < oldTextureSize; i++)
+
+	// Static command buffers still refer to the old pipelines.
+	if (isRebuilt)
 	{
-		Object* WillBeDeleted = FindObjectByName(std::string("diffuseImage") + std::to_string(i));
-		const auto& iter = std::find(graphicResources.begin(), graphicResources.end(), WillBeDeleted);
-		graphicResources.erase(iter);
-		delete WillBeDeleted;
+		InvalidateCommandBuffers();
 	}
 
-	// Reload model buffers
-	const int meshSize = model->GetMeshSize();
-	for (int i = 0; i < meshSize; i++)
+	// Compute passes are recorded every frame, so their command buffers are not invalidated.
+	MeshCuller* meshCuller = graphicResources.Get(meshCullerHandle);
+	for (const ShaderHotReloader::ReloadedShader& reloadedShader : reloadedShaders)
+	{
+		meshCuller->ReloadShader(reloadedShader.spvPath, reloadedShader.reloadedPath);
+		graphics->GetDepthPyramid().ReloadShader(reloadedShader.spvPath, reloadedShader.reloadedPath);
+	}
+}
+
+void MyScene::UpdateTextureStreaming()
+{
+	PROFILE_FUNCTION();
+	std::vector<TextureStreamer::TextureUpdate> updates = textureStreamer.TakeUpdates();
+	if (updates.empty())
+	{
+		return;
+	}
+
+	// Frames in flight may read the old views and their slots, so nothing is waited.
+		// New levels are uploaded into the same image, old views are destroyed later by Graphics, and new views are written to new slots of the texture table.
+	BindlessTextureTable* textureTable = graphicResources.Get(textureTableHandle);
+	for (const TextureStreamer::TextureUpdate& update : updates)
 	{
-		if (i < oldMeshSize)
+		Texture* texture = graphicResources.Get(diffuseImageHandles[update.index]);
+		if (texture != nullptr)
 		{
-			Buffer* buffer = dynamic_cast<Buffer*>(FindObjectByName(std::string("vertex") + std::to_string(i)));
-			buffer->ChangeBufferData(sizeof(Vertex), model->GetVertexCount(i), model->GetVertexData(i));
-			Buffer* indexBuffer = dynamic_cast<Buffer*>(FindObjectByName(std::string("index") + std::to_string(i)));
-			indexBuffer->ChangeBufferData(sizeof(uint32_t), model->GetIndexCount(i), model->GetIndexData(i));
-			Buffer* uniqueBuffer = dynamic_cast<Buffer*>(FindObjectByName(std::string("uniqueVertex") + std::to_string(i)));
-			uniqueBuffer->ChangeBufferData(sizeof(Vertex), model->GetUniqueVertexCount(i), model->GetUniqueVertexData(i));
+			texture->UploadMipLevels(update.texture, update.firstLevel);
 		}
 		else
 		{
-			graphicResources.push_back(new Buffer(graphics, std::string("vertex") + std::to_string(i), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, sizeof(Vertex), model->GetVertexCount(i), model->GetVertexData(i)));
-			graphicResources.push_back(new Buffer(graphics, std::string("index") + std::to_string(i), VK_BUFFER_USAGE_INDEX_BUFFER_BIT, sizeof(uint32_t), model->GetIndexCount(i), model->GetIndexData(i)));
-			graphicResources.push_back(new Buffer(graphics, std::string("uniqueVertex") + std::to_string(i), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, sizeof(Vertex), model->GetUniqueVertexCount(i), model->GetUniqueVertexData(i)));
+			diffuseImageHandles[update.index] = graphicResources.Add(new Texture(graphics, std::string("diffuseImage") + std::to_string(update.index), update.texture, update.firstLevel, update.width, update.height, update.mipLevelCount));
+			texture = graphicResources.Get(diffuseImageHandles[update.index]);
+		}
+
+		// Textures not fitting in the table keep the emergency texture.
+		const uint32_t slot = textureTable->AllocateSlot();
+		if (slot == BindlessTextureTable::INVALID_SLOT)
+		{
+			continue;
+		}
+		textureTable->Write(slot, texture->GetImageView(), graphics->GetTextureSampler());
+		if (diffuseSlots[update.index] != EMERGENCY_TEXTURE_SLOT)
+		{
+			textureTable->FreeSlot(diffuseSlots[update.index]);
 		}
+		diffuseSlots[update.index] = slot;
+	}
+
+	// Draws of cloth meshes in the static command buffers have the old slots.
+	InvalidateCommandBuffers();
+}
+
+void MyScene::InvalidateCommandBuffers()
+{
+	std::fill(isStaticCommandBufferDirty.begin(), isStaticCommandBufferDirty.end(), true);
+}
+
+void MyScene::RecordDrawCalls(VkCommandBuffer commandBuffer, uint32_t currentFrameID)
+{
+	PROFILE_FUNCTION();
+	if (DrawState drawState = GetDrawState();
+		drawState != lastDrawState)
+	{
+		InvalidateCommandBuffers();
+		lastDrawState = drawState;
 	}
-	for (int i = meshSize; i < oldMeshSize; i++)
+
+	// Fence of this frame is already waited, so the cached command buffers are not in use.
+	// Dynamic offsets are baked in the command buffers, so they are recorded again if the offsets are moved.
+	if (isStaticCommandBufferDirty[currentFrameID] || recordedUniformOffsets[currentFrameID] != uniformOffsets)
 	{
-		Object* WillBeDeleted = FindObjectByName(std::string("vertex") + std::to_string(i));
-		const auto& iter = std::find(graphicResources.begin(), graphicResources.end(), WillBeDeleted);
-		graphicResources.erase(iter);
-		delete WillBeDeleted;
+		RecordStaticDrawCalls(currentFrameID);
+		isStaticCommandBufferDirty[currentFrameID] = false;
+		recordedUniformOffsets[currentFrameID] = uniformOffsets;
+	}
 
-		Object* WillBeDeleted2 = FindObjectByName(std::string("index") + std::to_string(i));
-		const auto& iter2 = std::find(graphicResources.begin(), graphicResources.end(), WillBeDeleted2);
-		graphicResources.erase(iter2);
-		delete WillBeDeleted2;
+	VkCommandBuffer dynamicCommandBuffer = graphics->GetDynamicCommandBuffer();
+	GPUProfiler& gpuProfiler = graphics->GetGPUProfiler();
+	graphics->BeginSecondaryCommandBuffer(dynamicCommandBuffer);
+	RecordDrawVertexPointsCalls(dynamicCommandBuffer);
+	gpuProfiler.BeginRegion(dynamicCommandBuffer, currentFrameID, GPUProfiler::Region::HairBone);
+	RecordDrawHairBoneCall(dynamicCommandBuffer);
+	gpuProfiler.EndRegion(dynamicCommandBuffer, currentFrameID, GPUProfiler::Region::HairBone);
+	gpuProfiler.BeginRegion(dynamicCommandBuffer, currentFrameID, GPUProfiler::Region::Sphere);
+	RecordDrawSphereCall(dynamicCommandBuffer);
+	gpuProfiler.EndRegion(dynamicCommandBuffer, currentFrameID, GPUProfiler::Region::Sphere);
+	graphics->EndSecondaryCommandBuffer(dynamicCommandBuffer);
+
+	secondaryCommandBuffers.clear();
+	for (uint32_t i = 0; i < staticChunkCounts[currentFrameID]; i++)
+	{
+		secondaryCommandBuffers.push_back(graphics->GetThreadCommandBuffer(i, currentFrameID));
+	}
+	secondaryCommandBuffers.push_back(dynamicCommandBuffer);
+	vkCmdExecuteCommands(commandBuffer, static_cast<uint32_t>(secondaryCommandBuffers.size()), secondaryCommandBuffers.data());
+}
 
-		Object* WillBeDeleted3 = FindObjectByName(std::string("uniqueVertex") + std::to_string(i));
-		const auto& iter3 = std::find(graphicResources.begin(), graphicResources.end(), WillBeDeleted3);
-		graphicResources.erase(iter3);
-		delete WillBeDeleted3;
+void MyScene::RecordStaticDrawCalls(uint32_t currentFrameID)
+{
+	PROFILE_FUNCTION();
+	// The last chunk also draws the skeleton, so the GPU time of the model and the skeleton can be measured apart.
+		// Chunks are executed in order, so the model region begins in the first chunk and ends in the last one.
+	const uint32_t chunkCount = GetStaticChunkCount();
+	GPUProfiler& gpuProfiler = graphics->GetGPUProfiler();
+	std::vector<uint32_t> chunks(chunkCount);
+	std::iota(chunks.begin(), chunks.end(), 0);
+
+	// Each chunk only touches the command pool of its own thread ID, so no synchronization is needed.
+	std::for_each(std::execution::par, chunks.begin(), chunks.end(), [&](uint32_t chunk)
+		{
+			PROFILE_SCOPE("MyScene::RecordStaticDrawCalls chunk");
+			graphics->ResetThreadCommandPool(chunk, currentFrameID);
+			VkCommandBuffer chunkCommandBuffer = graphics->GetThreadCommandBuffer(chunk, currentFrameID);
+
+			graphics->BeginSecondaryCommandBuffer(chunkCommandBuffer);
+			if (chunk == 0)
+			{
+				gpuProfiler.BeginRegion(chunkCommandBuffer, currentFrameID, GPUProfiler::Region::Model);
+			}
+			RecordDrawModelCalls(chunkCommandBuffer, chunk, GetChunkFirstMesh(chunk, chunkCount), GetChunkFirstMesh(chunk + 1, chunkCount));
+			if (chunk == chunkCount - 1)
+			{
+				gpuProfiler.EndRegion(chunkCommandBuffer, currentFrameID, GPUProfiler::Region::Model);
+				gpuProfiler.BeginRegion(chunkCommandBuffer, currentFrameID, GPUProfiler::Region::Skeleton);
+				RecordDrawSkeletonCall(chunkCommandBuffer);
+				gpuProfiler.EndRegion(chunkCommandBuffer, currentFrameID, GPUProfiler::Region::Skeleton);
+			}
+			graphics->EndSecondaryCommandBuffer(chunkCommandBuffer);
+		});
+
+	staticChunkCounts[currentFrameID] = chunkCount;
+}
+
+uint32_t MyScene::GetStaticChunkCount()
+{
+	return std::clamp(static_cast<uint32_t>(model->GetMeshSize()), 1u, graphics->GetRecordingThreadCount());
+}
+
+int MyScene::GetChunkFirstMesh(uint32_t chunk, uint32_t chunkCount)
+{
+	return static_cast<int>(model->GetMeshSize() * chunk / chunkCount);
+}
+
+void MyScene::FillBufferWithFloats(VkCommandBuffer cmdBuffer, VkBuffer dstBuffer, VkDeviceSize offset, VkDeviceSize size, const float value)
+{
+	vkCmdFillBuffer(cmdBuffer, dstBuffer, offset, size, *(const uint32_t*)&value);
+}
+
+void MyScene::LoadNewModel()
+{
+	PROFILE_FUNCTION();
+	windowHolder->isPathDropped = false;
+	const char* newPath = windowHolder->path;
+
+	const int oldMeshSize = model->GetMeshSize();
+
+	if (model->LoadModel(newPath) == false)
+	{
+		windowHolder->DisplayMessage("Failed model loading!", model->GetErrorString());
+		return;
 	}
 
-	Buffer* skeletonBuffer = dynamic_cast<Buffer*>(FindObjectByName("skeletonBuffer"));
-	skeletonBuffer->ChangeBufferData(sizeof(LineVertex), 2 * model->GetBoneCount(), model->GetBoneDataForDrawing());
+	// In order to clean previous model buffers successfully, 
+			// I should guarantee that deleted buffers are not in use by a command buffer.
+	// Thus, wait until the submitted command buffer completed execution.
+	graphics->DeviceWaitIdle();
+
+	InvalidateCommandBuffers();
+
+	// Cloth patches are cleared with the previous model.
+	for (int i = 0; i < oldMeshSize; i++)
+	{
+		DeleteClothVertexBuffer(i);
+	}
+
+	// Reload textures
+	// Textures of the previous model are released at once, and new ones are streamed while the model is drawn with the emergency texture.
+	for (ResourceHandle<Texture>& handle : diffuseImageHandles)
+	{
+		graphicResources.Remove(handle);
+	}
+	const int textureSize = static_cast<const int>(model->GetDiffuseImagePaths().size());
+	diffuseImageHandles.assign(textureSize, ResourceHandle<Texture>());
+	textureStreamer.Request(model->GetDiffuseImagePaths());
 
+	// Reload model buffers
+	// Arenas keep their buffers if the new model fits in them.
+	const int meshSize = model->GetMeshSize();
+	meshResources.resize(meshSize);
+	graphicResources.Get(meshArenaHandle)->ChangeMeshes(GetMeshData());
+	graphicResources.Get(uniqueVertexArenaHandle)->ChangeMeshes(GetUniqueVertexMeshData());
+	UpdateCullingBoxes();
 
-	UniformBuffer* animationUniformBuffer = dynamic_cast<UniformBuffer*>(FindObjectByName("animationUniformBuffer"));
-	animationUniformBuffer->ChangeBufferData(sizeof(glm::mat4) * model->GetBoneCount(), Graphics::MAX_FRAMES_IN_FLIGHT);
+	Buffer* skeletonBuffer = graphicResources.Get(skeletonBufferHandle);
+	skeletonBuffer->ChangeBufferData(sizeof(LineVertex), 2 * model->GetBoneCount(), model->GetBoneDataForDrawing());
 
-	UniformBuffer* unitBoneUniformBuffer = dynamic_cast<UniformBuffer*>(FindObjectByName("unitBoneUniformBuffer"));
-	unitBoneUniformBuffer->ChangeBufferData(sizeof(glm::mat4) * model->GetBoneCount(), Graphics::MAX_FRAMES_IN_FLIGHT);
+	ReserveUniformRingBuffer();
 
 	MyImGUI::UpdateClickedVertexAddress(nullptr);
 	MyImGUI::UpdateAnimationNameList();
@@ -293,68 +506,13 @@ void MyScene::LoadNewModel()
 
 	InitUniformBufferData();
 
-	// If loaded data is waxing model(do not have texture data),
-	if (textureSize <= 0)
-	{
-		if (meshSize > oldMeshSize)
-		{
-			DescriptorSet* waxDes = dynamic_cast<DescriptorSet*>(FindObjectByName("waxDescriptor"));
-			waxDes->ChangeDescriptorSet(Graphics::MAX_FRAMES_IN_FLIGHT * meshSize, {
-					{0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT, nullptr},
-					{1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT, nullptr}
-				});
-			DescriptorSet* blendingDes = dynamic_cast<DescriptorSet*>(FindObjectByName("blendingWeightDescriptor"));
-			blendingDes->ChangeDescriptorSet(Graphics::MAX_FRAMES_IN_FLIGHT * meshSize, {
-				{0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT, nullptr},
-				{1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT, nullptr}
-				});
-
-			DescriptorSet* hairBoneDescriptor = dynamic_cast<DescriptorSet*>(FindObjectByName("hairBoneDescriptor"));
-			hairBoneDescriptor->ChangeDescriptorSet(Graphics::MAX_FRAMES_IN_FLIGHT,
-				{
-			{0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT, nullptr},
-			{1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT, nullptr},
-			{2, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT, nullptr},
-			{3, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT, nullptr}
-				});
-		}
-		WriteWaxDescriptorSet();
-		WriteBlendingWeightDescriptorSet();
-		WriteHairBoneDescriptorSet();
-
-		return;
-	}
-
-	// It is an old code when there was no wax descriptor sets.
-	// Currently, Create descriptor sets at everytime reloads, which might not be good. (?)
-	// Solve two different functions, merge together and recover this functionality back.
-	if (meshSize > oldMeshSize || textureSize > oldTextureSize)
-	{
-		DescriptorSet* des = dynamic_cast<DescriptorSet*>(FindObjectByName("descriptor"));
-		des->ChangeDescriptorSet(Graphics::MAX_FRAMES_IN_FLIGHT * meshSize, {
-		{0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT, nullptr},
-		{1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT, nullptr},
-		{2, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr}
-			});
-		DescriptorSet* blendingDes = dynamic_cast<DescriptorSet*>(FindObjectByName("blendingWeightDescriptor"));
-		blendingDes->ChangeDescriptorSet(Graphics::MAX_FRAMES_IN_FLIGHT * meshSize, {
-			{0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT, nullptr},
-			{1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT, nullptr}
-			});
-
-		DescriptorSet* hairBoneDescriptor = dynamic_cast<DescriptorSet*>(FindObjectByName("hairBoneDescriptor"));
-		hairBoneDescriptor->ChangeDescriptorSet(Graphics::MAX_FRAMES_IN_FLIGHT,
-			{
-		{0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT, nullptr},
-		{1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT, nullptr},
-		{2, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT, nullptr},
-		{3, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT, nullptr}
-			});
-	}
+	// Descriptor sets do not depend on the number of meshes or textures, so they are only written again for the new ring buffer and bone count.
 	WriteDescriptorSet();
+	WriteTextureTable();
+	WriteWaxDescriptorSet();
 	WriteBlendingWeightDescriptorSet();
 	WriteHairBoneDescriptorSet();
-
+	WriteCullingDescriptorSet();
 }
 
 void MyScene::InitGUI()
@@ -363,6 +521,8 @@ void MyScene::InitGUI()
 	MyImGUI::SendSkeletonInfo(&showSkeletonFlag, &blendingWeightMode, &selectedBone, &cleanBoneFlag);
 	MyImGUI::SendAnimationInfo(&animationTimer, &bindPoseFlag, &isUpdateAnimationTimer);
 	MyImGUI::SendConfigInfo(&mouseSensitivity);
+	MyImGUI::SendMemoryInfo(&graphics->GetMemoryAllocator());
+	MyImGUI::SendGPUProfilerInfo(&graphics->GetGPUProfiler());
 
 	glm::vec3 min;
 	glm::vec3 max;
@@ -373,6 +533,7 @@ void MyScene::InitGUI()
 
 	MyImGUI::SendHairBoneInfo(hairBone0, newBoneName, boneNameContainerSize, &applyingBone, reinterpret_cast<float*>(&sphereTrans), minF, maxF, &sphereRadius, &boneIDIndex, reinterpret_cast<float*>(&userInputBoneWeights), &flagChangeBoneIndexInSphere);
 	MyImGUI::SendPhysicsInfo(&runRealtime, &proceedFrame);
+	MyImGUI::SendClothInfo(&flagMakeClothInSphere);
 
 	MyImGUI::UpdateAnimationNameList();
 	MyImGUI::UpdateBoneNameList();
@@ -381,6 +542,7 @@ void MyScene::InitGUI()
 
 void MyScene::UpdateTimer(float dt)
 {
+	PROFILE_FUNCTION();
 	if (isUpdateAnimationTimer)
 	{
 		animationTimer += dt;
@@ -392,62 +554,92 @@ void MyScene::UpdateTimer(float dt)
 	}
 }
 
-void MyScene::RecordDrawModelCalls(VkCommandBuffer commandBuffer)
+void MyScene::RecordDrawModelCalls(VkCommandBuffer commandBuffer, uint32_t chunk, int firstMesh, int lastMesh)
 {
+	// If show model flag is on, display model and blending weight model
+	if (showModel == false)
+	{
+		return;
+	}
 
-	const int meshSize = model->GetMeshSize();
-	for (int i = 0; i < meshSize; i++)
+	// Every mesh uses the same pipeline and descriptor sets, so they are bound once.
+	const bool isTextured = (blendingWeightMode == false) && (model->GetDiffuseImagePaths().size() > 0);
+	Pipeline* pipeline;
+	DescriptorSet* descriptorSet;
+	if (blendingWeightMode == true)
+	{
+		pipeline = graphicResources.Get(blendingWeightPipelineHandle);
+		descriptorSet = graphicResources.Get(blendingWeightDescriptorHandle);
+		RecordPushConstants(commandBuffer, pipeline->GetPipelineLayout(), VK_SHADER_STAGE_VERTEX_BIT, &selectedBone, sizeof(int));
+	}
+	else if (isTextured == false)
+	{
+		pipeline = graphicResources.Get(waxPipelineHandle);
+		descriptorSet = graphicResources.Get(waxDescriptorHandle);
+	}
+	else
 	{
-		Buffer* vertexBuffer = dynamic_cast<Buffer*>(FindObjectByName(std::string("vertex") + std::to_string(i)));
-		Buffer* indexBuffer = dynamic_cast<Buffer*>(FindObjectByName(std::string("index") + std::to_string(i)));
-		VkBuffer VB[] = { vertexBuffer->GetBuffer() };
-		VkDeviceSize offsets[] = { 0 };
-		vkCmdBindVertexBuffers(commandBuffer, 0, 1, VB, offsets);
-		vkCmdBindIndexBuffer(commandBuffer, indexBuffer->GetBuffer(), 0, VK_INDEX_TYPE_UINT32);
+		pipeline = graphicResources.Get(pipelineHandle);
+		descriptorSet = graphicResources.Get(descriptorHandle);
+	}
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline->GetPipeline());
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline->GetPipelineLayout(), 0, 1, descriptorSet->GetDescriptorSetPtr(0), MODEL_DYNAMIC_OFFSET_COUNT, uniformOffsets.data());
+	if (isTextured)
+	{
+		BindlessTextureTable* textureTable = graphicResources.Get(textureTableHandle);
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline->GetPipelineLayout(), 1, 1, textureTable->GetDescriptorSetPtr(), 0, nullptr);
+	}
 
-		// If show model flag is on, display model and blending weight model
-		if (showModel == true)
-		{
-			if (blendingWeightMode == true)
-			{
-				Pipeline* bwPipeline = dynamic_cast<Pipeline*>(FindObjectByName("blendingWeightPipeline"));
-				DescriptorSet* bwDes = dynamic_cast<DescriptorSet*>(FindObjectByName("blendingWeightDescriptor"));
-				RecordPushConstants(commandBuffer, bwPipeline->GetPipelineLayout(), VK_SHADER_STAGE_VERTEX_BIT, &selectedBone, sizeof(int));
+	// Meshes share the arenas, so the buffers are bound once and the whole range is drawn by the commands of this frame.
+	// Visible commands of the chunk are compacted to its first mesh, and their count is written by the culling pass.
+	MeshArena* meshArena = graphicResources.Get(meshArenaHandle);
+	MeshCuller* meshCuller = graphicResources.Get(meshCullerHandle);
+	const uint32_t currentFrameID = graphics->GetCurrentFrameID();
+	VkBuffer VB[] = { meshArena->GetVertexBuffer() };
+	VkDeviceSize offsets[] = { 0 };
+	vkCmdBindVertexBuffers(commandBuffer, 0, 1, VB, offsets);
+	vkCmdBindIndexBuffer(commandBuffer, meshArena->GetIndexBuffer(), 0, VK_INDEX_TYPE_UINT32);
+	vkCmdDrawIndexedIndirectCount(commandBuffer, meshCuller->GetDrawBuffer(currentFrameID), sizeof(VkDrawIndexedIndirectCommand) * firstMesh,
+		meshCuller->GetDrawCountBuffer(currentFrameID), meshCuller->GetDrawCountOffset(chunk), static_cast<uint32_t>(lastMesh - firstMesh), sizeof(VkDrawIndexedIndirectCommand));
 
-				vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, bwPipeline->GetPipeline());
-				vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, bwPipeline->GetPipelineLayout(), 0, 1, bwDes->GetDescriptorSetPtr(i * Graphics::MAX_FRAMES_IN_FLIGHT + graphics->GetCurrentFrameID()), 0, nullptr);
-				vkCmdDrawIndexed(commandBuffer, indexBuffer->GetBufferDataSize(), 1, 0, 0, 0);
-			}
-			else
-			{
-				if (model->GetDiffuseImagePaths().size() <= 0)
-				{
-					Pipeline* wPipeline = dynamic_cast<Pipeline*>(FindObjectByName("waxPipeline"));
-					DescriptorSet* wDes = dynamic_cast<DescriptorSet*>(FindObjectByName("waxDescriptor"));
-					vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, wPipeline->GetPipeline());
-					vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, wPipeline->GetPipelineLayout(), 0, 1, wDes->GetDescriptorSetPtr(i * Graphics::MAX_FRAMES_IN_FLIGHT + graphics->GetCurrentFrameID()), 0, nullptr);
-					vkCmdDrawIndexed(commandBuffer, indexBuffer->GetBufferDataSize(), 1, 0, 0, 0);
-				}
-				else
-				{
-					Pipeline* pipeline = dynamic_cast<Pipeline*>(FindObjectByName("pipeline"));
-					DescriptorSet* des = dynamic_cast<DescriptorSet*>(FindObjectByName("descriptor"));
-					vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline->GetPipeline());
-					vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline->GetPipelineLayout(), 0, 1, des->GetDescriptorSetPtr(i * Graphics::MAX_FRAMES_IN_FLIGHT + graphics->GetCurrentFrameID()), 0, nullptr);
-					vkCmdDrawIndexed(commandBuffer, indexBuffer->GetBufferDataSize(), 1, 0, 0, 0);
-				}
-			}
+	// Mesh with cloth reads vertices from the dynamic vertex buffer of this frame, and indices from the arena.
+	for (int i = firstMesh; i < lastMesh; i++)
+	{
+		UniformBuffer* clothBuffer = graphicResources.Get(meshResources[i].clothVertex);
+		if (clothBuffer == nullptr)
+		{
+			continue;
 		}
+		VkBuffer clothVB[] = { clothBuffer->GetBuffer(currentFrameID) };
+		vkCmdBindVertexBuffers(commandBuffer, 0, 1, clothVB, offsets);
+		const MeshRange& range = meshArena->GetMeshRange(i);
+		vkCmdDrawIndexed(commandBuffer, range.indexCount, 1, range.firstIndex, 0, GetMaterialIndex(i));
+	}
+}
 
-		// No matter showing model or not, display vertex points if and only if vertex points mode is on.
-		if (vertexPointsMode == true && ((selectedMesh == i) || selectedMesh == meshSize))
-		{
-			Buffer* uniqueBuffer = dynamic_cast<Buffer*>(FindObjectByName(std::string("uniqueVertex") + std::to_string(i)));
-			VkBuffer uniqueVB[] = { uniqueBuffer->GetBuffer() };
-			vkCmdBindVertexBuffers(commandBuffer, 0, 1, uniqueVB, offsets);
-			Pipeline* vPipeline = dynamic_cast<Pipeline*>(FindObjectByName("vertexPipeline"));
-			DescriptorSet* des = dynamic_cast<DescriptorSet*>(FindObjectByName("blendingWeightDescriptor"));
+void MyScene::RecordDrawVertexPointsCalls(VkCommandBuffer commandBuffer)
+{
+	// No matter showing model or not, display vertex points if and only if vertex points mode is on.
+	if (vertexPointsMode == false)
+	{
+		return;
+	}
 
+	// Unique vertices of every mesh share one vertex buffer, so the pipeline and the buffer are bound once.
+	Pipeline* vPipeline = graphicResources.Get(vertexPipelineHandle);
+	DescriptorSet* des = graphicResources.Get(blendingWeightDescriptorHandle);
+	MeshArena* uniqueVertexArena = graphicResources.Get(uniqueVertexArenaHandle);
+	VkBuffer uniqueVB[] = { uniqueVertexArena->GetVertexBuffer() };
+	VkDeviceSize offsets[] = { 0 };
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, vPipeline->GetPipeline());
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, vPipeline->GetPipelineLayout(), 0, 1, des->GetDescriptorSetPtr(0), MODEL_DYNAMIC_OFFSET_COUNT, uniformOffsets.data());
+	vkCmdBindVertexBuffers(commandBuffer, 0, 1, uniqueVB, offsets);
+
+	const int meshSize = model->GetMeshSize();
+	for (int i = 0; i < meshSize; i++)
+	{
+		if ((selectedMesh == i) || selectedMesh == meshSize)
+		{
 			VertexPipelinePushConstants tmp;
 			tmp.pointSize = pointSize;
 			tmp.vertexID = GetSelectedVertexID(selectedMesh);
@@ -469,14 +661,90 @@ void MyScene::RecordDrawModelCalls(VkCommandBuffer commandBuffer)
 				}
 			}
 
+			// gl_VertexIndex starts from the first vertex of the mesh in the arena.
+			const MeshRange& range = uniqueVertexArena->GetMeshRange(i);
+			if (tmp.vertexID != -1)
+			{
+				tmp.vertexID += static_cast<int>(range.firstVertex);
+			}
+
 			RecordPushConstants(commandBuffer, vPipeline->GetPipelineLayout(), VK_SHADER_STAGE_VERTEX_BIT, &tmp, sizeof(VertexPipelinePushConstants));
-			vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, vPipeline->GetPipeline());
-			vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, vPipeline->GetPipelineLayout(), 0, 1, des->GetDescriptorSetPtr(i * Graphics::MAX_FRAMES_IN_FLIGHT + graphics->GetCurrentFrameID()), 0, nullptr);
-			vkCmdDraw(commandBuffer, uniqueBuffer->GetBufferDataSize(), 1, 0, 0);
+			vkCmdDraw(commandBuffer, range.vertexCount, 1, range.firstVertex, 0);
 		}
 	}
 }
 
+std::vector<MeshData> MyScene::GetMeshData()
+{
+	const int meshSize = model->GetMeshSize();
+	std::vector<MeshData> meshes(meshSize);
+	for (int i = 0; i < meshSize; i++)
+	{
+		meshes[i] = { model->GetVertexData(i), static_cast<uint32_t>(model->GetVertexCount(i)), static_cast<const uint32_t*>(model->GetIndexData(i)), static_cast<uint32_t>(model->GetIndexCount(i)) };
+	}
+	return meshes;
+}
+
+std::vector<MeshData> MyScene::GetUniqueVertexMeshData()
+{
+	const int meshSize = model->GetMeshSize();
+	std::vector<MeshData> meshes(meshSize);
+	for (int i = 0; i < meshSize; i++)
+	{
+		meshes[i] = { model->GetUniqueVertexData(i), static_cast<uint32_t>(model->GetUniqueVertexCount(i)), nullptr, 0 };
+	}
+	return meshes;
+}
+
+void MyScene::UpdateIndirectCommands(uint32_t currentFrameID)
+{
+	PROFILE_FUNCTION();
+	MeshArena* meshArena = graphicResources.Get(meshArenaHandle);
+	const int meshSize = model->GetMeshSize();
+	indirectCommands.resize(meshSize);
+	for (int i = 0; i < meshSize; i++)
+	{
+		const MeshRange& range = meshArena->GetMeshRange(i);
+		VkDrawIndexedIndirectCommand& command = indirectCommands[i];
+		command.indexCount = range.indexCount;
+		command.instanceCount = (graphicResources.Get(meshResources[i].clothVertex) == nullptr) ? 1 : 0;
+		command.firstIndex = range.firstIndex;
+		command.vertexOffset = static_cast<int32_t>(range.firstVertex);
+		command.firstInstance = GetMaterialIndex(i);
+	}
+
+	const uint32_t chunkCount = GetStaticChunkCount();
+	chunkFirstDraws.resize(chunkCount);
+	for (uint32_t i = 0; i < chunkCount; i++)
+	{
+		chunkFirstDraws[i] = static_cast<uint32_t>(GetChunkFirstMesh(i, chunkCount));
+	}
+	graphicResources.Get(meshCullerHandle)->UpdateDraws(currentFrameID, indirectCommands, chunkFirstDraws);
+}
+
+std::vector<std::vector<CullingBox>> MyScene::GetCullingBoxes()
+{
+	const int meshSize = model->GetMeshSize();
+	std::vector<std::vector<CullingBox>> meshBoxes(meshSize);
+	for (int i = 0; i < meshSize; i++)
+	{
+		meshBoxes[i] = MeshCuller::CalculateBoneBoxes(static_cast<const Vertex*>(model->GetVertexData(i)), model->GetVertexCount(i), model->GetBoneCount());
+	}
+	return meshBoxes;
+}
+
+void MyScene::UpdateCullingBoxes()
+{
+	// Boxes of meshes can be added or removed, so every box is uploaded again.
+	graphicResources.Get(meshCullerHandle)->ChangeMeshes(GetCullingBoxes());
+}
+
+void MyScene::WriteCullingDescriptorSet()
+{
+	UniformRingBuffer* uniformRing = graphicResources.Get(uniformRingHandle);
+	graphicResources.Get(meshCullerHandle)->WriteUniformBuffer(uniformRing->GetBuffer(), sizeof(UniformBufferObject), GetAnimationBlockSize());
+}
+
 void MyScene::InitUniformBufferData()
 {
 	uniformData.model = model->CalculateAdjustBoundingBoxMatrix();
@@ -489,6 +757,7 @@ void MyScene::InitUniformBufferData()
 
 void MyScene::UpdateUniformBuffer(uint32_t currentFrameID)
 {
+	PROFILE_FUNCTION();
 	// Update camera if and only if the user does not control ImGui window.
 	if (MyImGUI::IsMouseOnImGUIWindow() == false)
 	{
@@ -558,13 +827,8 @@ void MyScene::UpdateUniformBuffer(uint32_t currentFrameID)
 		uniformData.proj[1][1] *= -1;
 	}
 
-	UniformBuffer* uniformBuffer = dynamic_cast<UniformBuffer*>(FindObjectByName("uniformBuffer"));
-
-
-	void* data;
-	vkMapMemory(graphics->GetDevice(), uniformBuffer->GetBufferMemory(currentFrameID), 0, uniformBuffer->GetBufferSize(), 0, &data);
-	memcpy(data, &uniformData, uniformBuffer->GetBufferSize());
-	vkUnmapMemory(graphics->GetDevice(), uniformBuffer->GetBufferMemory(currentFrameID));
+	UniformRingBuffer* uniformRing = graphicResources.Get(uniformRingHandle);
+	uniformOffsets[SCENE_BLOCK] = uniformRing->Allocate(sizeof(UniformBufferObject), &uniformData);
 }
 
 glm::vec3 MyScene::GetMousePositionInWorldSpace(float targetZ)
@@ -598,92 +862,88 @@ glm::vec3 MyScene::GetProjectionVectorFromCamera()
 
 void MyScene::WriteDescriptorSet()
 {
-	DescriptorSet* descriptorSet = dynamic_cast<DescriptorSet*>(FindObjectByName("descriptor"));
-	UniformBuffer* uniformBuffer = dynamic_cast<UniformBuffer*>(FindObjectByName("uniformBuffer"));
-	UniformBuffer* animationUniformBuffer = dynamic_cast<UniformBuffer*>(FindObjectByName("animationUniformBuffer"));
-	Texture* emergencyTexture = dynamic_cast<Texture*>(FindObjectByName("EmergencyTexture"));
+	// Updating descriptor sets invalidates command buffers which bound them.
+	InvalidateCommandBuffers();
+
+	DescriptorSet* descriptorSet = graphicResources.Get(descriptorHandle);
+	UniformRingBuffer* uniformRing = graphicResources.Get(uniformRingHandle);
+
+	// Every frame shares the descriptor set. Dynamic offsets select the region of the frame in the ring buffer.
+		// Every binding is written by one call through the update template.
+	descriptorSet->Write(0, {
+		DescriptorSet::MakeBufferInfo(uniformRing->GetBuffer(), sizeof(UniformBufferObject)),
+		DescriptorSet::MakeBufferInfo(uniformRing->GetBuffer(), GetAnimationBlockSize())
+		});
+}
+
+void MyScene::WriteTextureTable()
+{
+	BindlessTextureTable* textureTable = graphicResources.Get(textureTableHandle);
+	Texture* emergencyTexture = graphicResources.Get(emergencyTextureHandle);
+	textureTable->Write(EMERGENCY_TEXTURE_SLOT, emergencyTexture->GetImageView(), graphics->GetTextureSampler());
 
-	const std::vector<std::string>& paths = model->GetDiffuseImagePaths();
-	std::vector<Texture*> textures(paths.size(), nullptr);
-	for (int i = 0; i < paths.size(); i++)
+	for (const uint32_t slot : diffuseSlots)
 	{
-		if (Texture* image = dynamic_cast<Texture*>(FindObjectByName(std::string("diffuseImage") + std::to_string(i)));
-			image != nullptr)
+		if (slot != EMERGENCY_TEXTURE_SLOT)
 		{
-			textures[i] = image;
+			textureTable->FreeSlot(slot);
 		}
 	}
+	diffuseSlots.assign(diffuseImageHandles.size(), EMERGENCY_TEXTURE_SLOT);
+}
 
-	for (int i = 0; i < model->GetMeshSize(); i++)
+uint32_t MyScene::GetMaterialIndex(int mesh)
+{
+	if (mesh < 0 || static_cast<size_t>(mesh) >= diffuseSlots.size())
 	{
-		for (int j = 0; j < Graphics::MAX_FRAMES_IN_FLIGHT; j++)
-		{
-			descriptorSet->Write(i * Graphics::MAX_FRAMES_IN_FLIGHT + j, 0, uniformBuffer->GetBuffer(j), uniformBuffer->GetBufferSize());
-			descriptorSet->Write(i * Graphics::MAX_FRAMES_IN_FLIGHT + j, 1, animationUniformBuffer->GetBuffer(j), animationUniformBuffer->GetBufferSize());
-			if (i < paths.size())
-			{
-				descriptorSet->Write(i * Graphics::MAX_FRAMES_IN_FLIGHT + j, 2, textures[i]->GetImageView(), graphics->GetTextureSampler());
-			}
-			else
-			{
-				descriptorSet->Write(i * Graphics::MAX_FRAMES_IN_FLIGHT + j, 2, emergencyTexture->GetImageView(), graphics->GetTextureSampler());
-			}
-		}
+		return EMERGENCY_TEXTURE_SLOT;
 	}
+	return diffuseSlots[mesh];
 }
 
 void MyScene::WriteWaxDescriptorSet()
 {
-	DescriptorSet* descriptorSet = dynamic_cast<DescriptorSet*>(FindObjectByName("waxDescriptor"));
-	UniformBuffer* uniformBuffer = dynamic_cast<UniformBuffer*>(FindObjectByName("uniformBuffer"));
-	UniformBuffer* animationUniformBuffer = dynamic_cast<UniformBuffer*>(FindObjectByName("animationUniformBuffer"));
-	for (int i = 0; i < model->GetMeshSize(); i++)
-	{
-		for (int j = 0; j < Graphics::MAX_FRAMES_IN_FLIGHT; j++)
-		{
-			descriptorSet->Write(i * Graphics::MAX_FRAMES_IN_FLIGHT + j, 0, uniformBuffer->GetBuffer(j), uniformBuffer->GetBufferSize());
-			descriptorSet->Write(i * Graphics::MAX_FRAMES_IN_FLIGHT + j, 1, animationUniformBuffer->GetBuffer(j), animationUniformBuffer->GetBufferSize());
-		}
-	}
+	InvalidateCommandBuffers();
+
+	DescriptorSet* descriptorSet = graphicResources.Get(waxDescriptorHandle);
+	UniformRingBuffer* uniformRing = graphicResources.Get(uniformRingHandle);
+	descriptorSet->Write(0, {
+		DescriptorSet::MakeBufferInfo(uniformRing->GetBuffer(), sizeof(UniformBufferObject)),
+		DescriptorSet::MakeBufferInfo(uniformRing->GetBuffer(), GetAnimationBlockSize())
+		});
 }
 
 void MyScene::UpdateAnimationUniformBuffer(uint32_t currentFrameID)
 {
+	PROFILE_FUNCTION();
 	if (model->GetBoneCount() <= 0)
 	{
+		// Nothing reads bone blocks, but bound dynamic offsets should still be in the ring buffer.
+		uniformOffsets[ANIMATION_BLOCK] = uniformOffsets[SCENE_BLOCK];
+		uniformOffsets[UNIT_BONE_BLOCK] = uniformOffsets[SCENE_BLOCK];
 		return;
 	}
 
 	std::vector<glm::mat4> animationBufferData = model->GetAnimationData();
 
-
-	UniformBuffer* animationUniformBuffer = dynamic_cast<UniformBuffer*>(FindObjectByName("animationUniformBuffer"));
-	void* data;
-	vkMapMemory(graphics->GetDevice(), animationUniformBuffer->GetBufferMemory(currentFrameID), 0, animationUniformBuffer->GetBufferSize(), 0, &data);
-	memcpy(data, animationBufferData.data(), animationUniformBuffer->GetBufferSize());
-	vkUnmapMemory(graphics->GetDevice(), animationUniformBuffer->GetBufferMemory(currentFrameID));
-
+	UniformRingBuffer* uniformRing = graphicResources.Get(uniformRingHandle);
+	const VkDeviceSize boneBlockSize = sizeof(glm::mat4) * model->GetBoneCount();
+	uniformOffsets[ANIMATION_BLOCK] = uniformRing->Allocate(boneBlockSize, animationBufferData.data());
 
 	model->GetUnitBoneData(animationBufferData);
-	UniformBuffer* unitBoneUniformBuffer = dynamic_cast<UniformBuffer*>(FindObjectByName("unitBoneUniformBuffer"));
-	vkMapMemory(graphics->GetDevice(), unitBoneUniformBuffer->GetBufferMemory(currentFrameID), 0, unitBoneUniformBuffer->GetBufferSize(), 0, &data);
-	memcpy(data, animationBufferData.data(), unitBoneUniformBuffer->GetBufferSize());
-	vkUnmapMemory(graphics->GetDevice(), unitBoneUniformBuffer->GetBufferMemory(currentFrameID));
+	uniformOffsets[UNIT_BONE_BLOCK] = uniformRing->Allocate(boneBlockSize, animationBufferData.data());
 }
 
 void MyScene::WriteBlendingWeightDescriptorSet()
 {
-	DescriptorSet* descriptorSet = dynamic_cast<DescriptorSet*>(FindObjectByName("blendingWeightDescriptor"));
-	UniformBuffer* uniformBuffer = dynamic_cast<UniformBuffer*>(FindObjectByName("uniformBuffer"));
-	UniformBuffer* animationUniformBuffer = dynamic_cast<UniformBuffer*>(FindObjectByName("animationUniformBuffer"));
-	for (int i = 0; i < model->GetMeshSize(); i++)
-	{
-		for (int j = 0; j < Graphics::MAX_FRAMES_IN_FLIGHT; j++)
-		{
-			descriptorSet->Write(i * Graphics::MAX_FRAMES_IN_FLIGHT + j, 0, uniformBuffer->GetBuffer(j), uniformBuffer->GetBufferSize());
-			descriptorSet->Write(i * Graphics::MAX_FRAMES_IN_FLIGHT + j, 1, animationUniformBuffer->GetBuffer(j), animationUniformBuffer->GetBufferSize());
-		}
-	}
+	InvalidateCommandBuffers();
+
+	DescriptorSet* descriptorSet = graphicResources.Get(blendingWeightDescriptorHandle);
+	UniformRingBuffer* uniformRing = graphicResources.Get(uniformRingHandle);
+	descriptorSet->Write(0, {
+		DescriptorSet::MakeBufferInfo(uniformRing->GetBuffer(), sizeof(UniformBufferObject)),
+		DescriptorSet::MakeBufferInfo(uniformRing->GetBuffer(), GetAnimationBlockSize())
+		});
 }
 
 void MyScene::RecordPushConstants(VkCommandBuffer commandBuffer, VkPipelineLayout layout, VkShaderStageFlagBits targetStage, void* data, uint32_t dataSize)
@@ -698,19 +958,17 @@ void MyScene::RecordPushConstants(VkCommandBuffer commandBuffer, VkPipelineLayou
 
 void MyScene::WriteHairBoneDescriptorSet()
 {
-	DescriptorSet* hairBoneDescriptor = dynamic_cast<DescriptorSet*>(FindObjectByName("hairBoneDescriptor"));
-	UniformBuffer* uniformBuffer = dynamic_cast<UniformBuffer*>(FindObjectByName("uniformBuffer"));
-	UniformBuffer* animationUniformBuffer = dynamic_cast<UniformBuffer*>(FindObjectByName("animationUniformBuffer"));
-	UniformBuffer* unitBoneUniformBuffer = dynamic_cast<UniformBuffer*>(FindObjectByName("unitBoneUniformBuffer"));
-	UniformBuffer* uniformBuffer2 = dynamic_cast<UniformBuffer*>(FindObjectByName("HairBoneUniform"));
+	InvalidateCommandBuffers();
 
-	for (int j = 0; j < Graphics::MAX_FRAMES_IN_FLIGHT; j++)
-	{
-		hairBoneDescriptor->Write(j, 0, uniformBuffer->GetBuffer(j), uniformBuffer->GetBufferSize());
-		hairBoneDescriptor->Write(j, 1, animationUniformBuffer->GetBuffer(j), animationUniformBuffer->GetBufferSize());
-		hairBoneDescriptor->Write(j, 2, unitBoneUniformBuffer->GetBuffer(j), unitBoneUniformBuffer->GetBufferSize());
-		hairBoneDescriptor->Write(j, 3, uniformBuffer2->GetBuffer(j), uniformBuffer2->GetBufferSize());
-	}
+	DescriptorSet* hairBoneDescriptor = graphicResources.Get(hairBoneDescriptorHandle);
+	UniformRingBuffer* uniformRing = graphicResources.Get(uniformRingHandle);
+
+	hairBoneDescriptor->Write(0, {
+		DescriptorSet::MakeBufferInfo(uniformRing->GetBuffer(), sizeof(UniformBufferObject)),
+		DescriptorSet::MakeBufferInfo(uniformRing->GetBuffer(), GetAnimationBlockSize()),
+		DescriptorSet::MakeBufferInfo(uniformRing->GetBuffer(), GetAnimationBlockSize()),
+		DescriptorSet::MakeBufferInfo(uniformRing->GetBuffer(), hairBone0->GetHairBoneMaxDataSize())
+		});
 }
 
 void MyScene::RecordDrawHairBoneCall(VkCommandBuffer commandBuffer)
@@ -719,44 +977,58 @@ void MyScene::RecordDrawHairBoneCall(VkCommandBuffer commandBuffer)
 	{
 		return;
 	}
-	Buffer* vertexBuffer = dynamic_cast<Buffer*>(FindObjectByName(std::string("HairBone")));
+	Buffer* vertexBuffer = graphicResources.Get(hairBoneBufferHandle);
 	VkBuffer VB[] = { vertexBuffer->GetBuffer() };
 	VkDeviceSize offsets[] = { 0 };
-	Pipeline* pipeline = dynamic_cast<Pipeline*>(FindObjectByName("hairBonePipeline"));
-	DescriptorSet* des = dynamic_cast<DescriptorSet*>(FindObjectByName("hairBoneDescriptor"));
+	Pipeline* pipeline = graphicResources.Get(hairBonePipelineHandle);
+	DescriptorSet* des = graphicResources.Get(hairBoneDescriptorHandle);
 	vkCmdBindVertexBuffers(commandBuffer, 0, 1, VB, offsets);
 	HairBonePushConstants hpc{ pointSize, selectedBone };
 	RecordPushConstants(commandBuffer, pipeline->GetPipelineLayout(), VK_SHADER_STAGE_VERTEX_BIT, &hpc, sizeof(HairBonePushConstants));
 	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline->GetPipeline());
-	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline->GetPipelineLayout(), 0, 1, des->GetDescriptorSetPtr(graphics->GetCurrentFrameID()), 0, nullptr);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline->GetPipelineLayout(), 0, 1, des->GetDescriptorSetPtr(0), UNIFORM_BLOCK_COUNT, uniformOffsets.data());
 	vkCmdDraw(commandBuffer, 1, hairBone0->GetBoneSize(), 0, 0);
 }
 
 void MyScene::UpdateHairBoneBuffer(uint32_t currentFrameID)
 {
+	PROFILE_FUNCTION();
 	if (selectedMesh < 0 || selectedMesh >= model->GetMeshSize() || hairBone0->GetBoneSize() <= 0)
 	{
+		// Same as bone blocks, keep the dynamic offset in the ring buffer.
+		uniformOffsets[HAIR_BONE_BLOCK] = uniformOffsets[SCENE_BLOCK];
 		return;
 	}
-	UniformBuffer* uniformBuffer = dynamic_cast<UniformBuffer*>(FindObjectByName("HairBoneUniform"));
-	void* data;
-	vkMapMemory(graphics->GetDevice(), uniformBuffer->GetBufferMemory(currentFrameID), 0, hairBone0->GetHairBoneMaxDataSize(), 0, &data);
-	memcpy(data, hairBone0->GetBoneData(), hairBone0->GetHairBoneMaxDataSize());
-	vkUnmapMemory(graphics->GetDevice(), uniformBuffer->GetBufferMemory(currentFrameID));
+	UniformRingBuffer* uniformRing = graphicResources.Get(uniformRingHandle);
+	uniformOffsets[HAIR_BONE_BLOCK] = uniformRing->Allocate(hairBone0->GetHairBoneMaxDataSize(), hairBone0->GetBoneData());
 }
 
-Object* MyScene::FindObjectByName(std::string name)
+VkDeviceSize MyScene::GetAnimationBlockSize()
 {
-	for (Object* obj : graphicResources)
+	// Descriptor range cannot be 0 even if the model has no bone.
+	return sizeof(glm::mat4) * std::max<size_t>(model->GetBoneCount(), 1);
+}
+
+VkDeviceSize MyScene::GetUniformFrameSize()
+{
+	// Each block can be padded up to the dynamic offset alignment.
+	const VkDeviceSize alignment = graphics->GetPhysicalDeviceProperties().limits.minUniformBufferOffsetAlignment;
+	return sizeof(UniformBufferObject) + 2 * GetAnimationBlockSize() + hairBone0->GetHairBoneMaxDataSize() + UNIFORM_BLOCK_COUNT * alignment;
+}
+
+void MyScene::ReserveUniformRingBuffer()
+{
+	// Callers write the other descriptor sets again, since ranges of bone blocks are changed as well.
+	UniformRingBuffer* uniformRing = graphicResources.Get(uniformRingHandle);
+	if (uniformRing->Reserve(GetUniformFrameSize()) == true)
 	{
-		if (obj->GetName().compare(name) == 0)
-			return obj;
+		WriteSphereDescriptorSet();
 	}
-	return nullptr;
 }
 
 void MyScene::ModifyBone()
 {
+	PROFILE_FUNCTION();
 	if (applyingBone == false)
 	{
 		return;
@@ -785,30 +1057,26 @@ void MyScene::ModifyBone()
 
 	graphics->DeviceWaitIdle();
 
-	Buffer* skeleton = dynamic_cast<Buffer*>(FindObjectByName("skeletonBuffer"));
+	Buffer* skeleton = graphicResources.Get(skeletonBufferHandle);
 	skeleton->ChangeBufferData(sizeof(LineVertex), 2 * model->GetBoneCount(), model->GetBoneDataForDrawing());
 
-	UniformBuffer* animation = dynamic_cast<UniformBuffer*>(FindObjectByName("animationUniformBuffer"));
-	animation->ChangeBufferData(sizeof(glm::mat4) * model->GetBoneCount(), Graphics::MAX_FRAMES_IN_FLIGHT);
-
-	UniformBuffer* unitBoneUniformBuffer = dynamic_cast<UniformBuffer*>(FindObjectByName("unitBoneUniformBuffer"));
-	unitBoneUniformBuffer->ChangeBufferData(sizeof(glm::mat4) * model->GetBoneCount(), Graphics::MAX_FRAMES_IN_FLIGHT);
+	ReserveUniformRingBuffer();
 	WriteDescriptorSet();
 	WriteWaxDescriptorSet();
 	WriteBlendingWeightDescriptorSet();
 	WriteHairBoneDescriptorSet();
+	WriteCullingDescriptorSet();
 
 	hairBone0->SetBoneData(0, glm::vec4(0.f, 0.f, 0.f, 1.f));
 }
 
 void MyScene::WriteSphereDescriptorSet()
 {
-	DescriptorSet* descriptorSet = dynamic_cast<DescriptorSet*>(FindObjectByName("sphereDescriptor"));
-	UniformBuffer* uniformBuffer = dynamic_cast<UniformBuffer*>(FindObjectByName("uniformBuffer"));
-	for (int j = 0; j < Graphics::MAX_FRAMES_IN_FLIGHT; j++)
-	{
-		descriptorSet->Write(j, 0, uniformBuffer->GetBuffer(j), uniformBuffer->GetBufferSize());
-	}
+	InvalidateCommandBuffers();
+
+	DescriptorSet* descriptorSet = graphicResources.Get(sphereDescriptorHandle);
+	UniformRingBuffer* uniformRing = graphicResources.Get(uniformRingHandle);
+	descriptorSet->Write(0, { DescriptorSet::MakeBufferInfo(uniformRing->GetBuffer(), sizeof(UniformBufferObject)) });
 }
 
 void MyScene::RecordDrawSphereCall(VkCommandBuffer commandBuffer)
@@ -818,13 +1086,13 @@ void MyScene::RecordDrawSphereCall(VkCommandBuffer commandBuffer)
 		return;
 	}
 
-	Buffer* vertexBuffer = dynamic_cast<Buffer*>(FindObjectByName(std::string("sphereVertex")));
+	Buffer* vertexBuffer = graphicResources.Get(sphereVertexHandle);
 	VkBuffer VB[] = { vertexBuffer->GetBuffer() };
 	VkDeviceSize offsets[] = { 0 };
-	Pipeline* pipeline = dynamic_cast<Pipeline*>(FindObjectByName("spherePipeline"));
-	DescriptorSet* des = dynamic_cast<DescriptorSet*>(FindObjectByName("sphereDescriptor"));
+	Pipeline* pipeline = graphicResources.Get(spherePipelineHandle);
+	DescriptorSet* des = graphicResources.Get(sphereDescriptorHandle);
 	vkCmdBindVertexBuffers(commandBuffer, 0, 1, VB, offsets);
-	Buffer* indexBuffer = dynamic_cast<Buffer*>(FindObjectByName("sphereIndex"));
+	Buffer* indexBuffer = graphicResources.Get(sphereIndexHandle);
 	vkCmdBindIndexBuffer(commandBuffer, indexBuffer->GetBuffer(), 0, VK_INDEX_TYPE_UINT32);
 
 	SpherePushConstants pc;
@@ -854,13 +1122,14 @@ void MyScene::RecordDrawSphereCall(VkCommandBuffer commandBuffer)
 	pc.radius = sphereRadius;
 	RecordPushConstants(commandBuffer, pipeline->GetPipelineLayout(), VK_SHADER_STAGE_VERTEX_BIT, &pc, sizeof(SpherePushConstants));
 	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline->GetPipeline());
-	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline->GetPipelineLayout(), 0, 1, des->GetDescriptorSetPtr(graphics->GetCurrentFrameID()), 0, nullptr);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline->GetPipelineLayout(), 0, 1, des->GetDescriptorSetPtr(0), SPHERE_DYNAMIC_OFFSET_COUNT, uniformOffsets.data());
 	vkCmdDrawIndexed(commandBuffer, indexBuffer->GetBufferDataSize(), 1, 0, 0, 0);
 
 }
 
 void MyScene::ChangeBoneIndexInSphere()
 {
+	PROFILE_FUNCTION();
 	if (flagChangeBoneIndexInSphere == false)
 	{
 		return;
@@ -872,25 +1141,125 @@ void MyScene::ChangeBoneIndexInSphere()
 
 	// Update model data
 	std::vector<glm::vec3> changedVertices;
-	model->ChangeBoneIndexInSphere(selectedMesh, sphereTrans, sphereRadius, boneIDIndex, selectedBone, userInputBoneWeights, changedVertices);
+	std::vector<std::pair<int, glm::vec3>> removedVertices;
+	model->ChangeBoneIndexInSphere(selectedMesh, sphereTrans, sphereRadius, boneIDIndex, selectedBone, userInputBoneWeights, changedVertices, removedVertices);
+
+	// Update jiggle bone physics only by changed vertices.
+	std::map<int, std::vector<glm::vec3>> removedVerticesByBone;
+	for (const std::pair<int, glm::vec3>& removed : removedVertices)
+	{
+		removedVerticesByBone[removed.first].push_back(removed.second);
+	}
+	for (const std::pair<const int, std::vector<glm::vec3>>& removed : removedVerticesByBone)
+	{
+		if (removed.first < 0 || removed.first >= static_cast<int>(model->GetBoneCount()))
+		{
+			continue;
+		}
+		if (const JiggleBone* cjb = dynamic_cast<const JiggleBone*>(model->GetBone(removed.first));
+			cjb != nullptr)
+		{
+			const_cast<JiggleBone*>(cjb)->RemoveVertices(removed.second);
+		}
+	}
+
 	const Bone* bone = model->GetBone(selectedBone);
 	if (const JiggleBone* cjb = dynamic_cast<const JiggleBone*>(bone);
 		cjb != nullptr)
 	{
 		JiggleBone* jb = const_cast<JiggleBone*>(cjb);
 		jb->AddVertices(changedVertices);
-		jb->physics.Initialize();
 	}
 
 	// Update buffer data
-	Buffer* vertex = dynamic_cast<Buffer*>(FindObjectByName(std::string("vertex") + std::to_string(selectedMesh)));
-	vertex->ChangeBufferData(sizeof(Vertex), model->GetVertexCount(selectedMesh), model->GetVertexData(selectedMesh));
-	Buffer* uniqueVertex = dynamic_cast<Buffer*>(FindObjectByName(std::string("uniqueVertex") + std::to_string(selectedMesh)));
-	uniqueVertex->ChangeBufferData(sizeof(Vertex), model->GetUniqueVertexCount(selectedMesh), model->GetUniqueVertexData(selectedMesh));
+	// Vertex counts are not changed, so the vertices of the mesh are overwritten in place.
+	graphicResources.Get(meshArenaHandle)->UpdateVertices(selectedMesh, model->GetVertexData(selectedMesh));
+	graphicResources.Get(uniqueVertexArenaHandle)->UpdateVertices(selectedMesh, model->GetUniqueVertexData(selectedMesh));
+	InvalidateClothVertexBuffers();
+	UpdateCullingBoxes();
+}
+
+void MyScene::MakeClothInSphere()
+{
+	PROFILE_FUNCTION();
+	if (flagMakeClothInSphere == false)
+	{
+		return;
+	}
+
+	flagMakeClothInSphere = false;
+
+	// Every mesh if no mesh is selected
+	const int meshSize = model->GetMeshSize();
+	const int begin = (selectedMesh == meshSize) ? 0 : selectedMesh;
+	const int end = (selectedMesh == meshSize) ? meshSize : selectedMesh + 1;
+	for (int i = begin; i < end; i++)
+	{
+		if (model->CreateClothInSphere(i, sphereTrans, sphereRadius) >= 0)
+		{
+			meshResources[i].clothBaseFrameMask = 0;
+		}
+	}
+}
+
+void MyScene::UpdateClothVertexBuffer(uint32_t currentFrameID)
+{
+	PROFILE_FUNCTION();
+	const int meshSize = model->GetMeshSize();
+	for (int i = 0; i < meshSize; i++)
+	{
+		UniformBuffer* clothBuffer = graphicResources.Get(meshResources[i].clothVertex);
+		if (model->HasCloth(i) == false)
+		{
+			if (clothBuffer != nullptr)
+			{
+				DeleteClothVertexBuffer(i);
+				InvalidateCommandBuffers();
+			}
+			continue;
+		}
+
+		const VkDeviceSize bufferSize = sizeof(Vertex) * model->GetVertexCount(i);
+		if (clothBuffer == nullptr)
+		{
+			meshResources[i].clothVertex = graphicResources.Add(new UniformBuffer(graphics, std::string("clothVertex") + std::to_string(i), bufferSize, Graphics::MAX_FRAMES_IN_FLIGHT, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT));
+			clothBuffer = graphicResources.Get(meshResources[i].clothVertex);
+			meshResources[i].clothBaseFrameMask = 0;
+			InvalidateCommandBuffers();
+		}
+
+		// Vertices out of the patches are written once per buffer, and cloth vertices are written in place every frame.
+		const uint32_t frameBit = 1u << currentFrameID;
+		if ((meshResources[i].clothBaseFrameMask & frameBit) == 0)
+		{
+			clothBuffer->UpdateUniformData(bufferSize, model->GetVertexData(i), currentFrameID);
+			meshResources[i].clothBaseFrameMask |= frameBit;
+		}
+		model->GetClothVertexData(i, static_cast<Vertex*>(clothBuffer->GetBufferMemory(currentFrameID).mappedData));
+	}
+}
+
+void MyScene::DeleteClothVertexBuffer(int meshIndex)
+{
+	if (UniformBuffer* clothBuffer = graphicResources.Get(meshResources[meshIndex].clothVertex);
+		clothBuffer != nullptr)
+	{
+		clothBuffer->CleanLater();
+	}
+	graphicResources.Remove(meshResources[meshIndex].clothVertex);
+}
+
+void MyScene::InvalidateClothVertexBuffers()
+{
+	for (MeshResources& resources : meshResources)
+	{
+		resources.clothBaseFrameMask = 0;
+	}
 }
 
 void MyScene::CleanBones()
 {
+	PROFILE_FUNCTION();
 	if (cleanBoneFlag == false)
 	{
 		return;
@@ -903,18 +1272,19 @@ void MyScene::CleanBones()
 
 	graphics->DeviceWaitIdle();
 
-	Buffer* skeleton = dynamic_cast<Buffer*>(FindObjectByName("skeletonBuffer"));
+	Buffer* skeleton = graphicResources.Get(skeletonBufferHandle);
 	skeleton->ChangeBufferData(sizeof(LineVertex), 2 * model->GetBoneCount(), model->GetBoneDataForDrawing());
 
-	UniformBuffer* animation = dynamic_cast<UniformBuffer*>(FindObjectByName("animationUniformBuffer"));
-	animation->ChangeBufferData(sizeof(glm::mat4) * model->GetBoneCount(), Graphics::MAX_FRAMES_IN_FLIGHT);
+	// Bone IDs of vertices are changed with the bones.
+	InvalidateClothVertexBuffers();
+	UpdateCullingBoxes();
 
-	UniformBuffer* unitBoneUniformBuffer = dynamic_cast<UniformBuffer*>(FindObjectByName("unitBoneUniformBuffer"));
-	unitBoneUniformBuffer->ChangeBufferData(sizeof(glm::mat4) * model->GetBoneCount(), Graphics::MAX_FRAMES_IN_FLIGHT);
+	ReserveUniformRingBuffer();
 	WriteDescriptorSet();
 	WriteWaxDescriptorSet();
 	WriteBlendingWeightDescriptorSet();
 	WriteHairBoneDescriptorSet();
+	WriteCullingDescriptorSet();
 }
 
 bool MyScene::HasStencilComponent(VkFormat format)
@@ -930,7 +1300,7 @@ void MyScene::RecordDrawSkeletonCall(VkCommandBuffer commandBuffer)
 		return;
 	}
 
-	Pipeline* linePipeline = dynamic_cast<Pipeline*>(FindObjectByName("linePipeline"));
+	Pipeline* linePipeline = graphicResources.Get(linePipelineHandle);
 	if (blendingWeightMode == true)
 	{
 		RecordPushConstants(commandBuffer, linePipeline->GetPipelineLayout(), VK_SHADER_STAGE_VERTEX_BIT, &selectedBone, sizeof(int));
@@ -943,12 +1313,12 @@ void MyScene::RecordDrawSkeletonCall(VkCommandBuffer commandBuffer)
 
 	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, linePipeline->GetPipeline());
 
-	Buffer* skeletonBuffer = dynamic_cast<Buffer*>(FindObjectByName("skeletonBuffer"));
-	DescriptorSet* bwDescriptor = dynamic_cast<DescriptorSet*>(FindObjectByName("blendingWeightDescriptor"));
+	Buffer* skeletonBuffer = graphicResources.Get(skeletonBufferHandle);
+	DescriptorSet* bwDescriptor = graphicResources.Get(blendingWeightDescriptorHandle);
 	VkBuffer VB[] = { skeletonBuffer->GetBuffer() };
 	VkDeviceSize offsets[] = { 0 };
 	vkCmdBindVertexBuffers(commandBuffer, 0, 1, VB, offsets);
-	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, linePipeline->GetPipelineLayout(), 0, 1, bwDescriptor->GetDescriptorSetPtr(graphics->GetCurrentFrameID()), 0, nullptr);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, linePipeline->GetPipelineLayout(), 0, 1, bwDescriptor->GetDescriptorSetPtr(0), MODEL_DYNAMIC_OFFSET_COUNT, uniformOffsets.data());
 
 	vkCmdDraw(commandBuffer, boneSize * 2, 1, 0, 0);
 }
@@ -11,8 +11,12 @@ Creation Date: 06.12.2021
 #pragma once
 
 #include <fstream> // for ifstream to read spv file
+#include <array>
 #include "Graphics/Structures/Structs.h"
 #include <Engines/Objects/Object.h>
+#include <Engines/Objects/ResourceRegistry.h>
+#include <Graphics/Pipelines/ShaderHotReloader.h>
+#include <Graphics/Textures/TextureStreamer.h>
 
 
 class Model;
@@ -20,6 +24,16 @@ class Window;
 class DescriptorSet;
 class Graphics;
 class HairBone;
+class Buffer;
+class UniformBuffer;
+class UniformRingBuffer;
+class Texture;
+class Pipeline;
+class BindlessTextureTable;
+class MeshArena;
+class MeshCuller;
+struct MeshData;
+struct CullingBox;
 
 class MyScene
 {
@@ -48,7 +62,10 @@ private:
 
 	// It has drawing triangle part, which does not make sense.
 	// I'm gonna change it.
-	void RecordDrawModelCalls(VkCommandBuffer commandBuffer);
+	// Record meshes in [firstMesh, lastMesh) of the chunk by one indirect draw, whose count is given by the culling pass.
+		// Called by recording threads concurrently.
+	void RecordDrawModelCalls(VkCommandBuffer commandBuffer, uint32_t chunk, int firstMesh, int lastMesh);
+	void RecordDrawVertexPointsCalls(VkCommandBuffer commandBuffer);
 
 	void CreateUniformBuffers();
 	void InitUniformBufferData();
@@ -58,6 +75,11 @@ private:
 	glm::vec3 GetProjectionVectorFromCamera();
 
 	void WriteDescriptorSet();
+	// Slots can be written while command buffers using the table are recorded, so it does not invalidate them.
+		// Slots of the previous textures are freed, and every mesh samples the emergency texture until its texture is streamed.
+	void WriteTextureTable();
+	// Slot of the texture table read by the mesh. Given as firstInstance of its draw.
+	uint32_t GetMaterialIndex(int mesh);
 
 	void WriteWaxDescriptorSet();
 
@@ -107,7 +129,84 @@ private:
 	int selectedMesh;
 
 	Graphics* graphics;
-	std::vector<Object*> graphicResources;
+	ResourceRegistry graphicResources;
+
+	// @@ Resource handles
+	struct MeshResources
+	{
+		// Valid only if the mesh has cloth.
+		ResourceHandle<UniformBuffer> clothVertex;
+		// Bit of a frame is set if its clothVertex has every vertex of the mesh, so only cloth vertices are written to it.
+		uint32_t clothBaseFrameMask = 0;
+	};
+	std::vector<MeshResources> meshResources;
+	// Vertices and indices of every mesh, and unique vertices for the vertex points mode.
+	ResourceHandle<MeshArena> meshArenaHandle;
+	ResourceHandle<MeshArena> uniqueVertexArenaHandle;
+	// Draw commands of every mesh, compacted by the culling pass of each frame.
+	ResourceHandle<MeshCuller> meshCullerHandle;
+	std::vector<ResourceHandle<Texture>> diffuseImageHandles;
+	// Slot of each diffuse image in the texture table. Changed whenever the image is replaced, since frames in flight read the old slot.
+	std::vector<uint32_t> diffuseSlots;
+	ResourceHandle<Texture> emergencyTextureHandle;
+	ResourceHandle<Buffer> skeletonBufferHandle;
+	ResourceHandle<Buffer> sphereVertexHandle;
+	ResourceHandle<Buffer> sphereIndexHandle;
+	ResourceHandle<UniformRingBuffer> uniformRingHandle;
+	ResourceHandle<DescriptorSet> descriptorHandle;
+	// Slot 0 is the emergency texture, and diffuse images follow it.
+	static constexpr uint32_t EMERGENCY_TEXTURE_SLOT = 0;
+	ResourceHandle<BindlessTextureTable> textureTableHandle;
+	ResourceHandle<DescriptorSet> waxDescriptorHandle;
+	ResourceHandle<DescriptorSet> blendingWeightDescriptorHandle;
+	ResourceHandle<DescriptorSet> sphereDescriptorHandle;
+	ResourceHandle<Pipeline> pipelineHandle;
+	ResourceHandle<Pipeline> waxPipelineHandle;
+	ResourceHandle<Pipeline> blendingWeightPipelineHandle;
+	ResourceHandle<Pipeline> vertexPipelineHandle;
+	ResourceHandle<Pipeline> linePipelineHandle;
+	ResourceHandle<Pipeline> spherePipelineHandle;
+	ResourceHandle<Buffer> hairBoneBufferHandle;
+	ResourceHandle<DescriptorSet> hairBoneDescriptorHandle;
+	ResourceHandle<Pipeline> hairBonePipelineHandle;
+	// @@ End of resource handles
+
+	// @@ Shader hot reload
+	// Only started in debug builds.
+	ShaderHotReloader shaderHotReloader;
+	// Rebuild pipelines using shaders compiled by shaderHotReloader. Old pipelines are kept until their frames are completed.
+	void ReloadChangedShaders();
+	// @@ End of shader hot reload
+
+	// @@ Texture streaming
+	// Bytes of uploaded levels of diffuse images. Larger textures leave their highest levels out of it.
+		// Images are made with their full chain once, so a level out of the budget is not uploaded nor sampled, but its memory is still allocated.
+	static constexpr VkDeviceSize TEXTURE_BUDGET = 256 * 1024 * 1024;
+	// Diffuse images are drawn with the emergency texture until they are decoded.
+	TextureStreamer textureStreamer;
+	// Upload textures decoded since the last frame, and write them into the texture table.
+	void UpdateTextureStreaming();
+	// @@ End of texture streaming
+
+	// @@ Uniform ring buffer
+	// Blocks in binding order of the hair bone descriptor set. The other descriptor sets use the first blocks of them.
+	enum UniformBlock
+	{
+		SCENE_BLOCK = 0,
+		ANIMATION_BLOCK,
+		UNIT_BONE_BLOCK,
+		HAIR_BONE_BLOCK,
+		UNIFORM_BLOCK_COUNT
+	};
+	static constexpr uint32_t MODEL_DYNAMIC_OFFSET_COUNT = ANIMATION_BLOCK + 1;
+	static constexpr uint32_t SPHERE_DYNAMIC_OFFSET_COUNT = SCENE_BLOCK + 1;
+	// Dynamic offsets of blocks allocated in the current frame.
+	std::array<uint32_t, UNIFORM_BLOCK_COUNT> uniformOffsets;
+	VkDeviceSize GetAnimationBlockSize();
+	VkDeviceSize GetUniformFrameSize();
+	// Grow the ring buffer if blocks of a frame do not fit in. Device should be idle.
+	void ReserveUniformRingBuffer();
+	// @@ End of uniform ring buffer
 
 	float mouseSensitivity;
 
@@ -116,8 +215,6 @@ private:
 	void RecordDrawHairBoneCall(VkCommandBuffer commandBuffer);
 	void UpdateHairBoneBuffer(uint32_t currentFrameID);
 private:
-	Object* FindObjectByName(std::string name);
-
 	bool applyingBone;
 	static constexpr size_t boneNameContainerSize = 128;
 	char newBoneName[boneNameContainerSize] = "newBone";
@@ -141,4 +238,65 @@ private:
 
 	bool cleanBoneFlag;
 	void CleanBones();
+
+	// @@ Cached command buffers
+	// Model and skeleton draws are recorded once per frame in flight, and recorded again only when they are dirty.
+	// Meshes are split into chunks, and each chunk is recorded by its own thread into the command buffer of the thread.
+		// A chunk is one indirect draw, so the number of draw calls depends on the number of threads rather than meshes.
+	// Draws depending on the mouse or the timer are recorded every frame into the dynamic command buffer.
+	struct DrawState
+	{
+		bool showModel;
+		bool blendingWeightMode;
+		bool vertexPointsMode;
+		bool showSkeletonFlag;
+		int selectedBone;
+		uint32_t swapchainGeneration;
+
+		bool operator==(const DrawState& other) const;
+		bool operator!=(const DrawState& other) const;
+	};
+	DrawState GetDrawState();
+	// Should be called whenever buffers or descriptor sets used by the static draws are changed.
+	void InvalidateCommandBuffers();
+	void RecordDrawCalls(VkCommandBuffer commandBuffer, uint32_t currentFrameID);
+	void RecordStaticDrawCalls(uint32_t currentFrameID);
+	// Chunks have at least one mesh.
+	uint32_t GetStaticChunkCount();
+	int GetChunkFirstMesh(uint32_t chunk, uint32_t chunkCount);
+	std::vector<bool> isStaticCommandBufferDirty;
+	// Number of recording threads used for the static draws of each frame.
+	std::vector<uint32_t> staticChunkCounts;
+	std::vector<VkCommandBuffer> secondaryCommandBuffers;
+	DrawState lastDrawState;
+	// Dynamic offsets baked in the cached command buffers of each frame.
+	std::vector<std::array<uint32_t, UNIFORM_BLOCK_COUNT>> recordedUniformOffsets;
+	// @@ End of cached command buffers
+
+	// @@ Indirect draws
+	std::vector<MeshData> GetMeshData();
+	std::vector<MeshData> GetUniqueVertexMeshData();
+	// Write draw commands of every mesh for this frame. Meshes with cloth get no instance, since they are drawn from their own vertex buffers.
+		// Commands of each chunk are compacted into the range of the chunk by the culling pass.
+	void UpdateIndirectCommands(uint32_t currentFrameID);
+	std::vector<VkDrawIndexedIndirectCommand> indirectCommands;
+	std::vector<uint32_t> chunkFirstDraws;
+	// Bone boxes of every mesh in the bind pose. Should be updated whenever bone weights of vertices are changed.
+	std::vector<std::vector<CullingBox>> GetCullingBoxes();
+	void UpdateCullingBoxes();
+	// Culling reads the same uniform blocks as the model draws.
+	void WriteCullingDescriptorSet();
+	// @@ End of indirect draws
+
+	// @@ Cloth
+	bool flagMakeClothInSphere;
+	// Make cloth patches from triangles in GUI sphere
+	void MakeClothInSphere();
+	// Write simulated vertices to the dynamic vertex buffers "clothVertex{i}", one per frame in flight.
+	void UpdateClothVertexBuffer(uint32_t currentFrameID);
+	// Frames in flight may read the buffers, so they are destroyed later by Graphics.
+	void DeleteClothVertexBuffer(int meshIndex);
+	// Every vertex is written again, after vertices of the mesh or cloth patches are changed.
+	void InvalidateClothVertexBuffers();
+	// @@ End of cloth
 };
\ No newline at end of file
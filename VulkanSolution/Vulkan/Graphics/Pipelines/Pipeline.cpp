@@ -9,18 +9,116 @@ Creation Date: 12.19.2022
 	Header file for Texture.
 ******************************************************************************/
 #include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <numeric>	// for std::iota
+#include <execution>
 #include "Pipeline.h"
 #include <Helper/VulkanHelper.h>
 #include <Graphics/Structures/Structs.h>
 #include <Graphics/Graphics.h>
 
-Pipeline::Pipeline(Graphics* graphics, std::string pipelineName, const std::string& vertShader, const std::string& fragShader, VkDescriptorSetLayout* descriptorSetLayoutPtr, VkPrimitiveTopology primitiveTopology)
-	:Object(pipelineName), device(graphics->GetDevice())
+Pipeline::Pipeline(Graphics* graphics, const PipelineDescription& description)
+	:Object(description.name), graphics(graphics), description(description), shaderOverrides(), device(graphics->GetDevice()), pipelineLayout(VK_NULL_HANDLE), pipeline(VK_NULL_HANDLE)
 {
+	std::vector<VkPushConstantRange> pushConstantRanges;
+	if (description.pushConstantSize > 0)
+	{
+		VkPushConstantRange pushConstantRange{};
+		pushConstantRange.offset = 0;
+		pushConstantRange.size = description.pushConstantSize;
+		pushConstantRange.stageFlags = description.pushConstantTargetStage;
+		pushConstantRanges.push_back(pushConstantRange);
+	}
+
+	// Pipelines with the same layouts share one VkPipelineLayout.
+	pipelineLayout = graphics->GetPipelineLayoutCache().Acquire(description.descriptorSetLayouts, pushConstantRanges);
+
+	VulkanHelper::VkCheck(CreatePipeline(pipeline), "Creating pipeline has failed!");
+}
+
+Pipeline::~Pipeline()
+{
+	Clean();
+}
+
+bool Pipeline::Init()
+{
+	return true;
+}
+
+void Pipeline::Update(float dt)
+{
+}
+
+void Pipeline::Clean()
+{
+	vkDestroyPipeline(device, pipeline, nullptr);
+	graphics->GetPipelineLayoutCache().Release(pipelineLayout);
+}
+
+VkPipelineLayout Pipeline::GetPipelineLayout()
+{
+	return pipelineLayout;
+}
+
+VkPipeline Pipeline::GetPipeline()
+{
+	return pipeline;
+}
+
+bool Pipeline::UsesShader(const std::string& spvPath) const
+{
+	return description.vertShader == spvPath || description.fragShader == spvPath || description.compShader == spvPath;
+}
+
+bool Pipeline::OverrideShader(const std::string& spvPath, const std::string& overridePath)
+{
+	if (UsesShader(spvPath) == false)
+	{
+		return false;
+	}
+	shaderOverrides[spvPath] = overridePath;
+	return true;
+}
+
+const std::string& Pipeline::GetShaderPath(const std::string& spvPath) const
+{
+	if (auto iter = shaderOverrides.find(spvPath);
+		iter != shaderOverrides.end())
+	{
+		return iter->second;
+	}
+	return spvPath;
+}
+
+bool Pipeline::Rebuild()
+{
+	VkPipeline newPipeline = VK_NULL_HANDLE;
+	if (CreatePipeline(newPipeline) != VK_SUCCESS)
+	{
+		std::cout << "Rebuilding " << GetName() << " has failed! The old pipeline is kept." << std::endl;
+		return false;
+	}
 
+	graphics->DestroyPipelineLater(pipeline);
+	pipeline = newPipeline;
+	return true;
+}
 
-	VkShaderModule vertModule = CreateShaderModule(readFile(vertShader));
-	VkShaderModule fragModule = CreateShaderModule(readFile(fragShader));
+VkResult Pipeline::CreatePipeline(VkPipeline& newPipeline)
+{
+	if (description.compShader.empty() == false)
+	{
+		return CreateComputePipeline(newPipeline);
+	}
+	return CreateGraphicsPipeline(newPipeline);
+}
+
+VkResult Pipeline::CreateGraphicsPipeline(VkPipeline& newPipeline)
+{
+	VkShaderModule vertModule = CreateShaderModule(readFile(GetShaderPath(description.vertShader)));
+	VkShaderModule fragModule = CreateShaderModule(readFile(GetShaderPath(description.fragShader)));
 
 	VkPipelineShaderStageCreateInfo vertShaderStageInfo{};
 	vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
@@ -48,16 +146,14 @@ Pipeline::Pipeline(Graphics* graphics, std::string pipelineName, const std::stri
 
 	VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
 	vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-	const VkVertexInputBindingDescription& bindingDescription = Vertex::GetBindingDescription();
-	const std::vector<VkVertexInputAttributeDescription>& attributeDescription = Vertex::GetAttributeDescriptions();
 	vertexInputInfo.vertexBindingDescriptionCount = 1;
-	vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
-	vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescription.size());
-	vertexInputInfo.pVertexAttributeDescriptions = attributeDescription.data();
+	vertexInputInfo.pVertexBindingDescriptions = &description.bindingDescription;
+	vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(description.attributeDescription.size());
+	vertexInputInfo.pVertexAttributeDescriptions = description.attributeDescription.data();
 
 	VkPipelineInputAssemblyStateCreateInfo inputAssemblyInfo{};
 	inputAssemblyInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-	inputAssemblyInfo.topology = primitiveTopology;
+	inputAssemblyInfo.topology = description.primitiveTopology;
 	inputAssemblyInfo.primitiveRestartEnable = VK_FALSE;
 
 	VkPipelineViewportStateCreateInfo viewportState{};
@@ -96,8 +192,8 @@ Pipeline::Pipeline(Graphics* graphics, std::string pipelineName, const std::stri
 
 	VkPipelineDepthStencilStateCreateInfo depthStencil{};
 	depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
-	depthStencil.depthTestEnable = VK_TRUE;
-	depthStencil.depthWriteEnable = VK_TRUE;
+	depthStencil.depthTestEnable = description.depthTestWrite;
+	depthStencil.depthWriteEnable = description.depthTestWrite;
 	depthStencil.depthCompareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
 	depthStencil.depthBoundsTestEnable = VK_FALSE;
 	depthStencil.minDepthBounds = 0.f;
@@ -132,15 +228,6 @@ Pipeline::Pipeline(Graphics* graphics, std::string pipelineName, const std::stri
 	colorBlending.blendConstants[2] = 0.0f;
 	colorBlending.blendConstants[3] = 0.0f;
 
-	VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
-	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-	pipelineLayoutInfo.setLayoutCount = 1;
-	pipelineLayoutInfo.pSetLayouts = descriptorSetLayoutPtr;
-	pipelineLayoutInfo.pushConstantRangeCount = 0;
-	pipelineLayoutInfo.pPushConstantRanges = nullptr;
-
-	VulkanHelper::VkCheck(vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout), "Creating pipelineLayout has failed!");
-
 	VkGraphicsPipelineCreateInfo pipelineInfo{};
 	// shader stages
 	pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
@@ -164,185 +251,49 @@ Pipeline::Pipeline(Graphics* graphics, std::string pipelineName, const std::stri
 	pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
 	pipelineInfo.basePipelineIndex = -1;
 
-	VulkanHelper::VkCheck(vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline), "Creating graphics pipeline has failed!");
-
-
+	// Pipeline cache is loaded from the disk, so the driver can skip compiling shaders which were compiled in the last run.
+	VkResult result = vkCreateGraphicsPipelines(device, graphics->GetPipelineCache(), 1, &pipelineInfo, nullptr, &newPipeline);
 
 	vkDestroyShaderModule(device, vertModule, nullptr);
 	vkDestroyShaderModule(device, fragModule, nullptr);
-}
-
 
+	return result;
+}
 
-Pipeline::Pipeline(Graphics* graphics, std::string pipelineName, const std::string& vertShader, const std::string& fragShader, const VkVertexInputBindingDescription& bindingDescription, const std::vector<VkVertexInputAttributeDescription>& attributeDescription, uint32_t pushConstantSize, VkShaderStageFlags pushConstantTargetStage, VkDescriptorSetLayout* descriptorSetLayoutPtr, VkPrimitiveTopology primitiveTopology, bool depthTestWrite)
-	:Object(pipelineName), device(graphics->GetDevice())
+VkResult Pipeline::CreateComputePipeline(VkPipeline& newPipeline)
 {
-
-	VkShaderModule vertModule = CreateShaderModule(readFile(vertShader));
-	VkShaderModule fragModule = CreateShaderModule(readFile(fragShader));
-
-	VkPipelineShaderStageCreateInfo vertShaderStageInfo{};
-	vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-	vertShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
-	vertShaderStageInfo.module = vertModule;
-	vertShaderStageInfo.pName = "main";
-
-	VkPipelineShaderStageCreateInfo fragShaderStageInfo{};
-	fragShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-	fragShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-	fragShaderStageInfo.module = fragModule;
-	fragShaderStageInfo.pName = "main";
-
-	VkPipelineShaderStageCreateInfo shaderStages[] = { vertShaderStageInfo, fragShaderStageInfo };
-
-	std::vector<VkDynamicState> dynamicStates = {
-		VK_DYNAMIC_STATE_VIEWPORT,
-		VK_DYNAMIC_STATE_SCISSOR,
-	};
-	VkPipelineDynamicStateCreateInfo dynamicStateCreateInfo{};
-	dynamicStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
-	dynamicStateCreateInfo.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
-	dynamicStateCreateInfo.pDynamicStates = dynamicStates.data();
-
-	VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
-	vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-	// @@ TODO @@ : Binding Description is fixed to Vertex: Make it flexible.
-	vertexInputInfo.vertexBindingDescriptionCount = 1;
-	vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
-	vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescription.size());
-	vertexInputInfo.pVertexAttributeDescriptions = attributeDescription.data();
-
-	VkPipelineInputAssemblyStateCreateInfo inputAssemblyInfo{};
-	inputAssemblyInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-	inputAssemblyInfo.topology = primitiveTopology;
-	inputAssemblyInfo.primitiveRestartEnable = VK_FALSE;
-
-	VkPipelineViewportStateCreateInfo viewportState{};
-	viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
-	viewportState.viewportCount = 1;
-	viewportState.scissorCount = 1;
-
-	VkPipelineRasterizationStateCreateInfo rasterizer{};
-	rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
-	rasterizer.depthClampEnable = VK_FALSE;
-	rasterizer.rasterizerDiscardEnable = VK_FALSE;
-	rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
-	rasterizer.lineWidth = 1.f;
-	rasterizer.cullMode = VK_CULL_MODE_BACK_BIT;
-	rasterizer.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
-	rasterizer.depthBiasEnable = VK_FALSE;
-	rasterizer.depthBiasConstantFactor = 0.0f;
-	rasterizer.depthBiasClamp = 0.0f;
-	rasterizer.depthBiasSlopeFactor = 0.0f;
-
-	VkPipelineMultisampleStateCreateInfo multisampling{};
-	multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-	multisampling.sampleShadingEnable = VK_FALSE;
-	multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
-	multisampling.minSampleShading = 1.f;
-	multisampling.pSampleMask = nullptr;
-	multisampling.alphaToCoverageEnable = VK_FALSE;
-	multisampling.alphaToOneEnable = VK_FALSE;
-
-	VkPipelineDepthStencilStateCreateInfo depthStencil{};
-	depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
-	depthStencil.depthTestEnable = depthTestWrite;
-	depthStencil.depthWriteEnable = depthTestWrite;
-	depthStencil.depthCompareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
-	depthStencil.depthBoundsTestEnable = VK_FALSE;
-	depthStencil.minDepthBounds = 0.f;
-	depthStencil.maxDepthBounds = 1.f;
-	depthStencil.stencilTestEnable = VK_FALSE;
-
-	VkPipelineColorBlendAttachmentState colorBlendAttachment{};
-	colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
-	colorBlendAttachment.blendEnable = VK_TRUE;
-	colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
-	colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
-	colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
-	colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
-	colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
-	colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
-
-	VkPipelineColorBlendStateCreateInfo colorBlending{};
-	colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
-	colorBlending.logicOpEnable = VK_FALSE;
-	colorBlending.logicOp = VK_LOGIC_OP_COPY;
-	colorBlending.attachmentCount = 1;
-	colorBlending.pAttachments = &colorBlendAttachment;
-	colorBlending.blendConstants[0] = 0.0f;
-	colorBlending.blendConstants[1] = 0.0f;
-	colorBlending.blendConstants[2] = 0.0f;
-	colorBlending.blendConstants[3] = 0.0f;
-
-	VkPushConstantRange pushConstantRange{};
-	pushConstantRange.offset = 0;
-	pushConstantRange.size = pushConstantSize;
-	pushConstantRange.stageFlags = pushConstantTargetStage;
-
-	VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
-	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-	pipelineLayoutInfo.setLayoutCount = 1;
-	pipelineLayoutInfo.pSetLayouts = descriptorSetLayoutPtr;
-	pipelineLayoutInfo.pushConstantRangeCount = 1;
-	pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
-
-	VulkanHelper::VkCheck(vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout), "Creating pipelineLayout has failed!");
-
-	VkGraphicsPipelineCreateInfo pipelineInfo{};
-	pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-	pipelineInfo.stageCount = 2;
-	pipelineInfo.pStages = shaderStages;
-	pipelineInfo.pVertexInputState = &vertexInputInfo;
-	pipelineInfo.pInputAssemblyState = &inputAssemblyInfo;
-	pipelineInfo.pViewportState = &viewportState;
-	pipelineInfo.pRasterizationState = &rasterizer;
-	pipelineInfo.pMultisampleState = &multisampling;
-	pipelineInfo.pDepthStencilState = &depthStencil;
-	pipelineInfo.pColorBlendState = &colorBlending;
-	pipelineInfo.pDynamicState = &dynamicStateCreateInfo;
+	VkShaderModule compModule = CreateShaderModule(readFile(GetShaderPath(description.compShader)));
+
+	VkComputePipelineCreateInfo pipelineInfo{};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	pipelineInfo.stage.module = compModule;
+	pipelineInfo.stage.pName = "main";
 	pipelineInfo.layout = pipelineLayout;
-	pipelineInfo.renderPass = graphics->GetRenderPass();
-	pipelineInfo.subpass = 0;
 	pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
 	pipelineInfo.basePipelineIndex = -1;
 
-	VulkanHelper::VkCheck(vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline), "Creating graphics pipeline has failed!");
-
-
+	VkResult result = vkCreateComputePipelines(device, graphics->GetPipelineCache(), 1, &pipelineInfo, nullptr, &newPipeline);
 
-	vkDestroyShaderModule(device, vertModule, nullptr);
-	vkDestroyShaderModule(device, fragModule, nullptr);
-}
+	vkDestroyShaderModule(device, compModule, nullptr);
 
-Pipeline::~Pipeline()
-{
-	Clean();
+	return result;
 }
 
-bool Pipeline::Init()
+std::vector<Pipeline*> Pipeline::CreatePipelines(Graphics* graphics, const std::vector<PipelineDescription>& descriptions)
 {
-	return true;
-}
+	std::vector<Pipeline*> pipelines(descriptions.size(), nullptr);
+	std::vector<size_t> indices(descriptions.size());
+	std::iota(indices.begin(), indices.end(), 0);
 
-void Pipeline::Update(float dt)
-{
-}
+	// Pipeline cache and layout cache are internally synchronized, and each pipeline only touches its own objects.
+	std::for_each(std::execution::par, indices.begin(), indices.end(), [&](size_t i)
+		{
+			pipelines[i] = new Pipeline(graphics, descriptions[i]);
+		});
 
-void Pipeline::Clean()
-{
-	vkDestroyPipeline(device, pipeline, nullptr);
-	vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
-}
-
-VkPipelineLayout Pipeline::GetPipelineLayout()
-{
-	return pipelineLayout;
-}
-
-VkPipeline Pipeline::GetPipeline()
-{
-	return pipeline;
+	return pipelines;
 }
 
 std::vector<char> Pipeline::readFile(const std::string& filename)
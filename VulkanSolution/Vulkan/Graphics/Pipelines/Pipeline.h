@@ -13,15 +13,34 @@ Creation Date: 12.19.2022
 #include <Engines/Objects/Object.h>
 #include <vulkan/vulkan.h>
 #include <vector>
+#include <string>
+#include <unordered_map>
 
 class Graphics;
 
+// Everything needed to build a pipeline, so pipelines can be described up front and built together on worker threads.
+struct PipelineDescription
+{
+	std::string name;
+	std::string vertShader;
+	std::string fragShader;
+	VkVertexInputBindingDescription bindingDescription;
+	std::vector<VkVertexInputAttributeDescription> attributeDescription;
+	// No push constant range if it is 0.
+	uint32_t pushConstantSize = 0;
+	VkShaderStageFlags pushConstantTargetStage = 0;
+	// In the order of set numbers.
+	std::vector<VkDescriptorSetLayout> descriptorSetLayouts;
+	VkPrimitiveTopology primitiveTopology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+	VkBool32 depthTestWrite = VK_TRUE;
+	// Compute pipeline is created instead if it is given. Vertex input and the shaders above are ignored then.
+	std::string compShader;
+};
+
 class Pipeline : public Object
 {
 public:
-	Pipeline(Graphics* graphics, std::string pipelineName, const std::string& vertShader, const std::string& fragShader, VkDescriptorSetLayout* descriptorSetLayoutPtr, VkPrimitiveTopology primitiveTopology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST);
-	// Push Constant compatible pipeline
-	Pipeline(Graphics* graphics, std::string pipelineName, const std::string& vertShader, const std::string& fragShader, const VkVertexInputBindingDescription& bindingDescription, const std::vector<VkVertexInputAttributeDescription>& attributeDescription, uint32_t pushConstantSize, VkShaderStageFlags pushConstantTargetStage, VkDescriptorSetLayout* descriptorSetLayoutPtr, VkPrimitiveTopology primitiveTopology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST, bool depthTestWrite = VK_TRUE);
+	Pipeline(Graphics* graphics, const PipelineDescription& description);
 	~Pipeline();
 
 	bool Init();
@@ -31,12 +50,35 @@ public:
 	VkPipelineLayout GetPipelineLayout();
 	VkPipeline GetPipeline();
 
+	bool UsesShader(const std::string& spvPath) const;
+	// Read the shader from overridePath instead of spvPath from the next Rebuild(). Return false if the pipeline does not use spvPath.
+	bool OverrideShader(const std::string& spvPath, const std::string& overridePath);
+	// Create the pipeline again from the spv files. The old pipeline is destroyed after frames using it are completed.
+		// Keep the old pipeline if it fails.
+	bool Rebuild();
+
+	// Read shaders and create pipelines in parallel, and return when every pipeline is created.
+		// Pipelines are returned in the order of descriptions.
+	static std::vector<Pipeline*> CreatePipelines(Graphics* graphics, const std::vector<PipelineDescription>& descriptions);
+
 private:
 	static std::vector<char> readFile(const std::string& filename);
+	// Overriding path if exists.
+	const std::string& GetShaderPath(const std::string& spvPath) const;
 	VkShaderModule CreateShaderModule(const std::vector<char>& code);
+	// Layout should be acquired already.
+	VkResult CreateGraphicsPipeline(VkPipeline& newPipeline);
+	VkResult CreateComputePipeline(VkPipeline& newPipeline);
+	// Compute or graphics, depending on the description.
+	VkResult CreatePipeline(VkPipeline& newPipeline);
 
 private:
+	Graphics* graphics;
+	PipelineDescription description;
+	// Spv path of the description -> path of the reloaded shader.
+	std::unordered_map<std::string, std::string> shaderOverrides;
 	VkDevice device;
+	// Owned by PipelineLayoutCache of graphics.
 	VkPipelineLayout pipelineLayout;
 	VkPipeline pipeline;
 };
\ No newline at end of file
@@ -0,0 +1,113 @@
+/******************************************************************************
+Copyright (C) 2022 DigiPen Institute of Technology.
+Reproduction or disclosure of this file or its contents without the prior
+written consent of DigiPen Institute of Technology is prohibited.
+File Name:   PipelineLayoutCache.cpp
+Author
+	- sinil.kang	rtd99062@gmail.com
+Creation Date: 12.24.2022
+	source file for cache of shared pipeline layouts.
+******************************************************************************/
+#include <iostream>
+#include "PipelineLayoutCache.h"
+#include <Helper/VulkanHelper.h>
+
+PipelineLayoutCache::PipelineLayoutCache()
+	: device(VK_NULL_HANDLE), entries(), mutex()
+{
+}
+
+PipelineLayoutCache::~PipelineLayoutCache()
+{
+}
+
+void PipelineLayoutCache::Init(VkDevice _device)
+{
+	device = _device;
+}
+
+void PipelineLayoutCache::Clean()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	for (auto& [key, entry] : entries)
+	{
+		vkDestroyPipelineLayout(device, entry.pipelineLayout, nullptr);
+	}
+	entries.clear();
+}
+
+VkPipelineLayout PipelineLayoutCache::Acquire(const std::vector<VkDescriptorSetLayout>& setLayouts, const std::vector<VkPushConstantRange>& pushConstantRanges)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	const Key key = MakeKey(setLayouts, pushConstantRanges);
+	if (auto iter = entries.find(key);
+		iter != entries.end())
+	{
+		iter->second.referenceCount++;
+		return iter->second.pipelineLayout;
+	}
+
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(setLayouts.size());
+	pipelineLayoutInfo.pSetLayouts = setLayouts.data();
+	pipelineLayoutInfo.pushConstantRangeCount = static_cast<uint32_t>(pushConstantRanges.size());
+	pipelineLayoutInfo.pPushConstantRanges = pushConstantRanges.data();
+
+	VkPipelineLayout pipelineLayout;
+	VulkanHelper::VkCheck(vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout), "Creating pipelineLayout has failed!");
+	entries[key] = { pipelineLayout, 1 };
+
+	return pipelineLayout;
+}
+
+void PipelineLayoutCache::Release(VkPipelineLayout pipelineLayout)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	// Few layouts live at the same time, so linear search is fine.
+	for (auto iter = entries.begin(); iter != entries.end(); ++iter)
+	{
+		if (iter->second.pipelineLayout != pipelineLayout)
+		{
+			continue;
+		}
+
+		iter->second.referenceCount--;
+		if (iter->second.referenceCount == 0)
+		{
+			vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
+			entries.erase(iter);
+		}
+		return;
+	}
+	std::cout << "Releasing pipeline layout which is not in the cache!" << std::endl;
+}
+
+size_t PipelineLayoutCache::GetLayoutCount()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	return entries.size();
+}
+
+PipelineLayoutCache::Key PipelineLayoutCache::MakeKey(const std::vector<VkDescriptorSetLayout>& setLayouts, const std::vector<VkPushConstantRange>& pushConstantRanges)
+{
+	Key key;
+	key.reserve(1 + setLayouts.size() + pushConstantRanges.size() * 3);
+	// Count separates set layouts from push constant ranges.
+	key.push_back(setLayouts.size());
+	for (VkDescriptorSetLayout setLayout : setLayouts)
+	{
+		key.push_back(reinterpret_cast<uint64_t>(setLayout));
+	}
+	for (const VkPushConstantRange& range : pushConstantRanges)
+	{
+		key.push_back(range.stageFlags);
+		key.push_back(range.offset);
+		key.push_back(range.size);
+	}
+	return key;
+}
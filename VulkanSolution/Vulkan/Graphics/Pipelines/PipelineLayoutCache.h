@@ -0,0 +1,47 @@
+/******************************************************************************
+Copyright (C) 2022 DigiPen Institute of Technology.
+Reproduction or disclosure of this file or its contents without the prior
+written consent of DigiPen Institute of Technology is prohibited.
+File Name:   PipelineLayoutCache.h
+Author
+	- sinil.kang	rtd99062@gmail.com
+Creation Date: 12.24.2022
+	header file for cache of shared pipeline layouts.
+******************************************************************************/
+#pragma once
+#include <vector>
+#include <map>
+#include <mutex>
+#include <vulkan/vulkan.h>
+
+// Pipelines with the same descriptor set layouts and push constant ranges share one VkPipelineLayout.
+// Layouts are reference counted, and destroyed when the last pipeline releases it.
+class PipelineLayoutCache
+{
+public:
+	PipelineLayoutCache();
+	~PipelineLayoutCache();
+
+	void Init(VkDevice device);
+	// Destroy every layout, even if a pipeline still holds it.
+	void Clean();
+
+	VkPipelineLayout Acquire(const std::vector<VkDescriptorSetLayout>& setLayouts, const std::vector<VkPushConstantRange>& pushConstantRanges);
+	void Release(VkPipelineLayout pipelineLayout);
+
+	size_t GetLayoutCount();
+private:
+	// Descriptor set layout handles and push constant ranges (stageFlags, offset, size) in order.
+	using Key = std::vector<uint64_t>;
+	struct Entry
+	{
+		VkPipelineLayout pipelineLayout;
+		uint32_t referenceCount;
+	};
+
+	static Key MakeKey(const std::vector<VkDescriptorSetLayout>& setLayouts, const std::vector<VkPushConstantRange>& pushConstantRanges);
+
+	VkDevice device;
+	std::map<Key, Entry> entries;
+	std::mutex mutex;
+};
@@ -0,0 +1,254 @@
+/******************************************************************************
+Copyright (C) 2022 DigiPen Institute of Technology.
+Reproduction or disclosure of this file or its contents without the prior
+written consent of DigiPen Institute of Technology is prohibited.
+File Name:   ShaderHotReloader.cpp
+Author
+	- sinil.kang	rtd99062@gmail.com
+Creation Date: 12.24.2022
+	source file for watching GLSL sources and recompiling them in the background.
+******************************************************************************/
+#define _CRT_SECURE_NO_WARNINGS	// for std::getenv
+#include "ShaderHotReloader.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <cstdlib>
+
+ShaderHotReloader::ShaderHotReloader()
+	: shaderDirectory(), spvDirectory(), cacheDirectory(), lastWriteTimes(), sourceHashes(), watcher(), isWatching(false), reloadedShaders(), mutex(), wakeUp()
+{
+}
+
+ShaderHotReloader::~ShaderHotReloader()
+{
+	Clean();
+}
+
+void ShaderHotReloader::Init(const std::string& shaderDirectoryPath, const std::string& spvDirectoryPath)
+{
+	shaderDirectory = shaderDirectoryPath;
+	spvDirectory = spvDirectoryPath;
+	cacheDirectory = spvDirectory / "cache";
+
+	std::error_code error;
+	std::filesystem::create_directories(cacheDirectory, error);
+	if (error)
+	{
+		std::cout << "Creating shader cache directory has failed! Shader hot reload is disabled." << std::endl;
+		return;
+	}
+
+	// Spv files of existing sources are built by the project, so only later changes are compiled.
+	for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator(shaderDirectory, error))
+	{
+		if (entry.is_regular_file() && IsShaderSource(entry.path()))
+		{
+			lastWriteTimes[entry.path().filename().string()] = entry.last_write_time(error);
+		}
+	}
+	if (error)
+	{
+		std::cout << "Reading shader directory has failed! Shader hot reload is disabled." << std::endl;
+		return;
+	}
+
+	isWatching = true;
+	watcher = std::thread(&ShaderHotReloader::WatchShaders, this);
+}
+
+void ShaderHotReloader::Clean()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		isWatching = false;
+	}
+	wakeUp.notify_all();
+	if (watcher.joinable())
+	{
+		watcher.join();
+	}
+}
+
+std::vector<ShaderHotReloader::ReloadedShader> ShaderHotReloader::TakeReloadedShaders()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	std::vector<ReloadedShader> result;
+	result.swap(reloadedShaders);
+	return result;
+}
+
+void ShaderHotReloader::WatchShaders()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	while (true)
+	{
+		wakeUp.wait_for(lock, POLLING_INTERVAL, [this]() { return isWatching == false; });
+		if (isWatching == false)
+		{
+			break;
+		}
+
+		// Compiling takes a while, so the lock is not held meanwhile.
+		lock.unlock();
+		std::vector<ReloadedShader> compiledShaders;
+		std::error_code error;
+		for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator(shaderDirectory, error))
+		{
+			if (entry.is_regular_file() == false || IsShaderSource(entry.path()) == false)
+			{
+				continue;
+			}
+
+			const std::string fileName = entry.path().filename().string();
+			const std::filesystem::file_time_type writeTime = entry.last_write_time(error);
+			if (error)
+			{
+				continue;
+			}
+			if (auto iter = lastWriteTimes.find(fileName);
+				iter != lastWriteTimes.end() && iter->second == writeTime)
+			{
+				continue;
+			}
+			lastWriteTimes[fileName] = writeTime;
+
+			if (std::filesystem::path reloadedPath;
+				ReloadShader(entry.path(), reloadedPath))
+			{
+				compiledShaders.push_back({ (spvDirectory / (fileName + ".spv")).generic_string(), reloadedPath.generic_string() });
+			}
+		}
+		lock.lock();
+
+		reloadedShaders.insert(reloadedShaders.end(), compiledShaders.begin(), compiledShaders.end());
+	}
+}
+
+bool ShaderHotReloader::ReloadShader(const std::filesystem::path& sourcePath, std::filesystem::path& reloadedPath)
+{
+	std::ifstream file(sourcePath, std::ios::binary);
+	if (file.is_open() == false)
+	{
+		return false;
+	}
+	std::stringstream source;
+	source << file.rdbuf();
+	file.close();
+
+	// Editors often write a file without changing it.
+	const std::string fileName = sourcePath.filename().string();
+	const uint64_t hash = HashSource(source.str());
+	if (auto iter = sourceHashes.find(fileName);
+		iter != sourceHashes.end() && iter->second == hash)
+	{
+		return false;
+	}
+
+	// Extension is a part of the name, since the stage is decided by it.
+	std::stringstream cacheName;
+	cacheName << std::hex << std::setw(16) << std::setfill('0') << hash << sourcePath.extension().string() << ".spv";
+	const std::filesystem::path cachedPath = cacheDirectory / cacheName.str();
+
+	std::error_code error;
+	if (std::filesystem::exists(cachedPath, error) == false)
+	{
+		// Compiled into a temporary file, so a failed compilation never leaves a broken file in the cache.
+		std::filesystem::path temporaryPath = cachedPath;
+		temporaryPath += ".tmp";
+		if (CompileShader(sourcePath, temporaryPath) == false)
+		{
+			std::cout << "Compiling " << fileName << " has failed! The old shader is kept." << std::endl;
+			std::filesystem::remove(temporaryPath, error);
+			return false;
+		}
+		std::filesystem::rename(temporaryPath, cachedPath, error);
+		if (error)
+		{
+			std::cout << "Caching " << fileName << " has failed!" << std::endl;
+			return false;
+		}
+	}
+
+	// Cached files are never rewritten, so pipelines read them directly.
+	reloadedPath = cachedPath;
+	sourceHashes[fileName] = hash;
+	std::cout << "Shader is reloaded: " << fileName << std::endl;
+	return true;
+}
+
+bool ShaderHotReloader::CompileShader(const std::filesystem::path& sourcePath, const std::filesystem::path& outputPath) const
+{
+	std::string compiler, output, source;
+	if (QuoteArgument(GetCompilerPath(), compiler) == false || QuoteArgument(outputPath.string(), output) == false || QuoteArgument(sourcePath.string(), source) == false)
+	{
+		std::cout << "Shader paths cannot be passed to the shell safely: " << sourcePath.string() << std::endl;
+		return false;
+	}
+
+	std::string command = compiler + " -V -o " + output + " " + source;
+#ifdef _WIN32
+	// cmd removes the first and the last quote of a command which starts with a quote.
+	command = "\"" + command + "\"";
+#endif
+	return std::system(command.c_str()) == 0;
+}
+
+std::string ShaderHotReloader::GetCompilerPath() const
+{
+	// Same compiler as the custom build step of the project.
+	if (const char* sdkPath = std::getenv("VULKAN_SDK");
+		sdkPath != nullptr)
+	{
+#ifdef _WIN32
+		const std::filesystem::path compilerPath = std::filesystem::path(sdkPath) / "Bin" / "glslangValidator.exe";
+#else
+		const std::filesystem::path compilerPath = std::filesystem::path(sdkPath) / "bin" / "glslangValidator";
+#endif
+		std::error_code error;
+		if (std::filesystem::exists(compilerPath, error))
+		{
+			return compilerPath.string();
+		}
+	}
+	return "glslangValidator";
+}
+
+bool ShaderHotReloader::IsShaderSource(const std::filesystem::path& path)
+{
+	const std::filesystem::path extension = path.extension();
+	return extension == ".vert" || extension == ".frag" || extension == ".comp";
+}
+
+bool ShaderHotReloader::QuoteArgument(const std::string& argument, std::string& quoted)
+{
+#ifdef _WIN32
+	// cmd expands variables and delayed expansions even in quotes, and a quote cannot be escaped in it.
+	if (argument.find_first_of("\"%!") != std::string::npos)
+	{
+		return false;
+	}
+	quoted = "\"" + argument + "\"";
+#else
+	// Nothing is expanded in single quotes, and a single quote is closed, escaped, and opened again.
+	quoted = "'";
+	for (const char c : argument)
+	{
+		quoted += (c == '\'') ? std::string("'\\''") : std::string(1, c);
+	}
+	quoted += "'";
+#endif
+	return true;
+}
+
+uint64_t ShaderHotReloader::HashSource(const std::string& source)
+{
+	uint64_t hash = 14695981039346656037ull;
+	for (const char c : source)
+	{
+		hash ^= static_cast<uint8_t>(c);
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
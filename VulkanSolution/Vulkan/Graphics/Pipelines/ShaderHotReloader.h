@@ -0,0 +1,73 @@
+/******************************************************************************
+Copyright (C) 2022 DigiPen Institute of Technology.
+Reproduction or disclosure of this file or its contents without the prior
+written consent of DigiPen Institute of Technology is prohibited.
+File Name:   ShaderHotReloader.h
+Author
+	- sinil.kang	rtd99062@gmail.com
+Creation Date: 12.24.2022
+	header file for watching GLSL sources and recompiling them in the background.
+******************************************************************************/
+#pragma once
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <filesystem>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstdint>
+
+// Development mode only.
+// A background thread polls the shader directory, and compiles changed .vert/.frag/.comp files with glslangValidator of the Vulkan SDK.
+// Compiled SPIR-V is cached by hash of the source, so reverting a change does not compile again.
+// Spv files of the project are never overwritten. The main thread rebuilds pipelines using the cached file instead, which is not tracked.
+class ShaderHotReloader
+{
+public:
+	static constexpr std::chrono::milliseconds POLLING_INTERVAL{ 500 };
+
+	struct ReloadedShader
+	{
+		// Same as PipelineDescription.
+		std::string spvPath;
+		// Compiled file in the cache directory.
+		std::string reloadedPath;
+	};
+public:
+	ShaderHotReloader();
+	~ShaderHotReloader();
+
+	// Sources existing at this point are regarded as compiled already.
+	void Init(const std::string& shaderDirectory, const std::string& spvDirectory);
+	void Clean();
+
+	// Shaders compiled since the last call.
+	std::vector<ReloadedShader> TakeReloadedShaders();
+private:
+	void WatchShaders();
+	// Return false if nothing has changed or compiling has failed.
+	bool ReloadShader(const std::filesystem::path& sourcePath, std::filesystem::path& reloadedPath);
+	bool CompileShader(const std::filesystem::path& sourcePath, const std::filesystem::path& outputPath) const;
+	std::string GetCompilerPath() const;
+
+	static bool IsShaderSource(const std::filesystem::path& path);
+	// Quoted as one argument of the shell. Return false if the shell would still expand it.
+	static bool QuoteArgument(const std::string& argument, std::string& quoted);
+	// FNV-1a
+	static uint64_t HashSource(const std::string& source);
+
+	std::filesystem::path shaderDirectory;
+	std::filesystem::path spvDirectory;
+	std::filesystem::path cacheDirectory;
+	// Only touched by the watcher thread.
+	std::unordered_map<std::string, std::filesystem::file_time_type> lastWriteTimes;
+	std::unordered_map<std::string, uint64_t> sourceHashes;
+
+	std::thread watcher;
+	bool isWatching;
+	std::vector<ReloadedShader> reloadedShaders;
+	std::mutex mutex;
+	std::condition_variable wakeUp;
+};
@@ -0,0 +1,223 @@
+/******************************************************************************
+Copyright (C) 2022 DigiPen Institute of Technology.
+Reproduction or disclosure of this file or its contents without the prior
+written consent of DigiPen Institute of Technology is prohibited.
+File Name:   GPUProfiler.cpp
+Author
+	- sinil.kang	rtd99062@gmail.com
+Creation Date: 12.24.2022
+	source file for measuring GPU time of each pass with timestamp queries.
+******************************************************************************/
+#include "GPUProfiler.h"
+#include <algorithm>
+#include <numeric>
+#include <fstream>
+#include <iostream>
+#include <Helper/VulkanHelper.h>
+
+GPUProfiler::GPUProfiler()
+	: device(VK_NULL_HANDLE), queryPool(VK_NULL_HANDLE), timestampPeriod(0.f), timestampMask(0), frames(), isFrameEnded(), history()
+{
+}
+
+GPUProfiler::~GPUProfiler()
+{
+	Clean();
+}
+
+void GPUProfiler::Init(VkDevice _device, uint32_t frameCount, float _timestampPeriod, uint32_t timestampValidBits)
+{
+	device = _device;
+	timestampPeriod = _timestampPeriod;
+	// Bits above the valid bits are undefined.
+	timestampMask = (timestampValidBits >= 64) ? UINT64_MAX : ((uint64_t(1) << timestampValidBits) - 1);
+	frames.assign(frameCount, 0);
+	isFrameEnded.assign(frameCount, false);
+	history.clear();
+
+	if (timestampValidBits == 0 || timestampPeriod <= 0.f)
+	{
+		std::cout << "Timestamps are not supported by the queue. GPU time is not measured." << std::endl;
+		return;
+	}
+
+	VkQueryPoolCreateInfo queryPoolInfo{};
+	queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+	queryPoolInfo.queryCount = 2 * REGION_COUNT * frameCount;
+	VulkanHelper::VkCheck(vkCreateQueryPool(device, &queryPoolInfo, nullptr, &queryPool), "Creating timestamp query pool has failed!");
+}
+
+void GPUProfiler::Clean()
+{
+	if (queryPool != VK_NULL_HANDLE)
+	{
+		vkDestroyQueryPool(device, queryPool, nullptr);
+		queryPool = VK_NULL_HANDLE;
+	}
+}
+
+bool GPUProfiler::IsSupported() const
+{
+	return queryPool != VK_NULL_HANDLE;
+}
+
+const char* GPUProfiler::GetRegionName(Region region)
+{
+	switch (region)
+	{
+	case Region::Frame:
+		return "Frame";
+	case Region::Model:
+		return "Model";
+	case Region::Skeleton:
+		return "Skeleton";
+	case Region::HairBone:
+		return "Hair Bone";
+	case Region::Sphere:
+		return "Sphere";
+	case Region::GUI:
+		return "ImGui";
+	default:
+		return "Unknown";
+	}
+}
+
+void GPUProfiler::BeginFrame(VkCommandBuffer commandBuffer, uint32_t frameID)
+{
+	if (queryPool == VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	// Regions which are not written in this frame stay unavailable, so they are skipped when the frame is read.
+	vkCmdResetQueryPool(commandBuffer, queryPool, GetQueryIndex(frameID, Region::Frame, false), 2 * REGION_COUNT);
+	BeginRegion(commandBuffer, frameID, Region::Frame);
+}
+
+void GPUProfiler::EndFrame(VkCommandBuffer commandBuffer, uint32_t frameID, uint64_t frame)
+{
+	if (queryPool == VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	EndRegion(commandBuffer, frameID, Region::Frame);
+	frames[frameID] = frame;
+	isFrameEnded[frameID] = true;
+}
+
+void GPUProfiler::BeginRegion(VkCommandBuffer commandBuffer, uint32_t frameID, Region region)
+{
+	if (queryPool == VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	// Both ends are written when the previous commands are completed, so adjacent regions do not overlap.
+	vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, queryPool, GetQueryIndex(frameID, region, false));
+}
+
+void GPUProfiler::EndRegion(VkCommandBuffer commandBuffer, uint32_t frameID, Region region)
+{
+	if (queryPool == VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, queryPool, GetQueryIndex(frameID, region, true));
+}
+
+void GPUProfiler::ReadResults(uint32_t frameID)
+{
+	if (queryPool == VK_NULL_HANDLE || isFrameEnded[frameID] == false)
+	{
+		return;
+	}
+	isFrameEnded[frameID] = false;
+
+	// Value and availability of each query.
+	std::array<uint64_t, 2 * 2 * REGION_COUNT> results{};
+	// VK_NOT_READY is returned if any region is not written, but results of the written ones are still returned.
+	const VkResult result = vkGetQueryPoolResults(device, queryPool, GetQueryIndex(frameID, Region::Frame, false), 2 * REGION_COUNT, sizeof(results), results.data(), 2 * sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+	if (result != VK_SUCCESS && result != VK_NOT_READY)
+	{
+		return;
+	}
+
+	FrameResult frameResult;
+	frameResult.frame = frames[frameID];
+	for (uint32_t i = 0; i < REGION_COUNT; i++)
+	{
+		const uint64_t* begin = &results[4 * i];
+		const uint64_t* end = &results[4 * i + 2];
+		const bool isAvailable = (begin[1] != 0) && (end[1] != 0);
+		frameResult.milliseconds[i] = isAvailable ? static_cast<double>((end[0] - begin[0]) & timestampMask) * timestampPeriod * 1e-6 : -1.0;
+	}
+
+	if (history.size() >= HISTORY_CAPACITY)
+	{
+		history.pop_front();
+	}
+	history.push_back(frameResult);
+}
+
+void GPUProfiler::ReadAllResults()
+{
+	std::vector<uint32_t> frameIDs(frames.size());
+	std::iota(frameIDs.begin(), frameIDs.end(), 0);
+	std::sort(frameIDs.begin(), frameIDs.end(), [this](uint32_t a, uint32_t b) { return frames[a] < frames[b]; });
+	for (uint32_t frameID : frameIDs)
+	{
+		ReadResults(frameID);
+	}
+}
+
+const std::deque<GPUProfiler::FrameResult>& GPUProfiler::GetHistory() const
+{
+	return history;
+}
+
+void GPUProfiler::ClearHistory()
+{
+	history.clear();
+}
+
+bool GPUProfiler::ExportCSV(const std::string& path) const
+{
+	std::ofstream file(path);
+	if (file.is_open() == false)
+	{
+		std::cout << "Failed to open " << path << std::endl;
+		return false;
+	}
+
+	file << "frame";
+	for (uint32_t i = 0; i < REGION_COUNT; i++)
+	{
+		file << ',' << GetRegionName(static_cast<Region>(i));
+	}
+	file << '\n';
+
+	// Empty cell if the region is not recorded in the frame.
+	for (const FrameResult& frameResult : history)
+	{
+		file << frameResult.frame;
+		for (double milliseconds : frameResult.milliseconds)
+		{
+			file << ',';
+			if (milliseconds >= 0.0)
+			{
+				file << milliseconds;
+			}
+		}
+		file << '\n';
+	}
+
+	return true;
+}
+
+uint32_t GPUProfiler::GetQueryIndex(uint32_t frameID, Region region, bool isEnd) const
+{
+	return 2 * (REGION_COUNT * frameID + static_cast<uint32_t>(region)) + (isEnd ? 1 : 0);
+}
@@ -0,0 +1,91 @@
+/******************************************************************************
+Copyright (C) 2022 DigiPen Institute of Technology.
+Reproduction or disclosure of this file or its contents without the prior
+written consent of DigiPen Institute of Technology is prohibited.
+File Name:   GPUProfiler.h
+Author
+	- sinil.kang	rtd99062@gmail.com
+Creation Date: 12.24.2022
+	header file for measuring GPU time of each pass with timestamp queries.
+******************************************************************************/
+#pragma once
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <deque>
+#include <array>
+#include <string>
+#include <cstdint>
+
+// Each frame in flight has a begin and an end timestamp for every region.
+// Queries of a frame are read when the fence of the frame is waited, which is MAX_FRAMES_IN_FLIGHT frames later, so reading never stalls.
+// Regions may be written in secondary command buffers recorded by any thread, and in cached command buffers which are executed again.
+class GPUProfiler
+{
+public:
+	enum class Region : uint32_t
+	{
+		// Whole command buffer of the frame.
+		Frame,
+		Model,
+		Skeleton,
+		HairBone,
+		Sphere,
+		GUI,
+		Count,
+	};
+	static constexpr uint32_t REGION_COUNT = static_cast<uint32_t>(Region::Count);
+	// Older results are dropped beyond this.
+	static constexpr size_t HISTORY_CAPACITY = 256;
+
+	struct FrameResult
+	{
+		// Number of frames submitted before the frame.
+		uint64_t frame;
+		// Negative if the region is not recorded in the frame.
+		std::array<double, REGION_COUNT> milliseconds;
+	};
+public:
+	GPUProfiler();
+	~GPUProfiler();
+
+	// Nothing is measured if timestampValidBits or timestampPeriod is 0, which means the queue has no timestamps.
+	void Init(VkDevice device, uint32_t frameCount, float timestampPeriod, uint32_t timestampValidBits);
+	void Clean();
+	bool IsSupported() const;
+
+	static const char* GetRegionName(Region region);
+
+	// Recorded in the primary command buffer outside of a render pass, before any region of the frame.
+	void BeginFrame(VkCommandBuffer commandBuffer, uint32_t frameID);
+	// Recorded in the primary command buffer after every region of the frame. frame is the number of frames submitted before it.
+	void EndFrame(VkCommandBuffer commandBuffer, uint32_t frameID, uint64_t frame);
+	// A region is written at most once per frame.
+	void BeginRegion(VkCommandBuffer commandBuffer, uint32_t frameID, Region region);
+	void EndRegion(VkCommandBuffer commandBuffer, uint32_t frameID, Region region);
+
+	// Fence of the frame should be waited.
+	void ReadResults(uint32_t frameID);
+	// Device should be idle. Frames in flight are read in the order they are submitted.
+	void ReadAllResults();
+
+	// Oldest first.
+	const std::deque<FrameResult>& GetHistory() const;
+	void ClearHistory();
+	// One row per frame of the history, and one column per region.
+	bool ExportCSV(const std::string& path) const;
+private:
+	uint32_t GetQueryIndex(uint32_t frameID, Region region, bool isEnd) const;
+
+	VkDevice device;
+	// VK_NULL_HANDLE if timestamps are not supported.
+	VkQueryPool queryPool;
+	float timestampPeriod;
+	uint64_t timestampMask;
+
+	// Frame number written by EndFrame() of each frame in flight.
+	std::vector<uint64_t> frames;
+	// Queries of a frame are undefined until they are reset by its first BeginFrame().
+	std::vector<bool> isFrameEnded;
+
+	std::deque<FrameResult> history;
+};
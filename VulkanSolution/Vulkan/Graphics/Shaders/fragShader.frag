@@ -1,17 +1,20 @@
 // a sample fragment shader to test compile and run shader
 
 #version 450
+#extension GL_EXT_nonuniform_qualifier : require
 
 layout(location = 0) out vec4 outColor;
 
 layout(location = 0) in vec3 normal;
 layout(location = 1) in vec3 viewVector;
 layout(location = 2) in vec2 fragTexCoord;
+layout(location = 3) flat in uint materialIndex;
 
-layout(binding = 2) uniform sampler2D texSampler;
+// Bindless texture table, indexed by the material of the draw.
+layout(set = 1, binding = 0) uniform sampler2D textures[];
 
 void main()
 {
 	vec3 color = vec3(1.f, 1.f, 1.f) * dot(normal, viewVector);
-	outColor = vec4(color, 1.f) * texture(texSampler, fragTexCoord);
+	outColor = vec4(color, 1.f) * texture(textures[materialIndex], fragTexCoord);
 }
\ No newline at end of file
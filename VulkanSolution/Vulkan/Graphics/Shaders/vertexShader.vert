@@ -29,6 +29,8 @@ layout(binding = 1) uniform AnimationBufferObject
 layout(location = 0) out vec3 normal;
 layout(location = 1) out vec3 viewVector;
 layout(location = 2) out vec2 fragTexCoord;
+// Indirect draws of models give the material of each mesh as firstInstance.
+layout(location = 3) flat out uint materialIndex;
 
 void main()
 {
@@ -40,6 +42,7 @@ void main()
 	gl_Position = ubo.proj * ubo.view * ubo.model * animationTransform * vec4(inPosition, 1.0);
 	normal = normalize(vec3(transpose(inverse(ubo.model)) * animationTransform * vec4(inNormal, 0.f)));
 	fragTexCoord = inTexCoord;
+	materialIndex = uint(gl_InstanceIndex);
 
 	vec3 fragPos = vec3(ubo.model * animationTransform * vec4(inPosition, 1.f));
 
@@ -0,0 +1,471 @@
+/******************************************************************************
+Copyright (C) 2022 DigiPen Institute of Technology.
+Reproduction or disclosure of this file or its contents without the prior
+written consent of DigiPen Institute of Technology is prohibited.
+File Name:   Collider.cpp
+Author
+	- sinil.kang	rtd99062@gmail.com
+Creation Date: 12.21.2022
+	source file for bone colliders which interact with jiggle bones.
+******************************************************************************/
+#include "Collider.h"
+#include "Structs.h"
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <iostream>
+
+namespace
+{
+	constexpr float EPSILON = 1e-8f;
+
+	glm::mat4 GetPalette(const std::vector<glm::mat4>* animationMatrix, int boneID)
+	{
+		if (animationMatrix == nullptr || boneID < 0 || boneID >= static_cast<int>(animationMatrix->size()))
+		{
+			return glm::mat4(1.f);
+		}
+		return animationMatrix->at(boneID);
+	}
+
+	glm::vec3 TransformPoint(const glm::mat4& m, glm::vec3 p)
+	{
+		glm::vec4 result = m * glm::vec4(p, 1.f);
+		return glm::vec3(result.x, result.y, result.z);
+	}
+
+	// Closest points between segment (p1, q1) and segment (p2, q2).
+	// s, t are parameters of the closest points on each segment.
+	void ClosestPointsBetweenSegments(glm::vec3 p1, glm::vec3 q1, glm::vec3 p2, glm::vec3 q2, float& s, float& t, glm::vec3& c1, glm::vec3& c2)
+	{
+		glm::vec3 d1 = q1 - p1;
+		glm::vec3 d2 = q2 - p2;
+		glm::vec3 r = p1 - p2;
+		float a = glm::dot(d1, d1);
+		float e = glm::dot(d2, d2);
+		float f = glm::dot(d2, r);
+
+		if (a <= EPSILON && e <= EPSILON)
+		{
+			s = t = 0.f;
+		}
+		else if (a <= EPSILON)
+		{
+			// First segment is a point (sphere)
+			s = 0.f;
+			t = glm::clamp(f / e, 0.f, 1.f);
+		}
+		else
+		{
+			float c = glm::dot(d1, r);
+			if (e <= EPSILON)
+			{
+				t = 0.f;
+				s = glm::clamp(-c / a, 0.f, 1.f);
+			}
+			else
+			{
+				float b = glm::dot(d1, d2);
+				float denom = a * e - b * b;
+
+				// If segments are parallel, pick arbitrary s.
+				s = (denom != 0.f) ? glm::clamp((b * f - c * e) / denom, 0.f, 1.f) : 0.f;
+				t = (b * s + f) / e;
+
+				if (t < 0.f)
+				{
+					t = 0.f;
+					s = glm::clamp(-c / a, 0.f, 1.f);
+				}
+				else if (t > 1.f)
+				{
+					t = 1.f;
+					s = glm::clamp((b - c) / a, 0.f, 1.f);
+				}
+			}
+		}
+
+		c1 = p1 + d1 * s;
+		c2 = p2 + d2 * t;
+	}
+}
+
+BoneCollider::BoneCollider()
+	: type(ColliderType::Sphere), boneID(0), radius(1.f), localPointA(0.f), localPointB(0.f), pointA(0.f), pointB(0.f)
+{
+}
+
+BoneCollider::BoneCollider(ColliderType type, int boneID, float radius, glm::vec3 localPointA, glm::vec3 localPointB)
+	: type(type), boneID(boneID), radius(radius), localPointA(localPointA), localPointB(localPointB), pointA(0.f), pointB(0.f)
+{
+}
+
+ColliderSystem::ColliderSystem()
+	: segmentRadius(0.f), stiffness(500.f), damping(10.f), colliders(), segments(), proxies(), colliderProxyCount(0), activeColliders(), activeSegments(), pairs(), contacts(), lastSolveTime(0.f)
+{
+}
+
+ColliderSystem::~ColliderSystem()
+{
+}
+
+int ColliderSystem::AddCollider(const BoneCollider& collider)
+{
+	colliders.push_back(collider);
+	return static_cast<int>(colliders.size()) - 1;
+}
+
+void ColliderSystem::RemoveCollider(int index)
+{
+	if (index < 0 || index >= static_cast<int>(colliders.size()))
+	{
+		return;
+	}
+	colliders.erase(colliders.begin() + index);
+}
+
+void ColliderSystem::RemoveCollidersOutOfRange(int boneSize)
+{
+	colliders.erase(std::remove_if(colliders.begin(), colliders.end(), [boneSize](const BoneCollider& c) { return c.boneID >= boneSize; }), colliders.end());
+}
+
+void ColliderSystem::Clear()
+{
+	colliders.clear();
+	segments.clear();
+	proxies.clear();
+	colliderProxyCount = 0;
+	pairs.clear();
+	contacts.clear();
+}
+
+BoneCollider& ColliderSystem::GetCollider(int index)
+{
+	return colliders[index];
+}
+
+size_t ColliderSystem::GetColliderCount() const
+{
+	return colliders.size();
+}
+
+const std::vector<ColliderContact>& ColliderSystem::GetContacts() const
+{
+	return contacts;
+}
+
+size_t ColliderSystem::GetPairCount() const
+{
+	return pairs.size();
+}
+
+float ColliderSystem::GetLastSolveTime() const
+{
+	return lastSolveTime;
+}
+
+void ColliderSystem::UpdateColliders(const std::vector<Bone*>& bones, const std::vector<glm::mat4>* animationMatrix)
+{
+	const int boneSize = static_cast<int>(bones.size());
+	for (BoneCollider& collider : colliders)
+	{
+		if (collider.boneID < 0 || collider.boneID >= boneSize)
+		{
+			continue;
+		}
+
+		glm::mat4 toAnimatedFromUnit = GetPalette(animationMatrix, collider.boneID) * bones[collider.boneID]->toBoneFromUnit;
+		collider.pointA = TransformPoint(toAnimatedFromUnit, collider.localPointA);
+		collider.pointB = (collider.type == ColliderType::Capsule) ? TransformPoint(toAnimatedFromUnit, collider.localPointB) : collider.pointA;
+	}
+}
+
+void ColliderSystem::Solve(const std::vector<JiggleBone*>& jiggleBones, const std::vector<glm::mat4>* animationMatrix, std::vector<glm::vec3>& forcesA, std::vector<glm::vec3>& forcesB)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+
+	forcesA.assign(jiggleBones.size(), glm::vec3(0.f));
+	forcesB.assign(jiggleBones.size(), glm::vec3(0.f));
+
+	GatherSegments(jiggleBones, animationMatrix);
+	DetectContacts();
+	AccumulateForces(forcesA, forcesB);
+
+	lastSolveTime = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+void ColliderSystem::Benchmark(int colliderCount, int segmentCount, int iterations)
+{
+	ColliderSystem system;
+	std::mt19937 generator(0);
+	std::uniform_real_distribution<float> position(-10.f, 10.f);
+	std::uniform_real_distribution<float> offset(-0.5f, 0.5f);
+	std::uniform_real_distribution<float> size(0.1f, 0.5f);
+
+	system.colliders.resize(colliderCount);
+	for (int i = 0; i < colliderCount; i++)
+	{
+		BoneCollider& collider = system.colliders[i];
+		collider.type = (i % 2 == 0) ? ColliderType::Sphere : ColliderType::Capsule;
+		collider.radius = size(generator);
+		collider.pointA = glm::vec3(position(generator), position(generator), position(generator));
+		collider.pointB = (collider.type == ColliderType::Capsule) ? collider.pointA + glm::vec3(offset(generator), offset(generator), offset(generator)) : collider.pointA;
+	}
+
+	system.segments.resize(segmentCount);
+	for (int i = 0; i < segmentCount; i++)
+	{
+		ColliderSegment& segment = system.segments[i];
+		segment.pointA = glm::vec3(position(generator), position(generator), position(generator));
+		segment.pointB = segment.pointA + glm::vec3(offset(generator), offset(generator), offset(generator));
+		segment.velocity = glm::vec3(0.f);
+		segment.toPhysicsSpace = glm::mat3(1.f);
+		segment.jiggleBoneIndex = i;
+	}
+
+	std::vector<glm::vec3> forcesA(segmentCount), forcesB(segmentCount);
+	float totalTime = 0.f;
+	float worstTime = 0.f;
+	size_t totalPairs = 0;
+	size_t totalContacts = 0;
+	for (int iteration = 0; iteration < iterations; iteration++)
+	{
+		// Jitter segments like a simulation step would do.
+		for (ColliderSegment& segment : system.segments)
+		{
+			glm::vec3 move = glm::vec3(offset(generator), offset(generator), offset(generator)) * 0.1f;
+			segment.pointA += move;
+			segment.pointB += move;
+		}
+
+		auto start = std::chrono::high_resolution_clock::now();
+		std::fill(forcesA.begin(), forcesA.end(), glm::vec3(0.f));
+		std::fill(forcesB.begin(), forcesB.end(), glm::vec3(0.f));
+		system.DetectContacts();
+		system.AccumulateForces(forcesA, forcesB);
+		float elapsed = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+		totalTime += elapsed;
+		worstTime = std::max(worstTime, elapsed);
+		totalPairs += system.pairs.size();
+		totalContacts += system.contacts.size();
+	}
+
+	const int count = std::max(iterations, 1);
+	std::cout << "Collider benchmark: " << colliderCount << " colliders, " << segmentCount << " segments, " << iterations << " iterations" << std::endl;
+	std::cout << "\taverage: " << totalTime / count << " ms, worst: " << worstTime << " ms" << std::endl;
+	std::cout << "\taverage pairs: " << totalPairs / count << ", average contacts: " << totalContacts / count << std::endl;
+}
+
+void ColliderSystem::GatherSegments(const std::vector<JiggleBone*>& jiggleBones, const std::vector<glm::mat4>* animationMatrix)
+{
+	segments.clear();
+
+	const size_t jiggleBoneSize = jiggleBones.size();
+	for (size_t i = 0; i < jiggleBoneSize; i++)
+	{
+		const JiggleBone* jb = jiggleBones[i];
+		if (jb->isUpdateJigglePhysics == false)
+		{
+			continue;
+		}
+
+		// Jiggle physics is solved in bind pose space, then animation matrix of the bone is applied.
+		glm::mat4 palette = GetPalette(animationMatrix, jb->id);
+		glm::mat3 paletteLinear = glm::mat3(palette);
+
+		// Mean of the vertex velocities, so the response does not scale with the number of vertices.
+		glm::vec3 velocity = glm::vec3(0.f);
+		for (const glm::vec3& v : jb->physics.linearVelocities)
+		{
+			velocity += v;
+		}
+		if (jb->physics.linearVelocities.empty() == false)
+		{
+			velocity /= static_cast<float>(jb->physics.linearVelocities.size());
+		}
+
+		ColliderSegment segment;
+		segment.pointA = TransformPoint(palette, jb->GetDynamicPointA(true, nullptr));
+		segment.pointB = TransformPoint(palette, jb->GetDynamicPointB(true, nullptr));
+		segment.velocity = paletteLinear * velocity;
+		segment.toPhysicsSpace = glm::inverse(paletteLinear);
+		segment.jiggleBoneIndex = static_cast<int>(i);
+		segments.push_back(segment);
+	}
+}
+
+void ColliderSystem::DetectContacts()
+{
+	pairs.clear();
+	contacts.clear();
+
+	if (colliders.empty() || segments.empty())
+	{
+		return;
+	}
+
+	Broadphase();
+	Narrowphase();
+}
+
+void ColliderSystem::Broadphase()
+{
+	const size_t colliderSize = colliders.size();
+	const size_t segmentSize = segments.size();
+
+	// Rebuild proxies only when the number of objects is changed.
+	bool rebuild = (proxies.size() != colliderSize + segmentSize) || (colliderProxyCount != colliderSize);
+	if (rebuild)
+	{
+		proxies.resize(colliderSize + segmentSize);
+		for (size_t i = 0; i < colliderSize; i++)
+		{
+			proxies[i].index = static_cast<int>(i);
+			proxies[i].isCollider = true;
+		}
+		for (size_t i = 0; i < segmentSize; i++)
+		{
+			proxies[colliderSize + i].index = static_cast<int>(i);
+			proxies[colliderSize + i].isCollider = false;
+		}
+		colliderProxyCount = colliderSize;
+	}
+
+	for (Proxy& proxy : proxies)
+	{
+		glm::vec3 a, b;
+		float radius;
+		if (proxy.isCollider)
+		{
+			const BoneCollider& collider = colliders[proxy.index];
+			a = collider.pointA;
+			b = collider.pointB;
+			radius = collider.radius;
+		}
+		else
+		{
+			const ColliderSegment& segment = segments[proxy.index];
+			a = segment.pointA;
+			b = segment.pointB;
+			radius = segmentRadius;
+		}
+		proxy.min = glm::min(a, b) - glm::vec3(radius);
+		proxy.max = glm::max(a, b) + glm::vec3(radius);
+	}
+
+	if (rebuild)
+	{
+		std::sort(proxies.begin(), proxies.end(), [](const Proxy& lhs, const Proxy& rhs) { return lhs.min.x < rhs.min.x; });
+	}
+	else
+	{
+		// Insertion sort, proxies are nearly sorted from the previous step.
+		const size_t proxySize = proxies.size();
+		for (size_t i = 1; i < proxySize; i++)
+		{
+			Proxy key = proxies[i];
+			size_t j = i;
+			while (j > 0 && proxies[j - 1].min.x > key.min.x)
+			{
+				proxies[j] = proxies[j - 1];
+				j--;
+			}
+			proxies[j] = key;
+		}
+	}
+
+	// Sweep along x axis, only collider-segment pairs are reported.
+	activeColliders.clear();
+	activeSegments.clear();
+	for (size_t i = 0; i < proxies.size(); i++)
+	{
+		const Proxy& proxy = proxies[i];
+		const float sweepX = proxy.min.x;
+
+		auto isExpired = [this, sweepX](int proxyIndex) { return proxies[proxyIndex].max.x < sweepX; };
+		activeColliders.erase(std::remove_if(activeColliders.begin(), activeColliders.end(), isExpired), activeColliders.end());
+		activeSegments.erase(std::remove_if(activeSegments.begin(), activeSegments.end(), isExpired), activeSegments.end());
+
+		std::vector<int>& others = proxy.isCollider ? activeSegments : activeColliders;
+		for (int otherIndex : others)
+		{
+			const Proxy& other = proxies[otherIndex];
+			if (proxy.min.y > other.max.y || other.min.y > proxy.max.y ||
+				proxy.min.z > other.max.z || other.min.z > proxy.max.z)
+			{
+				continue;
+			}
+
+			if (proxy.isCollider)
+			{
+				pairs.push_back({ proxy.index, other.index });
+			}
+			else
+			{
+				pairs.push_back({ other.index, proxy.index });
+			}
+		}
+
+		if (proxy.isCollider)
+		{
+			activeColliders.push_back(static_cast<int>(i));
+		}
+		else
+		{
+			activeSegments.push_back(static_cast<int>(i));
+		}
+	}
+}
+
+void ColliderSystem::Narrowphase()
+{
+	for (const std::pair<int, int>& pair : pairs)
+	{
+		const BoneCollider& collider = colliders[pair.first];
+		const ColliderSegment& segment = segments[pair.second];
+
+		// Sphere is a capsule whose points are same.
+		float s, t;
+		glm::vec3 onCollider, onSegment;
+		ClosestPointsBetweenSegments(collider.pointA, collider.pointB, segment.pointA, segment.pointB, s, t, onCollider, onSegment);
+
+		glm::vec3 difference = onSegment - onCollider;
+		float distance = glm::length(difference);
+		float depth = collider.radius + segmentRadius - distance;
+		if (depth <= 0.f)
+		{
+			continue;
+		}
+
+		ColliderContact contact;
+		contact.colliderIndex = pair.first;
+		contact.segmentIndex = pair.second;
+		contact.normal = (distance > EPSILON) ? difference / distance : glm::vec3(0.f, 1.f, 0.f);
+		contact.depth = depth;
+		contact.t = t;
+		contacts.push_back(contact);
+	}
+}
+
+void ColliderSystem::AccumulateForces(std::vector<glm::vec3>& forcesA, std::vector<glm::vec3>& forcesB)
+{
+	for (const ColliderContact& contact : contacts)
+	{
+		const ColliderSegment& segment = segments[contact.segmentIndex];
+
+		// Penalty spring pushes out the segment, damper only works while approaching.
+		float magnitude = stiffness * contact.depth;
+		float approachingSpeed = glm::dot(segment.velocity, contact.normal);
+		if (approachingSpeed < 0.f)
+		{
+			magnitude -= damping * approachingSpeed;
+		}
+
+		glm::vec3 force = segment.toPhysicsSpace * (contact.normal * magnitude);
+
+		// Distribute the force to both ends of the stick.
+		forcesA[segment.jiggleBoneIndex] += (1.f - contact.t) * force;
+		forcesB[segment.jiggleBoneIndex] += contact.t * force;
+	}
+}
@@ -0,0 +1,124 @@
+/******************************************************************************
+Copyright (C) 2022 DigiPen Institute of Technology.
+Reproduction or disclosure of this file or its contents without the prior
+written consent of DigiPen Institute of Technology is prohibited.
+File Name:   Collider.h
+Author
+	- sinil.kang	rtd99062@gmail.com
+Creation Date: 12.21.2022
+	header file for bone colliders which interact with jiggle bones.
+******************************************************************************/
+#pragma once
+#include <vector>
+#include <GLMath.h>
+
+struct Bone;
+struct JiggleBone;
+
+enum class ColliderType
+{
+	Sphere,
+	Capsule,
+};
+
+// Collider attached to a regular bone.
+// localPointA/B are offsets from the bone's origin, so the collider follows the animated bone.
+// Sphere only uses localPointA.
+struct BoneCollider
+{
+	BoneCollider();
+	BoneCollider(ColliderType type, int boneID, float radius, glm::vec3 localPointA = glm::vec3(0.f), glm::vec3 localPointB = glm::vec3(0.f));
+
+	ColliderType type;
+	int boneID;
+	float radius;
+	glm::vec3 localPointA;
+	glm::vec3 localPointB;
+
+	// Animated model space positions, updated every physics step.
+	glm::vec3 pointA;
+	glm::vec3 pointB;
+};
+
+// A jiggle bone stick (dynamic point A to dynamic point B) in animated model space.
+struct ColliderSegment
+{
+	glm::vec3 pointA;
+	glm::vec3 pointB;
+	glm::vec3 velocity;
+	// Convert a force in animated model space back to the space jiggle physics is solved.
+	glm::mat3 toPhysicsSpace;
+	int jiggleBoneIndex;
+};
+
+struct ColliderContact
+{
+	int colliderIndex;
+	int segmentIndex;
+	// Points from the collider to the segment
+	glm::vec3 normal;
+	float depth;
+	// Where the contact is on the segment. 0 is point A, 1 is point B
+	float t;
+};
+
+class ColliderSystem
+{
+public:
+	ColliderSystem();
+	~ColliderSystem();
+
+	int AddCollider(const BoneCollider& collider);
+	void RemoveCollider(int index);
+	// Remove colliders attached to bones which are not exist anymore.
+	void RemoveCollidersOutOfRange(int boneSize);
+	void Clear();
+
+	BoneCollider& GetCollider(int index);
+	size_t GetColliderCount() const;
+	const std::vector<ColliderContact>& GetContacts() const;
+	size_t GetPairCount() const;
+	// Milliseconds spent in the last Solve() call.
+	float GetLastSolveTime() const;
+
+	// Move colliders by the animation palette. animationMatrix can be nullptr for bind pose.
+	void UpdateColliders(const std::vector<Bone*>& bones, const std::vector<glm::mat4>* animationMatrix);
+	// Collide jiggle bones with colliders, and return the penalty forces per jiggle bone.
+	void Solve(const std::vector<JiggleBone*>& jiggleBones, const std::vector<glm::mat4>* animationMatrix, std::vector<glm::vec3>& forcesA, std::vector<glm::vec3>& forcesB);
+
+	// Headless benchmark for broadphase + narrowphase. Print result to the std::cout.
+	static void Benchmark(int colliderCount, int segmentCount, int iterations);
+
+	// Thickness of the jiggle bone sticks.
+	float segmentRadius;
+	float stiffness;
+	float damping;
+private:
+	void GatherSegments(const std::vector<JiggleBone*>& jiggleBones, const std::vector<glm::mat4>* animationMatrix);
+	void DetectContacts();
+	void Broadphase();
+	void Narrowphase();
+	void AccumulateForces(std::vector<glm::vec3>& forcesA, std::vector<glm::vec3>& forcesB);
+
+	// Sweep and prune proxy along x axis.
+	struct Proxy
+	{
+		glm::vec3 min;
+		glm::vec3 max;
+		int index;
+		bool isCollider;
+	};
+
+	std::vector<BoneCollider> colliders;
+	std::vector<ColliderSegment> segments;
+
+	// Kept between steps. Order barely changes in a frame, so insertion sort is almost linear.
+	std::vector<Proxy> proxies;
+	size_t colliderProxyCount;
+	std::vector<int> activeColliders;
+	std::vector<int> activeSegments;
+	std::vector<std::pair<int, int>> pairs;
+	std::vector<ColliderContact> contacts;
+
+	float lastSolveTime;
+};
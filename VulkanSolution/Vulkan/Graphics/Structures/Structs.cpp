@@ -1,8 +1,19 @@
 #include "Structs.h"
+#include <algorithm>
+#include <execution>
+#include <cfloat>
+#include <cmath>
+#include <Engines/CPUProfiler.h>
 
 bool Physics::forceApplyFlag = false;
 glm::vec3 Physics::GravityVector = glm::vec3(0.f, -1.f, 0.f);
 float Physics::GravityScaler = 1.f;
+bool Physics::sleepFlag = true;
+float Physics::SleepThreshold = 0.01f;
+int Physics::SleepStepCount = 60;
+bool Physics::lodFlag = false;
+float Physics::LODScreenSize = 0.1f;
+int Physics::LODMaxRate = 4;
 
 Mesh::Mesh()
 	:meshName(), indices(), vertices(), uniqueVertices()
@@ -43,7 +54,7 @@ Mesh& Mesh::operator=(Mesh&& m)
 }
 
 Skeleton::Skeleton()
-	:bones(), boneSize(0)
+	:bones(), boneSize(0), colliders(), chains(), chainJiggleBones(), chainStats(), viewProjection(1.f), hasViewProjection(false)
 {
 }
 
@@ -53,6 +64,7 @@ Skeleton::~Skeleton()
 
 void Skeleton::Update(float dt, glm::mat4 modelMatrix, bool bindPoseFlag, std::vector<glm::mat4>* animationMatrix)
 {
+	PROFILE_FUNCTION();
 	// Iterate bones but usually useful bones are at the tails.
 	// It might be bad.
 		// Probabily use reversed iterator for better performance.
@@ -76,13 +88,110 @@ void Skeleton::Update(float dt, glm::mat4 modelMatrix, bool bindPoseFlag, std::v
 		}
 	}
 
+	const size_t jiggleBoneSize = jiggleBones.size();
+	if (jiggleBoneSize <= 0)
+	{
+		chains.clear();
+		chainJiggleBones.clear();
+		chainStats = JiggleChainStats();
+		return;
+	}
+
+	// Collisions are solved once per step, and the forces are held during the RK4 stages and substeps.
+	if (colliders.GetColliderCount() > 0)
+	{
+		const std::vector<glm::mat4>* palette = bindPoseFlag ? nullptr : animationMatrix;
+		std::vector<glm::vec3> collisionForcesA, collisionForcesB;
+		colliders.UpdateColliders(bones, palette);
+		colliders.Solve(jiggleBones, palette, collisionForcesA, collisionForcesB);
+		for (size_t i = 0; i < jiggleBoneSize; i++)
+		{
+			jiggleBones[i]->collisionForceA = collisionForcesA[i];
+			jiggleBones[i]->collisionForceB = collisionForcesB[i];
+		}
+	}
+	else
+	{
+		for (JiggleBone* jb : jiggleBones)
+		{
+			jb->collisionForceA = glm::vec3(0.f);
+			jb->collisionForceB = glm::vec3(0.f);
+		}
+	}
+
+	if (jiggleBones != chainJiggleBones)
+	{
+		BuildJiggleChains(jiggleBones);
+	}
+
+	const std::vector<glm::mat4>* palette = bindPoseFlag ? nullptr : animationMatrix;
+	chainStats = JiggleChainStats();
+	for (JiggleChain& chain : chains)
+	{
+		if (UpdateChainSleeping(chain, palette))
+		{
+			chainStats.sleepingCount++;
+			continue;
+		}
+
+		chain.lodRate = CalculateChainLODRate(chain, modelMatrix, palette);
+		if (chain.lodRate > 1)
+		{
+			chainStats.lodCount++;
+		}
+		else
+		{
+			chainStats.activeCount++;
+		}
+
+		chain.accumulatedTime += dt;
+		chain.skippedStepCount++;
+		if (chain.skippedStepCount < chain.lodRate)
+		{
+			continue;
+		}
+
+		// Accumulated time of a LOD chain is too long for one RK4 step.
+		const int stepCount = std::clamp(static_cast<int>(std::ceil(chain.accumulatedTime / Physics::MaxStepTime)), 1, Physics::MaxStepCount);
+		const float stepTime = std::min(chain.accumulatedTime / stepCount, Physics::MaxStepTime);
+		for (int step = 0; step < stepCount; step++)
+		{
+			IntegrateJiggleBones(stepTime, chain.jiggleBones);
+		}
+		chain.accumulatedTime = 0.f;
+		chain.skippedStepCount = 0;
+
+		if (Physics::sleepFlag && IsChainAtRest(chain))
+		{
+			chain.restStepCount++;
+			if (chain.restStepCount >= Physics::SleepStepCount)
+			{
+				// Freeze the chain at the current pose.
+				chain.isSleeping = true;
+				for (JiggleBone* jb : chain.jiggleBones)
+				{
+					std::fill(jb->physics.linearMomentums.begin(), jb->physics.linearMomentums.end(), glm::vec3(0.f));
+					std::fill(jb->physics.linearVelocities.begin(), jb->physics.linearVelocities.end(), glm::vec3(0.f));
+					jb->physics.angularMomentum = glm::vec3(0.f);
+					jb->physics.angularVelocity = glm::vec3(0.f);
+				}
+			}
+		}
+		else
+		{
+			chain.restStepCount = 0;
+		}
+	}
+}
+
+void Skeleton::IntegrateJiggleBones(float dt, std::vector<JiggleBone*>& jiggleBones)
+{
 	const size_t jiggleBoneSize = jiggleBones.size();
 	if (jiggleBoneSize <= 0)
 	{
 		return;
 	}
 
-	
 	std::vector<JiggleBone> k1;
 	CopyJiggleBoneVectors(jiggleBones, k1);
 	std::vector<JiggleBone> k2, k3;
@@ -211,6 +320,10 @@ void Skeleton::Clear()
 	}
 	bones.clear();
 	boneSize = 0;
+
+	colliders.Clear();
+	chains.clear();
+	chainJiggleBones.clear();
 }
 
 void Skeleton::GetToBoneFromUnit(std::vector<glm::mat4>& data)
@@ -257,6 +370,227 @@ void Skeleton::CleanBones()
 	boneSize -= numJiggleBone;
 
 	bones.resize(boneSize);
+
+	colliders.RemoveCollidersOutOfRange(boneSize);
+	chains.clear();
+	chainJiggleBones.clear();
+}
+
+int Skeleton::AddCollider(const BoneCollider& collider)
+{
+	if (collider.boneID < 0 || collider.boneID >= boneSize)
+	{
+		return -1;
+	}
+
+	// Colliders are for animated bones. Jiggle bones are the ones collide with them.
+	if (dynamic_cast<const JiggleBone*>(bones[collider.boneID]) != nullptr)
+	{
+		return -1;
+	}
+
+	return colliders.AddCollider(collider);
+}
+
+void Skeleton::RemoveCollider(int index)
+{
+	colliders.RemoveCollider(index);
+}
+
+ColliderSystem& Skeleton::GetColliderSystem()
+{
+	return colliders;
+}
+
+void Skeleton::SetViewProjection(glm::mat4 _viewProjection)
+{
+	viewProjection = _viewProjection;
+	hasViewProjection = true;
+}
+
+const JiggleChainStats& Skeleton::GetJiggleChainStats()
+{
+	return chainStats;
+}
+
+void Skeleton::BuildJiggleChains(const std::vector<JiggleBone*>& jiggleBones)
+{
+	chains.clear();
+	chainJiggleBones = jiggleBones;
+
+	std::vector<const JiggleBone*> assigned;
+	assigned.reserve(jiggleBones.size());
+	for (JiggleBone* jb : jiggleBones)
+	{
+		// Start a chain from a jiggle bone hanging on a normal bone.
+		if (dynamic_cast<const JiggleBone*>(jb->parentBonePtr) != nullptr)
+		{
+			continue;
+		}
+
+		JiggleChain chain;
+		chain.anchorBoneID = (jb->parentBonePtr != nullptr) ? jb->parentBonePtr->id : jb->parentID;
+		for (const JiggleBone* link = jb; link != nullptr; link = link->childBonePtr)
+		{
+			chain.jiggleBones.push_back(const_cast<JiggleBone*>(link));
+			assigned.push_back(link);
+		}
+		chains.push_back(chain);
+	}
+
+	// Jiggle bones which are not reachable from any chain root are updated alone.
+	for (JiggleBone* jb : jiggleBones)
+	{
+		if (std::find(assigned.begin(), assigned.end(), jb) != assigned.end())
+		{
+			continue;
+		}
+
+		JiggleChain chain;
+		chain.anchorBoneID = jb->parentID;
+		chain.jiggleBones.push_back(jb);
+		chains.push_back(chain);
+	}
+}
+
+bool Skeleton::UpdateChainSleeping(JiggleChain& chain, const std::vector<glm::mat4>* animationMatrix)
+{
+	glm::mat4 anchorTransform = GetAnimatedTransform(animationMatrix, chain.anchorBoneID);
+	const bool isParameterChanged = UpdateChainParameters(chain);
+
+	bool isAnchorMoved = false;
+	for (int column = 0; column < 4; column++)
+	{
+		glm::vec4 difference = anchorTransform[column] - chain.anchorTransform[column];
+		if (glm::dot(difference, difference) > 1e-10f)
+		{
+			isAnchorMoved = true;
+			break;
+		}
+	}
+
+	bool isColliding = false;
+	for (const JiggleBone* jb : chain.jiggleBones)
+	{
+		if (jb->collisionForceA != glm::vec3(0.f) || jb->collisionForceB != glm::vec3(0.f))
+		{
+			isColliding = true;
+			break;
+		}
+	}
+
+	if (Physics::sleepFlag == false || isAnchorMoved || isColliding || isParameterChanged)
+	{
+		chain.isSleeping = false;
+		chain.restStepCount = 0;
+	}
+	chain.anchorTransform = anchorTransform;
+
+	return chain.isSleeping;
+}
+
+bool Skeleton::IsChainAtRest(const JiggleChain& chain)
+{
+	const float thresholdSquared = Physics::SleepThreshold * Physics::SleepThreshold;
+	for (const JiggleBone* jb : chain.jiggleBones)
+	{
+		const Physics& physics = jb->physics;
+		const size_t springSize = physics.linearVelocities.size();
+		for (size_t i = 0; i < springSize; i++)
+		{
+			if (glm::dot(physics.linearVelocities[i], physics.linearVelocities[i]) > thresholdSquared ||
+				glm::dot(physics.linearMomentums[i], physics.linearMomentums[i]) > thresholdSquared)
+			{
+				return false;
+			}
+		}
+
+		if (glm::dot(physics.angularVelocity, physics.angularVelocity) > thresholdSquared ||
+			glm::dot(physics.angularMomentum, physics.angularMomentum) > thresholdSquared)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+int Skeleton::CalculateChainLODRate(const JiggleChain& chain, glm::mat4 modelMatrix, const std::vector<glm::mat4>* animationMatrix)
+{
+	if (Physics::lodFlag == false || hasViewProjection == false || chain.jiggleBones.empty())
+	{
+		return 1;
+	}
+
+	// Projected height of the chain on the screen. [-1, 1] in NDC, so halve it.
+	glm::vec2 minimum(FLT_MAX), maximum(-FLT_MAX);
+	for (const JiggleBone* jb : chain.jiggleBones)
+	{
+		glm::mat4 toClip = viewProjection * modelMatrix * GetAnimatedTransform(animationMatrix, jb->id);
+		for (glm::vec3 point : { jb->GetDynamicPointA(true, nullptr), jb->GetDynamicPointB(true, nullptr) })
+		{
+			glm::vec4 clip = toClip * glm::vec4(point, 1.f);
+			if (clip.w <= 0.f)
+			{
+				// Behind the camera
+				return Physics::LODMaxRate;
+			}
+			glm::vec2 ndc = glm::vec2(clip.x, clip.y) / clip.w;
+			minimum = glm::min(minimum, ndc);
+			maximum = glm::max(maximum, ndc);
+		}
+	}
+	float screenSize = std::max(maximum.x - minimum.x, maximum.y - minimum.y) * 0.5f;
+
+	int rate = 1;
+	float size = Physics::LODScreenSize;
+	while (screenSize < size && rate < Physics::LODMaxRate)
+	{
+		rate *= 2;
+		size *= 0.5f;
+	}
+
+	return std::min(rate, std::max(Physics::LODMaxRate, 1));
+}
+
+bool Skeleton::UpdateChainParameters(JiggleChain& chain)
+{
+	// Compared member by member, so changes from GUI or vertex brush never cancel out each other.
+	JiggleChainParameters& parameters = chain.parameters;
+	bool isChanged = parameters.forceApplyFlag != Physics::forceApplyFlag || parameters.gravityVector != Physics::GravityVector || parameters.gravityScaler != Physics::GravityScaler || parameters.bones.size() != chain.jiggleBones.size();
+	parameters.forceApplyFlag = Physics::forceApplyFlag;
+	parameters.gravityVector = Physics::GravityVector;
+	parameters.gravityScaler = Physics::GravityScaler;
+
+	const size_t jiggleBoneSize = chain.jiggleBones.size();
+	parameters.bones.resize(jiggleBoneSize);
+	for (size_t i = 0; i < jiggleBoneSize; i++)
+	{
+		const JiggleBone* jb = chain.jiggleBones[i];
+		const Physics& physics = jb->physics;
+		JiggleChainParameters::BoneParameters bone;
+		bone.isUpdateJigglePhysics = jb->isUpdateJigglePhysics;
+		bone.springScaler = physics.springScaler;
+		bone.dampingScaler = physics.dampingScaler;
+		bone.bendSpringScaler = physics.bendSpringScaler;
+		bone.bendDampingScaler = physics.bendDampingScaler;
+		bone.momentCount = physics.moments.count;
+		if ((parameters.bones[i] == bone) == false)
+		{
+			isChanged = true;
+			parameters.bones[i] = bone;
+		}
+	}
+	return isChanged;
+}
+
+glm::mat4 Skeleton::GetAnimatedTransform(const std::vector<glm::mat4>* animationMatrix, int boneID)
+{
+	if (animationMatrix == nullptr || boneID < 0 || boneID >= static_cast<int>(animationMatrix->size()))
+	{
+		return glm::mat4(1.f);
+	}
+	return animationMatrix->at(boneID);
 }
 
 void Skeleton::CopyJiggleBoneVectors(std::vector<JiggleBone*>& src, std::vector<JiggleBone>& dst)
@@ -266,7 +600,8 @@ void Skeleton::CopyJiggleBoneVectors(std::vector<JiggleBone*>& src, std::vector<
 	for (size_t i = 0; i < jiggleBoneSize; i++)
 	{
 		dst[i] = *src.at(i);
-		if (i > 0)
+		// Link copies only if they are linked originally, so independent chains are not tied together.
+		if (i > 0 && src.at(i)->parentBonePtr == src.at(i - 1))
 		{
 			dst[i - 1].childBonePtr = &dst[i];
 			dst[i].parentBonePtr = &dst[i - 1];
@@ -281,7 +616,7 @@ void Skeleton::CopyJiggleBoneVectors(std::vector<JiggleBone>& src, std::vector<J
 	for (size_t i = 0; i < jiggleBoneSize; i++)
 	{
 		dst[i] = src.at(i);
-		if (i > 0)
+		if (i > 0 && src.at(i).parentBonePtr == &src.at(i - 1))
 		{
 			dst[i - 1].childBonePtr = &dst[i];
 			dst[i].parentBonePtr = &dst[i - 1];
@@ -289,6 +624,21 @@ void Skeleton::CopyJiggleBoneVectors(std::vector<JiggleBone>& src, std::vector<J
 	}
 }
 
+bool JiggleChainParameters::BoneParameters::operator==(const BoneParameters& other) const
+{
+	return isUpdateJigglePhysics == other.isUpdateJigglePhysics &&
+		springScaler == other.springScaler &&
+		dampingScaler == other.dampingScaler &&
+		bendSpringScaler == other.bendSpringScaler &&
+		bendDampingScaler == other.bendDampingScaler &&
+		momentCount == other.momentCount;
+}
+
+JiggleChain::JiggleChain()
+	: jiggleBones(), anchorBoneID(-1), anchorTransform(1.f), parameters(), isSleeping(false), restStepCount(0), lodRate(1), skippedStepCount(0), accumulatedTime(0.f)
+{
+}
+
 Animation::Animation()
 	:animationName(), duration(-1.f), tracks()
 {
@@ -559,12 +909,12 @@ bool vec2Compare::operator()(const glm::vec2& lhs, const glm::vec2& rhs) const
 }
 
 JiggleBone::JiggleBone()
-	: Bone(), isUpdateJigglePhysics(false), customPhysicsTranslation(glm::mat4(0.f)), customPhysicsRotation(glm::mat4(1.f)), physics(), parentBonePtr(nullptr), childBonePtr(nullptr), grandParentBonePtr(nullptr), bendingSpringInitLengthA(0.f), bendingSpringInitLengthB(0.f)
+	: Bone(), isUpdateJigglePhysics(false), customPhysicsTranslation(glm::mat4(0.f)), customPhysicsRotation(glm::mat4(1.f)), physics(), parentBonePtr(nullptr), childBonePtr(nullptr), grandParentBonePtr(nullptr), bendingSpringInitLengthA(0.f), bendingSpringInitLengthB(0.f), collisionForceA(0.f), collisionForceB(0.f)
 {
 }
 
 JiggleBone::JiggleBone(std::string name, int parentID, int id, glm::mat4 toBoneFromUnit, glm::mat4 toModelFromBone, const Bone* parentBonePtr, const JiggleBone* childBonePtr, const Bone* grandParentBonePtr)
-	: Bone(name, parentID, id, toBoneFromUnit, toModelFromBone), isUpdateJigglePhysics(false), customPhysicsTranslation(glm::identity<glm::mat4>()), customPhysicsRotation(glm::identity<glm::mat4>()), physics(), parentBonePtr(parentBonePtr), childBonePtr(childBonePtr), grandParentBonePtr(grandParentBonePtr), bendingSpringInitLengthA(0.f), bendingSpringInitLengthB(0.f)
+	: Bone(name, parentID, id, toBoneFromUnit, toModelFromBone), isUpdateJigglePhysics(false), customPhysicsTranslation(glm::identity<glm::mat4>()), customPhysicsRotation(glm::identity<glm::mat4>()), physics(), parentBonePtr(parentBonePtr), childBonePtr(childBonePtr), grandParentBonePtr(grandParentBonePtr), bendingSpringInitLengthA(0.f), bendingSpringInitLengthB(0.f), collisionForceA(0.f), collisionForceB(0.f)
 {
 	glm::vec4 pointAParent4;
 	
@@ -591,12 +941,12 @@ JiggleBone::JiggleBone(std::string name, int parentID, int id, glm::mat4 toBoneF
 }
 
 JiggleBone::JiggleBone(const JiggleBone& jb)
-	: Bone(jb), isUpdateJigglePhysics(jb.isUpdateJigglePhysics), customPhysicsTranslation(jb.customPhysicsTranslation), customPhysicsRotation(jb.customPhysicsRotation), physics(jb.physics), parentBonePtr(jb.parentBonePtr), childBonePtr(jb.childBonePtr), grandParentBonePtr(jb.grandParentBonePtr), bendingSpringInitLengthA(jb.bendingSpringInitLengthA), bendingSpringInitLengthB(jb.bendingSpringInitLengthB)
+	: Bone(jb), isUpdateJigglePhysics(jb.isUpdateJigglePhysics), customPhysicsTranslation(jb.customPhysicsTranslation), customPhysicsRotation(jb.customPhysicsRotation), physics(jb.physics), parentBonePtr(jb.parentBonePtr), childBonePtr(jb.childBonePtr), grandParentBonePtr(jb.grandParentBonePtr), bendingSpringInitLengthA(jb.bendingSpringInitLengthA), bendingSpringInitLengthB(jb.bendingSpringInitLengthB), collisionForceA(jb.collisionForceA), collisionForceB(jb.collisionForceB)
 {
 }
 
 JiggleBone::JiggleBone(JiggleBone&& jb)
-	: Bone(jb), isUpdateJigglePhysics(jb.isUpdateJigglePhysics), customPhysicsTranslation(jb.customPhysicsTranslation), customPhysicsRotation(jb.customPhysicsRotation), physics(jb.physics), parentBonePtr(jb.parentBonePtr), childBonePtr(jb.childBonePtr), grandParentBonePtr(jb.grandParentBonePtr), bendingSpringInitLengthA(jb.bendingSpringInitLengthA), bendingSpringInitLengthB(jb.bendingSpringInitLengthB)
+	: Bone(jb), isUpdateJigglePhysics(jb.isUpdateJigglePhysics), customPhysicsTranslation(jb.customPhysicsTranslation), customPhysicsRotation(jb.customPhysicsRotation), physics(jb.physics), parentBonePtr(jb.parentBonePtr), childBonePtr(jb.childBonePtr), grandParentBonePtr(jb.grandParentBonePtr), bendingSpringInitLengthA(jb.bendingSpringInitLengthA), bendingSpringInitLengthB(jb.bendingSpringInitLengthB), collisionForceA(jb.collisionForceA), collisionForceB(jb.collisionForceB)
 {
 	
 }
@@ -650,8 +1000,8 @@ void JiggleBone::CalculateForces(glm::vec3& linearForceA, glm::vec3& linearForce
 	glm::vec3 springForce = physics.springScaler * (parentEndStickPoint - exertedAnchorPoint);
 	glm::vec3 dampingForce = physics.dampingScaler * (parentPhysicsLinearVelocity - physics.linearVelocities[0]);
 
-	glm::vec3 forceA = springForce + dampingForce + (0.5f * gravityForce);
-	glm::vec3 forceB = (0.5f * gravityForce);
+	glm::vec3 forceA = springForce + dampingForce + (0.5f * gravityForce) + collisionForceA;
+	glm::vec3 forceB = (0.5f * gravityForce) + collisionForceB;
 
 	glm::vec3 bendSpringForceB = (parentAnchorPoint - exertedPoint);
 	float bendSpringForceBLength = glm::length(bendSpringForceB);
@@ -719,6 +1069,8 @@ JiggleBone& JiggleBone::operator=(const JiggleBone& jb)
 	grandParentBonePtr = jb.grandParentBonePtr;
 	bendingSpringInitLengthA = jb.bendingSpringInitLengthA;
 	bendingSpringInitLengthB = jb.bendingSpringInitLengthB;
+	collisionForceA = jb.collisionForceA;
+	collisionForceB = jb.collisionForceB;
 
 	return *this;
 }
@@ -739,6 +1091,8 @@ JiggleBone& JiggleBone::operator=(JiggleBone&& jb)
 	grandParentBonePtr = jb.grandParentBonePtr;
 	bendingSpringInitLengthA = jb.bendingSpringInitLengthA;
 	bendingSpringInitLengthB = jb.bendingSpringInitLengthB;
+	collisionForceA = jb.collisionForceA;
+	collisionForceB = jb.collisionForceB;
 
 	return *this;
 }
@@ -761,8 +1115,12 @@ void JiggleBone::SetIsUpdateJigglePhysics(bool isUpdate)
 
 void JiggleBone::AddVertices(const std::vector<glm::vec3>& _vertices)
 {
-	physics.initVertices = _vertices;
-	physics.vertices = _vertices;
+	physics.AddVertices(_vertices);
+}
+
+void JiggleBone::RemoveVertices(const std::vector<glm::vec3>& _vertices)
+{
+	physics.RemoveVertices(_vertices);
 }
 
 void JiggleBone::SetChildBonePtr(const JiggleBone* _childBonePtr)
@@ -842,24 +1200,25 @@ glm::vec4 JiggleBone::CalculateParentTransformationRecursively(const JiggleBone*
 }
 
 Physics::Physics()
-	:centerOfMass(), initCenterOfMass(), translation(), linearMomentums(springSize, glm::vec3(0.f)), linearVelocities(springSize, glm::vec3(0.f)), force(), rotation(glm::mat3(1.f)), angularMomentum(), inertiaTensorInverse(), inertiaTensorObj(), torque(), totalMass(), vertices(),
+	:centerOfMass(0.f), initCenterOfMass(0.f), translation(0.f), linearMomentums(springSize, glm::vec3(0.f)), linearVelocities(springSize, glm::vec3(0.f)), force(0.f), rotation(glm::mat3(1.f)), angularMomentum(0.f), angularVelocity(0.f), inertiaTensorInverse(0.f), inertiaTensorObj(0.f), torque(0.f), totalMass(0.f), vertices(),
 	dampingScaler(5.f), springScaler(50.f),
-	bendDampingScaler(5.f), bendSpringScaler(50.f)
+	bendDampingScaler(5.f), bendSpringScaler(50.f), moments(), vertexSlots(), isVertexSlotsBuilt(false)
 {
 }
 
 Physics::Physics(const Physics& p)
-	:centerOfMass(p.centerOfMass), initCenterOfMass(p.initCenterOfMass), translation(p.translation), linearMomentums(p.linearMomentums), linearVelocities(p.linearVelocities), force(p.force), rotation(p.rotation), angularMomentum(p.angularMomentum), inertiaTensorInverse(p.inertiaTensorInverse), inertiaTensorObj(p.inertiaTensorObj), torque(p.torque), totalMass(p.totalMass), vertices(p.vertices),
+	:centerOfMass(p.centerOfMass), initCenterOfMass(p.initCenterOfMass), translation(p.translation), linearMomentums(p.linearMomentums), linearVelocities(p.linearVelocities), force(p.force), rotation(p.rotation), angularMomentum(p.angularMomentum), angularVelocity(p.angularVelocity), inertiaTensorInverse(p.inertiaTensorInverse), inertiaTensorObj(p.inertiaTensorObj), torque(p.torque), totalMass(p.totalMass), vertices(p.vertices),
 	dampingScaler(p.dampingScaler), springScaler(p.springScaler),
-	bendDampingScaler(p.bendDampingScaler), bendSpringScaler(p.bendSpringScaler)
+	bendDampingScaler(p.bendDampingScaler), bendSpringScaler(p.bendSpringScaler), moments(p.moments), vertexSlots(), isVertexSlotsBuilt(false)
 {
 }
 
 Physics::Physics(Physics&& p)
-	: centerOfMass(p.centerOfMass), initCenterOfMass(p.initCenterOfMass), translation(p.translation), linearMomentums(p.linearMomentums), linearVelocities(p.linearVelocities), force(p.force), rotation(p.rotation), angularMomentum(p.angularMomentum), inertiaTensorInverse(p.inertiaTensorInverse), inertiaTensorObj(p.inertiaTensorObj), torque(p.torque), totalMass(p.totalMass), vertices(p.vertices),
+	: centerOfMass(p.centerOfMass), initCenterOfMass(p.initCenterOfMass), translation(p.translation), linearMomentums(p.linearMomentums), linearVelocities(p.linearVelocities), force(p.force), rotation(p.rotation), angularMomentum(p.angularMomentum), angularVelocity(p.angularVelocity), inertiaTensorInverse(p.inertiaTensorInverse), inertiaTensorObj(p.inertiaTensorObj), torque(p.torque), totalMass(p.totalMass), vertices(p.vertices),
 	dampingScaler(p.dampingScaler), springScaler(p.springScaler),
-	bendDampingScaler(p.bendDampingScaler), bendSpringScaler(p.bendSpringScaler)
+	bendDampingScaler(p.bendDampingScaler), bendSpringScaler(p.bendSpringScaler), moments(p.moments), vertexSlots(std::move(p.vertexSlots)), isVertexSlotsBuilt(p.isVertexSlotsBuilt)
 {
+	p.isVertexSlotsBuilt = false;
 }
 
 Physics& Physics::operator=(const Physics& p)
@@ -876,6 +1235,7 @@ Physics& Physics::operator=(const Physics& p)
 
 	rotation = p.rotation;
 	angularMomentum = p.angularMomentum;
+	angularVelocity = p.angularVelocity;
 	inertiaTensorInverse = p.inertiaTensorInverse;
 	inertiaTensorObj = p.inertiaTensorObj;
 	torque = p.torque;
@@ -891,6 +1251,11 @@ Physics& Physics::operator=(const Physics& p)
 	bendDampingScaler = p.bendDampingScaler;
 	bendSpringScaler = p.bendSpringScaler;
 
+	moments = p.moments;
+
+	vertexSlots.clear();
+	isVertexSlotsBuilt = false;
+
 	return *this;
 }
 
@@ -908,6 +1273,7 @@ Physics& Physics::operator=(Physics&& p)
 
 	rotation = p.rotation;
 	angularMomentum = p.angularMomentum;
+	angularVelocity = p.angularVelocity;
 	inertiaTensorInverse = p.inertiaTensorInverse;
 	inertiaTensorObj = p.inertiaTensorObj;
 	torque = p.torque;
@@ -923,6 +1289,12 @@ Physics& Physics::operator=(Physics&& p)
 	bendDampingScaler = p.bendDampingScaler;
 	bendSpringScaler = p.bendSpringScaler;
 
+	moments = p.moments;
+
+	vertexSlots = std::move(p.vertexSlots);
+	isVertexSlotsBuilt = p.isVertexSlotsBuilt;
+	p.isVertexSlotsBuilt = false;
+
 	return *this;
 }
 
@@ -932,51 +1304,17 @@ Physics::~Physics()
 
 void Physics::Initialize()
 {
-	centerOfMass = glm::vec3(0.f, 0.f, 0.f);
 	vertices = initVertices;
-	for (glm::vec3& vertex : vertices)
-	{
-		centerOfMass += vertex;
-	}
 
-	totalMass = 1.f;
-	if (vertices.empty() == false)
-	{
-		centerOfMass /= vertices.size();
-	}
-	initCenterOfMass = centerOfMass;
+	// Parallel reduction of moments over all vertices.
+	moments = std::transform_reduce(std::execution::par, vertices.begin(), vertices.end(), Moments(), std::plus<Moments>(),
+		[](const glm::vec3& vertex) { return Moments(vertex); });
 
-	// Calculate inertiaTensor
+	totalMass = 1.f;
 	rotation = glm::mat4(1.f);
-	inertiaTensorObj = glm::mat3(0.f);
-	for (const glm::vec3& vertex : vertices)
-	{
-		glm::vec3 ri = (vertex - centerOfMass);
-
-		inertiaTensorObj[0][0] += (ri.y * ri.y + ri.z * ri.z) / vertices.size();
-		inertiaTensorObj[1][1] += (ri.x * ri.x + ri.z * ri.z) / vertices.size();
-		inertiaTensorObj[2][2] += (ri.x * ri.x + ri.y * ri.y) / vertices.size();
-
-		inertiaTensorObj[0][1] -= (ri.x * ri.y) / vertices.size();
-
-		inertiaTensorObj[0][2] -= (ri.x * ri.z) / vertices.size();
-
-		inertiaTensorObj[1][2] -= (ri.y * ri.z) / vertices.size();
-	}
-	inertiaTensorObj[1][0] = inertiaTensorObj[0][1];
-	inertiaTensorObj[2][0] = inertiaTensorObj[0][2];
-	inertiaTensorObj[2][1] = inertiaTensorObj[1][2];
-	
-	if (vertices.empty() == false)
-	{
-		inertiaTensorInverse = rotation * glm::inverse(inertiaTensorObj) * glm::transpose(rotation);
-	}
-	else
-	{
-		inertiaTensorInverse = glm::mat3(0.f);
-	}
-
 	translation = glm::vec3(0.f);
+	UpdateInertiaFromMoments();
+
 	linearMomentums.resize(springSize);
 	linearVelocities.resize(springSize);
 	for (size_t i = 0; i < springSize; i++)
@@ -1034,6 +1372,135 @@ void Physics::UpdateByForce(float dt, std::vector<glm::vec3> _forces, glm::vec3
 	}
 }
 
+void Physics::AddVertices(const std::vector<glm::vec3>& addedVertices)
+{
+	for (const glm::vec3& vertex : addedVertices)
+	{
+		moments = moments + Moments(vertex);
+	}
+	if (isVertexSlotsBuilt)
+	{
+		for (const glm::vec3& vertex : addedVertices)
+		{
+			vertexSlots[vertex].push_back(static_cast<uint32_t>(initVertices.size()));
+			initVertices.push_back(vertex);
+		}
+	}
+	else
+	{
+		initVertices.insert(initVertices.end(), addedVertices.begin(), addedVertices.end());
+	}
+	vertices.insert(vertices.end(), addedVertices.begin(), addedVertices.end());
+
+	UpdateInertiaFromMoments();
+}
+
+void Physics::RemoveVertices(const std::vector<glm::vec3>& removedVertices)
+{
+	if (removedVertices.empty())
+	{
+		return;
+	}
+
+	if (isVertexSlotsBuilt == false)
+	{
+		BuildVertexSlots();
+	}
+
+	// Order of vertices does not matter to the moments, so each removal swaps the last vertex into the removed slot.
+	for (const glm::vec3& vertex : removedVertices)
+	{
+		// Only vertices actually owned by this physics are subtracted.
+		auto iter = vertexSlots.find(vertex);
+		if (iter == vertexSlots.end())
+		{
+			continue;
+		}
+		const uint32_t slot = iter->second.back();
+		iter->second.pop_back();
+		if (iter->second.empty())
+		{
+			vertexSlots.erase(iter);
+		}
+		moments = moments - Moments(vertex);
+
+		const uint32_t lastSlot = static_cast<uint32_t>(initVertices.size() - 1);
+		if (slot != lastSlot)
+		{
+			initVertices[slot] = initVertices[lastSlot];
+			vertices[slot] = vertices[lastSlot];
+			std::vector<uint32_t>& movedSlots = vertexSlots.find(initVertices[slot])->second;
+			*std::find(movedSlots.begin(), movedSlots.end(), lastSlot) = slot;
+		}
+		initVertices.pop_back();
+		vertices.pop_back();
+	}
+
+	UpdateInertiaFromMoments();
+}
+
+void Physics::BuildVertexSlots()
+{
+	vertexSlots.clear();
+	const uint32_t vertexSize = static_cast<uint32_t>(initVertices.size());
+	for (uint32_t i = 0; i < vertexSize; i++)
+	{
+		vertexSlots[initVertices[i]].push_back(i);
+	}
+	isVertexSlotsBuilt = true;
+}
+
+void Physics::UpdateInertiaFromMoments()
+{
+	if (moments.count <= 0.0)
+	{
+		moments = Moments();
+		centerOfMass = initCenterOfMass = glm::vec3(0.f);
+		inertiaTensorObj = glm::mat3(0.f);
+		inertiaTensorInverse = glm::mat3(0.f);
+		return;
+	}
+
+	// Each vertex has mass of 1/N.
+	// I = trace(C) * E - C, where C = (sum of r*r^T) / N - c*c^T is the covariance about the center of mass.
+	glm::dvec3 center = moments.first / moments.count;
+	glm::dmat3 covariance = moments.second / moments.count - glm::outerProduct(center, center);
+	double trace = covariance[0][0] + covariance[1][1] + covariance[2][2];
+
+	initCenterOfMass = glm::vec3(center);
+	centerOfMass = initCenterOfMass + translation;
+	inertiaTensorObj = glm::mat3(glm::dmat3(trace) - covariance);
+	inertiaTensorInverse = rotation * glm::inverse(inertiaTensorObj) * glm::transpose(rotation);
+}
+
+Physics::Moments::Moments()
+	: count(0.0), first(0.0), second(0.0)
+{
+}
+
+Physics::Moments::Moments(glm::vec3 vertex)
+	: count(1.0), first(vertex), second(glm::outerProduct(glm::dvec3(vertex), glm::dvec3(vertex)))
+{
+}
+
+Physics::Moments Physics::Moments::operator+(const Moments& m) const
+{
+	Moments result;
+	result.count = count + m.count;
+	result.first = first + m.first;
+	result.second = second + m.second;
+	return result;
+}
+
+Physics::Moments Physics::Moments::operator-(const Moments& m) const
+{
+	Moments result;
+	result.count = count - m.count;
+	result.first = first - m.first;
+	result.second = second - m.second;
+	return result;
+}
+
 glm::mat3 Physics::Tilde(glm::vec3 v)
 {
 	glm::mat3 result(0.f);
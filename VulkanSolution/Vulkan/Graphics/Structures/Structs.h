@@ -15,6 +15,7 @@ Creation Date: 09.27.2022
 #include <GLMath.h>
 #include <string>
 #include <map>
+#include "Collider.h"
 
 struct LineVertex {
 	LineVertex(glm::vec3 position)
@@ -207,7 +208,35 @@ public:
 	static bool forceApplyFlag;
 	static glm::vec3 GravityVector;
 	static float GravityScaler;
+
+	// Chain sleeps when velocities and momentums stay under threshold for SleepStepCount steps.
+	static bool sleepFlag;
+	static float SleepThreshold;
+	static int SleepStepCount;
+	// Chain smaller than LODScreenSize (fraction of the screen height) is updated less often, up to once per LODMaxRate steps.
+	static bool lodFlag;
+	static float LODScreenSize;
+	static int LODMaxRate;
+	// Time longer than MaxStepTime, such as the accumulated time of a LOD chain, is integrated in substeps.
+		// Time beyond MaxStepCount substeps is dropped, so a long frame never blows the springs up.
+	static constexpr float MaxStepTime = 1.f / 30.f;
+	static constexpr int MaxStepCount = 4;
+
 	const size_t springSize = 4;
+
+	// Running first and second moments of vertices.
+	// Accumulated in double since second moment about the origin loses precision with many vertices.
+	struct Moments
+	{
+		Moments();
+		Moments(glm::vec3 vertex);
+		Moments operator+(const Moments& m) const;
+		Moments operator-(const Moments& m) const;
+
+		double count;
+		glm::dvec3 first;
+		glm::dmat3 second;
+	};
 public:
 	Physics();
 	Physics(const Physics& p);
@@ -217,7 +246,11 @@ public:
 
 	~Physics();
 
+	// Rebuild moments from all vertices (parallel reduction) and reset states.
 	void Initialize();
+	// Update moments and inertia tensor by changed vertices only. Motion states are kept.
+	void AddVertices(const std::vector<glm::vec3>& addedVertices);
+	void RemoveVertices(const std::vector<glm::vec3>& removedVertices);
 	void UpdateByForce(float dt, glm::vec3 force);
 	void UpdateByForce(float dt, std::vector<glm::vec3> _forces, glm::vec3 _torque);
 public:
@@ -241,6 +274,10 @@ public:
 
 	std::vector<glm::vec3> initVertices;
 	std::vector<glm::vec3> vertices;
+	// Slots of each position in initVertices and vertices, built by the first removal.
+		// Not copied, since copies are only integrated and never lose vertices.
+	std::map<glm::vec3, std::vector<uint32_t>, vec3Compare> vertexSlots;
+	bool isVertexSlotsBuilt;
 
 	float dampingScaler;
 	float springScaler;
@@ -248,8 +285,13 @@ public:
 	float bendDampingScaler;
 	float bendSpringScaler;
 
+	Moments moments;
+
 private:
 	glm::mat3 Tilde(glm::vec3 v);
+	// Derive centerOfMass and inertia tensor from the moments.
+	void UpdateInertiaFromMoments();
+	void BuildVertexSlots();
 };
 
 struct JiggleBone : public Bone
@@ -279,6 +321,7 @@ public:
 	void SetIsUpdateJigglePhysics(bool isUpdate);
 
 	void AddVertices(const std::vector<glm::vec3>& vertices);
+	void RemoveVertices(const std::vector<glm::vec3>& vertices);
 
 	bool isUpdateJigglePhysics;
 
@@ -292,10 +335,69 @@ public:
 
 	float bendingSpringInitLengthA;
 	float bendingSpringInitLengthB;
+
+	// Penalty forces from bone colliders, constant during a step.
+	glm::vec3 collisionForceA;
+	glm::vec3 collisionForceB;
 };
 
+// Physics parameters of a chain when it is updated last time.
+struct JiggleChainParameters
+{
+	struct BoneParameters
+	{
+		bool operator==(const BoneParameters& other) const;
+
+		bool isUpdateJigglePhysics = false;
+		float springScaler = 0.f;
+		float dampingScaler = 0.f;
+		float bendSpringScaler = 0.f;
+		float bendDampingScaler = 0.f;
+		double momentCount = 0.0;
+	};
+
+	bool forceApplyFlag = false;
+	glm::vec3 gravityVector = glm::vec3(0.f);
+	float gravityScaler = 0.f;
+	std::vector<BoneParameters> bones;
+};
+
+// Jiggle bones linked from a jiggle bone whose parent is not a jiggle bone.
+// Sleeping and LOD are decided per chain.
+struct JiggleChain
+{
+	JiggleChain();
+
+	std::vector<JiggleBone*> jiggleBones;
+	// Non-jiggle bone which the chain is hanging on.
+	int anchorBoneID;
+	glm::mat4 anchorTransform;
+	// Chain wakes up when any of them is changed.
+	JiggleChainParameters parameters;
+
+	bool isSleeping;
+	int restStepCount;
+
+	// Chain is updated once per lodRate steps with accumulated time.
+	int lodRate;
+	int skippedStepCount;
+	float accumulatedTime;
+};
+
+struct JiggleChainStats
+{
+	int activeCount = 0;
+	int sleepingCount = 0;
+	int lodCount = 0;
+};
+
+class PhysicsRecorder;
+
 class Skeleton
 {
+public:
+	// Reads and writes whole states for record and replay.
+	friend PhysicsRecorder;
 public:
 	Skeleton();
 	~Skeleton();
@@ -317,13 +419,43 @@ public:
 	void GetToModelFromBone(std::vector<glm::mat4>& data);
 
 	void CleanBones();
+
+	// Return -1 if the bone is not exist or it is a jiggle bone.
+	int AddCollider(const BoneCollider& collider);
+	void RemoveCollider(int index);
+	ColliderSystem& GetColliderSystem();
+
+	// Used for screen size of chains.
+	void SetViewProjection(glm::mat4 viewProjection);
+	const JiggleChainStats& GetJiggleChainStats();
 private:
 	// Helper functions that are not called outside of the struct.
 	void CopyJiggleBoneVectors(std::vector<JiggleBone>& src, std::vector<JiggleBone>& dst);
 	void CopyJiggleBoneVectors(std::vector<JiggleBone*>& src, std::vector<JiggleBone>& dst);
+
+	// Runge-Kutta 4th order integration of the given jiggle bones.
+	void IntegrateJiggleBones(float dt, std::vector<JiggleBone*>& jiggleBones);
+
+	void BuildJiggleChains(const std::vector<JiggleBone*>& jiggleBones);
+	// Return true if the chain is still sleeping.
+	bool UpdateChainSleeping(JiggleChain& chain, const std::vector<glm::mat4>* animationMatrix);
+	bool IsChainAtRest(const JiggleChain& chain);
+	int CalculateChainLODRate(const JiggleChain& chain, glm::mat4 modelMatrix, const std::vector<glm::mat4>* animationMatrix);
+	// Store the current parameters of the chain, and return true if any of them is changed.
+	bool UpdateChainParameters(JiggleChain& chain);
+	glm::mat4 GetAnimatedTransform(const std::vector<glm::mat4>* animationMatrix, int boneID);
 private:
 	std::vector<Bone*> bones;
 	int boneSize;
+
+	ColliderSystem colliders;
+
+	std::vector<JiggleChain> chains;
+	// Jiggle bones which chains are built from
+	std::vector<JiggleBone*> chainJiggleBones;
+	JiggleChainStats chainStats;
+	glm::mat4 viewProjection;
+	bool hasViewProjection;
 };
 
 struct KeyFrame
@@ -0,0 +1,343 @@
+/******************************************************************************
+Copyright (C) 2022 DigiPen Institute of Technology.
+Reproduction or disclosure of this file or its contents without the prior
+written consent of DigiPen Institute of Technology is prohibited.
+File Name:   BlockCompression.cpp
+Author
+	- sinil.kang	rtd99062@gmail.com
+Creation Date: 12.24.2022
+	source file for BC1 and BC7 texture encoders.
+******************************************************************************/
+#include "BlockCompression.h"
+#include <algorithm>
+#include <numeric>	// for std::iota
+#include <execution>
+#include <vector>
+#include <cmath>
+#include <cstring>
+#include <cfloat>
+#include <climits>
+
+namespace
+{
+	constexpr uint32_t TEXELS_PER_BLOCK = BlockCompression::BLOCK_DIMENSION * BlockCompression::BLOCK_DIMENSION;
+	// Interpolation weights of 4 bit indices of BC7, out of 64.
+	constexpr int BC7_WEIGHTS[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+	// Copy a 4x4 block. Texels outside of the image repeat the last row or column.
+	void FetchBlock(const uint8_t* pixels, uint32_t width, uint32_t height, uint32_t blockX, uint32_t blockY, uint8_t block[TEXELS_PER_BLOCK][4])
+	{
+		for (uint32_t y = 0; y < BlockCompression::BLOCK_DIMENSION; y++)
+		{
+			const uint32_t pixelY = std::min(blockY * BlockCompression::BLOCK_DIMENSION + y, height - 1);
+			for (uint32_t x = 0; x < BlockCompression::BLOCK_DIMENSION; x++)
+			{
+				const uint32_t pixelX = std::min(blockX * BlockCompression::BLOCK_DIMENSION + x, width - 1);
+				memcpy(block[y * BlockCompression::BLOCK_DIMENSION + x], pixels + (static_cast<size_t>(pixelY) * width + pixelX) * 4, 4);
+			}
+		}
+	}
+
+	// Find the line through the texels by power iteration on their covariance, and return the two extreme texels on it.
+	void FindEndpoints(const uint8_t block[TEXELS_PER_BLOCK][4], int channelCount, float endpoint0[4], float endpoint1[4])
+	{
+		float mean[4] = {};
+		for (uint32_t i = 0; i < TEXELS_PER_BLOCK; i++)
+		{
+			for (int c = 0; c < channelCount; c++)
+			{
+				mean[c] += block[i][c];
+			}
+		}
+		for (int c = 0; c < channelCount; c++)
+		{
+			mean[c] /= TEXELS_PER_BLOCK;
+		}
+
+		float covariance[4][4] = {};
+		for (uint32_t i = 0; i < TEXELS_PER_BLOCK; i++)
+		{
+			for (int r = 0; r < channelCount; r++)
+			{
+				for (int c = 0; c < channelCount; c++)
+				{
+					covariance[r][c] += (block[i][r] - mean[r]) * (block[i][c] - mean[c]);
+				}
+			}
+		}
+
+		float axis[4] = { 1.f, 1.f, 1.f, 1.f };
+		for (int iteration = 0; iteration < 8; iteration++)
+		{
+			float next[4] = {};
+			float length = 0.f;
+			for (int r = 0; r < channelCount; r++)
+			{
+				for (int c = 0; c < channelCount; c++)
+				{
+					next[r] += covariance[r][c] * axis[c];
+				}
+				length = std::max(length, std::abs(next[r]));
+			}
+			// Every texel is the same.
+			if (length < 1e-6f)
+			{
+				break;
+			}
+			for (int c = 0; c < channelCount; c++)
+			{
+				axis[c] = next[c] / length;
+			}
+		}
+
+		float minProjection = FLT_MAX;
+		float maxProjection = -FLT_MAX;
+		for (uint32_t i = 0; i < TEXELS_PER_BLOCK; i++)
+		{
+			float projection = 0.f;
+			for (int c = 0; c < channelCount; c++)
+			{
+				projection += (block[i][c] - mean[c]) * axis[c];
+			}
+			minProjection = std::min(minProjection, projection);
+			maxProjection = std::max(maxProjection, projection);
+		}
+
+		float axisLengthSquared = 0.f;
+		for (int c = 0; c < channelCount; c++)
+		{
+			axisLengthSquared += axis[c] * axis[c];
+		}
+		for (int c = 0; c < channelCount; c++)
+		{
+			endpoint0[c] = std::clamp(mean[c] + axis[c] * minProjection / axisLengthSquared, 0.f, 255.f);
+			endpoint1[c] = std::clamp(mean[c] + axis[c] * maxProjection / axisLengthSquared, 0.f, 255.f);
+		}
+	}
+
+	int GetDistanceSquared(const int* a, const uint8_t* b, int channelCount)
+	{
+		int distance = 0;
+		for (int c = 0; c < channelCount; c++)
+		{
+			distance += (a[c] - b[c]) * (a[c] - b[c]);
+		}
+		return distance;
+	}
+
+	uint16_t PackRGB565(const float color[4])
+	{
+		const uint16_t r = static_cast<uint16_t>(std::lround(color[0] * 31.f / 255.f));
+		const uint16_t g = static_cast<uint16_t>(std::lround(color[1] * 63.f / 255.f));
+		const uint16_t b = static_cast<uint16_t>(std::lround(color[2] * 31.f / 255.f));
+		return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+	}
+
+	void UnpackRGB565(uint16_t packed, int color[3])
+	{
+		const int r = (packed >> 11) & 31;
+		const int g = (packed >> 5) & 63;
+		const int b = packed & 31;
+		color[0] = (r << 3) | (r >> 2);
+		color[1] = (g << 2) | (g >> 4);
+		color[2] = (b << 3) | (b >> 2);
+	}
+
+	void EncodeBC1Block(const uint8_t block[TEXELS_PER_BLOCK][4], uint8_t* output)
+	{
+		float endpoint0[4];
+		float endpoint1[4];
+		FindEndpoints(block, 3, endpoint0, endpoint1);
+
+		uint16_t color0 = PackRGB565(endpoint1);
+		uint16_t color1 = PackRGB565(endpoint0);
+		// color0 > color1 selects the 4 color mode. Otherwise, index 3 would be transparent black.
+		if (color0 < color1)
+		{
+			std::swap(color0, color1);
+		}
+
+		uint32_t indices = 0;
+		if (color0 != color1)
+		{
+			int palette[4][3];
+			UnpackRGB565(color0, palette[0]);
+			UnpackRGB565(color1, palette[1]);
+			for (int c = 0; c < 3; c++)
+			{
+				palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+				palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+			}
+
+			for (uint32_t i = 0; i < TEXELS_PER_BLOCK; i++)
+			{
+				uint32_t bestIndex = 0;
+				int bestDistance = INT_MAX;
+				for (uint32_t p = 0; p < 4; p++)
+				{
+					const int distance = GetDistanceSquared(palette[p], block[i], 3);
+					if (distance < bestDistance)
+					{
+						bestDistance = distance;
+						bestIndex = p;
+					}
+				}
+				indices |= bestIndex << (2 * i);
+			}
+		}
+
+		output[0] = static_cast<uint8_t>(color0 & 0xFF);
+		output[1] = static_cast<uint8_t>(color0 >> 8);
+		output[2] = static_cast<uint8_t>(color1 & 0xFF);
+		output[3] = static_cast<uint8_t>(color1 >> 8);
+		memcpy(output + 4, &indices, sizeof(indices));
+	}
+
+	// Quantize an endpoint into 7 bits per channel with a shared p-bit, which becomes the lowest bit of every channel.
+	void QuantizeBC7Endpoint(const float endpoint[4], uint8_t quantized[4], uint8_t& pBit, int reconstructed[4])
+	{
+		float bestError = FLT_MAX;
+		for (uint8_t p = 0; p < 2; p++)
+		{
+			uint8_t candidate[4];
+			float error = 0.f;
+			for (int c = 0; c < 4; c++)
+			{
+				candidate[c] = static_cast<uint8_t>(std::clamp(std::lround((endpoint[c] - p) / 2.f), 0l, 127l));
+				const float difference = static_cast<float>((candidate[c] << 1) | p) - endpoint[c];
+				error += difference * difference;
+			}
+			if (error < bestError)
+			{
+				bestError = error;
+				pBit = p;
+				memcpy(quantized, candidate, 4);
+			}
+		}
+		for (int c = 0; c < 4; c++)
+		{
+			reconstructed[c] = (quantized[c] << 1) | pBit;
+		}
+	}
+
+	// Little endian bit writer for 128 bit blocks.
+	class BitWriter
+	{
+	public:
+		BitWriter(uint8_t* output)
+			: output(output), position(0)
+		{
+			memset(output, 0, BlockCompression::BC7_BLOCK_SIZE);
+		}
+		void Write(uint32_t value, uint32_t bitCount)
+		{
+			for (uint32_t i = 0; i < bitCount; i++, position++)
+			{
+				output[position / 8] |= static_cast<uint8_t>(((value >> i) & 1) << (position % 8));
+			}
+		}
+	private:
+		uint8_t* output;
+		uint32_t position;
+	};
+
+	void EncodeBC7Block(const uint8_t block[TEXELS_PER_BLOCK][4], uint8_t* output)
+	{
+		float endpoints[2][4];
+		FindEndpoints(block, 4, endpoints[0], endpoints[1]);
+
+		uint8_t quantized[2][4];
+		uint8_t pBits[2];
+		int palette[16][4];
+		int reconstructed[2][4];
+		QuantizeBC7Endpoint(endpoints[0], quantized[0], pBits[0], reconstructed[0]);
+		QuantizeBC7Endpoint(endpoints[1], quantized[1], pBits[1], reconstructed[1]);
+		for (int i = 0; i < 16; i++)
+		{
+			for (int c = 0; c < 4; c++)
+			{
+				palette[i][c] = ((64 - BC7_WEIGHTS[i]) * reconstructed[0][c] + BC7_WEIGHTS[i] * reconstructed[1][c] + 32) >> 6;
+			}
+		}
+
+		uint8_t indices[TEXELS_PER_BLOCK];
+		for (uint32_t i = 0; i < TEXELS_PER_BLOCK; i++)
+		{
+			int bestDistance = INT_MAX;
+			for (uint8_t p = 0; p < 16; p++)
+			{
+				const int distance = GetDistanceSquared(palette[p], block[i], 4);
+				if (distance < bestDistance)
+				{
+					bestDistance = distance;
+					indices[i] = p;
+				}
+			}
+		}
+
+		// The highest bit of the first index is implicitly 0, so endpoints are swapped if it is set.
+		if (indices[0] >= 8)
+		{
+			std::swap(quantized[0], quantized[1]);
+			std::swap(pBits[0], pBits[1]);
+			for (uint8_t& index : indices)
+			{
+				index = 15 - index;
+			}
+		}
+
+		BitWriter writer(output);
+		// Mode 6
+		writer.Write(1 << 6, 7);
+		for (int c = 0; c < 4; c++)
+		{
+			writer.Write(quantized[0][c], 7);
+			writer.Write(quantized[1][c], 7);
+		}
+		writer.Write(pBits[0], 1);
+		writer.Write(pBits[1], 1);
+		writer.Write(indices[0], 3);
+		for (uint32_t i = 1; i < TEXELS_PER_BLOCK; i++)
+		{
+			writer.Write(indices[i], 4);
+		}
+	}
+
+	template<typename BlockEncoder>
+	void EncodeBlocks(const uint8_t* pixels, uint32_t width, uint32_t height, uint8_t* blocks, uint32_t blockSize, BlockEncoder encodeBlock)
+	{
+		const uint32_t blockCountX = BlockCompression::GetBlockCount(width);
+		const uint32_t blockCountY = BlockCompression::GetBlockCount(height);
+		std::vector<uint32_t> rows(blockCountY);
+		std::iota(rows.begin(), rows.end(), 0);
+
+		// Each row of blocks is written to its own range of the output.
+		std::for_each(std::execution::par, rows.begin(), rows.end(), [&](uint32_t blockY)
+			{
+				uint8_t block[TEXELS_PER_BLOCK][4];
+				for (uint32_t blockX = 0; blockX < blockCountX; blockX++)
+				{
+					FetchBlock(pixels, width, height, blockX, blockY, block);
+					encodeBlock(block, blocks + (static_cast<size_t>(blockY) * blockCountX + blockX) * blockSize);
+				}
+			});
+	}
+}
+
+namespace BlockCompression
+{
+	void EncodeBC1(const uint8_t* pixels, uint32_t width, uint32_t height, uint8_t* blocks)
+	{
+		EncodeBlocks(pixels, width, height, blocks, BC1_BLOCK_SIZE, EncodeBC1Block);
+	}
+
+	void EncodeBC7(const uint8_t* pixels, uint32_t width, uint32_t height, uint8_t* blocks)
+	{
+		EncodeBlocks(pixels, width, height, blocks, BC7_BLOCK_SIZE, EncodeBC7Block);
+	}
+
+	uint32_t GetBlockCount(uint32_t texels)
+	{
+		return (texels + BLOCK_DIMENSION - 1) / BLOCK_DIMENSION;
+	}
+}
@@ -0,0 +1,28 @@
+/******************************************************************************
+Copyright (C) 2022 DigiPen Institute of Technology.
+Reproduction or disclosure of this file or its contents without the prior
+written consent of DigiPen Institute of Technology is prohibited.
+File Name:   BlockCompression.h
+Author
+	- sinil.kang	rtd99062@gmail.com
+Creation Date: 12.24.2022
+	header file for BC1 and BC7 texture encoders.
+******************************************************************************/
+#pragma once
+#include <cstdint>
+
+// CPU encoders of 4x4 texel blocks. Quality is traded for speed, since results are cached on the disk.
+	// Pixels are R8G8B8A8, and encoded as they are. (sRGB values stay sRGB)
+namespace BlockCompression
+{
+	constexpr uint32_t BLOCK_DIMENSION = 4;
+	constexpr uint32_t BC1_BLOCK_SIZE = 8;
+	constexpr uint32_t BC7_BLOCK_SIZE = 16;
+
+	// Alpha is ignored. 4 bits per texel.
+	void EncodeBC1(const uint8_t* pixels, uint32_t width, uint32_t height, uint8_t* blocks);
+	// Mode 6 only, which has one subset with RGBA endpoints. 8 bits per texel.
+	void EncodeBC7(const uint8_t* pixels, uint32_t width, uint32_t height, uint8_t* blocks);
+
+	uint32_t GetBlockCount(uint32_t texels);
+}
@@ -10,12 +10,25 @@ Creation Date: 12.19.2022
 ******************************************************************************/
 #include "Texture.h"
 #include <Graphics/Graphics.h>
+#include <iostream>
 Texture::Texture(Graphics* graphics, std::string textureName, std::string texturePath)
-	: Object(textureName), graphics(graphics)
+	: Object(textureName), graphics(graphics), mipLevelCount(0), firstUploadedLevel(0)
 {
 	graphics->CreateTextureImageAndImageView(texturePath, textureImage, textureImageMemory, textureImageView);
 }
 
+Texture::Texture(Graphics* graphics, std::string textureName, const TextureData& texture)
+	: Object(textureName), graphics(graphics), mipLevelCount(static_cast<uint32_t>(texture.mipLevels.size())), firstUploadedLevel(0)
+{
+	graphics->CreateTextureImageAndImageView(texture, textureImage, textureImageMemory, textureImageView);
+}
+
+Texture::Texture(Graphics* graphics, std::string textureName, const TextureData& levels, uint32_t firstLevel, uint32_t width, uint32_t height, uint32_t _mipLevelCount)
+	: Object(textureName), graphics(graphics), mipLevelCount(_mipLevelCount), firstUploadedLevel(firstLevel)
+{
+	graphics->CreateStreamedTextureImage(levels, firstLevel, width, height, mipLevelCount, textureImage, textureImageMemory, textureImageView);
+}
+
 Texture::~Texture()
 {
 	Clean();
@@ -42,6 +55,27 @@ VkImageView Texture::GetImageView()
 
 void Texture::ChangeTexture(std::string newPath)
 {
-	graphics->DestroyTextureImageAndImageView(textureImage, textureImageMemory, textureImageView);
+	// Frames in flight may still sample the old image.
+	graphics->DestroyTextureImageAndImageViewLater(textureImage, textureImageMemory, textureImageView);
 	graphics->CreateTextureImageAndImageView(newPath, textureImage, textureImageMemory, textureImageView);
 }
+
+void Texture::ChangeTexture(const TextureData& newTexture)
+{
+	graphics->DestroyTextureImageAndImageViewLater(textureImage, textureImageMemory, textureImageView);
+	graphics->CreateTextureImageAndImageView(newTexture, textureImage, textureImageMemory, textureImageView);
+	mipLevelCount = static_cast<uint32_t>(newTexture.mipLevels.size());
+	firstUploadedLevel = 0;
+}
+
+void Texture::UploadMipLevels(const TextureData& levels, uint32_t firstLevel)
+{
+	if (firstLevel + levels.mipLevels.size() != firstUploadedLevel)
+	{
+		std::cout << GetName() << ": uploaded levels should end right before level " << firstUploadedLevel << std::endl;
+		return;
+	}
+
+	graphics->UploadTextureMipLevels(levels, firstLevel, mipLevelCount, textureImage, textureImageView);
+	firstUploadedLevel = firstLevel;
+}
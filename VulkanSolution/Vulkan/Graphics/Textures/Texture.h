@@ -13,6 +13,8 @@ Creation Date: 12.19.2022
 #include <Engines/Objects/Object.h>
 #include <vulkan/vulkan.h>
 #include <string>
+#include <Graphics/Allocator/MemoryAllocator.h>
+#include <Graphics/Textures/TextureImporter.h>
 
 class Graphics;
 
@@ -20,6 +22,11 @@ class Texture : public Object
 {
 public:
 	Texture(Graphics* graphics, std::string textureName, std::string texturePath);
+	// Texture decoded already by Graphics::ImportTextures().
+	Texture(Graphics* graphics, std::string textureName, const TextureData& texture);
+	// Streamed texture. The image has the full chain of mipLevelCount levels from width x height,
+		// but only levels, which start from firstLevel and end at the smallest level, are uploaded. Levels in front of them follow by UploadMipLevels().
+	Texture(Graphics* graphics, std::string textureName, const TextureData& levels, uint32_t firstLevel, uint32_t width, uint32_t height, uint32_t mipLevelCount);
 	~Texture();
 
 	bool Init();
@@ -28,11 +35,19 @@ public:
 
 	VkImageView GetImageView();
 
+	// The old image is destroyed after frames in flight using it are completed, so descriptors referring to it should be written again by then.
 	void ChangeTexture(std::string newPath);
+	void ChangeTexture(const TextureData& newTexture);
+	// Upload levels from firstLevel, which end right before the first uploaded level, into the same image.
+		// The image view is replaced, so descriptors referring to it should be written again.
+	void UploadMipLevels(const TextureData& levels, uint32_t firstLevel);
 
 private:
 	Graphics* graphics;
 	VkImage textureImage;
-	VkDeviceMemory textureImageMemory;
+	MemoryAllocation textureImageMemory;
 	VkImageView textureImageView;
+	uint32_t mipLevelCount;
+	// First level the view covers. 0 if every level is uploaded.
+	uint32_t firstUploadedLevel;
 };
\ No newline at end of file
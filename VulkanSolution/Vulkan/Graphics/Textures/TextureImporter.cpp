@@ -0,0 +1,671 @@
+/******************************************************************************
+Copyright (C) 2022 DigiPen Institute of Technology.
+Reproduction or disclosure of this file or its contents without the prior
+written consent of DigiPen Institute of Technology is prohibited.
+File Name:   TextureImporter.cpp
+Author
+	- sinil.kang	rtd99062@gmail.com
+Creation Date: 12.24.2022
+	source file for importing textures with mip chains and block compression.
+******************************************************************************/
+#include "TextureImporter.h"
+#include <Graphics/Textures/BlockCompression.h>
+#include <Engines/CPUProfiler.h>
+#include <stb_image.h>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <filesystem>
+#include <algorithm>
+#include <numeric>	// for std::iota
+#include <execution>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <atomic>
+
+namespace
+{
+	// Increase when the output of the importer changes, so old cache files are not used.
+		// 2: Cache files have KTXorientation, since KTX2 files without it are flipped on load.
+	constexpr uint32_t CACHE_VERSION = 2;
+
+	constexpr uint8_t KTX2_IDENTIFIER[12] = { 0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A };
+	constexpr size_t KTX2_HEADER_SIZE = 80;
+	constexpr size_t KTX2_LEVEL_INDEX_SIZE = 24;
+	// Rows of 2D textures go down by default, which is the opposite of the textures in memory.
+	constexpr char KTX2_ORIENTATION_KEY[] = "KTXorientation";
+	constexpr char KTX2_ORIENTATION_UP[] = "ru";
+
+	// @@ Data format descriptor
+	constexpr uint32_t KHR_DF_MODEL_RGBSDA = 1;
+	constexpr uint32_t KHR_DF_MODEL_BC1A = 128;
+	constexpr uint32_t KHR_DF_MODEL_BC7 = 134;
+	constexpr uint32_t KHR_DF_PRIMARIES_BT709 = 1;
+	constexpr uint32_t KHR_DF_TRANSFER_LINEAR = 1;
+	constexpr uint32_t KHR_DF_TRANSFER_SRGB = 2;
+	constexpr uint32_t KHR_DF_CHANNEL_ALPHA = 15;
+	constexpr uint32_t KHR_DF_SAMPLE_DATATYPE_LINEAR = 0x10;
+	// @@ End of data format descriptor
+
+	struct FormatInfo
+	{
+		// 1 for uncompressed formats.
+		uint32_t blockDimension;
+		uint32_t blockSize;
+		bool isSRGB;
+	};
+
+	bool GetFormatInfo(VkFormat format, FormatInfo& info)
+	{
+		switch (format)
+		{
+		case VK_FORMAT_R8G8B8A8_UNORM:
+			info = { 1, 4, false };
+			return true;
+		case VK_FORMAT_R8G8B8A8_SRGB:
+			info = { 1, 4, true };
+			return true;
+		case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+		case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+			info = { BlockCompression::BLOCK_DIMENSION, BlockCompression::BC1_BLOCK_SIZE, false };
+			return true;
+		case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+		case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+			info = { BlockCompression::BLOCK_DIMENSION, BlockCompression::BC1_BLOCK_SIZE, true };
+			return true;
+		case VK_FORMAT_BC7_UNORM_BLOCK:
+			info = { BlockCompression::BLOCK_DIMENSION, BlockCompression::BC7_BLOCK_SIZE, false };
+			return true;
+		case VK_FORMAT_BC7_SRGB_BLOCK:
+			info = { BlockCompression::BLOCK_DIMENSION, BlockCompression::BC7_BLOCK_SIZE, true };
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	VkDeviceSize GetLevelSize(const FormatInfo& info, uint32_t width, uint32_t height)
+	{
+		const VkDeviceSize blockCountX = (width + info.blockDimension - 1) / info.blockDimension;
+		const VkDeviceSize blockCountY = (height + info.blockDimension - 1) / info.blockDimension;
+		return blockCountX * blockCountY * info.blockSize;
+	}
+
+	// Lay out levels of the given extent in texture.data, without filling them.
+	void AllocateMipLevels(VkFormat format, uint32_t width, uint32_t height, uint32_t levelCount, TextureData& texture)
+	{
+		FormatInfo info;
+		GetFormatInfo(format, info);
+
+		texture.format = format;
+		texture.mipLevels.resize(levelCount);
+		VkDeviceSize offset = 0;
+		for (uint32_t level = 0; level < levelCount; level++)
+		{
+			TextureMipLevel& mipLevel = texture.mipLevels[level];
+			mipLevel.width = std::max(width >> level, 1u);
+			mipLevel.height = std::max(height >> level, 1u);
+			mipLevel.offset = offset;
+			mipLevel.size = GetLevelSize(info, mipLevel.width, mipLevel.height);
+			offset += (mipLevel.size + TextureImporter::LEVEL_ALIGNMENT - 1) / TextureImporter::LEVEL_ALIGNMENT * TextureImporter::LEVEL_ALIGNMENT;
+		}
+		texture.data.assign(static_cast<size_t>(offset), 0);
+	}
+
+	// @@ Color space
+	const std::array<float, 256>& GetSRGBToLinearTable()
+	{
+		static const std::array<float, 256> table = []()
+		{
+			std::array<float, 256> result;
+			for (int i = 0; i < 256; i++)
+			{
+				const float c = i / 255.f;
+				result[i] = (c <= 0.04045f) ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+			}
+			return result;
+		}();
+		return table;
+	}
+
+	uint8_t LinearToSRGB(float linear)
+	{
+		const float c = (linear <= 0.0031308f) ? linear * 12.92f : 1.055f * std::pow(linear, 1.f / 2.4f) - 0.055f;
+		return static_cast<uint8_t>(std::clamp(std::lround(c * 255.f), 0l, 255l));
+	}
+	// @@ End of color space
+
+	void FlipRows(uint8_t* rows, size_t rowSize, uint32_t rowCount)
+	{
+		std::vector<uint8_t> row(rowSize);
+		for (uint32_t y = 0; y < rowCount / 2; y++)
+		{
+			uint8_t* top = rows + rowSize * y;
+			uint8_t* bottom = rows + rowSize * (rowCount - 1 - y);
+			memcpy(row.data(), top, rowSize);
+			memcpy(top, bottom, rowSize);
+			memcpy(bottom, row.data(), rowSize);
+		}
+	}
+
+	// stbi_set_flip_vertically_on_load() is a global state, so images are flipped here to decode them on several threads.
+	void FlipVertically(uint8_t* pixels, uint32_t width, uint32_t height)
+	{
+		FlipRows(pixels, static_cast<size_t>(width) * 4, height);
+	}
+
+	// R8G8B8A8 levels are flipped by rows. BC1 levels are flipped by rows of blocks, and by rows of the indices in each block,
+		// which keeps every texel in its block only if the height is a multiple of the block or within one block. BC7 blocks cannot be flipped without decoding.
+	bool FlipMipLevels(TextureData& texture)
+	{
+		FormatInfo info;
+		GetFormatInfo(texture.format, info);
+		const bool isBC1 = (info.blockDimension > 1 && info.blockSize == BlockCompression::BC1_BLOCK_SIZE);
+		if (info.blockDimension > 1)
+		{
+			const bool isFlippable = isBC1 && std::all_of(texture.mipLevels.begin(), texture.mipLevels.end(), [&](const TextureMipLevel& mipLevel)
+				{
+					return mipLevel.height % info.blockDimension == 0 || mipLevel.height < info.blockDimension;
+				});
+			if (isFlippable == false)
+			{
+				return false;
+			}
+		}
+
+		for (const TextureMipLevel& mipLevel : texture.mipLevels)
+		{
+			uint8_t* levelData = texture.data.data() + mipLevel.offset;
+			const uint32_t blockCountX = (mipLevel.width + info.blockDimension - 1) / info.blockDimension;
+			const uint32_t blockCountY = (mipLevel.height + info.blockDimension - 1) / info.blockDimension;
+			FlipRows(levelData, static_cast<size_t>(blockCountX) * info.blockSize, blockCountY);
+			if (isBC1 == false)
+			{
+				continue;
+			}
+
+			// Two endpoints are followed by a byte of 2 bit indices per row.
+			const uint32_t rowCount = std::min(mipLevel.height, info.blockDimension);
+			for (uint32_t block = 0; block < blockCountX * blockCountY; block++)
+			{
+				uint8_t* indices = levelData + static_cast<size_t>(block) * info.blockSize + 4;
+				std::reverse(indices, indices + rowCount);
+			}
+		}
+		return true;
+	}
+
+	// Key of the cache file. Empty if the source does not exist.
+	std::filesystem::path GetCachePath(const std::filesystem::path& sourcePath)
+	{
+		std::error_code error;
+		const std::filesystem::path absolutePath = std::filesystem::absolute(sourcePath, error);
+		const uintmax_t fileSize = std::filesystem::file_size(sourcePath, error);
+		if (error)
+		{
+			return std::filesystem::path();
+		}
+		const std::filesystem::file_time_type writeTime = std::filesystem::last_write_time(sourcePath, error);
+		if (error)
+		{
+			return std::filesystem::path();
+		}
+
+		std::stringstream key;
+		key << CACHE_VERSION << '|' << absolutePath.generic_string() << '|' << fileSize << '|' << writeTime.time_since_epoch().count();
+
+		// FNV-1a
+		uint64_t hash = 14695981039346656037ull;
+		for (const char c : key.str())
+		{
+			hash ^= static_cast<uint8_t>(c);
+			hash *= 1099511628211ull;
+		}
+
+		std::stringstream fileName;
+		fileName << std::hex << std::setw(16) << std::setfill('0') << hash << ".ktx2";
+		return std::filesystem::path(TextureImporter::CACHE_DIRECTORY) / fileName.str();
+	}
+
+	// @@ KTX2 helpers
+	void Write32(std::vector<uint8_t>& buffer, size_t position, uint32_t value)
+	{
+		memcpy(buffer.data() + position, &value, sizeof(value));
+	}
+
+	void Write64(std::vector<uint8_t>& buffer, size_t position, uint64_t value)
+	{
+		memcpy(buffer.data() + position, &value, sizeof(value));
+	}
+
+	uint32_t Read32(const std::vector<uint8_t>& buffer, size_t position)
+	{
+		uint32_t value;
+		memcpy(&value, buffer.data() + position, sizeof(value));
+		return value;
+	}
+
+	uint64_t Read64(const std::vector<uint8_t>& buffer, size_t position)
+	{
+		uint64_t value;
+		memcpy(&value, buffer.data() + position, sizeof(value));
+		return value;
+	}
+
+	// Second character of KTXorientation is 'u' if rows go up. Rows go down if the key is not found.
+	bool IsOrientedUp(const std::vector<uint8_t>& buffer)
+	{
+		const uint64_t kvdOffset = Read32(buffer, 56);
+		const uint64_t kvdSize = Read32(buffer, 60);
+		if (kvdOffset > buffer.size() || kvdSize > buffer.size() - kvdOffset)
+		{
+			return false;
+		}
+
+		// Each entry is its size, the key and the value both terminated by NUL, and padding to 4 bytes.
+		const size_t keySize = sizeof(KTX2_ORIENTATION_KEY);
+		size_t position = static_cast<size_t>(kvdOffset);
+		const size_t end = static_cast<size_t>(kvdOffset + kvdSize);
+		while (position + 4 <= end)
+		{
+			const size_t entrySize = Read32(buffer, position);
+			position += 4;
+			if (entrySize > end - position)
+			{
+				return false;
+			}
+			if (entrySize > keySize + 1 && memcmp(buffer.data() + position, KTX2_ORIENTATION_KEY, keySize) == 0)
+			{
+				return buffer[position + keySize + 1] == 'u';
+			}
+			position += (entrySize + 3) / 4 * 4;
+		}
+		return false;
+	}
+
+	// Key/value data with KTXorientation only.
+	std::vector<uint8_t> MakeKeyValueData()
+	{
+		const uint32_t entrySize = static_cast<uint32_t>(sizeof(KTX2_ORIENTATION_KEY) + sizeof(KTX2_ORIENTATION_UP));
+		std::vector<uint8_t> data(4 + (entrySize + 3) / 4 * 4, 0);
+		memcpy(data.data(), &entrySize, sizeof(entrySize));
+		memcpy(data.data() + 4, KTX2_ORIENTATION_KEY, sizeof(KTX2_ORIENTATION_KEY));
+		memcpy(data.data() + 4 + sizeof(KTX2_ORIENTATION_KEY), KTX2_ORIENTATION_UP, sizeof(KTX2_ORIENTATION_UP));
+		return data;
+	}
+
+	// Basic data format descriptor of the Khronos Data Format Specification, including the total size in front.
+	std::vector<uint32_t> MakeDataFormatDescriptor(VkFormat format, const FormatInfo& info)
+	{
+		struct Sample
+		{
+			uint32_t bitOffset;
+			uint32_t bitLength;
+			uint32_t channelType;
+			uint32_t upper;
+		};
+		uint32_t colorModel;
+		std::vector<Sample> samples;
+		if (info.blockDimension == 1)
+		{
+			colorModel = KHR_DF_MODEL_RGBSDA;
+			// Alpha is not affected by the transfer function.
+			const uint32_t alphaType = KHR_DF_CHANNEL_ALPHA | (info.isSRGB ? KHR_DF_SAMPLE_DATATYPE_LINEAR : 0);
+			samples = { { 0, 8, 0, 255 }, { 8, 8, 1, 255 }, { 16, 8, 2, 255 }, { 24, 8, alphaType, 255 } };
+		}
+		else
+		{
+			const bool isBC7 = (format == VK_FORMAT_BC7_UNORM_BLOCK || format == VK_FORMAT_BC7_SRGB_BLOCK);
+			colorModel = isBC7 ? KHR_DF_MODEL_BC7 : KHR_DF_MODEL_BC1A;
+			samples = { { 0, info.blockSize * 8, 0, UINT32_MAX } };
+		}
+
+		const uint32_t blockSize = 24 + 16 * static_cast<uint32_t>(samples.size());
+		const uint32_t blockDimension = info.blockDimension - 1;
+		std::vector<uint32_t> words = {
+			4 + blockSize,
+			0,
+			2 | (blockSize << 16),
+			colorModel | (KHR_DF_PRIMARIES_BT709 << 8) | ((info.isSRGB ? KHR_DF_TRANSFER_SRGB : KHR_DF_TRANSFER_LINEAR) << 16),
+			blockDimension | (blockDimension << 8),
+			info.blockSize,
+			0,
+		};
+		for (const Sample& sample : samples)
+		{
+			words.push_back(sample.bitOffset | ((sample.bitLength - 1) << 16) | (sample.channelType << 24));
+			words.push_back(0);
+			words.push_back(0);
+			words.push_back(sample.upper);
+		}
+		return words;
+	}
+	// @@ End of KTX2 helpers
+}
+
+namespace TextureImporter
+{
+	bool Import(const std::string& path, bool compress, TextureData& texture)
+	{
+		PROFILE_SCOPE("TextureImporter::Import");
+		const std::filesystem::path sourcePath(path);
+		if (sourcePath.extension() == ".ktx2")
+		{
+			return LoadKTX2(path, texture);
+		}
+
+		// Textures compressed by artists are preferred to transcoding.
+		std::error_code error;
+		std::filesystem::path ktx2Path = sourcePath;
+		ktx2Path.replace_extension(".ktx2");
+		if (std::filesystem::exists(ktx2Path, error) && LoadKTX2(ktx2Path.string(), texture))
+		{
+			return true;
+		}
+
+		std::filesystem::path cachePath;
+		if (compress)
+		{
+			cachePath = GetCachePath(sourcePath);
+			if (cachePath.empty() == false && std::filesystem::exists(cachePath, error) && LoadKTX2(cachePath.string(), texture))
+			{
+				return true;
+			}
+		}
+
+		int texWidth, texHeight, texChannels;
+		stbi_uc* pixels = stbi_load(path.c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
+		if (pixels == nullptr)
+		{
+			return false;
+		}
+		FlipVertically(pixels, static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight));
+
+		GenerateMipmaps(pixels, static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight), texture);
+		stbi_image_free(pixels);
+
+		if (compress)
+		{
+			Compress(texture);
+
+			std::filesystem::create_directories(CACHE_DIRECTORY, error);
+			if (cachePath.empty() || SaveKTX2(cachePath.string(), texture) == false)
+			{
+				std::cout << "Caching compressed texture has failed! " << path << std::endl;
+			}
+		}
+		return true;
+	}
+
+	void GenerateMipmaps(const uint8_t* pixels, uint32_t width, uint32_t height, TextureData& texture)
+	{
+		AllocateMipLevels(VK_FORMAT_R8G8B8A8_SRGB, width, height, GetMipLevelCount(width, height), texture);
+		memcpy(texture.data.data(), pixels, static_cast<size_t>(texture.mipLevels.front().size));
+
+		const std::array<float, 256>& toLinear = GetSRGBToLinearTable();
+		for (size_t level = 1; level < texture.mipLevels.size(); level++)
+		{
+			const TextureMipLevel& source = texture.mipLevels[level - 1];
+			const TextureMipLevel& destination = texture.mipLevels[level];
+			const uint8_t* sourceTexels = texture.data.data() + source.offset;
+			uint8_t* destinationTexels = texture.data.data() + destination.offset;
+
+			std::vector<uint32_t> rows(destination.height);
+			std::iota(rows.begin(), rows.end(), 0);
+			std::for_each(std::execution::par, rows.begin(), rows.end(), [&](uint32_t y)
+				{
+					// The last row or column of an odd extent is folded into its neighbor.
+					const uint32_t y0 = std::min(2 * y, source.height - 1);
+					const uint32_t y1 = std::min(2 * y + 1, source.height - 1);
+					for (uint32_t x = 0; x < destination.width; x++)
+					{
+						const uint32_t x0 = std::min(2 * x, source.width - 1);
+						const uint32_t x1 = std::min(2 * x + 1, source.width - 1);
+						const uint8_t* quad[4] = {
+							sourceTexels + (static_cast<size_t>(y0) * source.width + x0) * 4,
+							sourceTexels + (static_cast<size_t>(y0) * source.width + x1) * 4,
+							sourceTexels + (static_cast<size_t>(y1) * source.width + x0) * 4,
+							sourceTexels + (static_cast<size_t>(y1) * source.width + x1) * 4,
+						};
+
+						uint8_t* texel = destinationTexels + (static_cast<size_t>(y) * destination.width + x) * 4;
+						for (int c = 0; c < 3; c++)
+						{
+							const float linear = (toLinear[quad[0][c]] + toLinear[quad[1][c]] + toLinear[quad[2][c]] + toLinear[quad[3][c]]) * 0.25f;
+							texel[c] = LinearToSRGB(linear);
+						}
+						texel[3] = static_cast<uint8_t>((quad[0][3] + quad[1][3] + quad[2][3] + quad[3][3] + 2) / 4);
+					}
+				});
+		}
+	}
+
+	void Compress(TextureData& texture)
+	{
+		const TextureMipLevel& baseLevel = texture.mipLevels.front();
+		bool isOpaque = true;
+		for (VkDeviceSize i = 3; i < baseLevel.size; i += 4)
+		{
+			if (texture.data[static_cast<size_t>(baseLevel.offset + i)] != 255)
+			{
+				isOpaque = false;
+				break;
+			}
+		}
+
+		const bool isSRGB = (texture.format == VK_FORMAT_R8G8B8A8_SRGB);
+		VkFormat format;
+		if (isOpaque)
+		{
+			format = isSRGB ? VK_FORMAT_BC1_RGB_SRGB_BLOCK : VK_FORMAT_BC1_RGB_UNORM_BLOCK;
+		}
+		else
+		{
+			format = isSRGB ? VK_FORMAT_BC7_SRGB_BLOCK : VK_FORMAT_BC7_UNORM_BLOCK;
+		}
+
+		TextureData compressed;
+		AllocateMipLevels(format, baseLevel.width, baseLevel.height, static_cast<uint32_t>(texture.mipLevels.size()), compressed);
+		for (size_t level = 0; level < texture.mipLevels.size(); level++)
+		{
+			const TextureMipLevel& source = texture.mipLevels[level];
+			const uint8_t* pixels = texture.data.data() + source.offset;
+			uint8_t* blocks = compressed.data.data() + compressed.mipLevels[level].offset;
+			if (isOpaque)
+			{
+				BlockCompression::EncodeBC1(pixels, source.width, source.height, blocks);
+			}
+			else
+			{
+				BlockCompression::EncodeBC7(pixels, source.width, source.height, blocks);
+			}
+		}
+		texture = std::move(compressed);
+	}
+
+	bool LoadKTX2(const std::string& path, TextureData& texture)
+	{
+		std::ifstream file(path, std::ios::ate | std::ios::binary);
+		if (file.is_open() == false)
+		{
+			return false;
+		}
+		std::vector<uint8_t> buffer(static_cast<size_t>(file.tellg()));
+		file.seekg(0);
+		file.read(reinterpret_cast<char*>(buffer.data()), buffer.size());
+		file.close();
+
+		if (buffer.size() < KTX2_HEADER_SIZE || memcmp(buffer.data(), KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) != 0)
+		{
+			std::cout << "Not a KTX2 file! " << path << std::endl;
+			return false;
+		}
+
+		const VkFormat format = static_cast<VkFormat>(Read32(buffer, 12));
+		const uint32_t width = Read32(buffer, 20);
+		const uint32_t height = Read32(buffer, 24);
+		const uint32_t depth = Read32(buffer, 28);
+		const uint32_t layerCount = Read32(buffer, 32);
+		const uint32_t faceCount = Read32(buffer, 36);
+		// 0 asks the loader to generate mips, which is not supported for compressed formats.
+		const uint32_t levelCount = std::max(Read32(buffer, 40), 1u);
+		const uint32_t supercompressionScheme = Read32(buffer, 44);
+
+		FormatInfo info;
+		if (GetFormatInfo(format, info) == false || width == 0 || height == 0 || depth > 1 || layerCount > 1 || faceCount != 1 || supercompressionScheme != 0
+			|| levelCount > GetMipLevelCount(width, height) || buffer.size() < KTX2_HEADER_SIZE + KTX2_LEVEL_INDEX_SIZE * levelCount)
+		{
+			std::cout << "Unsupported KTX2 file! Only 2D R8G8B8A8, BC1 and BC7 textures without supercompression are supported. " << path << std::endl;
+			return false;
+		}
+
+		AllocateMipLevels(format, width, height, levelCount, texture);
+		for (uint32_t level = 0; level < levelCount; level++)
+		{
+			const size_t indexPosition = KTX2_HEADER_SIZE + KTX2_LEVEL_INDEX_SIZE * level;
+			const uint64_t byteOffset = Read64(buffer, indexPosition);
+			const uint64_t byteLength = Read64(buffer, indexPosition + 8);
+			const TextureMipLevel& mipLevel = texture.mipLevels[level];
+			if (byteLength != mipLevel.size || byteOffset > buffer.size() || byteLength > buffer.size() - byteOffset)
+			{
+				std::cout << "Broken KTX2 file! " << path << std::endl;
+				return false;
+			}
+			memcpy(texture.data.data() + mipLevel.offset, buffer.data() + byteOffset, static_cast<size_t>(byteLength));
+		}
+
+		// Files written by SaveKTX2() go up already. Authored files usually go down, and they are flipped here like decoded images.
+		if (IsOrientedUp(buffer) == false && FlipMipLevels(texture) == false)
+		{
+			std::cout << "Rows of the KTX2 file go down, and its format cannot be flipped! Store it with " << KTX2_ORIENTATION_KEY << " = " << KTX2_ORIENTATION_UP << ". " << path << std::endl;
+			return false;
+		}
+		return true;
+	}
+
+	bool SaveKTX2(const std::string& path, const TextureData& texture)
+	{
+		FormatInfo info;
+		if (GetFormatInfo(texture.format, info) == false || texture.mipLevels.empty())
+		{
+			return false;
+		}
+
+		const uint32_t levelCount = static_cast<uint32_t>(texture.mipLevels.size());
+		const std::vector<uint32_t> dataFormatDescriptor = MakeDataFormatDescriptor(texture.format, info);
+		const size_t dfdOffset = KTX2_HEADER_SIZE + KTX2_LEVEL_INDEX_SIZE * levelCount;
+		const size_t dfdSize = dataFormatDescriptor.size() * sizeof(uint32_t);
+		// Texels are in memory order, so rows go up.
+		const std::vector<uint8_t> keyValueData = MakeKeyValueData();
+		const size_t kvdOffset = dfdOffset + dfdSize;
+
+		// Levels are stored from the smallest one, aligned to the texel block size.
+		size_t position = kvdOffset + keyValueData.size();
+		std::vector<size_t> levelPositions(levelCount);
+		for (uint32_t level = levelCount; level-- > 0;)
+		{
+			position = (position + info.blockSize - 1) / info.blockSize * info.blockSize;
+			levelPositions[level] = position;
+			position += static_cast<size_t>(texture.mipLevels[level].size);
+		}
+
+		std::vector<uint8_t> buffer(position, 0);
+		memcpy(buffer.data(), KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER));
+		Write32(buffer, 12, texture.format);
+		// typeSize
+		Write32(buffer, 16, 1);
+		Write32(buffer, 20, texture.mipLevels.front().width);
+		Write32(buffer, 24, texture.mipLevels.front().height);
+		// depth, layer count
+		Write32(buffer, 28, 0);
+		Write32(buffer, 32, 0);
+		Write32(buffer, 36, 1);
+		Write32(buffer, 40, levelCount);
+		Write32(buffer, 44, 0);
+		Write32(buffer, 48, static_cast<uint32_t>(dfdOffset));
+		Write32(buffer, 52, static_cast<uint32_t>(dfdSize));
+		Write32(buffer, 56, static_cast<uint32_t>(kvdOffset));
+		Write32(buffer, 60, static_cast<uint32_t>(keyValueData.size()));
+		// No supercompression global data.
+		Write64(buffer, 64, 0);
+		Write64(buffer, 72, 0);
+		for (uint32_t level = 0; level < levelCount; level++)
+		{
+			const TextureMipLevel& mipLevel = texture.mipLevels[level];
+			const size_t indexPosition = KTX2_HEADER_SIZE + KTX2_LEVEL_INDEX_SIZE * level;
+			Write64(buffer, indexPosition, levelPositions[level]);
+			Write64(buffer, indexPosition + 8, mipLevel.size);
+			Write64(buffer, indexPosition + 16, mipLevel.size);
+			memcpy(buffer.data() + levelPositions[level], texture.data.data() + mipLevel.offset, static_cast<size_t>(mipLevel.size));
+		}
+		memcpy(buffer.data() + dfdOffset, dataFormatDescriptor.data(), dfdSize);
+		memcpy(buffer.data() + kvdOffset, keyValueData.data(), keyValueData.size());
+
+		// Several threads may save the same texture, and others may load it meanwhile.
+			// Each writes its own temporary file and renames it into place, so a reader never sees a partial file.
+		static std::atomic<uint32_t> saveCount = 0;
+		const std::string temporaryPath = path + ".tmp" + std::to_string(saveCount++);
+		{
+			std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+			if (file.is_open() == false)
+			{
+				return false;
+			}
+			file.write(reinterpret_cast<const char*>(buffer.data()), buffer.size());
+			if (file.good() == false)
+			{
+				file.close();
+				std::error_code error;
+				std::filesystem::remove(temporaryPath, error);
+				return false;
+			}
+		}
+
+		std::error_code error;
+		std::filesystem::rename(temporaryPath, path, error);
+		if (error)
+		{
+			std::filesystem::remove(temporaryPath, error);
+			// The file may be held by another thread which saved the same texture.
+			return std::filesystem::exists(path, error);
+		}
+		return true;
+	}
+
+	uint32_t GetMipLevelCount(uint32_t width, uint32_t height)
+	{
+		uint32_t levelCount = 1;
+		for (uint32_t extent = std::max(width, height); extent > 1; extent >>= 1)
+		{
+			levelCount++;
+		}
+		return levelCount;
+	}
+
+	TextureData ExtractMipLevels(const TextureData& texture, uint32_t firstLevel, uint32_t levelCount)
+	{
+		const TextureMipLevel& baseLevel = texture.mipLevels[firstLevel];
+		levelCount = std::min(levelCount, static_cast<uint32_t>(texture.mipLevels.size()) - firstLevel);
+
+		TextureData result;
+		AllocateMipLevels(texture.format, baseLevel.width, baseLevel.height, levelCount, result);
+		for (uint32_t level = 0; level < levelCount; level++)
+		{
+			const TextureMipLevel& source = texture.mipLevels[firstLevel + level];
+			memcpy(result.data.data() + result.mipLevels[level].offset, texture.data.data() + source.offset, static_cast<size_t>(source.size));
+		}
+		return result;
+	}
+
+	VkDeviceSize GetMipLevelsSize(const TextureData& texture, uint32_t firstLevel)
+	{
+		VkDeviceSize size = 0;
+		for (size_t level = firstLevel; level < texture.mipLevels.size(); level++)
+		{
+			size += texture.mipLevels[level].size;
+		}
+		return size;
+	}
+}
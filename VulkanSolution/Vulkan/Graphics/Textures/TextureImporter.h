@@ -0,0 +1,65 @@
+/******************************************************************************
+Copyright (C) 2022 DigiPen Institute of Technology.
+Reproduction or disclosure of this file or its contents without the prior
+written consent of DigiPen Institute of Technology is prohibited.
+File Name:   TextureImporter.h
+Author
+	- sinil.kang	rtd99062@gmail.com
+Creation Date: 12.24.2022
+	header file for importing textures with mip chains and block compression.
+******************************************************************************/
+#pragma once
+#include <vulkan/vulkan.h>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+struct TextureMipLevel
+{
+	// Offset in TextureData::data. Aligned to TextureImporter::LEVEL_ALIGNMENT.
+	VkDeviceSize offset;
+	VkDeviceSize size;
+	uint32_t width;
+	uint32_t height;
+};
+
+// Texels of every mip level in one array, so they can be staged with a single copy.
+struct TextureData
+{
+	VkFormat format = VK_FORMAT_UNDEFINED;
+	std::vector<TextureMipLevel> mipLevels;
+	std::vector<uint8_t> data;
+};
+
+// Images are flipped vertically on load, since texture coordinates of models start from the bottom.
+	// KTX2 files are flipped as well, unless their KTXorientation says rows go up. Cache files are written after the flip with "ru", so they are never flipped again.
+namespace TextureImporter
+{
+	// Multiple of every texel block size, so each level can be copied from its offset.
+	constexpr VkDeviceSize LEVEL_ALIGNMENT = 16;
+	// Transcoded textures are saved here as KTX2, keyed by the path and the write time of the source.
+	constexpr const char* CACHE_DIRECTORY = "texture_cache";
+
+	// Load a texture with its full mip chain. Safe to call from several threads.
+		// "*.ktx2" or a KTX2 file next to the image with the same name is loaded without decoding.
+		// If compress is true, decoded images are transcoded into BC1 (opaque) or BC7 (with alpha), and cached.
+	bool Import(const std::string& path, bool compress, TextureData& texture);
+
+	// R8G8B8A8_SRGB pixels into a mip chain, filtered by a box filter in linear space.
+	void GenerateMipmaps(const uint8_t* pixels, uint32_t width, uint32_t height, TextureData& texture);
+	// Replace R8G8B8A8 texels of every level with BC1 or BC7 blocks.
+	void Compress(TextureData& texture);
+
+	// Only 2D textures without supercompression in R8G8B8A8, BC1 and BC7 formats are supported.
+		// BC7 files, and BC1 files whose levels cannot be flipped by blocks, should be stored with rows going up.
+	bool LoadKTX2(const std::string& path, TextureData& texture);
+	// Safe to call from several threads with the same path.
+	bool SaveKTX2(const std::string& path, const TextureData& texture);
+
+	uint32_t GetMipLevelCount(uint32_t width, uint32_t height);
+	// Copy of levelCount levels from firstLevel, or of the levels to the smallest one if levelCount is UINT32_MAX.
+		// The smallest level makes a complete chain, which can be uploaded as an image by itself.
+	TextureData ExtractMipLevels(const TextureData& texture, uint32_t firstLevel, uint32_t levelCount = UINT32_MAX);
+	// Bytes of the levels from firstLevel to the smallest one.
+	VkDeviceSize GetMipLevelsSize(const TextureData& texture, uint32_t firstLevel);
+}
@@ -0,0 +1,200 @@
+/******************************************************************************
+Copyright (C) 2022 DigiPen Institute of Technology.
+Reproduction or disclosure of this file or its contents without the prior
+written consent of DigiPen Institute of Technology is prohibited.
+File Name:   TextureStreamer.cpp
+Author
+	- sinil.kang	rtd99062@gmail.com
+Creation Date: 12.24.2022
+	source file for decoding textures in the background and streaming their mips.
+******************************************************************************/
+#include "TextureStreamer.h"
+#include <Graphics/Graphics.h>
+#include <Engines/CPUProfiler.h>
+#include <algorithm>
+#include <numeric>	// for std::iota
+#include <execution>
+#include <chrono>
+
+TextureStreamer::TextureStreamer()
+	: graphics(nullptr), budget(0), residentSize(0), currentRequestID(0)
+{
+}
+
+TextureStreamer::~TextureStreamer()
+{
+	Clean();
+}
+
+void TextureStreamer::Init(Graphics* _graphics, VkDeviceSize _budget)
+{
+	graphics = _graphics;
+	budget = _budget;
+}
+
+void TextureStreamer::Clean()
+{
+	// Images not started yet are skipped.
+	currentRequestID++;
+	for (std::future<void>& task : decodingTasks)
+	{
+		task.wait();
+	}
+	decodingTasks.clear();
+	textures.clear();
+	residentSize = 0;
+}
+
+void TextureStreamer::Request(const std::vector<std::string>& paths)
+{
+	CollectTasks();
+
+	std::lock_guard<std::mutex> lock(mutex);
+	const uint64_t requestID = ++currentRequestID;
+	textures.assign(paths.size(), StreamedTexture());
+	for (size_t i = 0; i < paths.size(); i++)
+	{
+		textures[i].path = paths[i];
+	}
+	residentSize = 0;
+
+	decodingTasks.push_back(std::async(std::launch::async, &TextureStreamer::DecodeTextures, this, requestID, paths));
+}
+
+std::vector<TextureStreamer::TextureUpdate> TextureStreamer::TakeUpdates()
+{
+	CollectTasks();
+
+	std::vector<size_t> decodedTextures;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		for (size_t i = 0; i < textures.size(); i++)
+		{
+			if ((textures[i].isDecoded || textures[i].isFailed) && textures[i].isComplete == false)
+			{
+				decodedTextures.push_back(i);
+			}
+		}
+	}
+
+	std::vector<TextureUpdate> updates;
+	VkDeviceSize uploadedBytes = 0;
+	for (const size_t i : decodedTextures)
+	{
+		StreamedTexture& texture = textures[i];
+		if (texture.isFailed)
+		{
+			const TextureData defaultTexture = graphics->ImportDefaultTexture(texture.path);
+			texture.residentLevel = 0;
+			texture.residentSize = TextureImporter::GetMipLevelsSize(defaultTexture, 0);
+			texture.isComplete = true;
+			residentSize += texture.residentSize;
+			updates.push_back(MakeUpdate(i, defaultTexture, 0, NOT_RESIDENT));
+			continue;
+		}
+
+		// Proxies are small enough to ignore the budget and the upload limit.
+		if (texture.residentLevel == NOT_RESIDENT)
+		{
+			const uint32_t proxyLevel = GetProxyLevel(texture.data);
+			texture.residentLevel = proxyLevel;
+			texture.residentSize = TextureImporter::GetMipLevelsSize(texture.data, proxyLevel);
+			residentSize += texture.residentSize;
+			updates.push_back(MakeUpdate(i, texture.data, proxyLevel, NOT_RESIDENT));
+			if (proxyLevel == 0)
+			{
+				texture.isComplete = true;
+				texture.data = TextureData();
+			}
+			continue;
+		}
+
+		if (uploadedBytes >= UPLOAD_BYTES_PER_UPDATE)
+		{
+			continue;
+		}
+
+		// Largest mip chain fitting in the budget. Resident levels are a part of the chain, so their size is counted once.
+		uint32_t firstLevel = 0;
+		VkDeviceSize size = 0;
+		for (; firstLevel < texture.residentLevel; firstLevel++)
+		{
+			size = TextureImporter::GetMipLevelsSize(texture.data, firstLevel);
+			if (residentSize - texture.residentSize + size <= budget)
+			{
+				break;
+			}
+		}
+
+		// Other textures only take more of the budget, so levels not fitting now never fit. The texture keeps its resident levels.
+		if (firstLevel < texture.residentLevel)
+		{
+			// Resident levels stay in the image, so only the new levels are uploaded.
+			uploadedBytes += size - texture.residentSize;
+			residentSize = residentSize - texture.residentSize + size;
+			updates.push_back(MakeUpdate(i, texture.data, firstLevel, texture.residentLevel));
+			texture.residentLevel = firstLevel;
+			texture.residentSize = size;
+		}
+		texture.isComplete = true;
+		texture.data = TextureData();
+	}
+
+	return updates;
+}
+
+void TextureStreamer::DecodeTextures(uint64_t requestID, std::vector<std::string> paths)
+{
+	PROFILE_FUNCTION();
+	std::vector<size_t> indices(paths.size());
+	std::iota(indices.begin(), indices.end(), 0);
+	std::for_each(std::execution::par, indices.begin(), indices.end(), [&](size_t i)
+		{
+			if (currentRequestID != requestID)
+			{
+				return;
+			}
+
+			TextureData data;
+			const bool isImported = graphics->ImportTexture(paths[i], data);
+
+			std::lock_guard<std::mutex> lock(mutex);
+			if (currentRequestID != requestID)
+			{
+				return;
+			}
+			textures[i].data = std::move(data);
+			textures[i].isDecoded = isImported;
+			textures[i].isFailed = !isImported;
+		});
+}
+
+TextureStreamer::TextureUpdate TextureStreamer::MakeUpdate(size_t index, const TextureData& data, uint32_t firstLevel, uint32_t residentLevel) const
+{
+	TextureUpdate update;
+	update.index = index;
+	update.texture = TextureImporter::ExtractMipLevels(data, firstLevel, (residentLevel == NOT_RESIDENT) ? UINT32_MAX : residentLevel - firstLevel);
+	update.firstLevel = firstLevel;
+	update.width = data.mipLevels.front().width;
+	update.height = data.mipLevels.front().height;
+	update.mipLevelCount = static_cast<uint32_t>(data.mipLevels.size());
+	return update;
+}
+
+uint32_t TextureStreamer::GetProxyLevel(const TextureData& texture) const
+{
+	uint32_t level = 0;
+	while (level + 1 < texture.mipLevels.size() && std::max(texture.mipLevels[level].width, texture.mipLevels[level].height) > PROXY_SIZE)
+	{
+		level++;
+	}
+	return level;
+}
+
+void TextureStreamer::CollectTasks()
+{
+	decodingTasks.erase(std::remove_if(decodingTasks.begin(), decodingTasks.end(), [](const std::future<void>& task)
+		{
+			return task.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+		}), decodingTasks.end());
+}
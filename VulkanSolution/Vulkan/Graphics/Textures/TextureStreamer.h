@@ -0,0 +1,95 @@
+/******************************************************************************
+Copyright (C) 2022 DigiPen Institute of Technology.
+Reproduction or disclosure of this file or its contents without the prior
+written consent of DigiPen Institute of Technology is prohibited.
+File Name:   TextureStreamer.h
+Author
+	- sinil.kang	rtd99062@gmail.com
+Creation Date: 12.24.2022
+	header file for decoding textures in the background and streaming their mips.
+******************************************************************************/
+#pragma once
+#include <vulkan/vulkan.h>
+#include <string>
+#include <vector>
+#include <future>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+#include <Graphics/Textures/TextureImporter.h>
+
+class Graphics;
+
+// Images are decoded on worker threads, so the caller keeps drawing with a placeholder until each texture arrives.
+// A decoded texture is first uploaded with its small mips only, which is cheap enough to be shown in the next frame.
+// The rest of the mip chain follows in a later frame, as long as the resident textures stay within the budget.
+	// Resident textures only grow while a request is streamed, so a texture is not checked again after that, and its decoded data is released.
+class TextureStreamer
+{
+public:
+	// Width and height of the largest level of the first upload.
+	static constexpr uint32_t PROXY_SIZE = 64;
+	// Bytes uploaded by one call of TakeUpdates(), except proxies. At least one texture is uploaded anyway.
+	static constexpr VkDeviceSize UPLOAD_BYTES_PER_UPDATE = 16 * 1024 * 1024;
+
+	// Mips of the texture at index, to be uploaded in front of the resident ones.
+	struct TextureUpdate
+	{
+		size_t index;
+		// Levels from firstLevel. The first update of a texture has the levels to the smallest one,
+			// and later ones have the levels up to the resident ones.
+		TextureData texture;
+		uint32_t firstLevel;
+		// Full mip chain, which the image is made with by the first update.
+		uint32_t width;
+		uint32_t height;
+		uint32_t mipLevelCount;
+	};
+public:
+	TextureStreamer();
+	~TextureStreamer();
+
+	void Init(Graphics* graphics, VkDeviceSize budget);
+	// Wait for the decoding threads.
+	void Clean();
+
+	// Start decoding the images. Textures of the previous request are regarded as released.
+	void Request(const std::vector<std::string>& paths);
+	// Main thread only. Failed images are reported here, and replaced with the default image.
+	std::vector<TextureUpdate> TakeUpdates();
+private:
+	static constexpr uint32_t NOT_RESIDENT = UINT32_MAX;
+
+	struct StreamedTexture
+	{
+		std::string path;
+		// Written by a decoding thread before isDecoded is set, and read by the main thread after that.
+		TextureData data;
+		bool isDecoded = false;
+		bool isFailed = false;
+		// First uploaded mip level. 0 if the full mip chain is uploaded.
+		uint32_t residentLevel = NOT_RESIDENT;
+		VkDeviceSize residentSize = 0;
+		// No more levels are uploaded, so data is released.
+		bool isComplete = false;
+	};
+
+	// Update of the levels from firstLevel up to the resident ones, or to the smallest level if nothing is resident.
+	TextureUpdate MakeUpdate(size_t index, const TextureData& data, uint32_t firstLevel, uint32_t residentLevel) const;
+
+	void DecodeTextures(uint64_t requestID, std::vector<std::string> paths);
+	uint32_t GetProxyLevel(const TextureData& texture) const;
+	// Remove finished decoding tasks.
+	void CollectTasks();
+
+	Graphics* graphics;
+	VkDeviceSize budget;
+	VkDeviceSize residentSize;
+
+	std::vector<StreamedTexture> textures;
+	// Results of an old request are dropped by decoding threads.
+	std::atomic<uint64_t> currentRequestID;
+	std::vector<std::future<void>> decodingTasks;
+	// Guards textures against decoding threads. Fields only touched by the main thread are not locked.
+	std::mutex mutex;
+};
@@ -0,0 +1,399 @@
+/******************************************************************************
+Copyright (C) 2022 DigiPen Institute of Technology.
+Reproduction or disclosure of this file or its contents without the prior
+written consent of DigiPen Institute of Technology is prohibited.
+File Name:   UploadQueue.cpp
+Author
+	- sinil.kang	rtd99062@gmail.com
+Creation Date: 12.24.2022
+	source file for asynchronous uploads on the transfer queue.
+******************************************************************************/
+#include <iostream>
+#include <algorithm>
+#include "UploadQueue.h"
+#include <Helper/VulkanHelper.h>
+
+UploadQueue::UploadQueue()
+	: device(VK_NULL_HANDLE), memoryAllocator(nullptr), queueFamily(), queue(VK_NULL_HANDLE), commandPool(VK_NULL_HANDLE), timelineSemaphore(VK_NULL_HANDLE), useTimelineSemaphore(false), lastSubmittedValue(0), submitCount(0),
+	stagingRing(), stagingRingData(nullptr), stagingAlignment(1), stagingRingHead(0), stagingRingUsed(0), recordingBatch(), hasCommands(false), pendingBatches(), freeCommandBuffers(), mutex()
+{
+}
+
+UploadQueue::~UploadQueue()
+{
+}
+
+bool UploadQueue::Init(VkDevice _device, DeviceMemoryAllocator* _memoryAllocator, uint32_t _queueFamily, VkQueue _queue, bool _useTimelineSemaphore, VkDeviceSize _stagingAlignment)
+{
+	device = _device;
+	memoryAllocator = _memoryAllocator;
+	queueFamily = _queueFamily;
+	queue = _queue;
+	useTimelineSemaphore = _useTimelineSemaphore;
+	stagingAlignment = std::max<VkDeviceSize>(_stagingAlignment, 1);
+
+	VkCommandPoolCreateInfo poolCreateInfo{};
+	poolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolCreateInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT | VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+	poolCreateInfo.queueFamilyIndex = queueFamily;
+	if (VulkanHelper::VkCheck(vkCreateCommandPool(device, &poolCreateInfo, nullptr, &commandPool), "Creating upload command pool has failed!") != VK_SUCCESS)
+	{
+		return false;
+	}
+
+	if (useTimelineSemaphore)
+	{
+		VkSemaphoreTypeCreateInfo typeCreateInfo{};
+		typeCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+		typeCreateInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+		typeCreateInfo.initialValue = 0;
+
+		VkSemaphoreCreateInfo semaphoreCreateInfo{};
+		semaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+		semaphoreCreateInfo.pNext = &typeCreateInfo;
+		if (VulkanHelper::VkCheck(vkCreateSemaphore(device, &semaphoreCreateInfo, nullptr, &timelineSemaphore), "Creating upload timeline semaphore has failed!") != VK_SUCCESS)
+		{
+			return false;
+		}
+	}
+	lastSubmittedValue = 0;
+	submitCount = 0;
+
+	// The ring is mapped by the allocator while it lives.
+	if (CreateStagingBuffer(STAGING_RING_SIZE, stagingRing) == false)
+	{
+		return false;
+	}
+	stagingRingData = static_cast<char*>(stagingRing.memory.mappedData);
+	stagingRingHead = 0;
+	stagingRingUsed = 0;
+
+	return true;
+}
+
+void UploadQueue::Clean()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	for (Batch& batch : pendingBatches)
+	{
+		ReleaseBatch(batch);
+	}
+	pendingBatches.clear();
+	if (recordingBatch.commandBuffer != VK_NULL_HANDLE)
+	{
+		vkEndCommandBuffer(recordingBatch.commandBuffer);
+	}
+	ReleaseBatch(recordingBatch);
+	hasCommands = false;
+
+	vkDestroyBuffer(device, stagingRing.buffer, nullptr);
+	memoryAllocator->Free(stagingRing.memory);
+	stagingRing = StagingBuffer();
+	stagingRingData = nullptr;
+
+	// Destroying the pool frees every command buffer allocated from it.
+	vkDestroyCommandPool(device, commandPool, nullptr);
+	freeCommandBuffers.clear();
+	vkDestroySemaphore(device, timelineSemaphore, nullptr);
+	commandPool = VK_NULL_HANDLE;
+	timelineSemaphore = VK_NULL_HANDLE;
+}
+
+VkCommandBuffer UploadQueue::BeginRecording()
+{
+	mutex.lock();
+
+	if (recordingBatch.commandBuffer == VK_NULL_HANDLE)
+	{
+		BeginBatch();
+	}
+	hasCommands = true;
+	return recordingBatch.commandBuffer;
+}
+
+VkCommandBuffer UploadQueue::BeginRecording(VkDeviceSize stagingSize, StagingRegion& staging)
+{
+	mutex.lock();
+
+	if (stagingSize > STAGING_RING_SIZE)
+	{
+		// Rare, so a buffer only for the data is fine.
+		StagingBuffer stagingBuffer;
+		if (CreateStagingBuffer(stagingSize, stagingBuffer) == false)
+		{
+			std::cout << "Staging " << stagingSize << " bytes has failed!" << std::endl;
+			staging = StagingRegion();
+			mutex.unlock();
+			return VK_NULL_HANDLE;
+		}
+		recordingBatch.stagingBuffers.push_back(stagingBuffer);
+		staging.buffer = stagingBuffer.buffer;
+		staging.offset = 0;
+		staging.mappedData = stagingBuffer.memory.mappedData;
+	}
+	else
+	{
+		VkDeviceSize offset;
+		while (AllocateFromRing(stagingSize, offset) == false)
+		{
+			// Space is given back in submission order, so the current batch goes first.
+			if (hasCommands)
+			{
+				SubmitBatch();
+			}
+			else
+			{
+				WaitOldestBatch();
+			}
+		}
+		staging.buffer = stagingRing.buffer;
+		staging.offset = offset;
+		staging.mappedData = stagingRingData + offset;
+	}
+
+	if (recordingBatch.commandBuffer == VK_NULL_HANDLE)
+	{
+		BeginBatch();
+	}
+	hasCommands = true;
+	return recordingBatch.commandBuffer;
+}
+
+void UploadQueue::EndRecording()
+{
+	mutex.unlock();
+}
+
+uint64_t UploadQueue::Submit()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	return SubmitBatch();
+}
+
+uint64_t UploadQueue::SubmitBatch()
+{
+	if (hasCommands == false)
+	{
+		return lastSubmittedValue;
+	}
+
+	VulkanHelper::VkCheck(vkEndCommandBuffer(recordingBatch.commandBuffer), "Ending upload command buffer has failed!");
+
+	const uint64_t signalValue = lastSubmittedValue + 1;
+
+	VkTimelineSemaphoreSubmitInfo timelineSubmitInfo{};
+	timelineSubmitInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+	timelineSubmitInfo.signalSemaphoreValueCount = 1;
+	timelineSubmitInfo.pSignalSemaphoreValues = &signalValue;
+
+	VkSubmitInfo submitInfo{};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &recordingBatch.commandBuffer;
+	if (useTimelineSemaphore)
+	{
+		submitInfo.pNext = &timelineSubmitInfo;
+		submitInfo.signalSemaphoreCount = 1;
+		submitInfo.pSignalSemaphores = &timelineSemaphore;
+	}
+	VulkanHelper::VkCheck(vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE), "Submitting upload queue has failed!");
+	lastSubmittedValue = signalValue;
+	submitCount++;
+
+	if (useTimelineSemaphore)
+	{
+		recordingBatch.timelineValue = signalValue;
+		pendingBatches.push_back(std::move(recordingBatch));
+	}
+	else
+	{
+		// Without timeline semaphores, draws cannot wait for the upload on the GPU.
+		vkQueueWaitIdle(queue);
+		ReleaseBatch(recordingBatch);
+	}
+	recordingBatch = Batch();
+	hasCommands = false;
+
+	return signalValue;
+}
+
+void UploadQueue::CollectGarbage()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	if (pendingBatches.empty())
+	{
+		return;
+	}
+
+	const uint64_t completedValue = GetCompletedValue();
+	size_t completedCount = 0;
+	while (completedCount < pendingBatches.size() && pendingBatches[completedCount].timelineValue <= completedValue)
+	{
+		ReleaseBatch(pendingBatches[completedCount]);
+		completedCount++;
+	}
+	pendingBatches.erase(pendingBatches.begin(), pendingBatches.begin() + completedCount);
+}
+
+VkSemaphore UploadQueue::GetTimelineSemaphore()
+{
+	return timelineSemaphore;
+}
+
+uint64_t UploadQueue::GetLastSubmittedValue()
+{
+	return lastSubmittedValue;
+}
+
+bool UploadQueue::IsTimelineSemaphoreUsed()
+{
+	return useTimelineSemaphore;
+}
+
+uint32_t UploadQueue::GetQueueFamily()
+{
+	return queueFamily;
+}
+
+uint32_t UploadQueue::GetSubmitCount()
+{
+	return submitCount;
+}
+
+void UploadQueue::BeginBatch()
+{
+	if (freeCommandBuffers.empty())
+	{
+		VkCommandBufferAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		allocInfo.commandPool = commandPool;
+		allocInfo.commandBufferCount = 1;
+		VulkanHelper::VkCheck(vkAllocateCommandBuffers(device, &allocInfo, &recordingBatch.commandBuffer), "Allocating upload command buffer has failed!");
+	}
+	else
+	{
+		recordingBatch.commandBuffer = freeCommandBuffers.back();
+		freeCommandBuffers.pop_back();
+		vkResetCommandBuffer(recordingBatch.commandBuffer, 0);
+	}
+
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	VulkanHelper::VkCheck(vkBeginCommandBuffer(recordingBatch.commandBuffer, &beginInfo), "Beginning upload command buffer has failed!");
+}
+
+void UploadQueue::ReleaseBatch(Batch& batch)
+{
+	for (StagingBuffer& stagingBuffer : batch.stagingBuffers)
+	{
+		vkDestroyBuffer(device, stagingBuffer.buffer, nullptr);
+		memoryAllocator->Free(stagingBuffer.memory);
+	}
+	batch.stagingBuffers.clear();
+
+	// Batches are released in submission order, which is the order they took the ring.
+	stagingRingUsed -= batch.stagingRingBytes;
+	batch.stagingRingBytes = 0;
+	if (stagingRingUsed == 0)
+	{
+		stagingRingHead = 0;
+	}
+
+	if (batch.commandBuffer != VK_NULL_HANDLE)
+	{
+		freeCommandBuffers.push_back(batch.commandBuffer);
+		batch.commandBuffer = VK_NULL_HANDLE;
+	}
+}
+
+void UploadQueue::WaitOldestBatch()
+{
+	if (pendingBatches.empty())
+	{
+		return;
+	}
+
+	Batch& oldestBatch = pendingBatches.front();
+	VkSemaphoreWaitInfo waitInfo{};
+	waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+	waitInfo.semaphoreCount = 1;
+	waitInfo.pSemaphores = &timelineSemaphore;
+	waitInfo.pValues = &oldestBatch.timelineValue;
+	VulkanHelper::VkCheck(vkWaitSemaphores(device, &waitInfo, UINT64_MAX), "Waiting upload timeline semaphore has failed!");
+
+	ReleaseBatch(oldestBatch);
+	pendingBatches.erase(pendingBatches.begin());
+}
+
+uint64_t UploadQueue::GetCompletedValue()
+{
+	uint64_t value = 0;
+	vkGetSemaphoreCounterValue(device, timelineSemaphore, &value);
+	return value;
+}
+
+bool UploadQueue::AllocateFromRing(VkDeviceSize size, VkDeviceSize& offset)
+{
+	if (stagingRingUsed == 0)
+	{
+		stagingRingHead = 0;
+	}
+
+	// Used bytes are always right behind the head, so free bytes start at the head.
+	offset = (stagingRingHead + stagingAlignment - 1) / stagingAlignment * stagingAlignment;
+	VkDeviceSize consumed = offset + size - stagingRingHead;
+	if (offset + size > STAGING_RING_SIZE)
+	{
+		// Data is not split, so skip the end of the ring.
+		offset = 0;
+		consumed = STAGING_RING_SIZE - stagingRingHead + size;
+	}
+	if (stagingRingUsed + consumed > STAGING_RING_SIZE)
+	{
+		return false;
+	}
+
+	stagingRingHead = offset + size;
+	stagingRingUsed += consumed;
+	recordingBatch.stagingRingBytes += consumed;
+	return true;
+}
+
+bool UploadQueue::CreateStagingBuffer(VkDeviceSize size, StagingBuffer& stagingBuffer)
+{
+	VkBufferCreateInfo bufferInfo{};
+	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferInfo.size = size;
+	bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+	// Only the upload queue reads it.
+	bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	if (VulkanHelper::VkCheck(vkCreateBuffer(device, &bufferInfo, nullptr, &stagingBuffer.buffer), "Creating staging buffer has failed!") != VK_SUCCESS)
+	{
+		return false;
+	}
+
+	VkMemoryRequirements memRequirements;
+	vkGetBufferMemoryRequirements(device, stagingBuffer.buffer, &memRequirements);
+	if (memoryAllocator->Allocate(memRequirements, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, MemoryResourceType::Buffer, MemoryLifetime::Staging, stagingBuffer.memory) == false)
+	{
+		std::cout << "Allocating staging buffer memory has failed!" << std::endl;
+		vkDestroyBuffer(device, stagingBuffer.buffer, nullptr);
+		stagingBuffer.buffer = VK_NULL_HANDLE;
+		return false;
+	}
+	if (stagingBuffer.memory.mappedData == nullptr)
+	{
+		std::cout << "Staging buffer memory is not mapped!" << std::endl;
+		memoryAllocator->Free(stagingBuffer.memory);
+		vkDestroyBuffer(device, stagingBuffer.buffer, nullptr);
+		stagingBuffer.buffer = VK_NULL_HANDLE;
+		return false;
+	}
+	vkBindBufferMemory(device, stagingBuffer.buffer, stagingBuffer.memory.memory, stagingBuffer.memory.offset);
+	return true;
+}
@@ -0,0 +1,115 @@
+/******************************************************************************
+Copyright (C) 2022 DigiPen Institute of Technology.
+Reproduction or disclosure of this file or its contents without the prior
+written consent of DigiPen Institute of Technology is prohibited.
+File Name:   UploadQueue.h
+Author
+	- sinil.kang	rtd99062@gmail.com
+Creation Date: 12.24.2022
+	header file for asynchronous uploads on the transfer queue.
+******************************************************************************/
+#pragma once
+#include <vector>
+#include <mutex>
+#include <vulkan/vulkan.h>
+#include <Graphics/Allocator/MemoryAllocator.h>
+
+// Copies and layout transitions of a frame are recorded into one command buffer and submitted at once.
+// A submission signals the next value of a timeline semaphore, and draws wait on the last signaled value on the GPU,
+	// so the CPU never waits for an upload.
+// Source data is staged in a persistent ring buffer. Space used by a batch is given back when the batch is completed.
+class UploadQueue
+{
+public:
+	static constexpr VkDeviceSize STAGING_RING_SIZE = 32ull * 1024 * 1024;
+public:
+	// Region of the staging ring reserved for an upload. Copy from buffer at offset.
+	struct StagingRegion
+	{
+		VkBuffer buffer = VK_NULL_HANDLE;
+		VkDeviceSize offset = 0;
+		void* mappedData = nullptr;
+	};
+public:
+	UploadQueue();
+	~UploadQueue();
+
+	// If timeline semaphores are not supported, Submit() waits for the queue instead.
+		// stagingAlignment should satisfy bufferOffset of vkCmdCopyBufferToImage.
+	bool Init(VkDevice device, DeviceMemoryAllocator* memoryAllocator, uint32_t queueFamily, VkQueue queue, bool useTimelineSemaphore, VkDeviceSize stagingAlignment);
+	// Device should be idle.
+	void Clean();
+
+	// Return the command buffer of the current batch. Commands recorded until Submit() are submitted together.
+		// Lock is held until EndRecording(), so uploads from several threads are not interleaved.
+	VkCommandBuffer BeginRecording();
+	// Same as above, and reserve stagingSize bytes of staging memory for the commands.
+		// If the ring is full, the current batch is submitted and the CPU waits for the oldest batch.
+		// Data larger than the ring gets its own staging buffer. If it cannot be made, VK_NULL_HANDLE is returned without holding the lock,
+		// and EndRecording() should not be called.
+	VkCommandBuffer BeginRecording(VkDeviceSize stagingSize, StagingRegion& staging);
+	void EndRecording();
+
+	// Submit the current batch if there are recorded commands. Return the timeline value signaled by the batch.
+	uint64_t Submit();
+	// Free staging buffers and command buffers of completed batches.
+	void CollectGarbage();
+
+	// Semaphore and value draws should wait on. Value 0 means nothing has been uploaded yet.
+	VkSemaphore GetTimelineSemaphore();
+	uint64_t GetLastSubmittedValue();
+	bool IsTimelineSemaphoreUsed();
+	uint32_t GetQueueFamily();
+	// Number of submissions so far. Useful to check uploads are batched.
+	uint32_t GetSubmitCount();
+private:
+	struct StagingBuffer
+	{
+		VkBuffer buffer;
+		MemoryAllocation memory;
+	};
+	struct Batch
+	{
+		VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+		// 0 while recording.
+		uint64_t timelineValue = 0;
+		// Bytes of the staging ring used by the batch, including padding and the skipped end of the ring.
+		VkDeviceSize stagingRingBytes = 0;
+		// Only for data larger than the staging ring.
+		std::vector<StagingBuffer> stagingBuffers;
+	};
+
+	// Functions below are called with the lock held.
+	void BeginBatch();
+	uint64_t SubmitBatch();
+	void ReleaseBatch(Batch& batch);
+	// Wait until the oldest submitted batch is completed, and release it.
+	void WaitOldestBatch();
+	uint64_t GetCompletedValue();
+	bool AllocateFromRing(VkDeviceSize size, VkDeviceSize& offset);
+	bool CreateStagingBuffer(VkDeviceSize size, StagingBuffer& stagingBuffer);
+
+	VkDevice device;
+	DeviceMemoryAllocator* memoryAllocator;
+	uint32_t queueFamily;
+	VkQueue queue;
+	VkCommandPool commandPool;
+	VkSemaphore timelineSemaphore;
+	bool useTimelineSemaphore;
+	uint64_t lastSubmittedValue;
+	uint32_t submitCount;
+
+	StagingBuffer stagingRing;
+	char* stagingRingData;
+	VkDeviceSize stagingAlignment;
+	// Next free byte of the ring, and bytes in use behind it.
+	VkDeviceSize stagingRingHead;
+	VkDeviceSize stagingRingUsed;
+
+	Batch recordingBatch;
+	bool hasCommands;
+	// Submitted batches in timeline order.
+	std::vector<Batch> pendingBatches;
+	std::vector<VkCommandBuffer> freeCommandBuffers;
+	std::mutex mutex;
+};
@@ -15,10 +15,13 @@ Creation Date: 10.06.2022
 #include "ImGUI/imgui.h"
 #include "ImGUI/backends/imgui_impl_vulkan.h"
 #include <xutility>
+#include <cfloat>
 #include "Engines/Window.h"
 #include "Graphics/Model/Model.h"
 #include <Graphics/Structures/Structs.h>
 #include <Engines/Objects/HairBone.h>
+#include <Graphics/Allocator/MemoryAllocator.h>
+#include <Graphics/Profiling/GPUProfiler.h>
 
 VkDescriptorPool imguiDescriptorPool{ VK_NULL_HANDLE };
 VkDevice guiDevice;
@@ -84,7 +87,17 @@ namespace
     bool* runRealtime;
     bool* proceedFrame;
 
+    bool* flagMakeClothInSphere = nullptr;
+
     bool* cleanBones;
+
+    DeviceMemoryAllocator* memoryAllocator = nullptr;
+
+    GPUProfiler* gpuProfiler = nullptr;
+    // Number of the latest frames shown in the graphs.
+    constexpr int GPU_TIMING_GRAPH_FRAMES = 120;
+    const char* GPU_TIMING_CSV_PATH = "gpuTimings.csv";
+    std::string gpuTimingExportMessage;
 }
 
 namespace MyImGUI
@@ -416,6 +429,10 @@ void MyImGUI::Helper::VertexSelectionSphereManipulator()
         //clickedVertex->boneIDs[*boneIDIndex] = *selectedBone;
         *flagChangeBoneIndexInSphere = true;
     }
+    if (ImGui::Button("Make cloth in sphere"))
+    {
+        *flagMakeClothInSphere = true;
+    }
 }
 
 void MyImGUI::Helper::BlendingWeightsSkeletonSelectionRecursively(int currentBoneIndex, int boneSize, ImGuiTreeNodeFlags baseFlags, bool nodeOpened)
@@ -539,6 +556,16 @@ void MyImGUI::SendConfigInfo(float* _mouseSensitivity)
     mouseSensitivity = _mouseSensitivity;
 }
 
+void MyImGUI::SendMemoryInfo(DeviceMemoryAllocator* _memoryAllocator)
+{
+    memoryAllocator = _memoryAllocator;
+}
+
+void MyImGUI::SendGPUProfilerInfo(GPUProfiler* _gpuProfiler)
+{
+    gpuProfiler = _gpuProfiler;
+}
+
 void MyImGUI::SendHairBoneInfo(HairBone* _hairBone, char* _newBoneName, size_t _boneContainerNameSize, bool* applyingBone, float* _sphereTrans, float min, float max, float* _sphereRadius, int* _boneIDIndex, float* _boneWeight, bool* _flagChange)
 {
     hairBone = _hairBone;
@@ -559,6 +586,11 @@ void MyImGUI::SendPhysicsInfo(bool* _runRealtime, bool* _proceedFrame)
     proceedFrame = _proceedFrame;
 }
 
+void MyImGUI::SendClothInfo(bool* _flagMakeCloth)
+{
+    flagMakeClothInSphere = _flagMakeCloth;
+}
+
 void MyImGUI::UpdateClickedVertexAddress(Vertex* _vertex)
 {
     clickedVertex = _vertex;
@@ -628,7 +660,8 @@ void MyImGUI::UpdateSphereMinMaxRange(float min, float max)
 
 bool MyImGUI::IsMouseOnImGUIWindow()
 {
-    return ImGui::GetIO().WantCaptureMouse;
+    // No context is made in the headless mode.
+    return ImGui::GetCurrentContext() != nullptr && ImGui::GetIO().WantCaptureMouse;
 }
 
 
@@ -695,6 +728,113 @@ void MyImGUI::Helper::Physics()
         }
 
         ImGui::Checkbox("Apply force flag", &Physics::forceApplyFlag);
+
+        ImGui::Separator();
+        ImGui::Checkbox("Sleep", &Physics::sleepFlag);
+        if (Physics::sleepFlag)
+        {
+            ImGui::SliderFloat("Sleep Threshold", &Physics::SleepThreshold, 0.001f, 1.f);
+            ImGui::SliderInt("Sleep Steps", &Physics::SleepStepCount, 1, 300);
+        }
+        ImGui::Checkbox("Physics LOD", &Physics::lodFlag);
+        if (Physics::lodFlag)
+        {
+            ImGui::SliderFloat("LOD Screen Size", &Physics::LODScreenSize, 0.01f, 1.f);
+            ImGui::SliderInt("LOD Max Rate", &Physics::LODMaxRate, 1, 16);
+        }
+        const JiggleChainStats& chainStats = model->GetJiggleChainStats();
+        ImGui::Text("Chains - Active: %d, Sleeping: %d, LOD: %d", chainStats.activeCount, chainStats.sleepingCount, chainStats.lodCount);
+
+        ImGui::Separator();
+        if (model->IsPhysicsRecording())
+        {
+            ImGui::Text("Recording... %d steps", static_cast<int>(model->GetPhysicsRecordedStepCount()));
+            if (ImGui::Button("Stop physics recording"))
+            {
+                model->EndPhysicsRecording();
+            }
+        }
+        else if (ImGui::Button("Record physics to physics.rec"))
+        {
+            model->BeginPhysicsRecording("physics.rec");
+        }
+
+        ImGui::Separator();
+        ColliderSystem& colliderSystem = model->GetColliderSystem();
+        ImGui::Text("Colliders");
+        ImGui::SliderFloat("Stick Radius", &colliderSystem.segmentRadius, 0.f, 1.f);
+        ImGui::SliderFloat("Collision Stiffness", &colliderSystem.stiffness, 1.f, 5000.f);
+        ImGui::SliderFloat("Collision Damping", &colliderSystem.damping, 0.f, 500.f);
+        if (ImGui::Button("Add sphere to the selected bone"))
+        {
+            model->AddCollider(BoneCollider(ColliderType::Sphere, *selectedBone, 1.f));
+        }
+        if (ImGui::Button("Add capsule to the selected bone"))
+        {
+            model->AddCollider(BoneCollider(ColliderType::Capsule, *selectedBone, 1.f, glm::vec3(0.f), glm::vec3(0.f, 1.f, 0.f)));
+        }
+
+        const int colliderCount = static_cast<int>(colliderSystem.GetColliderCount());
+        int removeIndex = -1;
+        for (int i = 0; i < colliderCount; i++)
+        {
+            BoneCollider& collider = colliderSystem.GetCollider(i);
+            ImGui::PushID(i);
+            std::string label = ((collider.type == ColliderType::Sphere) ? "Sphere " : "Capsule ") + std::to_string(i) + " : " + model->GetBoneName(collider.boneID);
+            if (ImGui::TreeNode(label.c_str()))
+            {
+                ImGui::SliderFloat("Radius", &collider.radius, 0.01f, 10.f);
+                ImGui::DragFloat3("Point A", &collider.localPointA.x, 0.01f);
+                if (collider.type == ColliderType::Capsule)
+                {
+                    ImGui::DragFloat3("Point B", &collider.localPointB.x, 0.01f);
+                }
+                if (ImGui::Button("Remove"))
+                {
+                    removeIndex = i;
+                }
+                ImGui::TreePop();
+            }
+            ImGui::PopID();
+        }
+        if (removeIndex >= 0)
+        {
+            model->RemoveCollider(removeIndex);
+        }
+
+        ImGui::Text("Pairs: %d, Contacts: %d", static_cast<int>(colliderSystem.GetPairCount()), static_cast<int>(colliderSystem.GetContacts().size()));
+        ImGui::Text("Collision time: %.3f ms", colliderSystem.GetLastSolveTime());
+
+        ImGui::Separator();
+        ClothSystem& clothSystem = model->GetClothSystem();
+        ImGui::Text("Cloth");
+        ImGui::SliderInt("Substeps", &clothSystem.substepCount, 1, 32);
+        ImGui::SliderFloat("Stretch Compliance", &clothSystem.stretchCompliance, 0.f, 0.01f, "%.5f");
+        ImGui::SliderFloat("Bend Compliance", &clothSystem.bendCompliance, 0.f, 1.f, "%.4f");
+        ImGui::SliderFloat("Cloth Damping", &clothSystem.damping, 0.f, 10.f);
+        ImGui::SliderFloat("Cloth Gravity Scaler", &clothSystem.gravityScaler, 0.f, 20.f);
+        ImGui::SliderFloat("Cloth Thickness", &clothSystem.thickness, 0.f, 0.1f);
+        ImGui::Checkbox("Collide with colliders", &clothSystem.collisionFlag);
+
+        const int patchCount = static_cast<int>(clothSystem.GetPatchCount());
+        int removePatchIndex = -1;
+        for (int i = 0; i < patchCount; i++)
+        {
+            const ClothPatch& patch = clothSystem.GetPatch(i);
+            ImGui::PushID(i);
+            ImGui::Text("Patch %d : mesh %d, %d particles, %d pinned, %d constraints", i, patch.meshIndex, static_cast<int>(patch.GetParticleCount()), static_cast<int>(patch.pinnedParticles.size()), static_cast<int>(patch.constraints.size()));
+            ImGui::SameLine();
+            if (ImGui::Button("Remove"))
+            {
+                removePatchIndex = i;
+            }
+            ImGui::PopID();
+        }
+        if (removePatchIndex >= 0)
+        {
+            clothSystem.RemovePatch(removePatchIndex);
+        }
+        ImGui::Text("Cloth time: %.3f ms", clothSystem.GetLastUpdateTime());
     }
 }
 
@@ -705,5 +845,55 @@ void MyImGUI::Helper::Configuration()
     if (ImGui::CollapsingHeader("Configuration"))
     {
         ImGui::SliderFloat("Mouse Sensitivity", mouseSensitivity, 1.f, 100.f);
+
+        if (memoryAllocator != nullptr && ImGui::TreeNode("Device Memory"))
+        {
+            constexpr float MEGABYTE = 1024.f * 1024.f;
+            const MemoryStatistics statistics = memoryAllocator->GetStatistics();
+            ImGui::Text("vkAllocateMemory objects: %u / %u", statistics.blockCount + statistics.dedicatedCount, memoryAllocator->GetMaxMemoryAllocationCount());
+            ImGui::Text("Blocks: %u, Dedicated: %u", statistics.blockCount, statistics.dedicatedCount);
+            ImGui::Text("Allocations: %u", statistics.allocationCount);
+            ImGui::Text("Used: %.2f MB / Reserved: %.2f MB", statistics.usedBytes / MEGABYTE, statistics.reservedBytes / MEGABYTE);
+            ImGui::Text("Largest free range: %.2f MB", statistics.largestFreeRange / MEGABYTE);
+            ImGui::Text("Fragmentation: %.1f%%", statistics.fragmentation * 100.f);
+            ImGui::TreePop();
+        }
+
+        if (gpuProfiler != nullptr && ImGui::TreeNode("GPU Timings"))
+        {
+            if (gpuProfiler->IsSupported() == false)
+            {
+                ImGui::Text("Timestamps are not supported by the queue.");
+            }
+            else
+            {
+                const std::deque<GPUProfiler::FrameResult>& history = gpuProfiler->GetHistory();
+                const size_t firstFrame = history.size() - std::min(history.size(), static_cast<size_t>(GPU_TIMING_GRAPH_FRAMES));
+                std::vector<float> values;
+                for (uint32_t region = 0; region < GPUProfiler::REGION_COUNT; region++)
+                {
+                    // Frames where the region is not recorded are shown as 0.
+                    values.clear();
+                    for (size_t i = firstFrame; i < history.size(); i++)
+                    {
+                        values.push_back(static_cast<float>(std::max(history[i].milliseconds[region], 0.0)));
+                    }
+                    char overlay[32];
+                    snprintf(overlay, sizeof(overlay), "%.3f ms", values.empty() ? 0.f : values.back());
+                    ImGui::PlotLines(GPUProfiler::GetRegionName(static_cast<GPUProfiler::Region>(region)), values.data(), static_cast<int>(values.size()), 0, overlay, 0.f, FLT_MAX, ImVec2(0.f, 40.f));
+                }
+
+                if (ImGui::Button("Export CSV"))
+                {
+                    gpuTimingExportMessage = gpuProfiler->ExportCSV(GPU_TIMING_CSV_PATH) ? std::string("Written to ") + GPU_TIMING_CSV_PATH : std::string("Failed to write ") + GPU_TIMING_CSV_PATH;
+                }
+                if (gpuTimingExportMessage.empty() == false)
+                {
+                    ImGui::SameLine();
+                    ImGui::Text("%s", gpuTimingExportMessage.c_str());
+                }
+            }
+            ImGui::TreePop();
+        }
     }
 }
@@ -16,6 +16,8 @@ struct Vertex;
 struct GLFWwindow;
 class Model;
 class HairBone;
+class DeviceMemoryAllocator;
+class GPUProfiler;
 
 namespace MyImGUI
 {
@@ -28,8 +30,11 @@ namespace MyImGUI
     void SendSkeletonInfo(bool* showSkeletonFlag, bool* blendingWeightMode, int* selectedBone, bool* cleanBoneFlag);
     void SendAnimationInfo(float* worldTimer, bool* bindPoseFlag, bool* playAnimation);
     void SendConfigInfo(float* mouseSensitivity);
+    void SendMemoryInfo(DeviceMemoryAllocator* memoryAllocator);
+    void SendGPUProfilerInfo(GPUProfiler* gpuProfiler);
     void SendHairBoneInfo(HairBone* hairBone, char* newBoneName, size_t boneContainerNameSize, bool* applyingBone, float* sphereTrans, float min, float max, float* sphereRadius, int* boneIDIndex, float* boneWeight, bool* flagChange);
     void SendPhysicsInfo(bool* runRealtime, bool* proceedFrame);
+    void SendClothInfo(bool* flagMakeCloth);
 
     void UpdateClickedVertexAddress(Vertex* vertex);
     void UpdateAnimationNameList();
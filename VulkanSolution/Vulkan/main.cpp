@@ -11,12 +11,97 @@ Creation Date: 06.08.2021
 #include "GLMath.h"
 
 #include <iostream>
+#include <string>
 
 #include "Engines/Engine.h"
 #include "Engines/Timer.h"
+#include "Engines/CPUProfiler.h"
+#include "Graphics/Structures/Collider.h"
+#include "Graphics/Model/PhysicsRecorder.h"
 
-int main()
+namespace
 {
+	// Positive decimal number without any other character.
+	bool ParsePositive(const char* argument, uint32_t& value)
+	{
+		const std::string text(argument);
+		if (text.empty() || text.size() > 9 || text.find_first_not_of("0123456789") != std::string::npos)
+		{
+			return false;
+		}
+		value = static_cast<uint32_t>(std::stoul(text));
+		return value > 0;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	// Headless collider benchmark
+		// --collider-benchmark [colliderCount] [segmentCount] [iterations]
+	if (argc > 1 && std::string(argv[1]) == "--collider-benchmark")
+	{
+		uint32_t colliderCount = 300;
+		uint32_t segmentCount = 300;
+		uint32_t iterations = 1000;
+		if ((argc > 2 && ParsePositive(argv[2], colliderCount) == false) ||
+			(argc > 3 && ParsePositive(argv[3], segmentCount) == false) ||
+			(argc > 4 && ParsePositive(argv[4], iterations) == false))
+		{
+			std::cout << "Usage : --collider-benchmark [colliderCount] [segmentCount] [iterations]" << std::endl;
+			std::cout << "colliderCount, segmentCount and iterations should be positive numbers." << std::endl;
+			return 1;
+		}
+		ColliderSystem::Benchmark(static_cast<int>(colliderCount), static_cast<int>(segmentCount), static_cast<int>(iterations));
+		return 0;
+	}
+
+	// Headless physics replay
+		// --physics-replay <path>
+	if (argc > 2 && std::string(argv[1]) == "--physics-replay")
+	{
+		return PhysicsRecorder::Replay(argv[2]) ? 0 : 1;
+	}
+
+	// Headless offscreen rendering
+		// --headless [frameCount] [width] [height] [timingPath] [imagePath] [deviceName]
+	if (argc > 1 && std::string(argv[1]) == "--headless")
+	{
+		HeadlessSettings settings;
+		if ((argc > 2 && ParsePositive(argv[2], settings.frameCount) == false) ||
+			(argc > 3 && ParsePositive(argv[3], settings.width) == false) ||
+			(argc > 4 && ParsePositive(argv[4], settings.height) == false))
+		{
+			std::cout << "Usage : --headless [frameCount] [width] [height] [timingPath] [imagePath] [deviceName]" << std::endl;
+			std::cout << "frameCount, width and height should be positive numbers." << std::endl;
+			return 1;
+		}
+		settings.timingPath = (argc > 5) ? argv[5] : "";
+		settings.imagePath = (argc > 6) ? argv[6] : "";
+		settings.deviceName = (argc > 7) ? argv[7] : "";
+
+		Engine* engine = new Engine();
+		const bool isSucceed = engine->RunHeadless(settings);
+		delete engine;
+		return isSucceed ? 0 : 1;
+	}
+
+	// CPU trace of the first frames. F9 captures the next frames at any time.
+		// --cpu-trace [frameCount] [path]
+	const bool isCPUTrace = argc > 1 && std::string(argv[1]) == "--cpu-trace";
+	uint32_t traceFrameCount = CPUProfiler::DEFAULT_CAPTURE_FRAMES;
+	if (isCPUTrace && argc > 2 && ParsePositive(argv[2], traceFrameCount) == false)
+	{
+		std::cout << "Usage : --cpu-trace [frameCount] [path]" << std::endl;
+		std::cout << "frameCount should be a positive number." << std::endl;
+		return 1;
+	}
+#ifndef ENABLE_CPU_PROFILER
+	if (isCPUTrace)
+	{
+		std::cout << "CPU profiler is not compiled in this configuration. Use a Debug build for --cpu-trace." << std::endl;
+	}
+#endif
+
 	Engine* engine = new Engine();
 
 	if (engine->Init() == false)
@@ -25,9 +110,15 @@ int main()
 		return 0;
 	}
 
+	if (isCPUTrace)
+	{
+		PROFILE_CAPTURE(traceFrameCount, (argc > 3) ? argv[3] : CPUProfiler::DEFAULT_CAPTURE_PATH);
+	}
+
 	while (engine->IsUpdate())
 	{
 		engine->Update();
+		PROFILE_END_FRAME();
 	}
 
 	engine->Clean();